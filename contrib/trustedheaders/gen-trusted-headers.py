@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+#
+# gen-trusted-headers.py: Build and sign a trusted header table for -trustedheaders.
+#
+# Copyright (c) 2023 The Volkshash Core Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#
+
+import base64
+import getpass
+import hashlib
+import hmac
+import http.client
+import json
+import re
+import struct
+import sys
+
+# Keep in sync with trustedheaders.h
+TRUSTED_HEADERS_MAGIC = b'volkshash-trusted-headers'
+TRUSTED_HEADERS_VERSION = 1
+COMMITMENT_SIZE = 16
+
+# pchMessageStart per network, see chainparams.cpp
+MESSAGE_START = {
+    'main': bytes([0xde, 0xad, 0xf1, 0xb1]),
+    'test': bytes([0xce, 0xa2, 0xca, 0xab]),
+    'dev': bytes([0xe2, 0xca, 0xff, 0xce]),
+    'regtest': bytes([0xfc, 0xc1, 0xb7, 0xdc]),
+}
+
+settings = {}
+
+##### secp256k1 #####
+P = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F
+N = 0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141
+G = (0x79BE667EF9DCBBAC55A06295CE870B07029BFCDB2DCE28D959F2815B16F81798,
+     0x483ADA7726A3C4655DA4FBFC0E1108A8FD17B448A68554199C47D08FFB10D4B8)
+
+def point_add(p1, p2):
+    if p1 is None:
+        return p2
+    if p2 is None:
+        return p1
+    if p1[0] == p2[0] and (p1[1] + p2[1]) % P == 0:
+        return None
+    if p1 == p2:
+        lam = 3 * p1[0] * p1[0] * pow(2 * p1[1], P - 2, P) % P
+    else:
+        lam = (p2[1] - p1[1]) * pow(p2[0] - p1[0], P - 2, P) % P
+    x = (lam * lam - p1[0] - p2[0]) % P
+    return (x, (lam * (p1[0] - x) - p1[1]) % P)
+
+def point_mul(k, point=G):
+    result = None
+    while k:
+        if k & 1:
+            result = point_add(result, point)
+        point = point_add(point, point)
+        k >>= 1
+    return result
+
+def rfc6979_nonce(secret, msghash):
+    """ Deterministic nonce (RFC 6979 with HMAC-SHA256) """
+    x = secret.to_bytes(32, 'big')
+    v = b'\x01' * 32
+    k = b'\x00' * 32
+    k = hmac.new(k, v + b'\x00' + x + msghash, hashlib.sha256).digest()
+    v = hmac.new(k, v, hashlib.sha256).digest()
+    k = hmac.new(k, v + b'\x01' + x + msghash, hashlib.sha256).digest()
+    v = hmac.new(k, v, hashlib.sha256).digest()
+    while True:
+        v = hmac.new(k, v, hashlib.sha256).digest()
+        nonce = int.from_bytes(v, 'big')
+        if 0 < nonce < N:
+            return nonce
+        k = hmac.new(k, v + b'\x00', hashlib.sha256).digest()
+        v = hmac.new(k, v, hashlib.sha256).digest()
+
+def sign_compact(secret, compressed, msghash):
+    """ Compact recoverable signature as created by CHashSigner::SignHash """
+    z = int.from_bytes(msghash, 'big')
+    nonce = rfc6979_nonce(secret, msghash)
+    R = point_mul(nonce)
+    r = R[0] % N
+    s = pow(nonce, N - 2, N) * (z + r * secret) % N
+    recid = (R[1] & 1) | (2 if R[0] >= N else 0)
+    if s > N // 2:
+        s = N - s
+        recid ^= 1
+    header = 27 + recid + (4 if compressed else 0)
+    return bytes([header]) + r.to_bytes(32, 'big') + s.to_bytes(32, 'big')
+
+##### Serialization #####
+B58_DIGITS = '123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz'
+
+def sha256d(data):
+    return hashlib.sha256(hashlib.sha256(data).digest()).digest()
+
+def decode_secret(wif):
+    """ Returns (secret, compressed) for a base58 encoded private key """
+    n = 0
+    for c in wif:
+        n = n * 58 + B58_DIGITS.index(c)
+    data = n.to_bytes((n.bit_length() + 7) // 8, 'big')
+    data = b'\x00' * (len(wif) - len(wif.lstrip('1'))) + data
+    payload, checksum = data[:-4], data[-4:]
+    if sha256d(payload)[:4] != checksum:
+        raise ValueError('invalid private key checksum')
+    if len(payload) == 34 and payload[-1] == 1:
+        return int.from_bytes(payload[1:33], 'big'), True
+    if len(payload) == 33:
+        return int.from_bytes(payload[1:33], 'big'), False
+    raise ValueError('invalid private key length')
+
+def ser_compact_size(n):
+    if n < 253:
+        return struct.pack('<B', n)
+    if n < 0x10000:
+        return struct.pack('<BH', 253, n)
+    if n < 0x100000000:
+        return struct.pack('<BI', 254, n)
+    return struct.pack('<BQ', 255, n)
+
+def ser_string(s):
+    return ser_compact_size(len(s)) + s
+
+def ser_table(message_start, entries):
+    """ Everything covered by the signature, see CTrustedHeaderTable::GetSignatureHash() """
+    data = ser_string(TRUSTED_HEADERS_MAGIC) + struct.pack('<i', TRUSTED_HEADERS_VERSION)
+    data += message_start + ser_compact_size(len(entries))
+    for hash_block, commitment in entries:
+        data += hash_block + commitment
+    return data
+
+##### RPC #####
+class BitcoinRPC:
+    def __init__(self, host, port, username, password):
+        authpair = "%s:%s" % (username, password)
+        self.authhdr = b"Basic " + base64.b64encode(authpair.encode('utf-8'))
+        self.conn = http.client.HTTPConnection(host, port=port, timeout=30)
+
+    def execute(self, obj):
+        self.conn.request('POST', '/', json.dumps(obj),
+                          {'Authorization': self.authhdr,
+                           'Content-type': 'application/json'})
+        resp = self.conn.getresponse()
+        return json.loads(resp.read().decode('utf-8'))
+
+    def call(self, method, params):
+        reply = self.execute({'version': '1.1', 'method': method, 'params': params, 'id': 0})
+        if reply.get('error') is not None:
+            raise RuntimeError('JSON-RPC: %s failed: %s' % (method, reply['error']))
+        return reply['result']
+
+    def call_batch(self, method, params_list):
+        reply = self.execute([{'version': '1.1', 'method': method, 'params': params, 'id': x}
+                              for x, params in enumerate(params_list)])
+        results = [None] * len(params_list)
+        for resp_obj in reply:
+            if resp_obj.get('error') is not None:
+                raise RuntimeError('JSON-RPC: %s %s failed: %s' % (method, params_list[resp_obj['id']], resp_obj['error']))
+            results[resp_obj['id']] = resp_obj['result']
+        return results
+
+def get_entries(rpc, max_height, max_blocks_per_call=1000):
+    """ (block hash, header commitment) pairs for heights 0 to max_height of the active chain """
+    entries = []
+    height = 0
+    while height <= max_height:
+        num_blocks = min(max_height + 1 - height, max_blocks_per_call)
+        hashes = rpc.call_batch('getblockhash', [[height + x] for x in range(num_blocks)])
+        headers = rpc.call_batch('getblockheader', [[h, False] for h in hashes])
+        for hash_hex, header_hex in zip(hashes, headers):
+            header = bytes.fromhex(header_hex)
+            assert len(header) == 80
+            entries.append((bytes.fromhex(hash_hex)[::-1], sha256d(header)[:COMMITMENT_SIZE]))
+        height += num_blocks
+        print('Fetched %d headers' % height, file=sys.stderr)
+    return entries
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print("Usage: gen-trusted-headers.py CONFIG-FILE")
+        sys.exit(1)
+
+    f = open(sys.argv[1])
+    for line in f:
+        # skip comment lines
+        m = re.search(r'^\s*#', line)
+        if m:
+            continue
+
+        # parse key=value lines
+        m = re.search(r'^(\w+)\s*=\s*(\S.*)$', line)
+        if m is None:
+            continue
+        settings[m.group(1)] = m.group(2)
+    f.close()
+
+    if 'host' not in settings:
+        settings['host'] = '127.0.0.1'
+    if 'port' not in settings:
+        settings['port'] = 17375
+    if 'output_file' not in settings:
+        settings['output_file'] = 'trustedheaders.dat'
+    if 'rpcuser' not in settings or 'rpcpassword' not in settings:
+        print("Missing username and/or password in cfg file", file=sys.stderr)
+        sys.exit(1)
+    if 'max_height' not in settings:
+        print("Missing max_height in cfg file", file=sys.stderr)
+        sys.exit(1)
+    if 'spork_key' not in settings:
+        settings['spork_key'] = getpass.getpass('Spork private key: ')
+
+    settings['port'] = int(settings['port'])
+    settings['max_height'] = int(settings['max_height'])
+
+    secret, compressed = decode_secret(settings['spork_key'].strip())
+
+    rpc = BitcoinRPC(settings['host'], settings['port'],
+                     settings['rpcuser'], settings['rpcpassword'])
+    chain = rpc.call('getblockchaininfo', [])['chain']
+    network = 'dev' if chain.startswith('dev') else chain
+    if network not in MESSAGE_START:
+        print("Unknown network %s" % chain, file=sys.stderr)
+        sys.exit(1)
+
+    entries = get_entries(rpc, settings['max_height'])
+    data = ser_table(MESSAGE_START[network], entries)
+    sig = sign_compact(secret, compressed, sha256d(data))
+
+    with open(settings['output_file'], 'wb') as fileout:
+        fileout.write(data + ser_string(sig))
+    print('Wrote %d entries up to block %s to %s' % (len(entries), entries[-1][0][::-1].hex(), settings['output_file']), file=sys.stderr)
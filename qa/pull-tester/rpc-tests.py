@@ -138,6 +138,7 @@ testScripts = [
     'reindex.py',
     # vv Tests less than 30s vv
     'mempool_resurrect_test.py',
+    'mempool_persist.py',
     'txn_doublespend.py --mineblock',
     'txn_clone.py',
     'getchaintips.py',
@@ -171,6 +172,9 @@ testScripts = [
     'listsinceblock.py',
     'p2p-leaktests.py',
     'p2p-compactblocks.py',
+    'p2p-txreconciliation.py',
+    'p2p-blockdownload.py', # NOTE: needs volkshash_hash to pass
+    'getmemoryinfo.py',
     'sporks.py',
 ]
 if ENABLE_ZMQ:
@@ -304,6 +304,9 @@ class DIP3Test(BitcoinTestFramework):
         for mn in mns_protx:
             self.test_protx_update_service(mn)
 
+        print("testing wallet ownership in protx list")
+        self.test_protx_list_wallet(mns_protx)
+
         print("testing P2SH/multisig for payee addresses")
         multisig = self.nodes[0].createmultisig(1, [self.nodes[0].getnewaddress(), self.nodes[0].getnewaddress()])['address']
         self.update_mn_payee(mns_protx[0], multisig)
@@ -503,6 +506,20 @@ class DIP3Test(BitcoinTestFramework):
         self.nodes[0].protx('update_service', mn.protx_hash, '127.0.0.1:%d' % mn.p2p_port, mn.blsMnkey, "", mn.fundsAddr)
         self.nodes[0].generate(1)
 
+    def test_protx_list_wallet(self, mns):
+        # all collaterals were funded by the wallet of node 0
+        entries = {}
+        for entry in self.nodes[0].protx('list', 'registered', True):
+            entries[entry['proTxHash']] = entry
+        wallet_hashes = self.nodes[0].protx('list', 'wallet')
+        for mn in mns:
+            assert_equal(entries[mn.protx_hash]['wallet']['ownsCollateral'], True)
+            assert_equal(entries[mn.protx_hash]['wallet']['hasOwnerKey'], True)
+            assert_equal(self.nodes[0].protx('info', mn.protx_hash)['wallet']['ownsCollateral'], True)
+            assert(mn.protx_hash in wallet_hashes)
+        for entry in self.nodes[1].protx('list', 'registered', True):
+            assert_equal(entry['wallet']['ownsCollateral'], False)
+
     def force_finish_mnsync(self, node):
         while True:
             s = node.mnsync('next')
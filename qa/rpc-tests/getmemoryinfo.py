@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+# Copyright (c) 2023 The Volkshash Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test getmemoryinfo "subsystems" and the shares of the -maxmemory budget.
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+SUBSYSTEMS = ["addrman", "coinscache", "governance", "instantsend", "llmq", "masternodes",
+              "mempool", "mnlists", "orphantxs", "sigcache"]
+
+class GetMemoryInfoTest(BitcoinTestFramework):
+
+    def __init__(self):
+        super().__init__()
+        self.num_nodes = 1
+        self.setup_clean_chain = False
+
+    def setup_network(self):
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir)
+        self.is_network_split = False
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        # the default mode is unchanged
+        info = node.getmemoryinfo()
+        assert("locked" in info)
+        assert_equal(node.getmemoryinfo("stats"), info)
+        assert_raises_jsonrpc(-8, "unknown mode", node.getmemoryinfo, "foo")
+
+        info = node.getmemoryinfo("subsystems")
+        for name in SUBSYSTEMS:
+            assert(name in info)
+            assert(info[name]["usage"] >= 0)
+        assert_equal(info["total"], sum(info[name]["usage"] for name in SUBSYSTEMS))
+        assert_greater_than(info["coinscache"]["usage"], 0)
+        # the limit is the size the cache may grow to, without the peak of a flush
+        assert(info["coinscache"]["usage"] <= info["coinscache"]["limit"])
+
+        # the mempool grows with its transactions
+        address = node.getnewaddress()
+        for i in range(10):
+            node.sendtoaddress(address, 1)
+        assert_greater_than(node.getmemoryinfo("subsystems")["mempool"]["usage"], info["mempool"]["usage"])
+
+        # without -maxmemory the caches keep their configured sizes
+        info = node.getmemoryinfo("subsystems")
+        assert_equal(info["mempool"]["limit"], node.getmempoolinfo()["maxmempool"])
+
+        print("Restarting with -maxmemory...")
+        stop_node(node, 0)
+        self.nodes[0] = start_node(0, self.options.tmpdir, ["-maxmemory=256"])
+        info = self.nodes[0].getmemoryinfo("subsystems")
+        shared = sum(info[name]["limit"] for name in ["coinscache", "mempool", "mnlists", "sigcache"])
+        assert(shared <= 256 * 1024 * 1024)
+        assert_equal(info["mempool"]["limit"], self.nodes[0].getmempoolinfo()["maxmempool"])
+
+if __name__ == '__main__':
+    GetMemoryInfoTest().main()
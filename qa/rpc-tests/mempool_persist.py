@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+# Copyright (c) 2023 The Volkshash Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test restoring the mempool from mempool.dat.
+#
+# Transactions dumped at the tip the node restarts at skip their script
+# checks, after the tip has moved on or when the file doesn't match its
+# hash they are fully validated again.
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+import re
+import shutil
+
+NUM_TXS = 5
+
+class MempoolPersistTest(BitcoinTestFramework):
+
+    def __init__(self):
+        super().__init__()
+        self.num_nodes = 2
+        self.setup_clean_chain = False
+
+    def setup_network(self):
+        # The nodes are not connected, so node1 can mine blocks without node0's transactions
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir)
+        self.is_network_split = True
+
+    def datadir(self):
+        return os.path.join(self.options.tmpdir, "node0", "regtest")
+
+    def restart_node0(self):
+        """Restart node0 and return the numbers logged once its mempool is loaded."""
+        with open(os.path.join(self.datadir(), "debug.log"), encoding="utf-8") as f:
+            f.seek(0, 2)
+            offset = f.tell()
+        self.nodes[0] = start_node(0, self.options.tmpdir)
+        timeout = 30
+        while True:
+            with open(os.path.join(self.datadir(), "debug.log"), encoding="utf-8") as f:
+                f.seek(offset)
+                match = re.search(r"Imported mempool transactions from disk: (\d+) successes \((\d+) at the tip", f.read())
+            if match:
+                return int(match.group(1)), int(match.group(2))
+            assert(timeout > 0)
+            time.sleep(0.5)
+            timeout -= 0.5
+
+    def run_test(self):
+        address = self.nodes[0].getnewaddress()
+        txids = [self.nodes[0].sendtoaddress(address, 1) for i in range(NUM_TXS)]
+        assert_equal(len(self.nodes[0].getrawmempool()), NUM_TXS)
+
+        print("Restarting at the same tip...")
+        stop_node(self.nodes[0], 0)
+        shutil.copyfile(os.path.join(self.datadir(), "mempool.dat"), os.path.join(self.options.tmpdir, "mempool.dat"))
+        assert_equal(self.restart_node0(), (NUM_TXS, NUM_TXS))
+        assert_equal(set(self.nodes[0].getrawmempool()), set(txids))
+
+        print("Restarting at the same tip with a damaged file hash...")
+        stop_node(self.nodes[0], 0)
+        with open(os.path.join(self.options.tmpdir, "mempool.dat"), "rb") as f:
+            data = bytearray(f.read())
+        data[-1] ^= 0xff
+        with open(os.path.join(self.datadir(), "mempool.dat"), "wb") as f:
+            f.write(data)
+        assert_equal(self.restart_node0(), (NUM_TXS, 0))
+        assert_equal(set(self.nodes[0].getrawmempool()), set(txids))
+
+        print("Restarting after the tip moved on...")
+        self.nodes[1].generate(1)
+        connect_nodes(self.nodes[0], 1)
+        sync_blocks(self.nodes)
+        stop_node(self.nodes[0], 0)
+        # put back the dump of the old tip
+        shutil.copyfile(os.path.join(self.options.tmpdir, "mempool.dat"), os.path.join(self.datadir(), "mempool.dat"))
+        assert_equal(self.restart_node0(), (NUM_TXS, 0))
+        assert_equal(set(self.nodes[0].getrawmempool()), set(txids))
+
+if __name__ == '__main__':
+    MempoolPersistTest().main()
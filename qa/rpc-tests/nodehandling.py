@@ -66,6 +66,25 @@ class NodeHandlingTest (BitcoinTestFramework):
         assert_equal("127.0.0.0/32", listAfterShutdown[1]['address'])
         assert_equal("/19" in listAfterShutdown[2]['address'], True)
 
+        ##test a damaged banjournal.dat doesn't drop banlist.dat
+        stop_node(self.nodes[2], 2)
+        datadir = os.path.join(self.options.tmpdir, "node2", "regtest")
+        journal = os.path.join(datadir, "banjournal.dat")
+        if os.path.exists(journal):
+            os.remove(journal)
+        self.nodes[2] = start_node(2, self.options.tmpdir)
+        listFromBanlist = self.nodes[2].listbanned()
+        stop_node(self.nodes[2], 2)
+        with open(journal, "wb") as f:
+            f.write(b"\x00" * 64)
+        self.nodes[2] = start_node(2, self.options.tmpdir)
+        assert_equal(self.nodes[2].listbanned(), listFromBanlist)
+        # the journal was replaced, later changes are kept again
+        self.nodes[2].setban("10.0.0.1", "add")
+        stop_node(self.nodes[2], 2)
+        self.nodes[2] = start_node(2, self.options.tmpdir)
+        assert_equal(len(self.nodes[2].listbanned()), len(listFromBanlist) + 1)
+
         ###########################
         # RPC disconnectnode test #
         ###########################
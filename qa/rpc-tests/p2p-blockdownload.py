@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+# Copyright (c) 2023 The Volkshash Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test adaptive block download with a fast and a throttled peer.
+#
+# node0 mines a chain, its blocks are then served to node1 by two mininode
+# peers: one answers getdata right away, the other delivers one block every
+# SLOW_BLOCK_DELAY seconds. node1 should request most blocks from the fast
+# peer, lower the in-flight limit of the slow one and request blocks held
+# back by it again from the fast peer.
+#
+# Before the limits were adapted, every peer had FIXED_BLOCKS_IN_FLIGHT
+# blocks in flight and a block held back by the slow peer was only requested
+# again after the stall timeout. The fast peer has to end up above that limit
+# and the slow one below it.
+#
+
+from test_framework.mininode import *
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+import threading
+
+NUM_BLOCKS = 300
+SLOW_BLOCK_DELAY = 0.5
+# MAX_BLOCKS_IN_TRANSIT_PER_PEER, the limit of a peer whose speed isn't known yet
+FIXED_BLOCKS_IN_FLIGHT = 16
+
+class msg_rawblock(object):
+    command = b"block"
+
+    def __init__(self, data):
+        self.data = data
+
+    def serialize(self):
+        return self.data
+
+    def __repr__(self):
+        return "msg_rawblock(%d bytes)" % len(self.data)
+
+class BlockServer(SingleNodeConnCB):
+    def __init__(self, blocks, delay):
+        SingleNodeConnCB.__init__(self)
+        self.blocks = blocks
+        self.delay = delay
+        self.served = 0
+        self.next_send = 0
+
+    def on_getdata(self, conn, message):
+        for inv in message.inv:
+            if inv.type != 2 or inv.hash not in self.blocks:
+                continue
+            self.served += 1
+            block = msg_rawblock(self.blocks[inv.hash])
+            if self.delay == 0:
+                conn.send_message(block)
+            else:
+                # deliver one block after the other, as a slow link would
+                self.next_send = max(self.next_send, time.time()) + self.delay
+                threading.Timer(self.next_send - time.time(), conn.send_message, [block]).start()
+
+class BlockDownloadTest(BitcoinTestFramework):
+
+    def __init__(self):
+        super().__init__()
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+
+    def setup_network(self):
+        # The nodes are not connected, node1 only learns about the chain from the mininodes
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir, [[], ["-debug=net", "-whitelist=127.0.0.1"]])
+        self.is_network_split = False
+
+    def run_test(self):
+        self.nodes[0].generate(NUM_BLOCKS)
+        blocks = {}
+        headers = []
+        for height in range(1, NUM_BLOCKS + 1):
+            blockhash = self.nodes[0].getblockhash(height)
+            blocks[int(blockhash, 16)] = hex_str_to_bytes(self.nodes[0].getblock(blockhash, False))
+            headers.append(FromHex(CBlockHeader(), self.nodes[0].getblockheader(blockhash, False)))
+
+        fast_node = BlockServer(blocks, 0)
+        slow_node = BlockServer(blocks, SLOW_BLOCK_DELAY)
+        connections = []
+        for test_node in [fast_node, slow_node]:
+            connections.append(NodeConn('127.0.0.1', p2p_port(1), self.nodes[1], test_node))
+            test_node.add_connection(connections[-1])
+        NetworkThread().start()
+        fast_node.wait_for_verack()
+        slow_node.wait_for_verack()
+
+        start = time.time()
+        for test_node in [slow_node, fast_node]:
+            msg = msg_headers()
+            msg.headers = headers
+            test_node.send_message(msg)
+        timeout = 120
+        while self.nodes[1].getblockcount() < NUM_BLOCKS:
+            assert(timeout > 0)
+            time.sleep(0.1)
+            timeout -= 0.1
+        elapsed = time.time() - start
+        assert_equal(self.nodes[1].getbestblockhash(), self.nodes[0].getbestblockhash())
+
+        stats = {}
+        for peer in self.nodes[1].getpeerinfo():
+            stats[int(peer["addr"].split(":")[-1])] = peer["blockdownload"]
+        fast_stats = stats[connections[0].socket.getsockname()[1]]
+        slow_stats = stats[connections[1].socket.getsockname()[1]]
+        print("Synced %d blocks in %.1fs" % (NUM_BLOCKS, elapsed))
+        print("fast peer: %s, served %d" % (fast_stats, fast_node.served))
+        print("slow peer: %s, served %d" % (slow_stats, slow_node.served))
+
+        assert_greater_than(fast_stats["inflightlimit"], slow_stats["inflightlimit"])
+        assert_greater_than(fast_stats["inflightlimit"], FIXED_BLOCKS_IN_FLIGHT)
+        assert_greater_than(FIXED_BLOCKS_IN_FLIGHT, slow_stats["inflightlimit"])
+        # blocks the slow peer held back were fetched from the fast one instead of waiting for it
+        assert_greater_than(fast_stats["rerequested"], 0)
+        assert_greater_than(fast_stats["blocks"], slow_stats["blocks"])
+        assert_greater_than(slow_stats["blockinterval"], fast_stats["blockinterval"])
+        assert_greater_than(fast_stats["rate"], slow_stats["rate"])
+
+        for conn in connections:
+            conn.disconnect_node()
+
+if __name__ == '__main__':
+    BlockDownloadTest().main()
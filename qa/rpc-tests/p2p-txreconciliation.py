@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+# Copyright (c) 2023 The Volkshash Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test transaction relay by set reconciliation (-txreconciliation).
+#
+# Four nodes are fully connected, so every transaction reaches each of them
+# over several connections. The same number of transactions is relayed once
+# by flooding inv messages and once with reconciliation. Reconciliation has
+# to spend fewer bytes on announcing them, fetching them costs the same.
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+
+RELAY_MSGS = ["inv", "getdata", "tx", "reqrecon", "reconsketch", "recondiff"]
+ANNOUNCE_MSGS = ["inv", "reqrecon", "reconsketch", "recondiff"]
+RECON_MSGS = ["reqrecon", "reconsketch", "recondiff"]
+TXS_PER_NODE = 10
+ROUNDS = 2
+
+class TxReconciliationTest(BitcoinTestFramework):
+
+    def __init__(self):
+        super().__init__()
+        self.num_nodes = 4
+        self.setup_clean_chain = False
+        self.num_txs = self.num_nodes * TXS_PER_NODE * ROUNDS
+
+    def setup_network(self):
+        self.start_mesh([])
+
+    def start_mesh(self, args):
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir, [args + ["-debug=net"]] * self.num_nodes)
+        for i in range(self.num_nodes):
+            for j in range(i + 1, self.num_nodes):
+                connect_nodes(self.nodes[i], j)
+        self.is_network_split = False
+        self.sync_all()
+
+    def relay_bytes(self, msgs):
+        total = 0
+        for node in self.nodes:
+            for peer in node.getpeerinfo():
+                for msg in msgs:
+                    total += peer["bytessent_per_msg"].get(msg, 0)
+        return total
+
+    def relay_txs(self):
+        # Every node sends, so each round has many transactions to reconcile. The
+        # sends are spread over a few blocks to stay within the mempool chain limits.
+        addresses = [node.getnewaddress() for node in self.nodes]
+        relay_before = self.relay_bytes(RELAY_MSGS)
+        announce_before = self.relay_bytes(ANNOUNCE_MSGS)
+        for i in range(ROUNDS):
+            txids = []
+            for n, node in enumerate(self.nodes):
+                address = addresses[(n + 1) % self.num_nodes]
+                txids += [node.sendtoaddress(address, 1) for j in range(TXS_PER_NODE)]
+            sync_mempools(self.nodes, timeout=120)
+            for node in self.nodes:
+                assert(set(txids).issubset(node.getrawmempool()))
+            self.nodes[i % self.num_nodes].generate(1)
+            self.sync_all()
+        relay_per_tx = (self.relay_bytes(RELAY_MSGS) - relay_before) / self.num_txs
+        announce_per_tx = (self.relay_bytes(ANNOUNCE_MSGS) - announce_before) / self.num_txs
+        return relay_per_tx, announce_per_tx
+
+    def run_test(self):
+        print("Relaying %d transactions by flooding..." % self.num_txs)
+        for peer in self.nodes[0].getpeerinfo():
+            assert("txreconciliation" not in peer)
+        flood_per_tx, flood_announce_per_tx = self.relay_txs()
+        assert_equal(self.relay_bytes(RECON_MSGS), 0)
+
+        print("Restarting with -txreconciliation...")
+        stop_nodes(self.nodes)
+        self.start_mesh(["-txreconciliation"])
+        # "sendrecon" is exchanged right after the handshake
+        timeout = 30
+        while any("txreconciliation" not in peer for node in self.nodes for peer in node.getpeerinfo()):
+            assert(timeout > 0)
+            time.sleep(0.5)
+            timeout -= 0.5
+        for node in self.nodes:
+            peers = node.getpeerinfo()
+            assert_equal(len(peers), self.num_nodes - 1)
+            for peer in peers:
+                assert("txreconciliation" in peer)
+                assert_equal(peer["txreconciliation"]["initiator"], not peer["inbound"])
+
+        print("Relaying %d transactions by reconciliation..." % self.num_txs)
+        recon_per_tx, recon_announce_per_tx = self.relay_txs()
+        assert_greater_than(self.relay_bytes(RECON_MSGS), 0)
+        rounds = 0
+        for node in self.nodes:
+            for peer in node.getpeerinfo():
+                rounds += peer["txreconciliation"]["rounds"]
+        assert_greater_than(rounds, 0)
+
+        print("Bytes per relayed transaction: %.1f flooding, %.1f reconciling" % (flood_per_tx, recon_per_tx))
+        print("Bytes per announced transaction: %.1f flooding, %.1f reconciling" % (flood_announce_per_tx, recon_announce_per_tx))
+        # Fetching a transaction costs the same either way, the announcements are where reconciliation saves
+        assert_greater_than(flood_announce_per_tx, recon_announce_per_tx)
+        assert_greater_than(flood_per_tx, recon_per_tx)
+
+if __name__ == '__main__':
+    TxReconciliationTest().main()
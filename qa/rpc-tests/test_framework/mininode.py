@@ -22,6 +22,7 @@
 # ser_*, deser_*: functions that handle serialization/deserialization
 
 
+import os
 import struct
 import socket
 import asyncore
@@ -76,6 +77,9 @@ def hash256(s):
     return sha256(sha256(s))
 
 def volkshashhash(s):
+    # nodes started with -cheapblockhash use SHA256d block hashes
+    if os.getenv("CHEAP_BLOCK_HASH", ""):
+        return hash256(s)
     return volkshash_hash.getPoWHash(s)
 
 def ser_compact_size(l):
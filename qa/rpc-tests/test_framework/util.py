@@ -275,6 +275,7 @@ def initialize_chain(test_dir, num_nodes, cachedir, extra_args=None, redirect_st
         for i in range(MAX_NODES):
             datadir=initialize_datadir(cachedir, i)
             args = [ os.getenv("DASHD", "volkshashd"), "-server", "-keypool=1", "-datadir="+datadir, "-discover=0", "-mocktime="+str(GENESISTIME) ]
+            args += cheap_block_hash_args()
             if i > 0:
                 args.append("-connect=127.0.0.1:"+str(p2p_port(0)))
             if extra_args is not None:
@@ -356,6 +357,15 @@ def _rpchost_to_args(rpchost):
         rv += ['-rpcport=' + rpcport]
     return rv
 
+def cheap_block_hash_args():
+    """
+    Use SHA256d block hashes instead of yespower when CHEAP_BLOCK_HASH is set. The cache
+    directory has to be cleared when switching, as the genesis block differs.
+    """
+    if os.getenv("CHEAP_BLOCK_HASH", ""):
+        return [ "-cheapblockhash" ]
+    return []
+
 def start_node(i, dirname, extra_args=None, rpchost=None, timewait=None, binary=None, redirect_stderr=False):
     """
     Start a volkshashd and return RPC connection to it
@@ -367,6 +377,7 @@ def start_node(i, dirname, extra_args=None, rpchost=None, timewait=None, binary=
     args = [ binary, "-datadir="+datadir, "-server", "-keypool=1", "-discover=0", "-rest", "-blockprioritysize=50000", "-mocktime="+str(get_mocktime()) ]
     # Don't try auto backups (they fail a lot when running tests)
     args += [ "-createwalletbackups=0" ]
+    args += cheap_block_hash_args()
     if extra_args is not None: args.extend(extra_args)
 
     # Allow to redirect stderr to stdout in case we expect some non-critical warnings/errors printed to stderr
@@ -16,9 +16,114 @@
 
 #include <boost/filesystem.hpp>
 
+#include <limits>
+
+CBanIndex::CBanIndex() : nSize(0)
+{
+    hasher.k0 = GetRand(std::numeric_limits<uint64_t>::max());
+    hasher.k1 = GetRand(std::numeric_limits<uint64_t>::max());
+}
+
+size_t CBanIndex::KeyHasher::operator()(const Key& key) const
+{
+    return CSipHasher(k0, k1).Write(key.hi).Write(key.lo).Finalize();
+}
+
+CBanIndex::Key CBanIndex::MakeKey(const CNetAddr& addr, int nPrefixLength)
+{
+    Key key{0, 0};
+    for (int i = 0; i < 8; i++) {
+        key.hi = (key.hi << 8) | addr.GetByte(15 - i);
+        key.lo = (key.lo << 8) | addr.GetByte(7 - i);
+    }
+    // clear the bits after the prefix
+    if (nPrefixLength <= 64) {
+        key.lo = 0;
+        key.hi = nPrefixLength == 0 ? 0 : key.hi & (~uint64_t(0) << (64 - nPrefixLength));
+    } else if (nPrefixLength < 128) {
+        key.lo &= ~uint64_t(0) << (128 - nPrefixLength);
+    }
+    return key;
+}
+
+void CBanIndex::Clear()
+{
+    mapByPrefixLength.clear();
+    mapIrregular.clear();
+    nSize = 0;
+}
+
+void CBanIndex::Build(const banmap_t& banMap)
+{
+    Clear();
+    for (const auto& p : banMap)
+        Set(p.first, p.second.nBanUntil);
+}
+
+void CBanIndex::Set(const CSubNet& subNet, int64_t nBanUntil)
+{
+    // invalid subnets never match
+    if (!subNet.IsValid())
+        return;
+
+    int nPrefixLength = subNet.GetPrefixLength();
+    bool fInserted;
+    if (nPrefixLength < 0) {
+        auto ret = mapIrregular.emplace(subNet, nBanUntil);
+        fInserted = ret.second;
+        if (!fInserted)
+            ret.first->second = nBanUntil;
+    } else {
+        prefixmap_t& mapPrefix = mapByPrefixLength.emplace(nPrefixLength, prefixmap_t(0, hasher)).first->second;
+        auto ret = mapPrefix.emplace(MakeKey(subNet.GetNetwork(), nPrefixLength), nBanUntil);
+        fInserted = ret.second;
+        if (!fInserted)
+            ret.first->second = nBanUntil;
+    }
+    if (fInserted)
+        nSize++;
+}
+
+void CBanIndex::Erase(const CSubNet& subNet)
+{
+    if (!subNet.IsValid())
+        return;
+
+    int nPrefixLength = subNet.GetPrefixLength();
+    if (nPrefixLength < 0) {
+        nSize -= mapIrregular.erase(subNet);
+    } else {
+        auto it = mapByPrefixLength.find(nPrefixLength);
+        if (it == mapByPrefixLength.end())
+            return;
+        nSize -= it->second.erase(MakeKey(subNet.GetNetwork(), nPrefixLength));
+        if (it->second.empty())
+            mapByPrefixLength.erase(it);
+    }
+}
+
+bool CBanIndex::IsBanned(const CNetAddr& addr, int64_t nNow) const
+{
+    if (!addr.IsValid())
+        return false;
+
+    // a longer prefix may have expired while a shorter one is still banned, so all lengths are checked
+    for (const auto& p : mapByPrefixLength) {
+        auto it = p.second.find(MakeKey(addr, p.first));
+        if (it != p.second.end() && nNow < it->second)
+            return true;
+    }
+    for (const auto& p : mapIrregular) {
+        if (nNow < p.second && p.first.Match(addr))
+            return true;
+    }
+    return false;
+}
+
 CBanDB::CBanDB()
 {
     pathBanlist = GetDataDir() / "banlist.dat";
+    pathJournal = GetDataDir() / "banjournal.dat";
 }
 
 bool CBanDB::Write(const banmap_t& banSet)
@@ -56,6 +161,147 @@ bool CBanDB::Write(const banmap_t& banSet)
     if (!RenameOver(pathTmp, pathBanlist))
         return error("%s: Rename-into-place failed", __func__);
 
+    // The journal only holds changes which are also in the new list. It belongs to the old list, so
+    // it would be ignored anyway if removing it fails or is interrupted.
+    try {
+        boost::filesystem::remove(pathJournal);
+    } catch (const boost::filesystem::filesystem_error& e) {
+        LogPrintf("%s: Failed to remove %s - %s\n", __func__, pathJournal.string(), e.what());
+    }
+
+    return true;
+}
+
+bool CBanDB::ReadBanlistHash(uint256& hashRet)
+{
+    FILE *file = fopen(pathBanlist.string().c_str(), "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: Failed to open file %s", __func__, pathBanlist.string());
+    try {
+        if (fseek(filein.Get(), -(long)sizeof(uint256), SEEK_END) != 0)
+            return error("%s: %s is too short", __func__, pathBanlist.string());
+        filein >> hashRet;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+bool CBanDB::AppendJournal(const changes_t& vChanges)
+{
+    uint256 hashBanlist;
+    if (!ReadBanlistHash(hashBanlist))
+        return false;
+
+    // start a new journal unless the existing one belongs to the current list
+    bool fNewJournal = true;
+    {
+        FILE *file = fopen(pathJournal.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (!filein.IsNull()) {
+            unsigned char pchMsgTmp[4];
+            uint256 hashIn;
+            try {
+                filein >> FLATDATA(pchMsgTmp) >> hashIn;
+                fNewJournal = memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)) || hashIn != hashBanlist;
+            } catch (const std::exception& e) {
+                // an incomplete header
+            }
+        }
+    }
+
+    // every record has its own checksum, so that an interrupted append only loses that record
+    CDataStream ssJournal(SER_DISK, CLIENT_VERSION);
+    for (const auto& change : vChanges) {
+        CDataStream ssRecord(SER_DISK, CLIENT_VERSION);
+        ssRecord << FLATDATA(Params().MessageStart());
+        ssRecord << change;
+        uint256 hash = Hash(ssRecord.begin(), ssRecord.end());
+        ssRecord << hash;
+        ssJournal << std::vector<unsigned char>(ssRecord.begin(), ssRecord.end());
+    }
+
+    FILE *file = fopen(pathJournal.string().c_str(), fNewJournal ? "wb" : "ab");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: Failed to open file %s", __func__, pathJournal.string());
+
+    try {
+        if (fNewJournal)
+            fileout << FLATDATA(Params().MessageStart()) << hashBanlist;
+        fileout << ssJournal;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+    return true;
+}
+
+bool CBanDB::ReadJournal(changes_t& vChangesRet)
+{
+    vChangesRet.clear();
+
+    FILE *file = fopen(pathJournal.string().c_str(), "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        // there were no changes since banlist.dat was written
+        return true;
+    }
+
+    uint256 hashBanlist;
+    if (!ReadBanlistHash(hashBanlist))
+        return false;
+    unsigned char pchMsgTmp[4];
+    uint256 hashIn;
+    try {
+        filein >> FLATDATA(pchMsgTmp) >> hashIn;
+    } catch (const std::exception& e) {
+        return error("%s: Failed to read the header of %s - %s", __func__, pathJournal.string(), e.what());
+    }
+    if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+        return error("%s: Invalid network magic number", __func__);
+    if (hashIn != hashBanlist) {
+        // banlist.dat was rewritten, and the journal not removed after
+        LogPrintf("%s: %s belongs to an older banlist.dat, ignoring it\n", __func__, pathJournal.string());
+        return true;
+    }
+
+    while (true) {
+        std::vector<unsigned char> vchRecord;
+        try {
+            filein >> vchRecord;
+        } catch (const std::exception& e) {
+            // end of file or an incomplete record
+            break;
+        }
+        if (vchRecord.size() < sizeof(uint256))
+            break;
+        CDataStream ssRecord(vchRecord, SER_DISK, CLIENT_VERSION);
+
+        uint256 hashIn;
+        memcpy(hashIn.begin(), &ssRecord[ssRecord.size() - sizeof(uint256)], sizeof(uint256));
+        if (hashIn != Hash(ssRecord.begin(), ssRecord.end() - sizeof(uint256))) {
+            LogPrintf("%s: Checksum mismatch in %s, ignoring the remaining records\n", __func__, pathJournal.string());
+            break;
+        }
+
+        std::pair<CSubNet, CBanEntry> change;
+        try {
+            ssRecord >> FLATDATA(pchMsgTmp);
+            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+                return error("%s: Invalid network magic number", __func__);
+            ssRecord >> change;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        vChangesRet.emplace_back(change);
+    }
+
     return true;
 }
 
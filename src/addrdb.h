@@ -6,15 +6,19 @@
 #ifndef BITCOIN_ADDRDB_H
 #define BITCOIN_ADDRDB_H
 
+#include "netaddress.h"
 #include "serialize.h"
 
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <boost/filesystem/path.hpp>
 
-class CSubNet;
 class CAddrMan;
 class CDataStream;
+class uint256;
 
 typedef enum BanReason
 {
@@ -76,6 +80,54 @@ public:
 
 typedef std::map<CSubNet, CBanEntry> banmap_t;
 
+/**
+ * Index of banned subnets for matching addresses against large ban lists. Subnets are kept in one
+ * hash map per prefix length, so a lookup costs one hash map access per prefix length in use
+ * (at most 129) instead of a Match() per ban. Subnets with netmasks that aren't a prefix are
+ * matched one by one.
+ *
+ * Expired bans are ignored by IsBanned and only removed by Erase, so they can be swept lazily.
+ */
+class CBanIndex
+{
+private:
+    struct Key
+    {
+        uint64_t hi;
+        uint64_t lo;
+        bool operator==(const Key& other) const { return hi == other.hi && lo == other.lo; }
+    };
+
+    struct KeyHasher
+    {
+        uint64_t k0;
+        uint64_t k1;
+        size_t operator()(const Key& key) const;
+    };
+
+    typedef std::unordered_map<Key, int64_t, KeyHasher> prefixmap_t;
+
+    KeyHasher hasher;
+    // by prefix length, longest first. Only lengths in use have an entry.
+    std::map<int, prefixmap_t, std::greater<int> > mapByPrefixLength;
+    std::map<CSubNet, int64_t> mapIrregular;
+    size_t nSize;
+
+    static Key MakeKey(const CNetAddr& addr, int nPrefixLength);
+
+public:
+    CBanIndex();
+
+    void Clear();
+    void Build(const banmap_t& banMap);
+    // Adds the subnet or changes its ban time
+    void Set(const CSubNet& subNet, int64_t nBanUntil);
+    void Erase(const CSubNet& subNet);
+    // Whether addr is in a subnet which is banned after nNow
+    bool IsBanned(const CNetAddr& addr, int64_t nNow) const;
+    size_t size() const { return nSize; }
+};
+
 /** Access to the (IP) address database (peers.dat) */
 class CAddrDB
 {
@@ -88,15 +140,36 @@ public:
     bool Read(CAddrMan& addr, CDataStream& ssPeers);
 };
 
-/** Access to the banlist database (banlist.dat) */
+/**
+ * Access to the banlist database (banlist.dat)
+ *
+ * Changes made after banlist.dat was written are appended to banjournal.dat, so that
+ * single bans don't require to rewrite the whole list. A change is stored as the new
+ * entry of the subnet. Removals are stored as an entry without ban time, which is
+ * swept after loading.
+ *
+ * The journal starts with the checksum of the banlist.dat it applies to. A journal left
+ * behind by an older list, e.g. after a crash while the list was rewritten, is ignored.
+ */
 class CBanDB
 {
 private:
     boost::filesystem::path pathBanlist;
+    boost::filesystem::path pathJournal;
+
+    // The checksum stored at the end of banlist.dat
+    bool ReadBanlistHash(uint256& hashRet);
 public:
+    typedef std::vector<std::pair<CSubNet, CBanEntry> > changes_t;
+
     CBanDB();
+    // Writes the whole list and empties the journal
     bool Write(const banmap_t& banSet);
     bool Read(banmap_t& banSet);
+    bool AppendJournal(const changes_t& vChanges);
+    // Reads the journal up to the first damaged record, e.g. if a write was interrupted.
+    // Fails if the journal can't be used at all, a journal of another list is read as empty.
+    bool ReadJournal(changes_t& vChangesRet);
 };
 
 #endif // BITCOIN_ADDRDB_H
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_ADDRMAN_H
 #define BITCOIN_ADDRMAN_H
 
+#include "memusage.h"
 #include "netaddress.h"
 #include "protocol.h"
 #include "random.h"
@@ -490,6 +491,13 @@ public:
         return vRandom.size();
     }
 
+    //! Memory used by the address tables
+    size_t DynamicMemoryUsage() const
+    {
+        LOCK(cs);
+        return memusage::DynamicUsage(mapInfo) + memusage::DynamicUsage(mapAddr) + memusage::DynamicUsage(vRandom);
+    }
+
     //! Consistency check
     void Check()
     {
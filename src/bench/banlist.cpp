@@ -0,0 +1,101 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "addrdb.h"
+#include "netaddress.h"
+#include "random.h"
+
+#include <limits>
+#include <vector>
+
+static CNetAddr RandomAddr(FastRandomContext& rnd, bool fIPv4)
+{
+    CNetAddr addr;
+    std::vector<unsigned char> vch(fIPv4 ? 4 : 16);
+    for (auto& c : vch)
+        c = rnd.rand32() & 0xff;
+    addr.SetRaw(fIPv4 ? NET_IPV4 : NET_IPV6, vch.data());
+    return addr;
+}
+
+// A large abuse list: mostly single IPv4 addresses, some IPv4 ranges and IPv6 prefixes
+static banmap_t CreateBanList(FastRandomContext& rnd, size_t nSize)
+{
+    banmap_t banmap;
+    CBanEntry entry(1);
+    entry.nBanUntil = std::numeric_limits<int64_t>::max();
+    while (banmap.size() < nSize) {
+        switch (rnd.rand32() % 4) {
+        case 0:
+            banmap.emplace(CSubNet(RandomAddr(rnd, true), 24), entry);
+            break;
+        case 1:
+            banmap.emplace(CSubNet(RandomAddr(rnd, false), 48 + (rnd.rand32() % 3) * 8), entry);
+            break;
+        default:
+            banmap.emplace(CSubNet(RandomAddr(rnd, true)), entry);
+            break;
+        }
+    }
+    return banmap;
+}
+
+static std::vector<CNetAddr> CreateLookups(FastRandomContext& rnd)
+{
+    std::vector<CNetAddr> vAddrs;
+    for (int i = 0; i < 1000; i++)
+        vAddrs.emplace_back(RandomAddr(rnd, i % 4 != 0));
+    return vAddrs;
+}
+
+static void BanIndexLookup(benchmark::State& state)
+{
+    FastRandomContext rnd(true);
+    CBanIndex index;
+    index.Build(CreateBanList(rnd, 50000));
+    std::vector<CNetAddr> vAddrs = CreateLookups(rnd);
+
+    size_t i = 0;
+    size_t nBanned = 0;
+    while (state.KeepRunning()) {
+        nBanned += index.IsBanned(vAddrs[i++ % vAddrs.size()], 0);
+    }
+    assert(nBanned <= i);
+}
+
+// The previous implementation of CConnman::IsBanned, for comparison
+static void BanListLinearLookup(benchmark::State& state)
+{
+    FastRandomContext rnd(true);
+    banmap_t banmap = CreateBanList(rnd, 50000);
+    std::vector<CNetAddr> vAddrs = CreateLookups(rnd);
+
+    size_t i = 0;
+    size_t nBanned = 0;
+    while (state.KeepRunning()) {
+        const CNetAddr& addr = vAddrs[i++ % vAddrs.size()];
+        bool fResult = false;
+        for (const auto& p : banmap) {
+            if (p.first.Match(addr) && 0 < p.second.nBanUntil)
+                fResult = true;
+        }
+        nBanned += fResult;
+    }
+    assert(nBanned <= i);
+}
+
+static void BanIndexBuild(benchmark::State& state)
+{
+    FastRandomContext rnd(true);
+    banmap_t banmap = CreateBanList(rnd, 50000);
+    while (state.KeepRunning()) {
+        CBanIndex index;
+        index.Build(banmap);
+    }
+}
+
+BENCHMARK(BanIndexLookup);
+BENCHMARK(BanListLinearLookup);
+BENCHMARK(BanIndexBuild);
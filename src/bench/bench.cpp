@@ -5,8 +5,16 @@
 #include "bench.h"
 #include "perf.h"
 
+#include <univalue.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
 #include <sys/time.h>
 
 benchmark::BenchRunner::BenchmarkMap &benchmark::BenchRunner::benchmarks() {
@@ -25,18 +33,208 @@ benchmark::BenchRunner::BenchRunner(std::string name, benchmark::BenchFunction f
     benchmarks().insert(std::make_pair(name, func));
 }
 
-void
-benchmark::BenchRunner::RunAll(double elapsedTimeForOne)
+// nearest-rank percentile of sorted samples
+static double Percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+static benchmark::Result Summarize(const std::string& name, const std::vector<benchmark::State>& states)
+{
+    benchmark::Result result;
+    result.name = name;
+    result.count = 0;
+
+    std::vector<double> samples;
+    double elapsed = 0;
+    uint64_t cycles = 0;
+    for (const auto& state : states) {
+        samples.insert(samples.end(), state.samples.begin(), state.samples.end());
+        result.count += state.totalCount;
+        elapsed += state.totalElapsed;
+        cycles += state.totalCycles;
+    }
+    std::sort(samples.begin(), samples.end());
+    result.numSamples = samples.size();
+    if (samples.empty()) {
+        result.min = result.max = result.mean = result.median = result.p90 = result.p99 = result.stddev = 0;
+        result.averageCycles = 0;
+        return result;
+    }
+
+    result.min = samples.front();
+    result.max = samples.back();
+    result.median = Percentile(samples, 0.5);
+    result.p90 = Percentile(samples, 0.9);
+    result.p99 = Percentile(samples, 0.99);
+
+    double sum = 0;
+    for (double sample : samples)
+        sum += sample;
+    result.mean = sum / samples.size();
+    double sumSquares = 0;
+    for (double sample : samples)
+        sumSquares += (sample - result.mean) * (sample - result.mean);
+    result.stddev = samples.size() > 1 ? std::sqrt(sumSquares / (samples.size() - 1)) : 0;
+
+    // the mean over all iterations, not over the batches which have different sizes
+    result.mean = result.count ? elapsed / result.count : result.mean;
+    result.averageCycles = result.count ? cycles / result.count : 0;
+    return result;
+}
+
+static UniValue ResultToJSON(const benchmark::Result& result)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("name", result.name));
+    obj.push_back(Pair("count", result.count));
+    obj.push_back(Pair("samples", (uint64_t)result.numSamples));
+    obj.push_back(Pair("min", result.min));
+    obj.push_back(Pair("max", result.max));
+    obj.push_back(Pair("mean", result.mean));
+    obj.push_back(Pair("median", result.median));
+    obj.push_back(Pair("p90", result.p90));
+    obj.push_back(Pair("p99", result.p99));
+    obj.push_back(Pair("stddev", result.stddev));
+    obj.push_back(Pair("average_cycles", result.averageCycles));
+    return obj;
+}
+
+static bool ReadBaseline(const std::string& strFile, std::map<std::string, benchmark::Result>& mapBaselineRet)
+{
+    std::ifstream file(strFile);
+    if (!file) {
+        std::cerr << "Could not open baseline " << strFile << "\n";
+        return false;
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+
+    UniValue root;
+    if (!root.read(ss.str()) || !root.isObject() || !root["benchmarks"].isArray()) {
+        std::cerr << "Could not parse baseline " << strFile << "\n";
+        return false;
+    }
+    const UniValue& benchmarks = root["benchmarks"];
+    for (size_t i = 0; i < benchmarks.size(); i++) {
+        const UniValue& obj = benchmarks[i];
+        benchmark::Result result;
+        try {
+            result.name = obj["name"].get_str();
+            result.numSamples = obj["samples"].get_int64();
+            result.mean = obj["mean"].get_real();
+            result.median = obj["median"].get_real();
+            result.stddev = obj["stddev"].get_real();
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Malformed benchmark entry " << i << " in baseline " << strFile << ": " << e.what() << "\n";
+            return false;
+        }
+        mapBaselineRet[result.name] = result;
+    }
+    return true;
+}
+
+/**
+ * A benchmark regressed if its mean got slower by more than the threshold and the difference is
+ * significant according to Welch's t-test. The batch samples are not fully independent, so a
+ * conservative critical value is used.
+ */
+static bool CompareToBaseline(const std::vector<benchmark::Result>& results, const std::map<std::string, benchmark::Result>& mapBaseline, double threshold)
+{
+    static const double CRITICAL_T = 3.0;
+
+    bool fRegression = false;
+    std::cout << "#Comparison" << "," << "baseline_mean" << "," << "mean" << "," << "change" << "," << "t" << "," << "status" << "\n";
+    for (const auto& result : results) {
+        auto it = mapBaseline.find(result.name);
+        if (it == mapBaseline.end()) {
+            std::cout << result.name << ",,,,," << "new" << "\n";
+            continue;
+        }
+        const benchmark::Result& base = it->second;
+
+        double change = base.mean > 0 ? (result.mean - base.mean) / base.mean : 0;
+        double se = std::sqrt(result.stddev * result.stddev / std::max<size_t>(result.numSamples, 1) +
+                              base.stddev * base.stddev / std::max<size_t>(base.numSamples, 1));
+        double t = se > 0 ? (result.mean - base.mean) / se : 0;
+
+        std::string status = "ok";
+        if (change > threshold && t > CRITICAL_T) {
+            status = "REGRESSION";
+            fRegression = true;
+        } else if (change < -threshold && t < -CRITICAL_T) {
+            status = "improvement";
+        }
+        std::cout << std::scientific << std::setprecision(6) << result.name << "," << base.mean << "," << result.mean << ","
+                  << std::fixed << std::setprecision(2) << change * 100 << "%," << t << "," << status << "\n";
+    }
+    return !fRegression;
+}
+
+bool
+benchmark::BenchRunner::RunAll(const Options& options)
 {
+    std::regex reFilter;
+    try {
+        reFilter = std::regex(options.filter);
+    } catch (const std::regex_error& e) {
+        std::cerr << "Invalid -filter regex " << options.filter << ": " << e.what() << "\n";
+        return false;
+    }
+
+    std::map<std::string, Result> mapBaseline;
+    if (!options.baselineFile.empty() && !ReadBaseline(options.baselineFile, mapBaseline))
+        return false;
+
     perf_init();
-    std::cout << "#Benchmark" << "," << "count" << "," << "min" << "," << "max" << "," << "average" << ","
-              << "min_cycles" << "," << "max_cycles" << "," << "average_cycles" << "\n";
+    std::cout << "#Benchmark" << "," << "count" << "," << "samples" << "," << "min" << "," << "max" << "," << "mean" << ","
+              << "median" << "," << "p90" << "," << "p99" << "," << "stddev" << "," << "average_cycles" << "\n";
 
+    std::vector<Result> results;
     for (const auto &p: benchmarks()) {
-        State state(p.first, elapsedTimeForOne);
-        p.second(state);
+        if (!std::regex_match(p.first, reFilter))
+            continue;
+
+        for (int i = 0; i < options.warmup; i++) {
+            State state(p.first, options.elapsedTimeForOne);
+            p.second(state);
+        }
+        std::vector<State> states;
+        for (int i = 0; i < options.repetitions; i++) {
+            states.emplace_back(p.first, options.elapsedTimeForOne);
+            p.second(states.back());
+        }
+
+        Result result = Summarize(p.first, states);
+        std::cout << std::scientific << std::setprecision(6) << result.name << "," << result.count << "," << result.numSamples << ","
+                  << result.min << "," << result.max << "," << result.mean << "," << result.median << ","
+                  << result.p90 << "," << result.p99 << "," << result.stddev << "," << result.averageCycles << "\n";
+        results.push_back(result);
     }
     perf_fini();
+
+    if (!options.jsonFile.empty()) {
+        UniValue arr(UniValue::VARR);
+        for (const auto& result : results)
+            arr.push_back(ResultToJSON(result));
+        UniValue root(UniValue::VOBJ);
+        root.push_back(Pair("warmup", options.warmup));
+        root.push_back(Pair("repetitions", options.repetitions));
+        root.push_back(Pair("time", options.elapsedTimeForOne));
+        root.push_back(Pair("benchmarks", arr));
+
+        std::ofstream file(options.jsonFile);
+        file << root.write(4) << "\n";
+        if (!file) {
+            std::cerr << "Could not write " << options.jsonFile << "\n";
+            return false;
+        }
+    }
+
+    if (!options.baselineFile.empty())
+        return CompareToBaseline(results, mapBaseline, options.regressionThreshold);
+    return true;
 }
 
 bool benchmark::State::KeepRunning()
@@ -55,14 +253,7 @@ bool benchmark::State::KeepRunning()
         now = gettimedouble();
         double elapsed = now - lastTime;
         double elapsedOne = elapsed * countMaskInv;
-        if (elapsedOne < minTime) minTime = elapsedOne;
-        if (elapsedOne > maxTime) maxTime = elapsedOne;
-
-        // We only use relative values, so don't have to handle 64-bit wrap-around specially
         nowCycles = perf_cpucycles();
-        uint64_t elapsedOneCycles = (nowCycles - lastCycles) * countMaskInv;
-        if (elapsedOneCycles < minCycles) minCycles = elapsedOneCycles;
-        if (elapsedOneCycles > maxCycles) maxCycles = elapsedOneCycles;
 
         if (elapsed*128 < maxElapsed) {
           // If the execution was much too fast (1/128th of maxElapsed), increase the count mask by 8x and restart timing.
@@ -70,12 +261,10 @@ bool benchmark::State::KeepRunning()
           countMask = ((countMask<<3)|7) & ((1LL<<60)-1);
           countMaskInv = 1./(countMask+1);
           count = 0;
-          minTime = std::numeric_limits<double>::max();
-          maxTime = std::numeric_limits<double>::min();
-          minCycles = std::numeric_limits<uint64_t>::max();
-          maxCycles = std::numeric_limits<uint64_t>::min();
+          samples.clear();
           return true;
         }
+        samples.push_back(elapsedOne);
         if (elapsed*16 < maxElapsed) {
           uint64_t newCountMask = ((countMask<<1)|1) & ((1LL<<60)-1);
           if ((count & newCountMask)==0) {
@@ -92,11 +281,10 @@ bool benchmark::State::KeepRunning()
 
     --count;
 
-    // Output results
-    double average = (now-beginTime)/count;
-    int64_t averageCycles = (nowCycles-beginCycles)/count;
-    std::cout << std::fixed << std::setprecision(15) << name << "," << count << "," << minTime << "," << maxTime << "," << average << ","
-              << minCycles << "," << maxCycles << "," << averageCycles << "\n";
+    // We only use relative values, so don't have to handle 64-bit wrap-around specially
+    totalCount = count;
+    totalElapsed = now - beginTime;
+    totalCycles = nowCycles - beginCycles;
 
     return false;
 }
@@ -7,6 +7,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/function.hpp>
 #include <boost/preprocessor/cat.hpp>
@@ -40,19 +41,19 @@ namespace benchmark {
         std::string name;
         double maxElapsed;
         double beginTime;
-        double lastTime, minTime, maxTime, countMaskInv;
+        double lastTime, countMaskInv;
         uint64_t count;
         uint64_t countMask;
         uint64_t beginCycles;
         uint64_t lastCycles;
-        uint64_t minCycles;
-        uint64_t maxCycles;
     public:
-        State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0) {
-            minTime = std::numeric_limits<double>::max();
-            maxTime = std::numeric_limits<double>::min();
-            minCycles = std::numeric_limits<uint64_t>::max();
-            maxCycles = std::numeric_limits<uint64_t>::min();
+        //! Time per iteration of every timed batch of iterations, in seconds
+        std::vector<double> samples;
+        uint64_t totalCount;
+        double totalElapsed;
+        uint64_t totalCycles;
+
+        State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0), totalCount(0), totalElapsed(0), totalCycles(0) {
             countMask = 1;
             countMaskInv = 1./(countMask + 1);
         }
@@ -61,6 +62,31 @@ namespace benchmark {
 
     typedef boost::function<void(State&)> BenchFunction;
 
+    /** Statistics over the samples of all measured repetitions of a benchmark, times are per iteration in seconds */
+    struct Result {
+        std::string name;
+        uint64_t count;
+        size_t numSamples;
+        double min, max, mean, median, p90, p99, stddev;
+        uint64_t averageCycles;
+    };
+
+    struct Options {
+        //! Only run benchmarks whose name matches this regex
+        std::string filter = ".*";
+        //! Repetitions run before measuring, their results are discarded
+        int warmup = 1;
+        //! Measured repetitions, each one running for about elapsedTimeForOne seconds
+        int repetitions = 5;
+        double elapsedTimeForOne = 0.2;
+        //! Write the results as JSON to this file
+        std::string jsonFile;
+        //! Compare the results against a JSON file written by an earlier run
+        std::string baselineFile;
+        //! Relative slowdown of the mean which counts as a regression, if it is also significant
+        double regressionThreshold = 0.05;
+    };
+
     class BenchRunner
     {
         typedef std::map<std::string, BenchFunction> BenchmarkMap;
@@ -69,7 +95,8 @@ namespace benchmark {
     public:
         BenchRunner(std::string name, BenchFunction func);
 
-        static void RunAll(double elapsedTimeForOne=1.0);
+        /** Returns false if comparing against the baseline failed or found regressions */
+        static bool RunAll(const Options& options);
     };
 }
 
@@ -10,8 +10,11 @@
 
 #include "bls/bls.h"
 
+#include <iostream>
+
 void CleanupBLSTests();
 void CleanupBLSDkgTests();
+int RunBlockReplay();
 
 int
 main(int argc, char** argv)
@@ -22,12 +25,45 @@ main(int argc, char** argv)
     BLSInit();
     SetupEnvironment();
     fPrintToDebugLog = false; // don't want to write to debug.log file
+    ParseParameters(argc, argv);
+
+    if (IsArgSet("-?") || IsArgSet("-help")) {
+        std::cout << "Usage: bench_volkshash [options]\n\n"
+                  << "Options:\n"
+                  << "  -filter=<regex>             Only run benchmarks whose name matches <regex> (default: .*)\n"
+                  << "  -warmup=<n>                 Unmeasured repetitions of each benchmark (default: 1)\n"
+                  << "  -repetitions=<n>            Measured repetitions of each benchmark (default: 5)\n"
+                  << "  -time=<seconds>             Run time of each repetition (default: 0.2)\n"
+                  << "  -json=<file>                Write the results as JSON to <file>\n"
+                  << "  -baseline=<file>            Compare against the JSON results of an earlier run, fail on significant regressions\n"
+                  << "  -threshold=<percent>        Minimum slowdown of the mean counting as a regression (default: 5)\n"
+                  << "  -replayblocks=<from>:<to>   Replay blocks from -replaydatadir=<dir> instead of running the benchmarks\n"
+                  << "  -replayrepetitions=<n>      Number of replays (default: 3)\n";
+        return EXIT_SUCCESS;
+    }
+
+    if (IsArgSet("-replayblocks")) {
+        int ret = RunBlockReplay();
+        ECC_Stop();
+        return ret;
+    }
 
-    benchmark::BenchRunner::RunAll();
+    benchmark::Options options;
+    options.filter = GetArg("-filter", options.filter);
+    options.warmup = std::max(0, (int)GetArg("-warmup", options.warmup));
+    options.repetitions = std::max(1, (int)GetArg("-repetitions", options.repetitions));
+    options.elapsedTimeForOne = std::max(0.001, atof(GetArg("-time", std::to_string(options.elapsedTimeForOne)).c_str()));
+    options.jsonFile = GetArg("-json", "");
+    options.baselineFile = GetArg("-baseline", "");
+    options.regressionThreshold = atof(GetArg("-threshold", "5").c_str()) / 100;
+
+    bool fSuccess = benchmark::BenchRunner::RunAll(options);
 
     // need to be called before global destructors kick in (PoolAllocator is needed due to many BLSSecretKeys)
     CleanupBLSDkgTests();
     CleanupBLSTests();
 
     ECC_Stop();
+
+    return fSuccess ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,265 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "flat-database.h"
+#include "governance.h"
+#include "masternode-payments.h"
+#include "masternode-sync.h"
+#include "net.h"
+#include "random.h"
+#include "spork.h"
+#include "txdb.h"
+#include "txmempool.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include "evo/deterministicmns.h"
+#include "evo/evodb.h"
+#include "llmq/quorums_init.h"
+
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+/*
+ * Replays a range of blocks from the blk?????.dat files of a datadir snapshot and reports
+ * how long ConnectBlock and its stages took. Enabled with -replayblocks=<from>:<to> and
+ * -replaydatadir=<dir>, -par and -dbcache are honored like in volkshashd.
+ *
+ * The snapshot is never modified. For every repetition its databases are copied to a temporary
+ * datadir and the block files are linked into it. If the chainstate of the snapshot is above the
+ * start of the range, the blocks are disconnected first, which is not included in the timings.
+ *
+ * The spork, masternode payment and governance caches of the snapshot are loaded and the
+ * masternode sync is marked as finished, so the payee and superblock checks run like on a synced
+ * node. They can only use what these caches still hold at the time of the snapshot, e.g. the
+ * payment votes and triggers of recent blocks.
+ */
+
+static void CopyDirectory(const boost::filesystem::path& from, const boost::filesystem::path& to)
+{
+    boost::filesystem::create_directories(to);
+    for (boost::filesystem::directory_iterator it(from), end; it != end; ++it) {
+        if (boost::filesystem::is_directory(it->status())) {
+            CopyDirectory(it->path(), to / it->path().filename());
+        } else {
+            boost::filesystem::copy_file(it->path(), to / it->path().filename());
+        }
+    }
+}
+
+static void PrepareDatadir(const boost::filesystem::path& snapshot, const boost::filesystem::path& datadir)
+{
+    CopyDirectory(snapshot / "chainstate", datadir / "chainstate");
+    CopyDirectory(snapshot / "evodb", datadir / "evodb");
+    CopyDirectory(snapshot / "blocks" / "index", datadir / "blocks" / "index");
+    for (const char* pszCache : {"sporks.dat", "mnpayments.dat", "governance.dat"}) {
+        if (boost::filesystem::exists(snapshot / pszCache))
+            boost::filesystem::copy_file(snapshot / pszCache, datadir / pszCache);
+    }
+
+    // block and undo files can be huge and are only appended to, link them instead
+    for (boost::filesystem::directory_iterator it(snapshot / "blocks"), end; it != end; ++it) {
+        if (boost::filesystem::is_regular_file(it->status()) && it->path().extension() == ".dat") {
+            boost::filesystem::create_symlink(boost::filesystem::absolute(it->path()), datadir / "blocks" / it->path().filename());
+        }
+    }
+}
+
+static bool LoadMasternodeCaches()
+{
+    CFlatDB<CSporkManager> flatdb1("sporks.dat", "magicSporkCache");
+    if (!flatdb1.Load(sporkManager))
+        return false;
+    // not cleaned up, the masternode list they would be checked against isn't loaded
+    CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
+    if (!flatdb2.Load(mnpayments, false))
+        return false;
+    CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+    if (!flatdb3.Load(governance, false))
+        return false;
+    governance.InitOnLoad();
+    return true;
+}
+
+static void PrintTimings(const std::string& strName, int nBlocks, const CBlockConnectTimings& begin, const CBlockConnectTimings& end, int64_t nFinalFlush)
+{
+    std::vector<std::pair<std::string, int64_t> > vStages = {
+        {"read", end.nReadFromDisk - begin.nReadFromDisk},
+        {"sanity", end.nCheck - begin.nCheck},
+        {"forks", end.nForks - begin.nForks},
+        {"connect_txs", end.nConnect - begin.nConnect},
+        {"verify_scripts", end.nVerify - begin.nVerify},
+        {"payee_and_special", end.nPayeeAndSpecial - begin.nPayeeAndSpecial},
+        {"index", end.nIndex - begin.nIndex},
+        {"callbacks", end.nCallbacks - begin.nCallbacks},
+        {"connect_total", end.nConnectTotal - begin.nConnectTotal},
+        {"flush_view", end.nFlush - begin.nFlush},
+        {"write_chainstate", end.nChainState - begin.nChainState},
+        {"postprocess", end.nPostConnect - begin.nPostConnect},
+        {"final_flush", nFinalFlush},
+        {"total", end.nTotal - begin.nTotal + nFinalFlush},
+    };
+    for (const auto& stage : vStages) {
+        std::cout << std::fixed << std::setprecision(3) << strName << "," << stage.first << "," << stage.second * 0.001 << ","
+                  << stage.second * 0.001 / nBlocks << "\n";
+    }
+}
+
+static bool ReplayOnce(const boost::filesystem::path& snapshot, int nFrom, int nTo, int nRepetition)
+{
+    const CChainParams& chainparams = Params();
+
+    boost::filesystem::path datadir = boost::filesystem::temp_directory_path() / strprintf("bench_volkshash_replay_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+    PrepareDatadir(snapshot, datadir);
+    ForceSetArg("-datadir", datadir.string());
+    ClearDatadirCache();
+
+    // same split as in AppInitMain
+    int64_t nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
+    nTotalCache = std::max(nTotalCache, nMinDbCache << 20);
+    int64_t nBlockTreeDBCache = std::min(nTotalCache / 8, (GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
+    nTotalCache -= nBlockTreeDBCache;
+    int64_t nCoinDBCache = std::min(std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)), nMaxCoinsDBCache << 20);
+    nTotalCache -= nCoinDBCache;
+    nCoinCacheUsage = nTotalCache;
+
+    evoDb = new CEvoDB(1024 * 1024 * 16, false, false);
+    deterministicMNManager = new CDeterministicMNManager(*evoDb);
+    pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, false);
+    pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, false);
+    pcoinsTip = new CCoinsViewCache(pcoinsdbview);
+    llmq::InitLLMQSystem(*evoDb);
+
+    boost::thread_group scriptCheckThreads;
+    for (int i = 0; i < nScriptCheckThreads - 1; i++)
+        scriptCheckThreads.create_thread(&ThreadScriptCheck);
+
+    bool fSuccess = false;
+    do {
+        if (!LoadBlockIndex(chainparams)) {
+            std::cerr << "Error loading the block index of the snapshot\n";
+            break;
+        }
+        if (!LoadMasternodeCaches()) {
+            std::cerr << "Error loading the masternode caches of the snapshot\n";
+            break;
+        }
+        // without a finished sync the payee and superblock checks accept any coinbase
+        CConnman connman(GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max()));
+        while (!masternodeSync.IsSynced())
+            masternodeSync.SwitchToNextAsset(connman);
+
+        CBlockIndex* pindexTarget = NULL;
+        {
+            LOCK(cs_main);
+            if (chainActive.Height() >= nTo) {
+                pindexTarget = chainActive[nTo];
+            } else if (pindexBestHeader && pindexBestHeader->nHeight >= nTo) {
+                pindexTarget = pindexBestHeader->GetAncestor(nTo);
+            }
+            if (!pindexTarget || !(pindexTarget->nStatus & BLOCK_HAVE_DATA)) {
+                std::cerr << strprintf("Block %d is not in the block files of the snapshot\n", nTo);
+                break;
+            }
+            if (chainActive.Height() < nFrom - 1) {
+                std::cerr << strprintf("The chainstate of the snapshot is at height %d, below the start of the range\n", chainActive.Height());
+                break;
+            }
+        }
+
+        if (!DisconnectBlocks(chainActive.Height() - (nFrom - 1)))
+            break;
+        mempool.clear();
+
+        LOCK(cs_main);
+        if (pindexTarget->GetAncestor(nFrom - 1) != chainActive.Tip()) {
+            std::cerr << "The range of blocks is not on the active chain of the snapshot\n";
+            break;
+        }
+
+        CValidationState state;
+        CBlockConnectTimings begin = GetBlockConnectTimings();
+        while (chainActive.Tip() != pindexTarget) {
+            if (!ConnectNextBlock(state, chainparams, pindexTarget)) {
+                std::cerr << strprintf("Failed to connect block %d: %s\n", chainActive.Height() + 1, FormatStateMessage(state));
+                break;
+            }
+        }
+        if (chainActive.Tip() != pindexTarget)
+            break;
+        CBlockConnectTimings end = GetBlockConnectTimings();
+
+        int64_t nTimeFlushStart = GetTimeMicros();
+        FlushStateToDisk();
+        int64_t nFinalFlush = GetTimeMicros() - nTimeFlushStart;
+
+        PrintTimings(strprintf("replay_%d", nRepetition), nTo - nFrom + 1, begin, end, nFinalFlush);
+        fSuccess = true;
+    } while (false);
+
+    scriptCheckThreads.interrupt_all();
+    scriptCheckThreads.join_all();
+
+    masternodeSync.Reset();
+    governance.Clear();
+    mnpayments.Clear();
+    sporkManager.Clear();
+    UnloadBlockIndex();
+    delete pcoinsTip;
+    pcoinsTip = NULL;
+    llmq::DestroyLLMQSystem();
+    delete pcoinsdbview;
+    pcoinsdbview = NULL;
+    delete pblocktree;
+    pblocktree = NULL;
+    delete deterministicMNManager;
+    deterministicMNManager = NULL;
+    delete evoDb;
+    evoDb = NULL;
+
+    boost::filesystem::remove_all(datadir);
+    return fSuccess;
+}
+
+int RunBlockReplay()
+{
+    std::string strRange = GetArg("-replayblocks", "");
+    int nFrom, nTo;
+    size_t nSep = strRange.find(':');
+    if (nSep == std::string::npos || !ParseInt32(strRange.substr(0, nSep), &nFrom) || !ParseInt32(strRange.substr(nSep + 1), &nTo) ||
+            nFrom < 1 || nTo < nFrom) {
+        std::cerr << "Invalid -replayblocks range, expecting <from>:<to>\n";
+        return EXIT_FAILURE;
+    }
+    boost::filesystem::path snapshot = GetArg("-replaydatadir", "");
+    if (snapshot.empty() || !boost::filesystem::is_directory(snapshot / "chainstate")) {
+        std::cerr << "-replaydatadir must point to a datadir containing a chainstate\n";
+        return EXIT_FAILURE;
+    }
+
+    SelectParams(ChainNameFromCommandLine());
+
+    nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
+    if (nScriptCheckThreads <= 0)
+        nScriptCheckThreads += GetNumCores();
+    if (nScriptCheckThreads <= 1)
+        nScriptCheckThreads = 0;
+    else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
+        nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
+
+    std::cout << "#Replay" << "," << "stage" << "," << "total_ms" << "," << "ms_per_block" << "\n";
+    int nRepetitions = GetArg("-replayrepetitions", 3);
+    for (int i = 0; i < nRepetitions; i++) {
+        if (!ReplayOnce(snapshot, nFrom, nTo, i))
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -3,9 +3,11 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "bench.h"
+#include "random.h"
 #include "wallet/wallet.h"
 
 #include <boost/foreach.hpp>
+#include <cmath>
 #include <set>
 
 static void addCoin(const CAmount& nValue, const CWallet& wallet, std::vector<COutput>& vCoins)
@@ -57,4 +59,62 @@ static void CoinSelection(benchmark::State& state)
     }
 }
 
+// A wallet that received many payments, like the hot wallet of an exchange: values are spread
+// log-uniformly between 0.001 and 100 coins
+static void CreateLargeWallet(const CWallet& wallet, std::vector<COutput>& vCoins, int nCoins)
+{
+    FastRandomContext rand(true);
+    for (int i = 0; i < nCoins; i++) {
+        double dExp = -3.0 + 5.0 * rand.rand32() / 4294967296.0;
+        addCoin((CAmount)(std::pow(10.0, dExp) * COIN), wallet, vCoins);
+    }
+}
+
+// Withdrawal amounts between 0.05 and 40 coins, with a few duffs of fee like CreateTransaction adds
+static CAmount GetLargeWalletTarget(int nIteration)
+{
+    static const CAmount vTargets[] = {5 * CENT, 12 * CENT, 75 * CENT, 1 * COIN, 3 * COIN + 17 * CENT, 10 * COIN, 40 * COIN};
+    return vTargets[nIteration % 7] + 226 + nIteration % 1000;
+}
+
+static void CoinSelectionLargeWallet(benchmark::State& state, bool fUseBnB)
+{
+    const CWallet wallet;
+    std::vector<COutput> vCoins;
+    LOCK(wallet.cs_wallet);
+    CreateLargeWallet(wallet, vCoins, 20000);
+
+    // 1000 duffs/kB
+    CoinSelectionParams params;
+    params.fUseBnB = true;
+    params.nInputFee = P2PKH_INPUT_SIZE;
+    params.nCostOfChange = P2PKH_INPUT_SIZE + P2PKH_OUTPUT_SIZE;
+
+    int nIteration = 0;
+    while (state.KeepRunning()) {
+        std::set<std::pair<const CWalletTx*, unsigned int> > setCoinsRet;
+        CAmount nValueRet;
+        CAmount nTarget = GetLargeWalletTarget(nIteration++);
+        // CreateTransaction falls back to the knapsack when there is no changeless solution
+        bool success = (fUseBnB && wallet.SelectCoinsMinConf(nTarget, 1, 6, 0, vCoins, setCoinsRet, nValueRet, ALL_COINS, false, &params)) ||
+                       wallet.SelectCoinsMinConf(nTarget, 1, 6, 0, vCoins, setCoinsRet, nValueRet);
+        assert(success);
+    }
+
+    BOOST_FOREACH (COutput output, vCoins)
+        delete output.tx;
+}
+
+static void CoinSelectionLargeWalletKnapsack(benchmark::State& state)
+{
+    CoinSelectionLargeWallet(state, false);
+}
+
+static void CoinSelectionLargeWalletBnB(benchmark::State& state)
+{
+    CoinSelectionLargeWallet(state, true);
+}
+
 BENCHMARK(CoinSelection);
+BENCHMARK(CoinSelectionLargeWalletKnapsack);
+BENCHMARK(CoinSelectionLargeWalletBnB);
@@ -0,0 +1,130 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "policy/policy.h"
+#include "txmempool.h"
+#include "validation.h"
+
+#include <limits>
+#include <vector>
+
+static void AddTx(const CTransactionRef& tx, CTxMemPool& pool)
+{
+    int64_t nTime = 0;
+    double dPriority = 10.0;
+    unsigned int nHeight = 1;
+    bool spendsCoinbase = false;
+    unsigned int sigOpCost = 4;
+    LockPoints lp;
+    pool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(
+                                         tx, 1000, nTime, dPriority, nHeight,
+                                         tx->GetValueOut(), spendsCoinbase, sigOpCost, lp));
+}
+
+// A chain of nLength transactions, each spending the only output of the previous one
+static std::vector<CTransactionRef> CreateChain(int nLength)
+{
+    std::vector<CTransactionRef> vTxs;
+    uint256 prevHash;
+    for (int i = 0; i < nLength; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(prevHash, 0);
+        tx.vin[0].scriptSig = CScript() << i << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = COIN;
+        vTxs.push_back(MakeTransactionRef(tx));
+        prevHash = vTxs.back()->GetHash();
+    }
+    return vTxs;
+}
+
+// nWidth parents with nWidth outputs each, and nWidth children spending one output of every parent
+static std::vector<CTransactionRef> CreateDiamonds(int nWidth)
+{
+    std::vector<CTransactionRef> vTxs;
+    for (int i = 0; i < nWidth; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << i << OP_2;
+        tx.vout.resize(nWidth);
+        for (int j = 0; j < nWidth; j++) {
+            tx.vout[j].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+            tx.vout[j].nValue = COIN;
+        }
+        vTxs.push_back(MakeTransactionRef(tx));
+    }
+    for (int i = 0; i < nWidth; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(nWidth);
+        for (int j = 0; j < nWidth; j++) {
+            tx.vin[j].prevout = COutPoint(vTxs[j]->GetHash(), i);
+        }
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_3 << OP_EQUAL;
+        tx.vout[0].nValue = COIN;
+        vTxs.push_back(MakeTransactionRef(tx));
+    }
+    return vTxs;
+}
+
+static void MempoolAncestorsChain(benchmark::State& state)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    std::vector<CTransactionRef> vTxs = CreateChain(DEFAULT_ANCESTOR_LIMIT);
+    for (const auto& tx : vTxs)
+        AddTx(tx, pool);
+
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::string dummy;
+    LOCK(pool.cs);
+    CTxMemPool::txiter tip = pool.mapTx.find(vTxs.back()->GetHash());
+    CTxMemPool::txiter root = pool.mapTx.find(vTxs.front()->GetHash());
+    while (state.KeepRunning()) {
+        CTxMemPool::setEntries setAncestors, setDescendants;
+        pool.CalculateMemPoolAncestors(*tip, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+        pool.CalculateDescendants(root, setDescendants);
+        assert(setAncestors.size() == setDescendants.size() - 1);
+    }
+}
+
+static void MempoolAncestorsDiamonds(benchmark::State& state)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    std::vector<CTransactionRef> vTxs = CreateDiamonds(20);
+    for (const auto& tx : vTxs)
+        AddTx(tx, pool);
+
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::string dummy;
+    LOCK(pool.cs);
+    while (state.KeepRunning()) {
+        // every child has all parents as ancestors, every parent has all children as descendants
+        for (const auto& tx : vTxs) {
+            CTxMemPool::txiter it = pool.mapTx.find(tx->GetHash());
+            CTxMemPool::setEntries setAncestors, setDescendants;
+            pool.CalculateMemPoolAncestors(*it, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+            pool.CalculateDescendants(it, setDescendants);
+        }
+    }
+}
+
+// Adding and removing a long chain updates the links and ancestor state of every entry
+static void MempoolAddRemoveChain(benchmark::State& state)
+{
+    std::vector<CTransactionRef> vTxs = CreateChain(DEFAULT_ANCESTOR_LIMIT);
+    while (state.KeepRunning()) {
+        CTxMemPool pool(CFeeRate(1000));
+        for (const auto& tx : vTxs)
+            AddTx(tx, pool);
+        pool.removeRecursive(*vTxs.front());
+        assert(pool.size() == 0);
+    }
+}
+
+BENCHMARK(MempoolAncestorsChain);
+BENCHMARK(MempoolAncestorsDiamonds);
+BENCHMARK(MempoolAddRemoveChain);
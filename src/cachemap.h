@@ -9,6 +9,7 @@
 #include <list>
 #include <cstddef>
 
+#include "memusage.h"
 #include "serialize.h"
 
 /**
@@ -103,6 +104,11 @@ public:
         return listItems.size();
     }
 
+    /// Memory used by the cache's own structures, not counting what the items own
+    size_t DynamicMemoryUsage() const {
+        return memusage::DynamicUsage(listItems) + memusage::DynamicUsage(mapIndex);
+    }
+
     bool Insert(const K& key, const V& value)
     {
         if(mapIndex.find(key) != mapIndex.end()) {
@@ -84,6 +84,15 @@ public:
         return listItems.size();
     }
 
+    /// Memory used by the cache's own structures, not counting what the items own
+    size_t DynamicMemoryUsage() const {
+        size_t nUsage = memusage::DynamicUsage(listItems) + memusage::DynamicUsage(mapIndex);
+        for (const auto& pair : mapIndex) {
+            nUsage += memusage::DynamicUsage(pair.second);
+        }
+        return nUsage;
+    }
+
     bool Insert(const K& key, const V& value)
     {
         map_it mit = mapIndex.find(key);
@@ -4,6 +4,32 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chain.h"
+#include "memusage.h"
+
+/**
+ * CBlockIndexArena implementation
+ */
+CBlockIndex* CBlockIndexArena::Allocate()
+{
+    if (nUsedInLastChunk == ENTRIES_PER_CHUNK) {
+        vChunks.emplace_back(new CBlockIndex[ENTRIES_PER_CHUNK]);
+        nUsedInLastChunk = 0;
+    }
+    nSize++;
+    return &vChunks.back()[nUsedInLastChunk++];
+}
+
+void CBlockIndexArena::Clear()
+{
+    vChunks.clear();
+    nUsedInLastChunk = ENTRIES_PER_CHUNK;
+    nSize = 0;
+}
+
+size_t CBlockIndexArena::DynamicMemoryUsage() const
+{
+    return vChunks.size() * memusage::MallocUsage(ENTRIES_PER_CHUNK * sizeof(CBlockIndex)) + memusage::DynamicUsage(vChunks);
+}
 
 /**
  * CChain implementation
@@ -12,6 +12,7 @@
 #include "tinyformat.h"
 #include "uint256.h"
 
+#include <memory>
 #include <vector>
 
 class CBlockFileInfo
@@ -163,20 +164,14 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
+    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
+    arith_uint256 nChainWork;
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
-    //! Which # file this block is stored in (blk?????.dat)
-    int nFile;
-
-    //! Byte offset within blk?????.dat where this block's data is stored
-    unsigned int nDataPos;
-
-    //! Byte offset within rev?????.dat where this block's undo data is stored
-    unsigned int nUndoPos;
-
-    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
-    arith_uint256 nChainWork;
+    //! Verification status of this block. See enum BlockStatus
+    unsigned int nStatus;
 
     //! Number of transactions in this block.
     //! Note: in a potential headers-first mode, this number cannot be relied upon
@@ -187,21 +182,33 @@ public:
     //! Change to 64-bit type when necessary; won't happen before 2030
     unsigned int nChainTx;
 
-    //! Verification status of this block. See enum BlockStatus
-    unsigned int nStatus;
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    int32_t nSequenceId;
 
-    //! block header
+    //! (memory only) Maximum nTime in the chain upto and including this block.
+    unsigned int nTimeMax;
+
+    //! block header fields used while walking the chain
     int nVersion;
-    uint256 hashMerkleRoot;
     unsigned int nTime;
     unsigned int nBits;
-    unsigned int nNonce;
 
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    int32_t nSequenceId;
+    //! Fields below are rarely accessed and kept at the end of the entry, away from the ones above which
+    //! are touched on every chain walk. On 64-bit platforms the fields take 140 bytes and the entry is
+    //! padded to 144, so one more 4-byte field fits without growing it.
 
-    //! (memory only) Maximum nTime in the chain upto and including this block.
-    unsigned int nTimeMax;
+    //! Which # file this block is stored in (blk?????.dat)
+    int nFile;
+
+    //! Byte offset within blk?????.dat where this block's data is stored
+    unsigned int nDataPos;
+
+    //! Byte offset within rev?????.dat where this block's undo data is stored
+    unsigned int nUndoPos;
+
+    //! block header fields only needed by GetBlockHeader()
+    uint256 hashMerkleRoot;
+    unsigned int nNonce;
 
     void SetNull()
     {
@@ -419,6 +426,36 @@ public:
     }
 };
 
+/**
+ * Owns the entries of the block index. Entries are allocated in large chunks instead of
+ * one heap allocation per entry and are only freed all at once, as the block index never
+ * removes single entries. Not thread-safe, protected by cs_main like mapBlockIndex.
+ */
+class CBlockIndexArena
+{
+private:
+    static const size_t ENTRIES_PER_CHUNK = 4096;
+
+    std::vector<std::unique_ptr<CBlockIndex[]> > vChunks;
+    size_t nUsedInLastChunk;
+    size_t nSize;
+
+public:
+    CBlockIndexArena() : nUsedInLastChunk(ENTRIES_PER_CHUNK), nSize(0) {}
+
+    CBlockIndexArena(const CBlockIndexArena&) = delete;
+    CBlockIndexArena& operator=(const CBlockIndexArena&) = delete;
+
+    /** Return a new, null entry which stays valid until Clear() is called */
+    CBlockIndex* Allocate();
+
+    /** Free all entries */
+    void Clear();
+
+    size_t size() const { return nSize; }
+    size_t DynamicMemoryUsage() const;
+};
+
 /** An in-memory indexed chain of blocks. */
 class CChain {
 private:
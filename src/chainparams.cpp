@@ -97,6 +97,42 @@ static CBlock FindDevNetGenesisBlock(const Consensus::Params& params, const CBlo
     assert(false);
 }
 
+static void MineGenesisBlock(CBlock& block)
+{
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(block.nBits);
+
+    for (block.nNonce = 0; block.nNonce < UINT32_MAX; block.nNonce++) {
+        if (UintToArith256(block.GetHash()) <= bnTarget)
+            return;
+    }
+
+    // test chains start with a very low difficulty, so this is very unlikely to happen
+    error("MineGenesisBlock: could not find a valid nonce");
+    assert(false);
+}
+
+void CChainParams::UpdateBlockHashFunction(BlockHashFunction func)
+{
+    nBlockHashFunction = func;
+    SetBlockHashFunction(func);
+
+    uint256 hashOldGenesis = consensus.hashGenesisBlock;
+    MineGenesisBlock(genesis);
+    consensus.hashGenesisBlock = genesis.GetHash();
+    if (consensus.defaultAssumeValid == hashOldGenesis)
+        consensus.defaultAssumeValid = consensus.hashGenesisBlock;
+    if (checkpointData.mapCheckpoints.count(0))
+        checkpointData.mapCheckpoints[0] = consensus.hashGenesisBlock;
+
+    if (!consensus.hashDevnetGenesisBlock.IsNull()) {
+        devnetGenesis = FindDevNetGenesisBlock(consensus, genesis, devnetGenesis.vtx[0]->GetValueOut());
+        consensus.hashDevnetGenesisBlock = devnetGenesis.GetHash();
+        if (checkpointData.mapCheckpoints.count(1))
+            checkpointData.mapCheckpoints[1] = consensus.hashDevnetGenesisBlock;
+    }
+}
+
 // this one is for testing only
 static Consensus::LLMQParams llmq10_60 = {
         .type = Consensus::LLMQ_10_60,
@@ -639,6 +675,11 @@ public:
         consensus.nHighSubsidyBlocks = nHighSubsidyBlocks;
         consensus.nHighSubsidyFactor = nHighSubsidyFactor;
     }
+
+    void UpdateDevnetBlockHashFunction(BlockHashFunction func)
+    {
+        UpdateBlockHashFunction(func);
+    }
 };
 static CDevNetParams *devNetParams;
 
@@ -816,6 +857,11 @@ public:
         consensus.nBudgetPaymentsStartBlock = nBudgetPaymentsStartBlock;
         consensus.nSuperblockStartBlock = nSuperblockStartBlock;
     }
+
+    void UpdateRegtestBlockHashFunction(BlockHashFunction func)
+    {
+        UpdateBlockHashFunction(func);
+    }
 };
 static CRegTestParams regTestParams;
 
@@ -844,6 +890,8 @@ CChainParams& Params(const std::string& chain)
 void SelectParams(const std::string& network)
 {
     if (network == CBaseChainParams::DEVNET) {
+        // the devnet genesis block is mined with the default hash function
+        SetBlockHashFunction(BLOCK_HASH_YESPOWER);
         devNetParams = (CDevNetParams*)new uint8_t[sizeof(CDevNetParams)];
         memset(devNetParams, 0, sizeof(CDevNetParams));
         new (devNetParams) CDevNetParams();
@@ -851,6 +899,7 @@ void SelectParams(const std::string& network)
 
     SelectBaseParams(network);
     pCurrentParams = &Params(network);
+    SetBlockHashFunction(pCurrentParams->GetBlockHashFunction());
 }
 
 void UpdateRegtestBIP9Parameters(Consensus::DeploymentPos d, int64_t nStartTime, int64_t nTimeout)
@@ -868,3 +917,14 @@ void UpdateDevnetSubsidyAndDiffParams(int nMinimumDifficultyBlocks, int nHighSub
     assert(devNetParams);
     devNetParams->UpdateSubsidyAndDiffParams(nMinimumDifficultyBlocks, nHighSubsidyBlocks, nHighSubsidyFactor);
 }
+
+void UpdateRegtestBlockHashFunction(BlockHashFunction func)
+{
+    regTestParams.UpdateRegtestBlockHashFunction(func);
+}
+
+void UpdateDevnetBlockHashFunction(BlockHashFunction func)
+{
+    assert(devNetParams);
+    devNetParams->UpdateDevnetBlockHashFunction(func);
+}
@@ -95,8 +95,13 @@ public:
     bool BIP9CheckMasternodesUpgraded() const { return fBIP9CheckMasternodesUpgraded; }
     const std::string& FounderAddress() const { return strFounderAddress; }       // volkshashHG
     double FounderFee() const { return dFounderFee; }       // volkshashHG
+    /** Hash function for block hashes and proof of work, always yespower on mainnet and testnet */
+    BlockHashFunction GetBlockHashFunction() const { return nBlockHashFunction; }
 protected:
-    CChainParams() {}
+    CChainParams() : nBlockHashFunction(BLOCK_HASH_YESPOWER) {}
+
+    /** Switch the block hash function and re-mine the genesis block(s) for it */
+    void UpdateBlockHashFunction(BlockHashFunction func);
 
     Consensus::Params consensus;
     CMessageHeader::MessageStartChars pchMessageStart;
@@ -127,6 +132,7 @@ protected:
     bool fBIP9CheckMasternodesUpgraded;
     std::string strFounderAddress;         // volkshashHG
     double dFounderFee;         // volkshashHG
+    BlockHashFunction nBlockHashFunction;
 };
 
 /**
@@ -161,4 +167,14 @@ void UpdateRegtestBudgetParameters(int nMasternodePaymentsStartBlock, int nBudge
  */
 void UpdateDevnetSubsidyAndDiffParams(int nMinimumDifficultyBlocks, int nHighSubsidyBlocks, int nHighSubsidyFactor);
 
+/**
+ * Allows switching the block hash function on regtest, e.g. to a cheap one for tests.
+ */
+void UpdateRegtestBlockHashFunction(BlockHashFunction func);
+
+/**
+ * Allows switching the block hash function on devnet.
+ */
+void UpdateDevnetBlockHashFunction(BlockHashFunction func);
+
 #endif // BITCOIN_CHAINPARAMS_H
@@ -8,6 +8,7 @@
 #include "memusage.h"
 #include "random.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <boost/foreach.hpp>
 
@@ -33,7 +34,7 @@ size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0), nCacheHits(0), nCacheMisses(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
@@ -41,8 +42,11 @@ size_t CCoinsViewCache::DynamicMemoryUsage() const {
 
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        nCacheHits++;
         return it;
+    }
+    nCacheMisses++;
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
@@ -215,6 +219,32 @@ void CCoinsViewCache::Uncache(const COutPoint& hash)
     }
 }
 
+bool CCoinsViewCache::Prefetch(const COutPoint& outpoint, Coin&& coin)
+{
+    if (coin.IsSpent())
+        return false;
+    std::pair<CCoinsMap::iterator, bool> ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple());
+    if (!ret.second)
+        return false;
+    ret.first->second.coin = std::move(coin);
+    cachedCoinsUsage += ret.first->second.coin.DynamicMemoryUsage();
+    return true;
+}
+
+void CCoinsViewCache::GetCachedOutpoints(std::vector<COutPoint>& vOutpointsRet, size_t nMax) const
+{
+    vOutpointsRet.reserve(vOutpointsRet.size() + std::min(cacheCoins.size(), nMax));
+    size_t nAdded = 0;
+    for (const auto& entry : cacheCoins) {
+        if (nAdded >= nMax)
+            break;
+        if (!entry.second.coin.IsSpent()) {
+            vOutpointsRet.push_back(entry.first);
+            nAdded++;
+        }
+    }
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
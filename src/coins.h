@@ -203,6 +203,10 @@ protected:
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    /* Lookups served from the cache and lookups passed on to the backing view. */
+    mutable uint64_t nCacheHits;
+    mutable uint64_t nCacheMisses;
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
@@ -261,12 +265,25 @@ public:
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Adds a coin read from the backing view ahead of its use, as if it was fetched. Nothing
+     * is changed if the cache already has an entry for the outpoint.
+     */
+    bool Prefetch(const COutPoint &outpoint, Coin&& coin);
+
+    //! Outpoints of the unspent coins held in the cache, stopping after nMax of them. The cache
+    //! keeps no access order, so which ones are returned past the limit is arbitrary.
+    void GetCachedOutpoints(std::vector<COutPoint>& vOutpointsRet, size_t nMax) const;
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    //! Number of lookups served from the cache and passed on to the backing view
+    void GetCacheStats(uint64_t& nHitsRet, uint64_t& nMissesRet) const { nHitsRet = nCacheHits; nMissesRet = nCacheMisses; }
+
     /** 
      * Amount of volkshash coming in to a transaction
      * Note that lightweight clients may not know anything besides the hash of previous transactions,
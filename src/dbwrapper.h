@@ -175,6 +175,12 @@ public:
         return piter->value().size();
     }
 
+    /** Append the still obfuscated value to buf, see CDBWrapper::DecodeValue() */
+    void AppendValueRaw(std::vector<char>& buf) {
+        leveldb::Slice slValue = piter->value();
+        buf.insert(buf.end(), slValue.data(), slValue.data() + slValue.size());
+    }
+
 };
 
 class CDBWrapper
@@ -251,6 +257,20 @@ public:
         return true;
     }
 
+    /** Deserialize a value previously copied with CDBIterator::AppendValueRaw(), safe to call from any thread */
+    template <typename V>
+    bool DecodeValue(const char* pbegin, const char* pend, V& value) const
+    {
+        try {
+            CDataStream ssValue(pbegin, pend, SER_DISK, CLIENT_VERSION);
+            ssValue.Xor(obfuscate_key);
+            ssValue >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
     template <typename K, typename V>
     bool Write(const K& key, const V& value, bool fSync = false)
     {
@@ -9,6 +9,7 @@
 #include "governance.h"
 #include "masternodeman.h"
 #include "masternode-payments.h"
+#include "masternode-sigworker.h"
 #include "masternode-sync.h"
 #include "privatesend.h"
 #ifdef ENABLE_WALLET
@@ -41,6 +42,7 @@ void CDSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, con
         return;
 
     deterministicMNManager->UpdatedBlockTip(pindexNew);
+    masternodeSigWorker.UpdatedBlockTip(pindexNew);
     llmq::quorumDummyDKG->UpdatedBlockTip(pindexNew, fInitialDownload);
 
     masternodeSync.UpdatedBlockTip(pindexNew, fInitialDownload, connman);
@@ -0,0 +1,379 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "eventnotifier.h"
+
+#include "compat.h"
+#include "tinyformat.h"
+#include "util.h"
+
+#include <boost/algorithm/string/replace.hpp>
+
+#include <chrono>
+#include <functional>
+#include <future>
+
+#ifndef WIN32
+#include <sys/un.h>
+#endif
+
+CEventNotifier eventNotifier;
+
+CEventNotifier::~CEventNotifier()
+{
+    Stop();
+    CloseSink();
+}
+
+const char* CEventNotifier::GetEventName(EventType type)
+{
+    switch (type) {
+        case EVENT_BLOCK: return "block";
+        case EVENT_WALLETTX: return "wallettx";
+        case EVENT_INSTANTSEND: return "instantsend";
+        default: return "unknown";
+    }
+}
+
+bool CEventNotifier::SetSink(const std::string& strSink, std::string& strError)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    CloseSink();
+    strSinkPath.clear();
+    fSinkSocket = false;
+
+    if (strSink.empty()) {
+        return true;
+    }
+    if (strSink.compare(0, 5, "unix:") == 0) {
+#ifdef WIN32
+        strError = _("Unix sockets are not supported on this platform");
+        return false;
+#else
+        std::string strPath = strSink.substr(5);
+        if (strPath.empty() || strPath.size() >= sizeof(((struct sockaddr_un*)nullptr)->sun_path)) {
+            strError = strprintf(_("Invalid unix socket path: %s"), strPath);
+            return false;
+        }
+        // the listener might not be up yet, connect when the first events are written
+        strSinkPath = strPath;
+        fSinkSocket = true;
+        return true;
+#endif
+    }
+
+    strSinkPath = strSink;
+    if (!OpenSink()) {
+        strError = strprintf(_("Unable to open event file %s"), strSinkPath);
+        strSinkPath.clear();
+        return false;
+    }
+    return true;
+}
+
+void CEventNotifier::SetCommand(EventType type, const std::string& strCmd)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    strCommands[type] = strCmd;
+}
+
+void CEventNotifier::SetQueueLimits(size_t nMaxQueueIn, int64_t nBatchMillisIn)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    nMaxQueue = std::max(nMaxQueueIn, (size_t)1);
+    nBatchMillis = std::max(nBatchMillisIn, (int64_t)0);
+}
+
+bool CEventNotifier::IsEnabled(EventType type) const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return !strSinkPath.empty() || !strCommands[type].empty();
+}
+
+bool CEventNotifier::OpenSink()
+{
+    if (!fSinkSocket) {
+        if (!fileSink) {
+            fileSink = fopen(strSinkPath.c_str(), "ab");
+        }
+        return fileSink != nullptr;
+    }
+#ifndef WIN32
+    if (fdSink >= 0) {
+        return true;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    // a stuck reader must not block the sink thread (and shutdown) forever
+    struct timeval timeout;
+    timeout.tv_sec = 5;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, strSinkPath.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return false;
+    }
+    fdSink = fd;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CEventNotifier::CloseSink()
+{
+    if (fileSink) {
+        fclose(fileSink);
+        fileSink = nullptr;
+    }
+#ifndef WIN32
+    if (fdSink >= 0) {
+        close(fdSink);
+        fdSink = -1;
+    }
+#endif
+}
+
+bool CEventNotifier::WriteSink(const std::string& strData)
+{
+    bool fOk = false;
+    if (OpenSink()) {
+        if (!fSinkSocket) {
+            fOk = fwrite(strData.data(), 1, strData.size(), fileSink) == strData.size() && fflush(fileSink) == 0;
+        } else {
+#ifndef WIN32
+            size_t nPos = 0;
+            while (nPos < strData.size()) {
+                ssize_t nSent = send(fdSink, strData.data() + nPos, strData.size() - nPos, MSG_NOSIGNAL);
+                if (nSent <= 0) {
+                    break;
+                }
+                nPos += nSent;
+            }
+            fOk = nPos == strData.size();
+#endif
+        }
+    }
+    if (!fOk) {
+        // reconnect/reopen on the next batch, only log the first failure in a row
+        CloseSink();
+        if (!fSinkError) {
+            LogPrintf("CEventNotifier::%s -- failed to write events to %s\n", __func__, strSinkPath);
+        }
+    } else if (fSinkError) {
+        LogPrintf("CEventNotifier::%s -- writing events to %s again\n", __func__, strSinkPath);
+    }
+    fSinkError = !fOk;
+    return fOk;
+}
+
+void CEventNotifier::Start()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (fRunning) {
+        return;
+    }
+    fStopping = false;
+    fRunning = true;
+    if (!strSinkPath.empty()) {
+        threadSink = std::thread(&TraceThread<std::function<void()> >, "eventsink", std::function<void()>(std::bind(&CEventNotifier::ThreadSink, this)));
+    }
+    for (const auto& strCmd : strCommands) {
+        if (!strCmd.empty()) {
+            threadCommands = std::thread(&TraceThread<std::function<void()> >, "notify", std::function<void()>(std::bind(&CEventNotifier::ThreadCommands, this)));
+            break;
+        }
+    }
+}
+
+void CEventNotifier::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (!fRunning) {
+            return;
+        }
+        fStopping = true;
+    }
+    condQueue.notify_all();
+    if (threadSink.joinable()) {
+        threadSink.join();
+    }
+    if (threadCommands.joinable()) {
+        threadCommands.join();
+    }
+
+    std::lock_guard<std::mutex> lock(cs);
+    nDropped += queueCommands.size();
+    queueCommands.clear();
+    setPendingCommands.clear();
+    fRunning = false;
+    condIdle.notify_all();
+
+    LogPrintf("CEventNotifier::%s -- %d events, %d lines written, %d commands run, %d coalesced, %d dropped\n", __func__,
+        nEvents.load(), nLinesWritten.load(), nCommandsRun.load(), nCoalesced.load(), nDropped.load());
+}
+
+void CEventNotifier::Notify(EventType type, const uint256& hash)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        bool fSink = !strSinkPath.empty();
+        bool fCommand = !strCommands[type].empty();
+        if (!fSink && !fCommand) {
+            return;
+        }
+        nEvents++;
+
+        if (fSink) {
+            if (queueSink.size() >= nMaxQueue) {
+                queueSink.pop_front();
+                nSinkDropped++;
+                nDropped++;
+            }
+            queueSink.emplace_back(strprintf("%s %s\n", GetEventName(type), hash.ToString()));
+        }
+
+        if (fCommand) {
+            event_t event(type, hash);
+            auto itBlock = queueCommands.end();
+            if (type == EVENT_BLOCK) {
+                for (auto it = queueCommands.begin(); it != queueCommands.end(); ++it) {
+                    if (it->first == EVENT_BLOCK) {
+                        itBlock = it;
+                        break;
+                    }
+                }
+            }
+            if (setPendingCommands.count(event)) {
+                nCoalesced++;
+            } else if (itBlock != queueCommands.end()) {
+                // the tip moved on before the command for the previous one ran
+                setPendingCommands.erase(*itBlock);
+                itBlock->second = hash;
+                setPendingCommands.insert(event);
+                nCoalesced++;
+            } else {
+                if (queueCommands.size() >= nMaxQueue) {
+                    setPendingCommands.erase(queueCommands.front());
+                    queueCommands.pop_front();
+                    nDropped++;
+                }
+                queueCommands.push_back(event);
+                setPendingCommands.insert(event);
+            }
+        }
+    }
+    condQueue.notify_all();
+}
+
+void CEventNotifier::ThreadSink()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        condQueue.wait(lock, [this] { return fStopping || !queueSink.empty() || nSinkDropped != 0; });
+        if (queueSink.empty() && nSinkDropped == 0) {
+            break; // stopping and nothing left to write
+        }
+        if (nBatchMillis > 0 && !fStopping) {
+            condQueue.wait_for(lock, std::chrono::milliseconds(nBatchMillis), [this] { return fStopping; });
+        }
+
+        std::string strData;
+        if (nSinkDropped != 0) {
+            strData = strprintf("dropped %d\n", nSinkDropped);
+            nSinkDropped = 0;
+        }
+        size_t nLines = queueSink.size();
+        for (const auto& strLine : queueSink) {
+            strData += strLine;
+        }
+        queueSink.clear();
+
+        nBusy++;
+        lock.unlock();
+        bool fOk = WriteSink(strData);
+        lock.lock();
+        nBusy--;
+
+        if (fOk) {
+            nLinesWritten += nLines;
+        } else {
+            nDropped += nLines;
+            nSinkDropped += nLines;
+            if (!fStopping) {
+                // don't spin on a sink that is gone, the next batch retries
+                condQueue.wait_for(lock, std::chrono::seconds(1), [this] { return fStopping; });
+            }
+            if (fStopping) {
+                nSinkDropped = 0;
+            }
+        }
+        condIdle.notify_all();
+    }
+}
+
+void CEventNotifier::ThreadCommands()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        condQueue.wait(lock, [this] { return fStopping || !queueCommands.empty(); });
+        if (fStopping) {
+            break;
+        }
+
+        event_t event = queueCommands.front();
+        queueCommands.pop_front();
+        setPendingCommands.erase(event);
+        std::string strCmd = strCommands[event.first];
+        boost::replace_all(strCmd, "%s", event.second.GetHex());
+
+        // A hung command must not block shutdown, so it runs on a thread of its own which is left
+        // running when stopping, like the other runCommand call sites do
+        std::packaged_task<void()> task(std::bind(runCommand, strCmd));
+        std::future<void> futureDone = task.get_future();
+        std::thread(std::move(task)).detach();
+
+        nBusy++;
+        while (futureDone.wait_for(std::chrono::seconds(0)) != std::future_status::ready && !fStopping) {
+            condQueue.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        nBusy--;
+        if (futureDone.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            nCommandsRun++;
+        }
+        condIdle.notify_all();
+    }
+}
+
+void CEventNotifier::WaitForIdle()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    condIdle.wait(lock, [this] {
+        if (!fRunning) {
+            return true;
+        }
+        bool fSinkIdle = strSinkPath.empty() || (queueSink.empty() && nSinkDropped == 0);
+        bool fCommandsIdle = !threadCommands.joinable() || queueCommands.empty();
+        return fSinkIdle && fCommandsIdle && nBusy == 0;
+    });
+}
+
+CEventNotifier::Stats CEventNotifier::GetStats() const
+{
+    Stats stats;
+    stats.nEvents = nEvents;
+    stats.nLinesWritten = nLinesWritten;
+    stats.nCommandsRun = nCommandsRun;
+    stats.nCoalesced = nCoalesced;
+    stats.nDropped = nDropped;
+    return stats;
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef EVENTNOTIFIER_H
+#define EVENTNOTIFIER_H
+
+#include "uint256.h"
+
+#include <atomic>
+#include <cstdio>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+
+class CEventNotifier;
+
+extern CEventNotifier eventNotifier;
+
+/** Default for -eventnotifyqueue, maximum number of pending events per queue */
+static const unsigned int DEFAULT_EVENTNOTIFY_QUEUE = 10000;
+/** Default for -eventnotifybatchms, time to collect events before writing them to the sink */
+static const int64_t DEFAULT_EVENTNOTIFY_BATCH_MS = 0;
+
+/**
+ * Delivers -blocknotify, -walletnotify and -instantsendnotify events without starting a thread
+ * for every event.
+ *
+ * Every event is written as a line "<event> <hash>" to the sink given by -eventnotify, which is
+ * either a file the lines are appended to or (with a "unix:" prefix) a unix stream socket some
+ * other process listens on. Lines are written in batches, at most one write per batch.
+ *
+ * The configured commands are still run with %s replaced by the hash, but one at a time by a
+ * single thread. Pending commands for the same event and hash are coalesced and only the most
+ * recent block is kept when several blocks are connected before the command gets to run.
+ *
+ * Both queues are bounded, the oldest events are dropped when they are full. A "dropped <n>" line
+ * tells sink readers that they have missed events and should resync.
+ */
+class CEventNotifier
+{
+public:
+    enum EventType {
+        EVENT_BLOCK,
+        EVENT_WALLETTX,
+        EVENT_INSTANTSEND,
+        EVENT_TYPE_COUNT
+    };
+
+    struct Stats {
+        uint64_t nEvents;
+        uint64_t nLinesWritten;
+        uint64_t nCommandsRun;
+        uint64_t nCoalesced;
+        uint64_t nDropped;
+    };
+
+private:
+    typedef std::pair<EventType, uint256> event_t;
+
+    mutable std::mutex cs;
+    std::condition_variable condQueue;
+    std::condition_variable condIdle;
+
+    std::string strCommands[EVENT_TYPE_COUNT];
+    std::string strSinkPath;
+    bool fSinkSocket{false};
+    FILE* fileSink{nullptr};
+    int fdSink{-1};
+    bool fSinkError{false};
+    size_t nMaxQueue{DEFAULT_EVENTNOTIFY_QUEUE};
+    int64_t nBatchMillis{DEFAULT_EVENTNOTIFY_BATCH_MS};
+
+    std::deque<std::string> queueSink;
+    uint64_t nSinkDropped{0};
+    std::deque<event_t> queueCommands;
+    std::set<event_t> setPendingCommands;
+    int nBusy{0};
+
+    std::thread threadSink;
+    std::thread threadCommands;
+    bool fStopping{false};
+    bool fRunning{false};
+
+    std::atomic<uint64_t> nEvents{0};
+    std::atomic<uint64_t> nLinesWritten{0};
+    std::atomic<uint64_t> nCommandsRun{0};
+    std::atomic<uint64_t> nCoalesced{0};
+    std::atomic<uint64_t> nDropped{0};
+
+    static const char* GetEventName(EventType type);
+
+    bool OpenSink();
+    void CloseSink();
+    bool WriteSink(const std::string& strData);
+
+    void ThreadSink();
+    void ThreadCommands();
+
+public:
+    ~CEventNotifier();
+
+    /**
+     * Configure the sink, either a file name or "unix:<path>". Must be called before Start,
+     * returns false and sets strError if the sink can't be used.
+     */
+    bool SetSink(const std::string& strSink, std::string& strError);
+    void SetCommand(EventType type, const std::string& strCmd);
+    void SetQueueLimits(size_t nMaxQueueIn, int64_t nBatchMillisIn);
+
+    /** Whether anything listens for events of this type, callers can skip building the event otherwise */
+    bool IsEnabled(EventType type) const;
+
+    void Start();
+    /**
+     * Stop the threads, pending commands are discarded but pending sink lines are still written.
+     * A command that is still running is not waited for.
+     */
+    void Stop();
+
+    /** Queue an event, never blocks on the sink or on running commands */
+    void Notify(EventType type, const uint256& hash);
+
+    /** Wait until all queued events have been delivered (used by tests) */
+    void WaitForIdle();
+
+    Stats GetStats() const;
+};
+
+#endif // EVENTNOTIFIER_H
@@ -170,35 +170,17 @@ static int CompareByLastPaid_GetHeight(const CDeterministicMN& dmn)
     return height;
 }
 
-static bool CompareByLastPaid(const CDeterministicMN& _a, const CDeterministicMN& _b)
+static CDeterministicMNList::MnPayeeOrderKey GetPayeeOrderKey(const CDeterministicMN& dmn)
 {
-    int ah = CompareByLastPaid_GetHeight(_a);
-    int bh = CompareByLastPaid_GetHeight(_b);
-    if (ah == bh) {
-        return _a.proTxHash < _b.proTxHash;
-    } else {
-        return ah < bh;
-    }
-}
-static bool CompareByLastPaid(const CDeterministicMNCPtr& _a, const CDeterministicMNCPtr& _b)
-{
-    return CompareByLastPaid(*_a, *_b);
+    return std::make_pair(CompareByLastPaid_GetHeight(dmn), dmn.proTxHash);
 }
 
 CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
 {
-    if (mnMap.size() == 0) {
+    if (mnPayeeOrder.empty()) {
         return nullptr;
     }
-
-    CDeterministicMNCPtr best;
-    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
-        if (!best || CompareByLastPaid(dmn, best)) {
-            best = dmn;
-        }
-    });
-
-    return best;
+    return GetMN(mnPayeeOrder.front().second);
 }
 
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int nCount) const
@@ -397,10 +379,55 @@ CDeterministicMNList CDeterministicMNList::ApplyDiff(const CDeterministicMNListD
     return result;
 }
 
+// index of the first entry in mnPayeeOrder which is not less than key
+static size_t PayeeOrderLowerBound(const CDeterministicMNList::MnPayeeOrder& order, const CDeterministicMNList::MnPayeeOrderKey& key)
+{
+    size_t first = 0;
+    size_t count = order.size();
+    while (count > 0) {
+        size_t step = count / 2;
+        if (order[first + step] < key) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+void CDeterministicMNList::AddToPayeeOrder(const CDeterministicMN& dmn)
+{
+    auto key = GetPayeeOrderKey(dmn);
+    mnPayeeOrder = mnPayeeOrder.insert(PayeeOrderLowerBound(mnPayeeOrder, key), key);
+}
+
+void CDeterministicMNList::RemoveFromPayeeOrder(const CDeterministicMN& dmn)
+{
+    auto key = GetPayeeOrderKey(dmn);
+    size_t pos = PayeeOrderLowerBound(mnPayeeOrder, key);
+    assert(pos < mnPayeeOrder.size() && mnPayeeOrder[pos] == key);
+    mnPayeeOrder = mnPayeeOrder.erase(pos);
+}
+
+void CDeterministicMNList::RebuildPayeeOrder()
+{
+    std::vector<MnPayeeOrderKey> vKeys;
+    vKeys.reserve(mnMap.size());
+    ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
+        vKeys.emplace_back(GetPayeeOrderKey(*dmn));
+    });
+    std::sort(vKeys.begin(), vKeys.end());
+    mnPayeeOrder = MnPayeeOrder(vKeys.begin(), vKeys.end());
+}
+
 void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn)
 {
     assert(!mnMap.find(dmn->proTxHash));
     mnMap = mnMap.set(dmn->proTxHash, dmn);
+    if (IsMNValid(dmn)) {
+        AddToPayeeOrder(*dmn);
+    }
     AddUniqueProperty(dmn, dmn->collateralOutpoint);
     if (dmn->pdmnState->addr != CService()) {
         AddUniqueProperty(dmn, dmn->pdmnState->addr);
@@ -413,13 +440,26 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn)
 
 void CDeterministicMNList::UpdateMN(const uint256& proTxHash, const CDeterministicMNStateCPtr& pdmnState)
 {
-    auto oldDmn = mnMap.find(proTxHash);
-    assert(oldDmn != nullptr);
-    auto dmn = std::make_shared<CDeterministicMN>(**oldDmn);
+    auto p = mnMap.find(proTxHash);
+    assert(p != nullptr);
+    CDeterministicMNCPtr oldDmn = *p;
+    auto dmn = std::make_shared<CDeterministicMN>(*oldDmn);
     auto oldState = dmn->pdmnState;
     dmn->pdmnState = pdmnState;
     mnMap = mnMap.set(proTxHash, dmn);
 
+    // most updates don't touch the payment order, e.g. service or key changes
+    bool fWasValid = IsMNValid(oldDmn);
+    bool fIsValid = IsMNValid(dmn);
+    if (fWasValid != fIsValid || (fIsValid && GetPayeeOrderKey(*oldDmn) != GetPayeeOrderKey(*dmn))) {
+        if (fWasValid) {
+            RemoveFromPayeeOrder(*oldDmn);
+        }
+        if (fIsValid) {
+            AddToPayeeOrder(*dmn);
+        }
+    }
+
     UpdateUniqueProperty(dmn, oldState->addr, pdmnState->addr);
     UpdateUniqueProperty(dmn, oldState->keyIDOwner, pdmnState->keyIDOwner);
     UpdateUniqueProperty(dmn, oldState->pubKeyOperator, pdmnState->pubKeyOperator);
@@ -437,6 +477,9 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
     if (dmn->pdmnState->pubKeyOperator.IsValid()) {
         DeleteUniqueProperty(dmn, dmn->pdmnState->pubKeyOperator);
     }
+    if (IsMNValid(dmn)) {
+        RemoveFromPayeeOrder(*dmn);
+    }
     mnMap = mnMap.erase(proTxHash);
 }
 
@@ -786,8 +829,10 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const uint256& blo
 
     auto it = mnListsCache.find(blockHash);
     if (it != mnListsCache.end()) {
+        nListsCacheHits++;
         return it->second;
     }
+    nListsCacheMisses++;
 
     uint256 blockHashTmp = blockHash;
     CDeterministicMNList snapshot;
@@ -828,6 +873,25 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const uint256& blo
     return snapshot;
 }
 
+void CDeterministicMNManager::SetListsCacheLimit(size_t nBytes)
+{
+    LOCK(cs);
+    nListsCacheSize = std::max<size_t>(LISTS_CACHE_SIZE, nBytes / LIST_CACHE_ENTRY_USAGE);
+}
+
+size_t CDeterministicMNManager::GetListsCacheUsage()
+{
+    LOCK(cs);
+    return mnListsCache.size() * LIST_CACHE_ENTRY_USAGE;
+}
+
+void CDeterministicMNManager::GetListsCacheStats(uint64_t& nHitsRet, uint64_t& nMissesRet)
+{
+    LOCK(cs);
+    nHitsRet = nListsCacheHits;
+    nMissesRet = nListsCacheMisses;
+}
+
 CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
 {
     LOCK(cs);
@@ -893,7 +957,7 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
 
     std::vector<uint256> toDelete;
     for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LISTS_CACHE_SIZE < nHeight) {
+        if (p.second.GetHeight() + nListsCacheSize < nHeight) {
             toDelete.emplace_back(p.first);
         }
     }
@@ -13,6 +13,7 @@
 #include "simplifiedmns.h"
 #include "sync.h"
 
+#include "immer/flex_vector.hpp"
 #include "immer/map.hpp"
 #include "immer/map_transient.hpp"
 
@@ -200,6 +201,9 @@ class CDeterministicMNList
 public:
     typedef immer::map<uint256, CDeterministicMNCPtr> MnMap;
     typedef immer::map<uint256, std::pair<uint256, uint32_t> > MnUniquePropertyMap;
+    // (last paid, revived or registered height, proTxHash), payments go to the lowest key first
+    typedef std::pair<int, uint256> MnPayeeOrderKey;
+    typedef immer::flex_vector<MnPayeeOrderKey> MnPayeeOrder;
 
 private:
     uint256 blockHash;
@@ -211,6 +215,10 @@ private:
     // the entries in the map are ref counted as some properties might appear multiple times per MN (e.g. operator/owner keys)
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // all valid MNs in the order in which they get paid. Like the maps, it is shared between copies of
+    // the list, so that the next payees are found without visiting all MNs
+    MnPayeeOrder mnPayeeOrder;
+
 public:
     CDeterministicMNList() {}
     explicit CDeterministicMNList(const uint256& _blockHash, int _height) :
@@ -229,6 +237,7 @@ public:
         if (ser_action.ForRead()) {
             UnserializeImmerMap(s, mnMap);
             UnserializeImmerMap(s, mnUniquePropertyMap);
+            RebuildPayeeOrder();
         } else {
             SerializeImmerMap(s, mnMap);
             SerializeImmerMap(s, mnUniquePropertyMap);
@@ -369,6 +378,10 @@ public:
     }
 
 private:
+    void AddToPayeeOrder(const CDeterministicMN& dmn);
+    void RemoveFromPayeeOrder(const CDeterministicMN& dmn);
+    void RebuildPayeeOrder();
+
     template <typename T>
     void AddUniqueProperty(const CDeterministicMNCPtr& dmn, const T& v)
     {
@@ -454,12 +467,20 @@ class CDeterministicMNManager
     static const int LISTS_CACHE_SIZE = 576;
 
 public:
+    // rough memory cost of one cached list, most of a list is shared with the lists of the neighbouring blocks
+    static const size_t LIST_CACHE_ENTRY_USAGE = 4096;
+    static const size_t MIN_LISTS_CACHE_USAGE = LISTS_CACHE_SIZE * LIST_CACHE_ENTRY_USAGE;
+
     CCriticalSection cs;
 
 private:
     CEvoDB& evoDb;
 
     std::map<uint256, CDeterministicMNList> mnListsCache;
+    // number of blocks to keep lists for, at least LISTS_CACHE_SIZE
+    int nListsCacheSize{LISTS_CACHE_SIZE};
+    uint64_t nListsCacheHits{0};
+    uint64_t nListsCacheMisses{0};
     int tipHeight{-1};
     uint256 tipBlockHash;
 
@@ -479,6 +500,11 @@ public:
     CDeterministicMNList GetListForBlock(const uint256& blockHash);
     CDeterministicMNList GetListAtChainTip();
 
+    // size the lists cache to about nBytes, it's never made smaller than MIN_LISTS_CACHE_USAGE
+    void SetListsCacheLimit(size_t nBytes);
+    size_t GetListsCacheUsage();
+    void GetListsCacheStats(uint64_t& nHitsRet, uint64_t& nMissesRet);
+
     // TODO remove after removal of old non-deterministic lists
     bool HasValidMNCollateralAtChainTip(const COutPoint& outpoint);
     bool HasMNCollateralAtChainTip(const COutPoint& outpoint);
@@ -172,10 +172,15 @@ public:
         strMagicMessage = strMagicMessageIn;
     }
 
-    bool Load(T& objToLoad)
+    /**
+     * Without fCleanup, the loaded data is not checked against the current state (e.g. the chain).
+     * This allows to load it before that state is available, the caller then has to call
+     * CheckAndRemove() itself.
+     */
+    bool Load(T& objToLoad, bool fCleanup = true)
     {
         LogPrintf("Reading info from %s...\n", strFilename);
-        ReadResult readResult = Read(objToLoad);
+        ReadResult readResult = Read(objToLoad, !fCleanup);
         if (readResult == FileError)
             LogPrintf("Missing file %s, will try to recreate\n", strFilename);
         else if (readResult != Ok)
@@ -491,6 +491,21 @@ void CGovernanceObject::GetData(UniValue& objResult)
 *
 */
 
+size_t CGovernanceObject::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    size_t nUsage = memusage::DynamicUsage(vchData) + memusage::DynamicUsage(vchSig);
+    nUsage += memusage::DynamicUsage(mapCurrentMNVotes);
+    for (const auto& votepair : mapCurrentMNVotes) {
+        nUsage += memusage::DynamicUsage(votepair.second.mapInstances);
+    }
+    nUsage += cmmapOrphanVotes.DynamicMemoryUsage();
+    for (const auto& item : cmmapOrphanVotes.GetItemList()) {
+        nUsage += item.value.first.DynamicMemoryUsage();
+    }
+    return nUsage + fileVotes.DynamicMemoryUsage();
+}
+
 std::string CGovernanceObject::GetDataAsHexString() const
 {
     return HexStr(vchData);
@@ -257,6 +257,9 @@ public:
         return fileVotes;
     }
 
+    /// Estimated memory used by the object's data, signature and votes
+    size_t DynamicMemoryUsage() const;
+
     // Signature related functions
 
     void SetMasternodeOutpoint(const COutPoint& outpoint);
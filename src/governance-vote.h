@@ -7,6 +7,7 @@
 #define GOVERNANCE_VOTE_H
 
 #include "key.h"
+#include "memusage.h"
 #include "primitives/transaction.h"
 #include "bls/bls.h"
 
@@ -105,6 +106,8 @@ public:
 
     const COutPoint& GetMasternodeOutpoint() const { return masternodeOutpoint; }
 
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(vchSig); }
+
     /**
     *   GetHash()
     *
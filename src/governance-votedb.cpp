@@ -55,6 +55,15 @@ std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
     return vecResult;
 }
 
+size_t CGovernanceObjectVoteFile::DynamicMemoryUsage() const
+{
+    size_t nUsage = memusage::DynamicUsage(listVotes) + memusage::DynamicUsage(mapVoteIndex);
+    for (const auto& vote : listVotes) {
+        nUsage += vote.DynamicMemoryUsage();
+    }
+    return nUsage;
+}
+
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
     vote_l_it it = listVotes.begin();
@@ -73,6 +73,8 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    size_t DynamicMemoryUsage() const;
+
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidProposalVotes(const COutPoint& outpointMasternode);
 
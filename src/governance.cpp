@@ -517,25 +517,33 @@ std::vector<CGovernanceVote> CGovernanceManager::GetCurrentVotes(const uint256&
     const CGovernanceObject& govobj = it->second;
 
     CMasternode mn;
-    std::map<COutPoint, CMasternode> mapMasternodes;
+    CMasternodeMan::masternode_map_t mapMasternodes;
     if (mnCollateralOutpointFilter.IsNull()) {
         mapMasternodes = mnodeman.GetFullMasternodeMap();
     } else if (mnodeman.Get(mnCollateralOutpointFilter, mn)) {
-        mapMasternodes[mnCollateralOutpointFilter] = mn;
+        mapMasternodes = mapMasternodes.set(mnCollateralOutpointFilter, mn);
     }
 
-    // Loop thru each MN collateral outpoint and get the votes for the `nParentHash` governance object
+    // The snapshot doesn't iterate in outpoint order, sort it so that the votes come in the same order every time
+    std::vector<COutPoint> vecOutpoints;
+    vecOutpoints.reserve(mapMasternodes.size());
     for (const auto& mnpair : mapMasternodes) {
+        vecOutpoints.emplace_back(mnpair.first);
+    }
+    std::sort(vecOutpoints.begin(), vecOutpoints.end());
+
+    // Loop thru each MN collateral outpoint and get the votes for the `nParentHash` governance object
+    for (const auto& outpoint : vecOutpoints) {
         // get a vote_rec_t from the govobj
         vote_rec_t voteRecord;
-        if (!govobj.GetCurrentMNVotes(mnpair.first, voteRecord)) continue;
+        if (!govobj.GetCurrentMNVotes(outpoint, voteRecord)) continue;
 
         for (const auto& voteInstancePair : voteRecord.mapInstances) {
             int signal = voteInstancePair.first;
             int outcome = voteInstancePair.second.eOutcome;
             int64_t nCreationTime = voteInstancePair.second.nCreationTime;
 
-            CGovernanceVote vote = CGovernanceVote(mnpair.first, nParentHash, (vote_signal_enum_t)signal, (vote_outcome_enum_t)outcome);
+            CGovernanceVote vote = CGovernanceVote(outpoint, nParentHash, (vote_signal_enum_t)signal, (vote_outcome_enum_t)outcome);
             vote.SetTime(nCreationTime);
 
             vecResult.push_back(vote);
@@ -1229,6 +1237,36 @@ void CGovernanceManager::InitOnLoad()
     LogPrintf("     %s\n", ToString());
 }
 
+size_t CGovernanceManager::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    size_t nUsage = memusage::DynamicUsage(mapObjects) + memusage::DynamicUsage(mapPostponedObjects);
+    for (const auto& objpair : mapObjects) {
+        nUsage += objpair.second.DynamicMemoryUsage();
+    }
+    for (const auto& objpair : mapPostponedObjects) {
+        nUsage += objpair.second.DynamicMemoryUsage();
+    }
+    nUsage += memusage::DynamicUsage(mapErasedGovernanceObjects);
+    nUsage += memusage::DynamicUsage(mapMasternodeOrphanObjects);
+    for (const auto& objpair : mapMasternodeOrphanObjects) {
+        nUsage += objpair.second.first.DynamicMemoryUsage();
+    }
+    nUsage += memusage::DynamicUsage(mapMasternodeOrphanCounter) + memusage::DynamicUsage(setAdditionalRelayObjects);
+    nUsage += cmapVoteToObject.DynamicMemoryUsage();
+    nUsage += cmapInvalidVotes.DynamicMemoryUsage();
+    for (const auto& item : cmapInvalidVotes.GetItemList()) {
+        nUsage += item.value.DynamicMemoryUsage();
+    }
+    nUsage += cmmapOrphanVotes.DynamicMemoryUsage();
+    for (const auto& item : cmmapOrphanVotes.GetItemList()) {
+        nUsage += item.value.first.DynamicMemoryUsage();
+    }
+    nUsage += memusage::DynamicUsage(mapLastMasternodeObject);
+    nUsage += memusage::DynamicUsage(setRequestedObjects) + memusage::DynamicUsage(setRequestedVotes);
+    return nUsage;
+}
+
 std::string CGovernanceManager::ToString() const
 {
     LOCK(cs);
@@ -338,6 +338,9 @@ public:
     std::string ToString() const;
     UniValue ToJson() const;
 
+    /// Estimated memory used by the governance objects, their votes and the caches around them
+    size_t DynamicMemoryUsage() const;
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -22,6 +22,8 @@
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
+#include "memorybudget.h"
+#include "memoryregistry.h"
 #include "validation.h"
 #include "miner.h"
 #include "netbase.h"
@@ -37,7 +39,9 @@
 #include "timedata.h"
 #include "txdb.h"
 #include "txmempool.h"
+#include "txreconciliation.h"
 #include "torcontrol.h"
+#include "trustedheaders.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
@@ -48,6 +52,7 @@
 
 #include "activemasternode.h"
 #include "dsnotificationinterface.h"
+#include "eventnotifier.h"
 #include "flat-database.h"
 #include "governance.h"
 #include "instantx.h"
@@ -55,6 +60,8 @@
 #include "keepass.h"
 #endif
 #include "masternode-payments.h"
+#include "masternode-sigworker.h"
+#include "msglanes.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
 #include "masternodeconfig.h"
@@ -69,10 +76,13 @@
 
 #include "evo/deterministicmns.h"
 
+#include "llmq/quorums_blockprocessor.h"
 #include "llmq/quorums_init.h"
 
 #include <stdint.h>
 #include <stdio.h>
+#include <atomic>
+#include <future>
 #include <memory>
 
 #include "bls/bls.h"
@@ -106,6 +116,7 @@ static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
 
 
 std::unique_ptr<CConnman> g_connman;
+CScheduler* g_scheduler = nullptr;
 std::unique_ptr<PeerLogicValidation> peerLogic;
 
 #if ENABLE_ZMQ
@@ -239,6 +250,7 @@ void PrepareShutdown()
     StopREST();
     StopRPC();
     StopHTTPServer();
+    g_scheduler = nullptr;
 
     // fRPCInWarmup should be `false` if we completed the loading sequence
     // before a shutdown request was received
@@ -259,9 +271,12 @@ void PrepareShutdown()
     peerLogic.reset();
     if (g_connman) {
         // make sure to stop all threads before g_connman is reset to nullptr as these threads might still be accessing it
+        messageLanes.Stop();
         g_connman->Stop();
     }
     g_connman.reset();
+    masternodeSigWorker.Stop();
+    eventNotifier.Stop();
 
     if (!fLiteMode && !fRPCInWarmup) {
         // STORE DATA CACHES INTO SERIALIZED DAT FILES
@@ -297,6 +312,14 @@ void PrepareShutdown()
         fFeeEstimatesInitialized = false;
     }
 
+    // the budget and the registry call into the caches deleted below
+    memoryBudget.Clear();
+    memoryRegistry.Clear();
+
+    // before the flush below empties the cache
+    if (GetBoolArg("-persistcoinscache", DEFAULT_PERSIST_COINS_CACHE))
+        DumpCoinsCache();
+
     {
         LOCK(cs_main);
         if (pcoinsTip != NULL) {
@@ -448,13 +471,22 @@ std::string HelpMessage(HelpMessageMode mode)
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-eventnotify=<file>", _("Append a line \"<event> <hash>\" to <file> for every block, wallet transaction and InstantSend lock notification, use unix:<path> to write to a unix socket instead. Notify commands run one at a time, pending commands for the same hash or for older blocks are coalesced"));
+    if (showDebug) {
+        strUsage += HelpMessageOpt("-eventnotifybatchms=<n>", strprintf("Collect events for <n> milliseconds before writing them to the -eventnotify sink (default: %d)", DEFAULT_EVENTNOTIFY_BATCH_MS));
+        strUsage += HelpMessageOpt("-eventnotifyqueue=<n>", strprintf("Keep at most <n> pending events for the sink and for notify commands, older events are dropped (default: %u)", DEFAULT_EVENTNOTIFY_QUEUE));
+    }
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+    strUsage += HelpMessageOpt("-maxmemory=<n>", strprintf(_("Share <n> megabytes between the database caches, the UTXO cache, the mempool, the signature cache and the masternode list cache, moving memory to the caches that need it most. Overrides -dbcache, -maxmempool and -maxsigcachesize (at least %d, default: %d)"), MIN_MAX_MEMORY, DEFAULT_MAX_MEMORY));
     strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE));
     strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions in the mempool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-schedulerthreads=<n>", strprintf("Set the number of threads running scheduled tasks (1 to %d, default: %d)", MAX_SCHEDULER_THREADS, DEFAULT_SCHEDULER_THREADS));
+    strUsage += HelpMessageOpt("-persistcoinscache", strprintf(_("Whether to save the outpoints held by the UTXO cache on shutdown and prefetch them at the next startup (default: %u)"), DEFAULT_PERSIST_COINS_CACHE));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
@@ -466,6 +498,7 @@ std::string HelpMessage(HelpMessageMode mode)
 #ifndef WIN32
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
+    strUsage += HelpMessageOpt("-trustedheaders=<file>", _("Accept headers below the height of the signed trusted header table in <file> without computing their proof of work hash first, they are verified in the background"));
     strUsage += HelpMessageOpt("-txindex", strprintf(_("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)"), DEFAULT_TXINDEX));
 
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
@@ -490,6 +523,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
     strUsage += HelpMessageOpt("-maxtimeadjustment", strprintf(_("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)"), DEFAULT_MAX_TIME_ADJUSTMENT));
+    strUsage += HelpMessageOpt("-msglanes", strprintf(_("Process masternode, governance, PrivateSend, spork and quorum messages on separate threads (default: %u)"), DEFAULT_MSGLANES));
+    strUsage += HelpMessageOpt("-netthreads=<n>", strprintf(_("Number of threads to send and receive peer data (1 to %d, default: %d)"), MAX_NET_THREADS, DEFAULT_NET_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), DEFAULT_PERMIT_BAREMULTISIG));
@@ -501,6 +536,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
+    strUsage += HelpMessageOpt("-txreconciliation", strprintf(_("Announce transactions to peers supporting it by set reconciliation instead of flooding (default: %u)"), DEFAULT_TXRECONCILIATION_ENABLE));
 #ifdef USE_UPNP
 #if USE_UPNP
     strUsage += HelpMessageOpt("-upnp", _("Use UPnP to map the listening port (default: 1 when listening and no -proxy)"));
@@ -554,6 +590,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitdescendantcount=<n>", strprintf("Do not accept transactions if any ancestor would have <n> or more in-mempool descendants (default: %u)", DEFAULT_DESCENDANT_LIMIT));
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-bip9params=deployment:start:end", "Use given start/end times for specified BIP9 deployment (regtest-only)");
+        strUsage += HelpMessageOpt("-cheapblockhash", strprintf("Use SHA256d instead of yespower for block hashes and proof of work, much faster for tests (regtest and devnet only, default: %u)", DEFAULT_CHEAP_BLOCK_HASH));
     }
     std::string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, http, leveldb, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, tor, zmq, "
                                   "volkshash (or specifically: gobject, instantsend, keepass, masternode, mnpayments, mnsync, privatesend, spork)"; // Don't translate these and qt below
@@ -678,10 +715,7 @@ static void BlockNotifyCallback(bool initialSync, const CBlockIndex *pBlockIndex
     if (initialSync || !pBlockIndex)
         return;
 
-    std::string strCmd = GetArg("-blocknotify", "");
-
-    boost::replace_all(strCmd, "%s", pBlockIndex->GetBlockHash().GetHex());
-    boost::thread t(runCommand, strCmd); // thread runs free
+    eventNotifier.Notify(CEventNotifier::EVENT_BLOCK, pBlockIndex->GetBlockHash());
 }
 
 static bool fHaveGenesis = false;
@@ -754,6 +788,81 @@ void CleanupBlockRevFiles()
     }
 }
 
+/**
+ * Reads the masternode, governance and InstantSend caches in the background. Reading them doesn't
+ * depend on the chain state, so it overlaps with loading and verifying the block index. Cleaning
+ * them up against the chain state is left to Step 11d, in the same order as before.
+ */
+class CCacheLoader
+{
+private:
+    struct Stage
+    {
+        std::string strFilename;
+        std::string strError;
+        std::future<bool> result;
+        std::atomic<int64_t> nTimeMillis{0};
+    };
+
+    std::map<std::string, std::unique_ptr<Stage>> mapStages;
+
+public:
+    // waits for the remaining stages if initialization is aborted early
+    ~CCacheLoader()
+    {
+        for (auto& p : mapStages) {
+            if (p.second->result.valid()) {
+                p.second->result.wait();
+            }
+        }
+    }
+
+    template<typename T>
+    void Start(const std::string& strFilename, const std::string& strMagicMessage, const std::string& strError, T& objToLoad)
+    {
+        std::unique_ptr<Stage> stage(new Stage());
+        stage->strFilename = strFilename;
+        stage->strError = strError;
+        Stage* pstage = stage.get();
+        stage->result = std::async(std::launch::async, [pstage, strMagicMessage, &objToLoad] {
+            RenameThread("volkshash-loadcache");
+            int64_t nStart = GetTimeMillis();
+            CFlatDB<T> flatdb(pstage->strFilename, strMagicMessage);
+            bool fRet = flatdb.Load(objToLoad, false);
+            pstage->nTimeMillis = GetTimeMillis() - nStart;
+            return fRet;
+        });
+        mapStages.emplace(strFilename, std::move(stage));
+    }
+
+    // Waits for a stage whose data turned out to be unneeded
+    template<typename T>
+    void Discard(const std::string& strFilename, T& objToLoad)
+    {
+        mapStages.at(strFilename)->result.wait();
+        objToLoad.Clear();
+    }
+
+    // Waits for a stage and cleans up the loaded data, returns false with strErrorRet set on failure
+    template<typename T>
+    bool Finish(const std::string& strFilename, T& objToLoad, std::string& strErrorRet)
+    {
+        Stage& stage = *mapStages.at(strFilename);
+        int64_t nStart = GetTimeMillis();
+        if (!stage.result.get()) {
+            strErrorRet = stage.strError + "\n" + (GetDataDir() / strFilename).string();
+            return false;
+        }
+        int64_t nWaitMillis = GetTimeMillis() - nStart;
+
+        nStart = GetTimeMillis();
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
+        LogPrintf(" %-16s load %6dms (waited %dms), cleanup %6dms\n", strFilename, stage.nTimeMillis.load(), nWaitMillis, GetTimeMillis() - nStart);
+        return true;
+    }
+};
+
 void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
 {
     const CChainParams& chainparams = Params();
@@ -1185,6 +1294,10 @@ bool AppInitParameterInteraction()
     int64_t nMempoolSizeMin = GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000 * 40;
     if (nMempoolSizeMax < 0 || nMempoolSizeMax < nMempoolSizeMin)
         return InitError(strprintf(_("-maxmempool must be at least %d MB"), std::ceil(nMempoolSizeMin / 1000000.0)));
+    mempool.SetSizeLimit(nMempoolSizeMax);
+    int64_t nMaxMemory = GetArg("-maxmemory", DEFAULT_MAX_MEMORY);
+    if (nMaxMemory != 0 && nMaxMemory < MIN_MAX_MEMORY)
+        return InitError(strprintf(_("-maxmemory must be 0 or at least %d MB"), MIN_MAX_MEMORY));
     // incremental relay fee sets the minimimum feerate increase necessary for BIP 125 replacement in the mempool
     // and the amount the mempool min fee increases above the feerate of txs evicted due to mempool limiting.
     if (IsArgSet("-incrementalrelayfee"))
@@ -1291,6 +1404,8 @@ bool AppInitParameterInteraction()
     if (GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
 
+    txreconciliation.SetEnabled(GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION_ENABLE));
+
     nMaxTipAge = GetArg("-maxtipage", DEFAULT_MAX_TIP_AGE);
 
     if (mapMultiArgs.count("-bip9params")) {
@@ -1362,6 +1477,17 @@ bool AppInitParameterInteraction()
         return InitError("Difficulty and subsidy parameters may only be overridden on devnet.");
     }
 
+    if (GetBoolArg("-cheapblockhash", DEFAULT_CHEAP_BLOCK_HASH)) {
+        if (chainparams.MineBlocksOnDemand()) {
+            UpdateRegtestBlockHashFunction(BLOCK_HASH_SHA256D);
+        } else if (chainparams.NetworkIDString() == CBaseChainParams::DEVNET) {
+            UpdateDevnetBlockHashFunction(BLOCK_HASH_SHA256D);
+        } else {
+            return InitError("The cheap block hash may only be used on regtest and devnet.");
+        }
+        LogPrintf("Using SHA256d block hashes, genesis block %s\n", chainparams.GetConsensus().hashGenesisBlock.ToString());
+    }
+
     return true;
 }
 
@@ -1435,7 +1561,13 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Using config file %s\n", GetConfigFile(GetArg("-conf", BITCOIN_CONF_FILENAME)).string());
     LogPrintf("Using at most %i automatic connections (%i file descriptors available)\n", nMaxConnections, nFD);
 
-    InitSignatureCache();
+    int64_t nMaxMemory = GetArg("-maxmemory", DEFAULT_MAX_MEMORY) << 20;
+    size_t nSigCacheUsage;
+    if (nMaxMemory > 0) {
+        nSigCacheUsage = InitSignatureCache(std::min(nMaxMemory / 32, MAX_MAX_SIG_CACHE_SIZE << 20));
+    } else {
+        nSigCacheUsage = InitSignatureCache();
+    }
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
@@ -1467,9 +1599,31 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads
+    int nSchedulerThreads = std::max(1, std::min((int)GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), MAX_SCHEDULER_THREADS));
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
-    threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    for (int i = 0; i < nSchedulerThreads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    g_scheduler = &scheduler;
+
+    // Deliver -blocknotify, -walletnotify, -instantsendnotify and -eventnotify events
+    if (IsArgSet("-eventnotify")) {
+        std::string strSink = GetArg("-eventnotify", "");
+        if (strSink.compare(0, 5, "unix:") != 0) {
+            boost::filesystem::path pathSink(strSink);
+            if (!pathSink.is_complete())
+                pathSink = GetDataDir() / pathSink;
+            strSink = pathSink.string();
+        }
+        std::string strError;
+        if (!eventNotifier.SetSink(strSink, strError))
+            return InitError(strError);
+    }
+    eventNotifier.SetCommand(CEventNotifier::EVENT_BLOCK, GetArg("-blocknotify", ""));
+    eventNotifier.SetCommand(CEventNotifier::EVENT_WALLETTX, GetArg("-walletnotify", ""));
+    eventNotifier.SetCommand(CEventNotifier::EVENT_INSTANTSEND, GetArg("-instantsendnotify", ""));
+    eventNotifier.SetQueueLimits(GetArg("-eventnotifyqueue", DEFAULT_EVENTNOTIFY_QUEUE), GetArg("-eventnotifybatchms", DEFAULT_EVENTNOTIFY_BATCH_MS));
+    eventNotifier.Start();
 
     /* Start the RPC server already.  It will be started in "warmup" mode
      * and not really process calls already (but it will signify connections
@@ -1682,6 +1836,18 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
+    // started here, so that reading the caches overlaps with loading the block index, see Step 11d
+    CCacheLoader cacheLoader;
+    if (!fLiteMode) {
+        cacheLoader.Start("mncache.dat", "magicMasternodeCache", _("Failed to load masternode cache from"), mnodeman);
+        cacheLoader.Start("mnpayments.dat", "magicMasternodePaymentsCache", _("Failed to load masternode payments cache from"), mnpayments);
+        cacheLoader.Start("governance.dat", "magicGovernanceCache", _("Failed to load governance cache from"), governance);
+        cacheLoader.Start("netfulfilled.dat", "magicFulfilledCache", _("Failed to load fulfilled requests cache from"), netfulfilledman);
+        if (GetBoolArg("-enableinstantsend", 1)) {
+            cacheLoader.Start("instantsend.dat", "magicInstantSendCache", _("Failed to load InstantSend data cache from"), instantsend);
+        }
+    }
+
     // ********************************************************* Step 7b: load block chain
 
     fReindex = GetBoolArg("-reindex", false);
@@ -1714,6 +1880,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
+    if (IsArgSet("-trustedheaders")) {
+        std::string strError;
+        if (!trustedHeaders.Load(GetArg("-trustedheaders", ""), strError))
+            return InitError(strError);
+    }
+
     // cache size calculations
     int64_t nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
@@ -1727,7 +1899,33 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t nEvoDbCache = 1024 * 1024 * 16; // TODO
+    int64_t nMnListsCache = CDeterministicMNManager::MIN_LISTS_CACHE_USAGE;
+    // shares of the dynamic caches under -maxmemory, each given as {initial, min, max}
+    int64_t nMempoolShare[3] = {nMempoolSizeMax, nMempoolSizeMax, nMempoolSizeMax};
+    int64_t nCoinCacheShare[3], nMnListsShare[3] = {nMnListsCache, nMnListsCache, nMnListsCache};
+    if (nMaxMemory > 0) {
+        // the database caches can't be resized once opened, they get a fixed part of the budget
+        nBlockTreeDBCache = std::min(nMaxMemory / 32, (GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
+        nCoinDBCache = std::min(nMaxMemory / 8, nMaxCoinsDBCache << 20);
+        int64_t nDynamic = nMaxMemory - nBlockTreeDBCache - nCoinDBCache - nEvoDbCache - nSigCacheUsage;
+        int64_t nMempoolSizeMin = GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000 * 40;
+        nMempoolShare[0] = std::max(std::min<int64_t>(DEFAULT_MAX_MEMPOOL_SIZE * 1000000, nDynamic / 4), nMempoolSizeMin);
+        nMempoolShare[1] = nMempoolSizeMin;
+        nMempoolShare[2] = std::max(nDynamic / 2, nMempoolSizeMin);
+        nMnListsShare[2] = std::max(nDynamic / 16, nMnListsCache);
+        nCoinCacheShare[0] = std::max(nDynamic - nMempoolShare[0] - nMnListsShare[0], nMinDbCache << 20);
+        nCoinCacheShare[1] = std::max(nDynamic / 16, nMinDbCache << 20);
+        nCoinCacheShare[2] = std::max(nDynamic, nCoinCacheShare[0]);
+        nCoinCacheUsage = nCoinCacheShare[0];
+        nMempoolSizeMax = nMempoolShare[0];
+        mempool.SetSizeLimit(nMempoolSizeMax);
+        memoryBudget.SetTotal(nMaxMemory);
+    } else {
+        nCoinCacheShare[0] = nCoinCacheShare[1] = nCoinCacheShare[2] = nCoinCacheUsage;
+    }
     LogPrintf("Cache configuration:\n");
+    if (nMaxMemory > 0)
+        LogPrintf("* Sharing %.1fMiB between all caches (-maxmemory)\n", nMaxMemory * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
@@ -1825,11 +2023,13 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     }
                 }
 
+                int64_t nStartVerify = GetTimeMillis();
                 if (!CVerifyDB().VerifyDB(chainparams, pcoinsdbview, GetArg("-checklevel", DEFAULT_CHECKLEVEL),
                               GetArg("-checkblocks", DEFAULT_CHECKBLOCKS))) {
                     strLoadError = _("Corrupted block database detected");
                     break;
                 }
+                LogPrintf(" verify db %17dms\n", GetTimeMillis() - nStartVerify);
             } catch (const std::exception& e) {
                 if (fDebug) LogPrintf("%s\n", e.what());
                 strLoadError = _("Error opening block database");
@@ -1869,6 +2069,36 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     }
     LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
 
+    // Register the caches with the memory budget. Without -maxmemory their shares stay at the
+    // configured sizes and the budget only reports their usage.
+    memoryBudget.RegisterFixed("blocktreedb", nBlockTreeDBCache);
+    memoryBudget.RegisterFixed("coinsdb", nCoinDBCache);
+    memoryBudget.RegisterFixed("evodb", nEvoDbCache);
+    memoryBudget.RegisterFixed("sigcache", nSigCacheUsage);
+    memoryBudget.RegisterDynamic("coinscache", nCoinCacheShare[0], nCoinCacheShare[1], nCoinCacheShare[2], 8, 1,
+        []() { LOCK(cs_main); return GetCoinsCacheUsage(); },
+        [](size_t nLimit) { LOCK(cs_main); nCoinCacheUsage = nLimit; },
+        [](uint64_t& nHits, uint64_t& nMisses) { LOCK(cs_main); pcoinsTip->GetCacheStats(nHits, nMisses); });
+    memoryBudget.RegisterDynamic("mempool", nMempoolShare[0], nMempoolShare[1], nMempoolShare[2], 0, 2,
+        []() { return mempool.DynamicMemoryUsage(); },
+        [](size_t nLimit) { mempool.SetSizeLimit(nLimit); });
+    memoryBudget.RegisterDynamic("mnlists", nMnListsShare[0], nMnListsShare[1], nMnListsShare[2], 0, 1,
+        []() { return deterministicMNManager->GetListsCacheUsage(); },
+        [](size_t nLimit) { deterministicMNManager->SetListsCacheLimit(nLimit); },
+        [](uint64_t& nHits, uint64_t& nMisses) { deterministicMNManager->GetListsCacheStats(nHits, nMisses); });
+
+    // Long-lived subsystems report their usage for getmemoryinfo "subsystems"
+    memoryRegistry.Register("addrman", []() { return g_connman ? g_connman->GetAddressMemoryUsage() : 0; });
+    memoryRegistry.Register("coinscache", []() { LOCK(cs_main); return pcoinsTip->DynamicMemoryUsage(); });
+    memoryRegistry.Register("governance", []() { return governance.DynamicMemoryUsage(); });
+    memoryRegistry.Register("instantsend", []() { return instantsend.DynamicMemoryUsage(); });
+    memoryRegistry.Register("llmq", []() { return llmq::quorumBlockProcessor ? llmq::quorumBlockProcessor->GetMinableCommitmentsUsage() : 0; });
+    memoryRegistry.Register("masternodes", []() { return mnodeman.DynamicMemoryUsage(); });
+    memoryRegistry.Register("mempool", []() { return mempool.DynamicMemoryUsage(); });
+    memoryRegistry.Register("mnlists", []() { return deterministicMNManager->GetListsCacheUsage(); });
+    memoryRegistry.Register("orphantxs", []() { return GetOrphanTxsMemoryUsage(); });
+    memoryRegistry.Register("sigcache", [nSigCacheUsage]() { return nSigCacheUsage; });
+
     boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fopen(est_path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -1910,7 +2140,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         fHaveGenesis = true;
     }
 
-    if (IsArgSet("-blocknotify"))
+    if (eventNotifier.IsEnabled(CEventNotifier::EVENT_BLOCK))
         uiInterface.NotifyBlockTip.connect(BlockNotifyCallback);
 
     std::vector<boost::filesystem::path> vImportFiles;
@@ -1922,6 +2152,16 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
+    if (GetBoolArg("-persistcoinscache", DEFAULT_PERSIST_COINS_CACHE) && !fReindex && !fReindexChainState) {
+        threadGroup.create_thread(boost::bind(&TraceThread<std::function<void()> >, "loadcoins",
+                std::function<void()>([] { LoadCoinsCache(); })));
+    }
+
+    if (trustedHeaders.IsEnabled()) {
+        threadGroup.create_thread(boost::bind(&TraceThread<std::function<void()> >, "hdrverify",
+                std::function<void()>(std::bind(&CTrustedHeaderTable::ThreadVerify, &trustedHeaders))));
+    }
+
     // Wait for genesis block to be processed
     {
         boost::unique_lock<boost::mutex> lock(cs_GenesisWait);
@@ -2037,71 +2277,71 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
 
     if (!fLiteMode) {
-        boost::filesystem::path pathDB = GetDataDir();
-        std::string strDBName;
+        int64_t nStartCaches = GetTimeMillis();
+        std::string strCacheError;
 
-        strDBName = "mncache.dat";
         uiInterface.InitMessage(_("Loading masternode cache..."));
-        CFlatDB<CMasternodeMan> flatdb1(strDBName, "magicMasternodeCache");
-        if(!flatdb1.Load(mnodeman)) {
-            return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / strDBName).string());
+        if (!cacheLoader.Finish("mncache.dat", mnodeman, strCacheError)) {
+            return InitError(strCacheError);
         }
 
+        // the payments and governance caches were read in parallel, but are only used with masternodes
         if(mnodeman.size()) {
-            strDBName = "mnpayments.dat";
             uiInterface.InitMessage(_("Loading masternode payment cache..."));
-            CFlatDB<CMasternodePayments> flatdb2(strDBName, "magicMasternodePaymentsCache");
-            if(!flatdb2.Load(mnpayments)) {
-                return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / strDBName).string());
+            if (!cacheLoader.Finish("mnpayments.dat", mnpayments, strCacheError)) {
+                return InitError(strCacheError);
             }
 
-            strDBName = "governance.dat";
             uiInterface.InitMessage(_("Loading governance cache..."));
-            CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
-            if(!flatdb3.Load(governance)) {
-                return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / strDBName).string());
+            if (!cacheLoader.Finish("governance.dat", governance, strCacheError)) {
+                return InitError(strCacheError);
             }
             governance.InitOnLoad();
         } else {
             uiInterface.InitMessage(_("Masternode cache is empty, skipping payments and governance cache..."));
+            cacheLoader.Discard("mnpayments.dat", mnpayments);
+            cacheLoader.Discard("governance.dat", governance);
         }
 
-        strDBName = "netfulfilled.dat";
         uiInterface.InitMessage(_("Loading fulfilled requests cache..."));
-        CFlatDB<CNetFulfilledRequestManager> flatdb4(strDBName, "magicFulfilledCache");
-        if(!flatdb4.Load(netfulfilledman)) {
-            return InitError(_("Failed to load fulfilled requests cache from") + "\n" + (pathDB / strDBName).string());
+        if (!cacheLoader.Finish("netfulfilled.dat", netfulfilledman, strCacheError)) {
+            return InitError(strCacheError);
         }
 
         if(fEnableInstantSend)
         {
-            strDBName = "instantsend.dat";
             uiInterface.InitMessage(_("Loading InstantSend data cache..."));
-            CFlatDB<CInstantSend> flatdb5(strDBName, "magicInstantSendCache");
-            if(!flatdb5.Load(instantsend)) {
-                return InitError(_("Failed to load InstantSend data cache from") + "\n" + (pathDB / strDBName).string());
+            if (!cacheLoader.Finish("instantsend.dat", instantsend, strCacheError)) {
+                return InitError(strCacheError);
             }
         }
+        LogPrintf(" caches %18dms after chain load\n", GetTimeMillis() - nStartCaches);
     }
 
     // ********************************************************* Step 11c: schedule Volkshash-specific tasks
 
+    scheduler.scheduleEvery([]() { memoryBudget.Rebalance(IsInitialBlockDownload()); }, MEMORY_BUDGET_INTERVAL, "memorybudget");
+
     if (!fLiteMode) {
-        scheduler.scheduleEvery(boost::bind(&CNetFulfilledRequestManager::DoMaintenance, boost::ref(netfulfilledman)), 60);
-        scheduler.scheduleEvery(boost::bind(&CMasternodeSync::DoMaintenance, boost::ref(masternodeSync), boost::ref(*g_connman)), 1);
-        scheduler.scheduleEvery(boost::bind(&CMasternodeMan::DoMaintenance, boost::ref(mnodeman), boost::ref(*g_connman)), 1);
-        scheduler.scheduleEvery(boost::bind(&CActiveLegacyMasternodeManager::DoMaintenance, boost::ref(legacyActiveMasternodeManager), boost::ref(*g_connman)), MASTERNODE_MIN_MNP_SECONDS);
+        masternodeSigWorker.Start();
+
+        // the masternode list, sync and payments maintenance share state and mostly run under
+        // cs_main, so they never run at the same time and only ever occupy one scheduler thread
+        scheduler.scheduleEvery(boost::bind(&CNetFulfilledRequestManager::DoMaintenance, boost::ref(netfulfilledman)), 60, "netfulfilled");
+        scheduler.scheduleEvery(boost::bind(&CMasternodeSync::DoMaintenance, boost::ref(masternodeSync), boost::ref(*g_connman)), 1, "mnsync", "masternodes");
+        scheduler.scheduleEvery(boost::bind(&CMasternodeMan::DoMaintenance, boost::ref(mnodeman), boost::ref(*g_connman)), 1, "mnodeman", "masternodes");
+        scheduler.scheduleEvery(boost::bind(&CActiveLegacyMasternodeManager::DoMaintenance, boost::ref(legacyActiveMasternodeManager), boost::ref(*g_connman)), MASTERNODE_MIN_MNP_SECONDS, "activemasternode", "masternodes");
 
-        scheduler.scheduleEvery(boost::bind(&CMasternodePayments::DoMaintenance, boost::ref(mnpayments)), 60);
-        scheduler.scheduleEvery(boost::bind(&CGovernanceManager::DoMaintenance, boost::ref(governance), boost::ref(*g_connman)), 60 * 5);
+        scheduler.scheduleEvery(boost::bind(&CMasternodePayments::DoMaintenance, boost::ref(mnpayments)), 60, "mnpayments", "masternodes");
+        scheduler.scheduleEvery(boost::bind(&CGovernanceManager::DoMaintenance, boost::ref(governance), boost::ref(*g_connman)), 60 * 5, "governance");
 
-        scheduler.scheduleEvery(boost::bind(&CInstantSend::DoMaintenance, boost::ref(instantsend)), 60);
+        scheduler.scheduleEvery(boost::bind(&CInstantSend::DoMaintenance, boost::ref(instantsend)), 60, "instantsend");
 
         if (fMasternodeMode)
-            scheduler.scheduleEvery(boost::bind(&CPrivateSendServer::DoMaintenance, boost::ref(privateSendServer), boost::ref(*g_connman)), 1);
+            scheduler.scheduleEvery(boost::bind(&CPrivateSendServer::DoMaintenance, boost::ref(privateSendServer), boost::ref(*g_connman)), 1, "privatesend");
 #ifdef ENABLE_WALLET
         else
-            scheduler.scheduleEvery(boost::bind(&CPrivateSendClientManager::DoMaintenance, boost::ref(privateSendClient), boost::ref(*g_connman)), 1);
+            scheduler.scheduleEvery(boost::bind(&CPrivateSendClientManager::DoMaintenance, boost::ref(privateSendClient), boost::ref(*g_connman)), 1, "privatesend");
 #endif // ENABLE_WALLET
     }
 
@@ -2133,6 +2373,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
+    connOptions.nNetThreads = std::max(1, std::min((int)GetArg("-netthreads", DEFAULT_NET_THREADS), MAX_NET_THREADS));
+
+    if (GetBoolArg("-msglanes", DEFAULT_MSGLANES))
+        messageLanes.Start();
 
     if (!connman.Start(scheduler, strNodeError, connOptions))
         return InitError(strNodeError);
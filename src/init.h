@@ -16,6 +16,9 @@ namespace boost
 class thread_group;
 } // namespace boost
 
+/** The scheduler passed to AppInitMain, for the RPC interface. Null when not running. */
+extern CScheduler* g_scheduler;
+
 void StartShutdown();
 void StartRestart();
 bool ShutdownRequested();
@@ -4,6 +4,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "activemasternode.h"
+#include "core_memusage.h"
+#include "eventnotifier.h"
 #include "init.h"
 #include "instantx.h"
 #include "key.h"
@@ -26,9 +28,6 @@
 #include "wallet/wallet.h"
 #endif // ENABLE_WALLET
 
-#include <boost/algorithm/string/replace.hpp>
-#include <boost/thread.hpp>
-
 #ifdef ENABLE_WALLET
 extern CWallet* pwalletMain;
 #endif // ENABLE_WALLET
@@ -536,12 +535,8 @@ void CInstantSend::UpdateLockedTransaction(const CTxLockCandidate& txLockCandida
     if (pwalletMain && pwalletMain->UpdatedTransaction(txHash)) {
         // bumping this to update UI
         nCompleteTXLocks++;
-        // notify an external script once threshold is reached
-        std::string strCmd = GetArg("-instantsendnotify", "");
-        if (!strCmd.empty()) {
-            boost::replace_all(strCmd, "%s", txHash.GetHex());
-            boost::thread t(runCommand, strCmd); // thread runs free
-        }
+        // notify an external script or the event sink once threshold is reached
+        eventNotifier.Notify(CEventNotifier::EVENT_INSTANTSEND, txHash);
     }
 #endif
 
@@ -928,6 +923,38 @@ std::string CInstantSend::ToString() const
     return strprintf("Lock Candidates: %llu, Votes %llu", mapTxLockCandidates.size(), mapTxLockVotes.size());
 }
 
+size_t CInstantSend::DynamicMemoryUsage() const
+{
+    LOCK(cs_instantsend);
+    size_t nUsage = memusage::DynamicUsage(mapLockRequestAccepted) + memusage::DynamicUsage(mapLockRequestRejected);
+    for (const auto& pair : mapLockRequestAccepted) {
+        nUsage += pair.second.DynamicMemoryUsage();
+    }
+    for (const auto& pair : mapLockRequestRejected) {
+        nUsage += pair.second.DynamicMemoryUsage();
+    }
+    nUsage += memusage::DynamicUsage(mapTxLockVotes) + memusage::DynamicUsage(mapTxLockVotesOrphan);
+    for (const auto& pair : mapTxLockVotes) {
+        nUsage += pair.second.DynamicMemoryUsage();
+    }
+    for (const auto& pair : mapTxLockVotesOrphan) {
+        nUsage += pair.second.DynamicMemoryUsage();
+    }
+    nUsage += memusage::DynamicUsage(mapTxLockCandidates);
+    for (const auto& pair : mapTxLockCandidates) {
+        nUsage += pair.second.txLockRequest.DynamicMemoryUsage() + memusage::DynamicUsage(pair.second.mapOutPointLocks);
+        for (const auto& lockpair : pair.second.mapOutPointLocks) {
+            nUsage += lockpair.second.DynamicMemoryUsage();
+        }
+    }
+    nUsage += memusage::DynamicUsage(mapVotedOutpoints);
+    for (const auto& pair : mapVotedOutpoints) {
+        nUsage += memusage::DynamicUsage(pair.second);
+    }
+    nUsage += memusage::DynamicUsage(mapLockedOutpoints) + memusage::DynamicUsage(mapMasternodeOrphanVotes);
+    return nUsage;
+}
+
 void CInstantSend::DoMaintenance()
 {
     if (ShutdownRequested()) return;
@@ -1024,6 +1051,12 @@ bool CTxLockRequest::IsSimple() const
     return (tx->vin.size() <= MAX_INPUTS_FOR_AUTO_IX);
 }
 
+size_t CTxLockRequest::DynamicMemoryUsage() const
+{
+    // the transaction is counted even when it's shared with the mempool
+    return memusage::DynamicUsage(tx) + RecursiveDynamicUsage(*tx);
+}
+
 //
 // CTxLockVote
 //
@@ -1222,6 +1255,15 @@ bool COutPointLock::AddVote(const CTxLockVote& vote)
     return mapMasternodeVotes.emplace(vote.GetMasternodeOutpoint(), vote).second;
 }
 
+size_t COutPointLock::DynamicMemoryUsage() const
+{
+    size_t nUsage = memusage::DynamicUsage(mapMasternodeVotes);
+    for (const auto& pair : mapMasternodeVotes) {
+        nUsage += pair.second.DynamicMemoryUsage();
+    }
+    return nUsage;
+}
+
 std::vector<CTxLockVote> COutPointLock::GetVotes() const
 {
     std::vector<CTxLockVote> vRet;
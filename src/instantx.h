@@ -6,6 +6,7 @@
 #define INSTANTX_H
 
 #include "chain.h"
+#include "memusage.h"
 #include "net.h"
 #include "primitives/transaction.h"
 
@@ -152,6 +153,8 @@ public:
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock);
 
     std::string ToString() const;
+    /// Estimated memory used by the lock requests, votes and lock candidates
+    size_t DynamicMemoryUsage() const;
 
     void DoMaintenance();
 
@@ -206,6 +209,8 @@ public:
         return tx->ToString();
     }
 
+    size_t DynamicMemoryUsage() const;
+
     friend bool operator==(const CTxLockRequest& a, const CTxLockRequest& b)
     {
         return *a.tx == *b.tx;
@@ -301,6 +306,8 @@ public:
     bool CheckSignature() const;
 
     void Relay(CConnman& connman) const;
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(vchMasternodeSignature); }
 };
 
 /**
@@ -343,6 +350,8 @@ public:
     void MarkAsAttacked() { fAttacked = true; }
 
     void Relay(CConnman& connman) const;
+
+    size_t DynamicMemoryUsage() const;
 };
 
 /**
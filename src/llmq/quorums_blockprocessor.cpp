@@ -10,6 +10,7 @@
 
 #include "chain.h"
 #include "chainparams.h"
+#include "memusage.h"
 #include "consensus/validation.h"
 #include "net.h"
 #include "net_processing.h"
@@ -305,6 +306,17 @@ bool CQuorumBlockProcessor::GetMinedCommitment(Consensus::LLMQType llmqType, con
     return evoDb.Read(key, ret);
 }
 
+size_t CQuorumBlockProcessor::GetMinableCommitmentsUsage()
+{
+    LOCK(minableCommitmentsCs);
+    size_t nUsage = memusage::DynamicUsage(minableCommitmentsByQuorum) + memusage::DynamicUsage(minableCommitments);
+    for (const auto& p : minableCommitments) {
+        // std::vector<bool> packs its elements into bits
+        nUsage += memusage::MallocUsage((p.second.signers.capacity() + 7) / 8) + memusage::MallocUsage((p.second.validMembers.capacity() + 7) / 8);
+    }
+    return nUsage;
+}
+
 bool CQuorumBlockProcessor::HasMinableCommitment(const uint256& hash)
 {
     LOCK(minableCommitmentsCs);
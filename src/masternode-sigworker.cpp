@@ -0,0 +1,119 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "masternode-sigworker.h"
+
+#include "chain.h"
+#include "masternode.h"
+#include "protocol.h"
+#include "util.h"
+
+#include "evo/deterministicmns.h"
+
+CMasternodeSigWorker masternodeSigWorker;
+
+CMasternodeSigWorker::~CMasternodeSigWorker()
+{
+    Stop();
+}
+
+void CMasternodeSigWorker::Start()
+{
+    int nWorkers = std::thread::hardware_concurrency() / 2;
+    nWorkers = std::min(std::max(nWorkers, 1), 4);
+    workerPool.resize(nWorkers);
+    RenameThreadPool(workerPool, "mn-sigworker");
+    fRunning = true;
+
+    LogPrintf("CMasternodeSigWorker::%s -- started %d workers\n", __func__, nWorkers);
+}
+
+void CMasternodeSigWorker::Stop()
+{
+    if (!fRunning.exchange(false)) {
+        return;
+    }
+    workerPool.clear_queue();
+    workerPool.stop(true);
+
+    LogPrint("masternode", "CMasternodeSigWorker::%s -- queued %d messages, skipped %d, duplicates %d\n", __func__,
+            nQueued.load(), nSkipped.load(), nDuplicates.load());
+}
+
+void CMasternodeSigWorker::UpdatedBlockTip(const CBlockIndex* pindex)
+{
+    if (!pindex || !deterministicMNManager) {
+        return;
+    }
+    fDeterministicMNsActive = deterministicMNManager->IsDeterministicMNsSporkActive(pindex->nHeight);
+}
+
+void CMasternodeSigWorker::PushMessage(NodeId nodeId, const std::string& strCommand, const uint256& hashMsg, const CDataStream& vRecv)
+{
+    if (strCommand != NetMsgType::MNANNOUNCE && strCommand != NetMsgType::MNPING) {
+        return;
+    }
+    if (!fRunning || fDeterministicMNsActive) {
+        return;
+    }
+    if (nPending >= MAX_PENDING_MESSAGES) {
+        // the message handler will do the recovery itself
+        nSkipped++;
+        return;
+    }
+
+    {
+        LOCK(cs);
+        if (filterQueued.contains(hashMsg)) {
+            // already recovered (or about to be), a repeat would only push useful entries out of the cache
+            nDuplicates++;
+            return;
+        }
+        int& nPeerPending = mapPeerPending[nodeId];
+        if (nPeerPending >= MAX_PENDING_MESSAGES_PER_PEER) {
+            nSkipped++;
+            return;
+        }
+        filterQueued.insert(hashMsg);
+        nPeerPending++;
+    }
+
+    nPending++;
+    nQueued++;
+    auto pvRecv = std::make_shared<CDataStream>(vRecv);
+    workerPool.push([this, nodeId, strCommand, pvRecv](int threadId) {
+        ProcessMessage(strCommand, *pvRecv);
+        MessageDone(nodeId);
+    });
+}
+
+void CMasternodeSigWorker::MessageDone(NodeId nodeId)
+{
+    {
+        LOCK(cs);
+        auto it = mapPeerPending.find(nodeId);
+        if (it != mapPeerPending.end() && --it->second <= 0) {
+            mapPeerPending.erase(it);
+        }
+    }
+    nPending--;
+}
+
+void CMasternodeSigWorker::ProcessMessage(const std::string& strCommand, CDataStream& vRecv)
+{
+    try {
+        if (strCommand == NetMsgType::MNANNOUNCE) {
+            CMasternodeBroadcast mnb;
+            vRecv >> mnb;
+            mnb.PreRecoverSignature();
+        } else if (strCommand == NetMsgType::MNPING) {
+            CMasternodePing mnp;
+            vRecv >> mnp;
+            mnp.PreRecoverSignature();
+        }
+    } catch (const std::exception& e) {
+        // malformed messages are handled (and punished) by the message handler
+        LogPrint("masternode", "CMasternodeSigWorker::%s -- failed to deserialize %s: %s\n", __func__, strCommand, e.what());
+    }
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_SIGWORKER_H
+#define MASTERNODE_SIGWORKER_H
+
+#include "bloom.h"
+#include "ctpl.h"
+#include "streams.h"
+#include "sync.h"
+
+#include <atomic>
+#include <map>
+
+class CBlockIndex;
+class CMasternodeSigWorker;
+
+typedef int64_t NodeId;
+
+extern CMasternodeSigWorker masternodeSigWorker;
+
+/**
+ * Recovers the signers of mnb and mnp messages in a worker pool as soon as the messages are
+ * received, while they still wait in the receive queue of the peer. The signature checks done
+ * later by CMasternodeMan under cs_main/mnodeman.cs then only have to compare key IDs.
+ *
+ * This is purely an optimization: every message is still fully checked by the message handler,
+ * messages that can't be queued (e.g. because too many are pending) are simply skipped.
+ *
+ * A message is only queued once, repeats are recognized by the hash of the whole message, and a
+ * single peer can't hold more than MAX_PENDING_MESSAGES_PER_PEER slots of the queue.
+ */
+class CMasternodeSigWorker
+{
+private:
+    static const int MAX_PENDING_MESSAGES = 5000;
+    static const int MAX_PENDING_MESSAGES_PER_PEER = 500;
+    static const unsigned int QUEUED_FILTER_SIZE = 20000;
+
+    ctpl::thread_pool workerPool;
+    std::atomic<bool> fRunning{false};
+    std::atomic<int> nPending{0};
+    // Cached by UpdatedBlockTip, the socket threads must not take deterministicMNManager->cs
+    std::atomic<bool> fDeterministicMNsActive{false};
+
+    CCriticalSection cs;
+    // hashes of the messages queued so far, to skip repeats
+    CRollingBloomFilter filterQueued{QUEUED_FILTER_SIZE, 0.000001};
+    std::map<NodeId, int> mapPeerPending;
+
+    std::atomic<uint64_t> nQueued{0};
+    std::atomic<uint64_t> nSkipped{0};
+    std::atomic<uint64_t> nDuplicates{0};
+
+    void ProcessMessage(const std::string& strCommand, CDataStream& vRecv);
+    void MessageDone(NodeId nodeId);
+
+public:
+    ~CMasternodeSigWorker();
+
+    void Start();
+    void Stop();
+
+    void UpdatedBlockTip(const CBlockIndex* pindex);
+
+    /// Called by the network thread for every complete message, must be cheap for other commands
+    void PushMessage(NodeId nodeId, const std::string& strCommand, const uint256& hashMsg, const CDataStream& vRecv);
+};
+
+#endif
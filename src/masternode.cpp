@@ -719,6 +719,25 @@ bool CMasternodeBroadcast::CheckSignature(int& nDos) const
     return true;
 }
 
+void CMasternodeBroadcast::PreRecoverSignature() const
+{
+    // same formats as in CheckSignature, the legacy one is only needed if the new one doesn't match
+    bool fMatched = false;
+    if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
+        fMatched = CHashSigner::PreRecoverHash(GetSignatureHash(), vchSig) == keyIDCollateralAddress;
+    }
+    if (!fMatched) {
+        std::string strMessage = addr.ToString(false) + std::to_string(sigTime) +
+                        keyIDCollateralAddress.ToString() + legacyKeyIDOperator.ToString() +
+                        std::to_string(nProtocolVersion);
+        CMessageSigner::PreRecoverMessage(strMessage, vchSig);
+    }
+
+    if (!lastPing.vchSig.empty()) {
+        lastPing.PreRecoverSignature(&legacyKeyIDOperator);
+    }
+}
+
 void CMasternodeBroadcast::Relay(CConnman& connman) const
 {
     // Do not relay until fully synced
@@ -835,6 +854,22 @@ bool CMasternodePing::CheckSignature(CKeyID& keyIDOperator, int &nDos) const
     return true;
 }
 
+void CMasternodePing::PreRecoverSignature(const CKeyID* pkeyIDOperator) const
+{
+    bool fMatched = false;
+    if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
+        CKeyID keyIDFromSig = CHashSigner::PreRecoverHash(GetSignatureHash(), vchSig);
+        // Without the operator key we can't tell if the legacy format is needed. Pings in
+        // the legacy format are rare once the spork is active, CheckSignature handles them.
+        fMatched = pkeyIDOperator == nullptr || keyIDFromSig == *pkeyIDOperator;
+    }
+    if (!fMatched) {
+        std::string strMessage = CTxIn(masternodeOutpoint).ToString() + blockHash.ToString() +
+                    std::to_string(sigTime);
+        CMessageSigner::PreRecoverMessage(strMessage, vchSig);
+    }
+}
+
 bool CMasternodePing::SimpleCheck(int& nDos)
 {
     // don't ban by default
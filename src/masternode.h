@@ -74,6 +74,8 @@ public:
 
     bool Sign(const CKey& keyMasternode, const CKeyID& keyIDOperator);
     bool CheckSignature(CKeyID& keyIDOperator, int &nDos) const;
+    /// Recover the signer ahead of CheckSignature, pkeyIDOperator is used if it's already known
+    void PreRecoverSignature(const CKeyID* pkeyIDOperator = nullptr) const;
     bool SimpleCheck(int& nDos);
     bool CheckAndUpdate(CMasternode* pmn, bool fFromNewBroadcast, int& nDos, CConnman& connman);
     void Relay(CConnman& connman);
@@ -385,6 +387,8 @@ public:
 
     bool Sign(const CKey& keyCollateralAddress);
     bool CheckSignature(int& nDos) const;
+    /// Recover the signers of the broadcast and its ping ahead of CheckSignature
+    void PreRecoverSignature() const;
     void Relay(CConnman& connman) const;
 };
 
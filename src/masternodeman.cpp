@@ -12,6 +12,7 @@
 #include "masternode-payments.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
+#include "memusage.h"
 #include "messagesigner.h"
 #include "netfulfilledman.h"
 #include "netmessagemaker.h"
@@ -74,6 +75,10 @@ CMasternodeMan::CMasternodeMan():
     fMasternodesRemoved(false),
     vecDirtyGovernanceObjectHashes(),
     nLastSentinelPingTime(0),
+    pSnapshot(std::make_shared<const masternode_map_t>()),
+    setSnapshotDirtyOutpoints(),
+    fSnapshotFullRebuild(false),
+    nSnapshotBatchDepth(0),
     mapSeenMasternodeBroadcast(),
     mapSeenMasternodePing(),
     nDsqCount(0)
@@ -82,6 +87,7 @@ CMasternodeMan::CMasternodeMan():
 bool CMasternodeMan::Add(CMasternode &mn)
 {
     LOCK(cs);
+    CSnapshotBatch batch(*this);
 
     if (deterministicMNManager->IsDeterministicMNsSporkActive())
         return false;
@@ -90,6 +96,7 @@ bool CMasternodeMan::Add(CMasternode &mn)
 
     LogPrint("masternode", "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     mapMasternodes[mn.outpoint] = mn;
+    MarkSnapshotDirty(mn.outpoint);
     fMasternodesAdded = true;
     return true;
 }
@@ -131,6 +138,7 @@ void CMasternodeMan::AskForMN(CNode* pnode, const COutPoint& outpoint, CConnman&
 bool CMasternodeMan::AllowMixing(const COutPoint &outpoint)
 {
     LOCK(cs);
+    CSnapshotBatch batch(*this);
     CMasternode* pmn = Find(outpoint);
     if (!pmn) {
         return false;
@@ -138,6 +146,7 @@ bool CMasternodeMan::AllowMixing(const COutPoint &outpoint)
     nDsqCount++;
     pmn->nLastDsq = nDsqCount;
     pmn->nMixingTxCount = 0;
+    MarkSnapshotDirty(outpoint);
 
     return true;
 }
@@ -145,11 +154,13 @@ bool CMasternodeMan::AllowMixing(const COutPoint &outpoint)
 bool CMasternodeMan::DisallowMixing(const COutPoint &outpoint)
 {
     LOCK(cs);
+    CSnapshotBatch batch(*this);
     CMasternode* pmn = Find(outpoint);
     if (!pmn) {
         return false;
     }
     pmn->nMixingTxCount++;
+    MarkSnapshotDirty(outpoint);
 
     return true;
 }
@@ -157,6 +168,7 @@ bool CMasternodeMan::DisallowMixing(const COutPoint &outpoint)
 bool CMasternodeMan::PoSeBan(const COutPoint &outpoint)
 {
     LOCK(cs);
+    CSnapshotBatch batch(*this);
 
     if (deterministicMNManager->IsDeterministicMNsSporkActive())
         return true;
@@ -166,6 +178,7 @@ bool CMasternodeMan::PoSeBan(const COutPoint &outpoint)
         return false;
     }
     pmn->PoSeBan();
+    MarkSnapshotDirty(outpoint);
 
     return true;
 }
@@ -173,6 +186,7 @@ bool CMasternodeMan::PoSeBan(const COutPoint &outpoint)
 void CMasternodeMan::Check()
 {
     LOCK2(cs_main, cs);
+    CSnapshotBatch batch(*this);
 
     if (deterministicMNManager->IsDeterministicMNsSporkActive())
         return;
@@ -180,7 +194,11 @@ void CMasternodeMan::Check()
     for (auto& mnpair : mapMasternodes) {
         // NOTE: internally it checks only every MASTERNODE_CHECK_SECONDS seconds
         // since the last time, so expect some MNs to skip this
+        int64_t nTimeLastCheckedPrev = mnpair.second.nTimeLastChecked;
         mnpair.second.Check();
+        if (mnpair.second.nTimeLastChecked != nTimeLastCheckedPrev) {
+            MarkSnapshotDirty(mnpair.first);
+        }
     }
 }
 
@@ -197,6 +215,7 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
         // Need LOCK2 here to ensure consistent locking order because code below locks cs_main
         // in CheckMnbAndUpdateMasternodeList()
         LOCK2(cs_main, cs);
+        CSnapshotBatch batch(*this);
 
         Check();
 
@@ -218,6 +237,7 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
 
                 // and finally remove it from the list
                 it->second.FlagGovernanceItemsAsDirty();
+                MarkSnapshotDirty(it->first);
                 mapMasternodes.erase(it++);
                 fMasternodesRemoved = true;
             } else {
@@ -379,6 +399,7 @@ void CMasternodeMan::AddDeterministicMasternodes()
     bool added = false;
     {
         LOCK(cs);
+        CSnapshotBatch batch(*this);
         unsigned int oldMnCount = mapMasternodes.size();
 
         auto mnList = deterministicMNManager->GetListAtChainTip();
@@ -386,6 +407,7 @@ void CMasternodeMan::AddDeterministicMasternodes()
             // call Find() on each deterministic MN to force creation of CMasternode object
             auto mn = Find(dmn->collateralOutpoint);
             assert(mn);
+            MarkSnapshotDirty(dmn->collateralOutpoint);
 
             // make sure we use the splitted keys from now on
             mn->keyIDOwner = dmn->pdmnState->keyIDOwner;
@@ -414,6 +436,7 @@ void CMasternodeMan::RemoveNonDeterministicMasternodes()
     bool erased = false;
     {
         LOCK(cs);
+        CSnapshotBatch batch(*this);
         std::set<COutPoint> mnSet;
         auto mnList = deterministicMNManager->GetListAtChainTip();
         mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
@@ -422,6 +445,7 @@ void CMasternodeMan::RemoveNonDeterministicMasternodes()
         auto it = mapMasternodes.begin();
         while (it != mapMasternodes.end()) {
             if (!mnSet.count(it->second.outpoint)) {
+                MarkSnapshotDirty(it->first);
                 mapMasternodes.erase(it++);
                 erased = true;
             } else {
@@ -437,7 +461,9 @@ void CMasternodeMan::RemoveNonDeterministicMasternodes()
 void CMasternodeMan::Clear()
 {
     LOCK(cs);
+    CSnapshotBatch batch(*this);
     mapMasternodes.clear();
+    MarkSnapshotDirty();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
@@ -449,8 +475,6 @@ void CMasternodeMan::Clear()
 
 int CMasternodeMan::CountMasternodes(int nProtocolVersion)
 {
-    LOCK(cs);
-
     int nCount = 0;
     nProtocolVersion = nProtocolVersion == -1 ? mnpayments.GetMinMasternodePaymentsProto() : nProtocolVersion;
 
@@ -458,7 +482,7 @@ int CMasternodeMan::CountMasternodes(int nProtocolVersion)
         auto mnList = deterministicMNManager->GetListAtChainTip();
         nCount = (int)mnList.GetAllMNsCount();
     } else {
-        for (const auto& mnpair : mapMasternodes) {
+        for (const auto& mnpair : GetMasternodeListSnapshot()) {
             if(mnpair.second.nProtocolVersion < nProtocolVersion) continue;
             nCount++;
         }
@@ -468,8 +492,6 @@ int CMasternodeMan::CountMasternodes(int nProtocolVersion)
 
 int CMasternodeMan::CountEnabled(int nProtocolVersion)
 {
-    LOCK(cs);
-
     int nCount = 0;
     nProtocolVersion = nProtocolVersion == -1 ? mnpayments.GetMinMasternodePaymentsProto() : nProtocolVersion;
 
@@ -477,7 +499,7 @@ int CMasternodeMan::CountEnabled(int nProtocolVersion)
         auto mnList = deterministicMNManager->GetListAtChainTip();
         nCount = (int)mnList.GetValidMNsCount();
     } else {
-        for (const auto& mnpair : mapMasternodes) {
+        for (const auto& mnpair : GetMasternodeListSnapshot()) {
             if (mnpair.second.nProtocolVersion < nProtocolVersion || !mnpair.second.IsEnabled()) continue;
             nCount++;
         }
@@ -554,11 +576,19 @@ CMasternode* CMasternodeMan::Find(const COutPoint &outpoint)
             // MN is not in mapMasternodes but in the deterministic list. Create an entry in mapMasternodes for compatibility with legacy code
             CMasternode mn(outpoint.hash, dmn);
             it = mapMasternodes.emplace(outpoint, mn).first;
+            // readers of the snapshot must see the new entry too, even when called from a read-only path
+            MarkSnapshotDirty(outpoint);
+            if (nSnapshotBatchDepth == 0) {
+                PublishSnapshot();
+            }
             return &(it->second);
         }
     } else {
         auto it = mapMasternodes.find(outpoint);
-        return it == mapMasternodes.end() ? nullptr : &(it->second);
+        if (it == mapMasternodes.end()) {
+            return nullptr;
+        }
+        return &(it->second);
     }
 }
 
@@ -730,8 +760,6 @@ bool CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight, bool f
 
 masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion)
 {
-    LOCK(cs);
-
     nProtocolVersion = nProtocolVersion == -1 ? mnpayments.GetMinMasternodePaymentsProto() : nProtocolVersion;
 
     int nCountEnabled = CountEnabled(nProtocolVersion);
@@ -740,9 +768,12 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
     LogPrintf("CMasternodeMan::FindRandomNotInVec -- %d enabled masternodes, %d masternodes to choose from\n", nCountEnabled, nCountNotExcluded);
     if(nCountNotExcluded < 1) return masternode_info_t();
 
+    // pointers stay valid for as long as we hold the snapshot
+    masternode_map_t mapSnapshot = GetMasternodeListSnapshot();
+
     // fill a vector of pointers
     std::vector<const CMasternode*> vpMasternodesShuffled;
-    for (const auto& mnpair : mapMasternodes) {
+    for (const auto& mnpair : mapSnapshot) {
         vpMasternodesShuffled.push_back(&mnpair.second);
     }
 
@@ -773,47 +804,101 @@ masternode_info_t CMasternodeMan::FindRandomNotInVec(const std::vector<COutPoint
     return masternode_info_t();
 }
 
-std::map<COutPoint, CMasternode> CMasternodeMan::GetFullMasternodeMap()
+CMasternodeMan::masternode_map_t CMasternodeMan::GetMasternodeListSnapshot() const
 {
-    LOCK(cs);
+    return *std::atomic_load(&pSnapshot);
+}
+
+CMasternodeMan::masternode_map_t CMasternodeMan::GetFullMasternodeMap()
+{
+    const masternode_map_t mapSnapshot = GetMasternodeListSnapshot();
+    masternode_map_t result = mapSnapshot;
 
     if (deterministicMNManager->IsDeterministicMNsSporkActive()) {
-        std::map<COutPoint, CMasternode> result;
         auto mnList = deterministicMNManager->GetListAtChainTip();
-        for (const auto &p : mapMasternodes) {
+        for (const auto &p : mapSnapshot) {
             auto dmn = mnList.GetMNByCollateral(p.first);
-            if (dmn && mnList.IsMNValid(dmn)) {
-                result.emplace(p.first, p.second);
+            if (!dmn || !mnList.IsMNValid(dmn)) {
+                result = result.erase(p.first);
             }
         }
-        return result;
-    } else {
-        return mapMasternodes;
     }
+    return result;
 }
 
-bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeMan::score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol)
+void CMasternodeMan::PublishSnapshot()
 {
     AssertLockHeld(cs);
 
+    if (!fSnapshotFullRebuild && setSnapshotDirtyOutpoints.empty())
+        return;
+
+    masternode_map_t mapSnapshot;
+    if (fSnapshotFullRebuild) {
+        for (const auto& mnpair : mapMasternodes) {
+            mapSnapshot = mapSnapshot.set(mnpair.first, mnpair.second);
+        }
+    } else {
+        // untouched entries are shared with the previous snapshot
+        mapSnapshot = GetMasternodeListSnapshot();
+        for (const auto& outpoint : setSnapshotDirtyOutpoints) {
+            auto it = mapMasternodes.find(outpoint);
+            if (it != mapMasternodes.end()) {
+                mapSnapshot = mapSnapshot.set(outpoint, it->second);
+            } else {
+                mapSnapshot = mapSnapshot.erase(outpoint);
+            }
+        }
+    }
+    std::atomic_store(&pSnapshot, std::make_shared<const masternode_map_t>(std::move(mapSnapshot)));
+
+    setSnapshotDirtyOutpoints.clear();
+    fSnapshotFullRebuild = false;
+}
+
+bool CMasternodeMan::GetMasternodeScores(masternode_map_t& mapSnapshot, const uint256& nBlockHash, CMasternodeMan::score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol)
+{
     vecMasternodeScoresRet.clear();
 
     if (deterministicMNManager->IsDeterministicMNsSporkActive()) {
         auto mnList = deterministicMNManager->GetListAtChainTip();
         auto scores = mnList.CalculateScores(nBlockHash);
+        bool fMissing = false;
+        for (const auto& p : scores) {
+            if (!mapSnapshot.find(p.second->collateralOutpoint)) {
+                fMissing = true;
+                break;
+            }
+        }
+        if (fMissing) {
+            // AddDeterministicMasternodes didn't run for the current list yet, create the missing
+            // compatibility entries so that ranks don't depend on how far the snapshot lags behind
+            {
+                LOCK(cs);
+                CSnapshotBatch batch(*this);
+                for (const auto& p : scores) {
+                    if (!mapSnapshot.find(p.second->collateralOutpoint)) {
+                        Find(p.second->collateralOutpoint);
+                    }
+                }
+            }
+            mapSnapshot = GetMasternodeListSnapshot();
+        }
         for (const auto& p : scores) {
-            auto* mn = Find(p.second->collateralOutpoint);
-            vecMasternodeScoresRet.emplace_back(p.first, mn);
+            const CMasternode* mn = mapSnapshot.find(p.second->collateralOutpoint);
+            if (mn) {
+                vecMasternodeScoresRet.emplace_back(p.first, mn);
+            }
         }
     } else {
         if (!masternodeSync.IsMasternodeListSynced())
             return false;
 
-        if (mapMasternodes.empty())
+        if (mapSnapshot.size() == 0)
             return false;
 
         // calculate scores
-        for (const auto& mnpair : mapMasternodes) {
+        for (const auto& mnpair : mapSnapshot) {
             if (mnpair.second.nProtocolVersion >= nMinProtocol) {
                 vecMasternodeScoresRet.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
             }
@@ -843,10 +928,11 @@ bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet,
         return false;
     }
 
-    LOCK(cs);
+    // score pairs point into the snapshot, keep it alive until we are done with them
+    masternode_map_t mapSnapshot = GetMasternodeListSnapshot();
 
     score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(blockHashRet, vecMasternodeScores, nMinProtocol))
+    if (!GetMasternodeScores(mapSnapshot, blockHashRet, vecMasternodeScores, nMinProtocol))
         return false;
 
     int nRank = 0;
@@ -875,10 +961,10 @@ bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMast
         return false;
     }
 
-    LOCK(cs);
+    masternode_map_t mapSnapshot = GetMasternodeListSnapshot();
 
     score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    if (!GetMasternodeScores(mapSnapshot, nBlockHash, vecMasternodeScores, nMinProtocol))
         return false;
 
     int nRank = 0;
@@ -1039,6 +1125,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
         LOCK2(cs_main, cs);
+        CSnapshotBatch batch(*this);
 
         if(mapSeenMasternodePing.count(nHash)) return; //seen
         mapSeenMasternodePing.insert(std::make_pair(nHash, mnp));
@@ -1047,6 +1134,10 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         // see if we have this Masternode
         CMasternode* pmn = Find(mnp.masternodeOutpoint);
+        if (pmn) {
+            // CheckAndUpdate may update the entry
+            MarkSnapshotDirty(mnp.masternodeOutpoint);
+        }
 
         if(pmn && mnp.fSentinelIsCurrent)
             UpdateLastSentinelPingTime();
@@ -1090,6 +1181,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         // Need LOCK2 here to ensure consistent locking order because all functions below call GetBlockHash which locks cs_main
         LOCK2(cs_main, cs);
+        CSnapshotBatch batch(*this);
 
         CMasternodeVerification mnv;
         vRecv >> mnv;
@@ -1280,6 +1372,7 @@ void CMasternodeMan::CheckSameAddr()
 
     {
         LOCK(cs);
+        CSnapshotBatch batch(*this);
 
         CMasternode* pprevMasternode = nullptr;
         CMasternode* pverifiedMasternode = nullptr;
@@ -1315,12 +1408,13 @@ void CMasternodeMan::CheckSameAddr()
             }
             pprevMasternode = pmn;
         }
-    }
 
-    // ban duplicates
-    for (auto& pmn : vBan) {
-        LogPrintf("CMasternodeMan::CheckSameAddr -- increasing PoSe ban score for masternode %s\n", pmn->outpoint.ToStringShort());
-        pmn->IncreasePoSeBanScore();
+        // ban duplicates
+        for (auto& pmn : vBan) {
+            LogPrintf("CMasternodeMan::CheckSameAddr -- increasing PoSe ban score for masternode %s\n", pmn->outpoint.ToStringShort());
+            pmn->IncreasePoSeBanScore();
+            MarkSnapshotDirty(pmn->outpoint);
+        }
     }
 }
 
@@ -1488,6 +1582,7 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
 
     {
         LOCK(cs);
+        CSnapshotBatch batch(*this);
 
         CMasternode* prealMasternode = nullptr;
         std::vector<CMasternode*> vpMasternodesToBan;
@@ -1497,6 +1592,8 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
 
         for (auto& mnpair : mapMasternodes) {
             if(CAddress(mnpair.second.addr, NODE_NETWORK) == pnode->addr) {
+                // PoSe ban score of every entry with this addr is updated below
+                MarkSnapshotDirty(mnpair.first);
                 bool fFound = false;
                 if (sporkManager.IsSporkActive(SPORK_6_NEW_SIGS)) {
                     fFound = CHashSigner::VerifyHash(hash1, mnpair.second.legacyKeyIDOperator, mnv.vchSig1, strError);
@@ -1633,6 +1730,7 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
 
     {
         LOCK(cs);
+        CSnapshotBatch batch(*this);
 
         CMasternode* pmn1 = Find(mnv.masternodeOutpoint1);
         if(!pmn1) {
@@ -1645,6 +1743,8 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
             LogPrintf("CMasternodeMan::ProcessVerifyBroadcast -- can't find masternode2 %s\n", mnv.masternodeOutpoint2.ToStringShort());
             return;
         }
+        MarkSnapshotDirty(mnv.masternodeOutpoint1);
+        MarkSnapshotDirty(mnv.masternodeOutpoint2);
 
         if(pmn1->addr != mnv.addr) {
             LogPrintf("CMasternodeMan::ProcessVerifyBroadcast -- addr %s does not match %s\n", mnv.addr.ToString(), pmn1->addr.ToString());
@@ -1693,6 +1793,7 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
         for (auto& mnpair : mapMasternodes) {
             if(mnpair.second.addr != mnv.addr || mnpair.first == mnv.masternodeOutpoint1) continue;
             mnpair.second.IncreasePoSeBanScore();
+            MarkSnapshotDirty(mnpair.first);
             nCount++;
             LogPrint("masternode", "CMasternodeMan::ProcessVerifyBroadcast -- increased PoSe ban score for %s addr %s, new score %d\n",
                         mnpair.first.ToStringShort(), mnpair.second.addr.ToString(), mnpair.second.nPoSeBanScore);
@@ -1703,6 +1804,74 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
     }
 }
 
+static size_t MasternodeDynamicUsage(const CMasternode& mn)
+{
+    return memusage::DynamicUsage(mn.vchSig) + memusage::DynamicUsage(mn.lastPing.vchSig) + memusage::DynamicUsage(mn.mapGovernanceObjectsVotedOn);
+}
+
+static size_t VerificationDynamicUsage(const CMasternodeVerification& mnv)
+{
+    return memusage::DynamicUsage(mnv.vchSig1) + memusage::DynamicUsage(mnv.vchSig2);
+}
+
+size_t CMasternodeMan::DynamicMemoryUsage() const
+{
+    size_t nUsage = 0;
+    {
+        LOCK(cs);
+        size_t nEntriesUsage = 0;
+        for (const auto& mnpair : mapMasternodes) {
+            nEntriesUsage += MasternodeDynamicUsage(mnpair.second);
+        }
+        // the published snapshot holds a copy of every entry
+        nUsage += memusage::DynamicUsage(mapMasternodes) + 2 * nEntriesUsage + mapMasternodes.size() * sizeof(CMasternode);
+        nUsage += memusage::DynamicUsage(mAskedUsForMasternodeList) + memusage::DynamicUsage(mWeAskedForMasternodeList);
+        nUsage += memusage::DynamicUsage(mWeAskedForMasternodeListEntry);
+        for (const auto& pair : mWeAskedForMasternodeListEntry) {
+            nUsage += memusage::DynamicUsage(pair.second);
+        }
+        nUsage += memusage::DynamicUsage(mWeAskedForVerification);
+        for (const auto& pair : mWeAskedForVerification) {
+            nUsage += VerificationDynamicUsage(pair.second);
+        }
+        nUsage += memusage::DynamicUsage(mMnbRecoveryRequests);
+        for (const auto& pair : mMnbRecoveryRequests) {
+            nUsage += memusage::DynamicUsage(pair.second.second);
+        }
+        nUsage += memusage::DynamicUsage(mMnbRecoveryGoodReplies);
+        for (const auto& pair : mMnbRecoveryGoodReplies) {
+            nUsage += memusage::DynamicUsage(pair.second);
+            for (const auto& mnb : pair.second) {
+                nUsage += MasternodeDynamicUsage(mnb);
+            }
+        }
+        nUsage += memusage::DynamicUsage(listScheduledMnbRequestConnections);
+        nUsage += memusage::DynamicUsage(mapPendingMNB);
+        for (const auto& pair : mapPendingMNB) {
+            nUsage += memusage::DynamicUsage(pair.second.second);
+        }
+        nUsage += memusage::DynamicUsage(vecDirtyGovernanceObjectHashes) + memusage::DynamicUsage(setSnapshotDirtyOutpoints);
+        nUsage += memusage::DynamicUsage(mapSeenMasternodeBroadcast);
+        for (const auto& pair : mapSeenMasternodeBroadcast) {
+            nUsage += MasternodeDynamicUsage(pair.second.second);
+        }
+        nUsage += memusage::DynamicUsage(mapSeenMasternodePing);
+        for (const auto& pair : mapSeenMasternodePing) {
+            nUsage += memusage::DynamicUsage(pair.second.vchSig);
+        }
+        nUsage += memusage::DynamicUsage(mapSeenMasternodeVerification);
+        for (const auto& pair : mapSeenMasternodeVerification) {
+            nUsage += VerificationDynamicUsage(pair.second);
+        }
+    }
+    LOCK(cs_mapPendingMNV);
+    nUsage += memusage::DynamicUsage(mapPendingMNV);
+    for (const auto& pair : mapPendingMNV) {
+        nUsage += VerificationDynamicUsage(pair.second.second);
+    }
+    return nUsage;
+}
+
 std::string CMasternodeMan::ToString() const
 {
     std::ostringstream info;
@@ -1731,6 +1900,7 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
 
     {
         LOCK(cs);
+        CSnapshotBatch batch(*this);
         nDos = 0;
         LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- masternode=%s\n", mnb.outpoint.ToStringShort());
 
@@ -1778,6 +1948,7 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         // search Masternode list
         CMasternode* pmn = Find(mnb.outpoint);
         if(pmn) {
+            MarkSnapshotDirty(mnb.outpoint);
             CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
             if(!mnb.Update(pmn, nDos, connman)) {
                 LogPrint("masternode", "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.outpoint.ToStringShort());
@@ -1820,6 +1991,7 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
 void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
 {
     LOCK2(cs_main, cs);
+    CSnapshotBatch batch(*this);
 
     if(fLiteMode || !masternodeSync.IsWinnersListSynced() || mapMasternodes.empty()) return;
 
@@ -1832,7 +2004,12 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
                             nCachedBlockHeight, nLastRunBlockHeight, nMaxBlocksToScanBack);
 
     for (auto& mnpair : mapMasternodes) {
+        int nBlockLastPaidOld = mnpair.second.GetLastPaidBlock();
+        int nTimeLastPaidOld = mnpair.second.GetLastPaidTime();
         mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+        if (mnpair.second.GetLastPaidBlock() != nBlockLastPaidOld || mnpair.second.GetLastPaidTime() != nTimeLastPaidOld) {
+            MarkSnapshotDirty(mnpair.first);
+        }
     }
 
     nLastRunBlockHeight = nCachedBlockHeight;
@@ -1856,30 +2033,36 @@ bool CMasternodeMan::IsSentinelPingActive()
 bool CMasternodeMan::AddGovernanceVote(const COutPoint& outpoint, uint256 nGovernanceObjectHash)
 {
     LOCK(cs);
+    CSnapshotBatch batch(*this);
     CMasternode* pmn = Find(outpoint);
     if(!pmn) {
         return false;
     }
     pmn->AddGovernanceVote(nGovernanceObjectHash);
+    MarkSnapshotDirty(outpoint);
     return true;
 }
 
 void CMasternodeMan::RemoveGovernanceObject(uint256 nGovernanceObjectHash)
 {
     LOCK(cs);
+    CSnapshotBatch batch(*this);
     for(auto& mnpair : mapMasternodes) {
         mnpair.second.RemoveGovernanceObject(nGovernanceObjectHash);
     }
+    MarkSnapshotDirty();
 }
 
 void CMasternodeMan::CheckMasternode(const CKeyID& keyIDOperator, bool fForce)
 {
     LOCK2(cs_main, cs);
+    CSnapshotBatch batch(*this);
     if (deterministicMNManager->IsDeterministicMNsSporkActive())
         return;
     for (auto& mnpair : mapMasternodes) {
         if (mnpair.second.legacyKeyIDOperator == keyIDOperator) {
             mnpair.second.Check(fForce);
+            MarkSnapshotDirty(mnpair.first);
             return;
         }
     }
@@ -1895,6 +2078,7 @@ bool CMasternodeMan::IsMasternodePingedWithin(const COutPoint& outpoint, int nSe
 void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMasternodePing& mnp)
 {
     LOCK(cs);
+    CSnapshotBatch batch(*this);
     if (deterministicMNManager->IsDeterministicMNsSporkActive())
         return;
     CMasternode* pmn = Find(outpoint);
@@ -1902,6 +2086,7 @@ void CMasternodeMan::SetMasternodeLastPing(const COutPoint& outpoint, const CMas
         return;
     }
     pmn->lastPing = mnp;
+    MarkSnapshotDirty(outpoint);
     if(mnp.fSentinelIsCurrent) {
         UpdateLastSentinelPingTime();
     }
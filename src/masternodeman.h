@@ -9,14 +9,27 @@
 #include "masternode.h"
 #include "sync.h"
 
+#include "immer/map.hpp"
+
+#include <memory>
+
 class CMasternodeMan;
 class CConnman;
 
 extern CMasternodeMan mnodeman;
 
+struct MasternodeOutpointHasher
+{
+    size_t operator()(const COutPoint& outpoint) const
+    {
+        return (size_t)(outpoint.hash.GetCheapHash() ^ outpoint.n);
+    }
+};
+
 class CMasternodeMan
 {
 public:
+    typedef immer::map<COutPoint, CMasternode, MasternodeOutpointHasher> masternode_map_t;
     typedef std::pair<arith_uint256, const CMasternode*> score_pair_t;
     typedef std::vector<score_pair_t> score_pair_vec_t;
     typedef std::pair<int, const CMasternode> rank_pair_t;
@@ -65,7 +78,7 @@ private:
     std::list< std::pair<CService, uint256> > listScheduledMnbRequestConnections;
     std::map<CService, std::pair<int64_t, std::set<uint256> > > mapPendingMNB;
     std::map<CService, std::pair<int64_t, CMasternodeVerification> > mapPendingMNV;
-    CCriticalSection cs_mapPendingMNV;
+    mutable CCriticalSection cs_mapPendingMNV;
 
     /// Set when masternodes are added, cleared when CGovernanceManager is notified
     bool fMasternodesAdded;
@@ -77,11 +90,45 @@ private:
 
     int64_t nLastSentinelPingTime;
 
+    // Immutable copy of mapMasternodes for readers which must not take cs, see GetMasternodeListSnapshot().
+    // Only accessed through std::atomic_load/std::atomic_store.
+    std::shared_ptr<const masternode_map_t> pSnapshot;
+    // Entries changed since the snapshot was published last time
+    std::set<COutPoint> setSnapshotDirtyOutpoints;
+    // Set when entries were modified in a way that can't be tracked per outpoint
+    bool fSnapshotFullRebuild;
+    // Number of CSnapshotBatch objects alive, changes outside of a batch are published right away
+    int nSnapshotBatchDepth;
+
+    /**
+     * Publishes the snapshot when a batch of mutations ends.
+     * Must be created after cs is locked so that it's destroyed before cs is released.
+     */
+    class CSnapshotBatch
+    {
+    private:
+        CMasternodeMan& mnman;
+    public:
+        explicit CSnapshotBatch(CMasternodeMan& mnmanIn) : mnman(mnmanIn) { mnman.nSnapshotBatchDepth++; }
+        ~CSnapshotBatch()
+        {
+            if (--mnman.nSnapshotBatchDepth == 0) {
+                mnman.PublishSnapshot();
+            }
+        }
+    };
+
+    void MarkSnapshotDirty(const COutPoint& outpoint) { setSnapshotDirtyOutpoints.insert(outpoint); }
+    void MarkSnapshotDirty() { fSnapshotFullRebuild = true; }
+    /// Apply pending changes of mapMasternodes to a new snapshot and swap it in
+    void PublishSnapshot();
+
     friend class CMasternodeSync;
-    /// Find an entry
+    /// Find an entry, callers which modify it have to call MarkSnapshotDirty() for it
     CMasternode* Find(const COutPoint& outpoint);
 
-    bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
+    /// Scores the entries of mapSnapshot, which is refreshed if it lacks compatibility entries for deterministic MNs
+    bool GetMasternodeScores(masternode_map_t& mapSnapshot, const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
 
     void SyncSingle(CNode* pnode, const COutPoint& outpoint, CConnman& connman);
     void SyncAll(CNode* pnode, CConnman& connman);
@@ -127,6 +174,10 @@ public:
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
+        if(ser_action.ForRead()) {
+            MarkSnapshotDirty();
+            PublishSnapshot();
+        }
     }
 
     CMasternodeMan();
@@ -184,7 +235,10 @@ public:
     /// Find a random entry
     masternode_info_t FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion = -1);
 
-    std::map<COutPoint, CMasternode> GetFullMasternodeMap();
+    /// Lock-free access to the last published state of the list, the returned map is never modified
+    masternode_map_t GetMasternodeListSnapshot() const;
+    /// Same as above but only with entries which are valid in the deterministic list when spork15 is active
+    masternode_map_t GetFullMasternodeMap();
 
     bool GetMasternodeRanks(rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight = -1, int nMinProtocol = 0);
     bool GetMasternodeRank(const COutPoint &outpoint, int& nRankRet, int nBlockHeight = -1, int nMinProtocol = 0);
@@ -209,6 +263,8 @@ public:
     int size() { return mapMasternodes.size(); }
 
     std::string ToString() const;
+    /// Estimated memory used by the list, its snapshot and the maps of seen messages and requests
+    size_t DynamicMemoryUsage() const;
 
     /// Perform complete check and only then update masternode list and maps using provided CMasternodeBroadcast
     bool CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBroadcast mnb, int& nDos, CConnman& connman);
@@ -0,0 +1,164 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "memorybudget.h"
+
+#include "util.h"
+
+#include <algorithm>
+#include <assert.h>
+
+CMemoryBudget memoryBudget;
+
+void CMemoryBudget::SetTotal(size_t nTotalIn)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    nTotal = nTotalIn;
+}
+
+size_t CMemoryBudget::GetTotal() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return nTotal;
+}
+
+bool CMemoryBudget::IsActive() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return nTotal > 0;
+}
+
+void CMemoryBudget::RegisterFixed(const std::string& strName, size_t nSize, UsageFunction usage)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    Consumer consumer;
+    consumer.strName = strName;
+    consumer.nLimit = consumer.nMin = consumer.nMax = nSize;
+    consumer.nWeightInitialDownload = consumer.nWeightTip = 0;
+    consumer.usage = usage;
+    consumer.nUsage = usage ? usage() : nSize;
+    vConsumers.push_back(consumer);
+}
+
+void CMemoryBudget::RegisterDynamic(const std::string& strName, size_t nInitial, size_t nMin, size_t nMax, int nWeightInitialDownload, int nWeightTip,
+                                    UsageFunction usage, LimitFunction limit, HitsFunction hits)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    Consumer consumer;
+    consumer.strName = strName;
+    consumer.nMin = nMin;
+    consumer.nMax = std::max(nMin, nMax);
+    consumer.nLimit = std::min(std::max(nInitial, consumer.nMin), consumer.nMax);
+    consumer.nWeightInitialDownload = nWeightInitialDownload;
+    consumer.nWeightTip = nWeightTip;
+    consumer.usage = usage;
+    consumer.limit = limit;
+    consumer.hits = hits;
+    if (hits) {
+        hits(consumer.nLastHits, consumer.nLastMisses);
+    }
+    vConsumers.push_back(consumer);
+    limit(consumer.nLimit);
+}
+
+void CMemoryBudget::Clear()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    vConsumers.clear();
+}
+
+void CMemoryBudget::Rebalance(bool fInitialDownload)
+{
+    std::lock_guard<std::mutex> lock(cs);
+
+    size_t nAssigned = 0;
+    for (auto& consumer : vConsumers) {
+        if (consumer.usage) {
+            consumer.nUsage = consumer.usage();
+        }
+        if (consumer.hits) {
+            uint64_t nHits = 0, nMisses = 0;
+            consumer.hits(nHits, nMisses);
+            uint64_t nLookups = (nHits - consumer.nLastHits) + (nMisses - consumer.nLastMisses);
+            consumer.dMissRate = nLookups ? double(nMisses - consumer.nLastMisses) / nLookups : 0;
+            consumer.nLastHits = nHits;
+            consumer.nLastMisses = nMisses;
+        }
+        nAssigned += consumer.nLimit;
+    }
+    if (nTotal == 0) {
+        return;
+    }
+    size_t nFree = nTotal > nAssigned ? nTotal - nAssigned : 0;
+
+    // Take back half of what idle caches don't use, keeping some headroom above their usage
+    for (auto& consumer : vConsumers) {
+        if (!consumer.limit || consumer.nUsage >= consumer.nLimit / 2) {
+            continue;
+        }
+        size_t nKeep = std::max(consumer.nMin, consumer.nUsage + consumer.nUsage / 2);
+        if (nKeep >= consumer.nLimit) {
+            continue;
+        }
+        size_t nGive = (consumer.nLimit - nKeep) / 2;
+        if (nGive == 0) {
+            continue;
+        }
+        consumer.nLimit -= nGive;
+        consumer.nShrunk++;
+        nFree += nGive;
+        consumer.limit(consumer.nLimit);
+        LogPrint("memory", "CMemoryBudget::%s -- %s shrunk to %.1fMiB (using %.1fMiB)\n", __func__, consumer.strName,
+                 consumer.nLimit * (1.0 / 1024 / 1024), consumer.nUsage * (1.0 / 1024 / 1024));
+    }
+
+    // Hand the unassigned budget to the caches running out of room
+    std::vector<std::pair<Consumer*, double> > vGrow;
+    double dWeights = 0;
+    for (auto& consumer : vConsumers) {
+        int nWeight = fInitialDownload ? consumer.nWeightInitialDownload : consumer.nWeightTip;
+        if (!consumer.limit || nWeight == 0 || consumer.nLimit >= consumer.nMax || consumer.nUsage < consumer.nLimit / 10 * 9) {
+            continue;
+        }
+        // a cache missing more lookups profits more from growing
+        double dWeight = nWeight * (1 + 10 * consumer.dMissRate);
+        vGrow.emplace_back(&consumer, dWeight);
+        dWeights += dWeight;
+    }
+    size_t nHandedOut = 0;
+    for (auto& grow : vGrow) {
+        Consumer& consumer = *grow.first;
+        size_t nGrow = std::min<size_t>(nFree * (grow.second / dWeights), consumer.nMax - consumer.nLimit);
+        if (nGrow == 0) {
+            continue;
+        }
+        consumer.nLimit += nGrow;
+        consumer.nGrown++;
+        nHandedOut += nGrow;
+        consumer.limit(consumer.nLimit);
+        LogPrint("memory", "CMemoryBudget::%s -- %s grown to %.1fMiB (using %.1fMiB, miss rate %.3f)\n", __func__, consumer.strName,
+                 consumer.nLimit * (1.0 / 1024 / 1024), consumer.nUsage * (1.0 / 1024 / 1024), consumer.dMissRate);
+    }
+    assert(nHandedOut <= nFree);
+}
+
+std::vector<CMemoryBudget::ConsumerStats> CMemoryBudget::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    std::vector<ConsumerStats> vStats;
+    for (const auto& consumer : vConsumers) {
+        ConsumerStats stats;
+        stats.strName = consumer.strName;
+        stats.fDynamic = (bool)consumer.limit;
+        stats.nLimit = consumer.nLimit;
+        stats.nUsage = consumer.nUsage;
+        stats.nMin = consumer.nMin;
+        stats.nMax = consumer.nMax;
+        stats.dMissRate = consumer.dMissRate;
+        stats.nGrown = consumer.nGrown;
+        stats.nShrunk = consumer.nShrunk;
+        vStats.push_back(stats);
+    }
+    return vStats;
+}
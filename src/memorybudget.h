@@ -0,0 +1,112 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class CMemoryBudget;
+
+extern CMemoryBudget memoryBudget;
+
+/** Default for -maxmemory in megabytes, 0 sizes every cache by its own option */
+static const int64_t DEFAULT_MAX_MEMORY = 0;
+/** Smallest -maxmemory in megabytes */
+static const int64_t MIN_MAX_MEMORY = 128;
+/** Seconds between two rebalancing rounds */
+static const int64_t MEMORY_BUDGET_INTERVAL = 10;
+
+/**
+ * One memory budget (-maxmemory) shared by the caches of the node.
+ *
+ * Every cache registers its share with the budget. Shares of caches that can't be resized while
+ * running (the LevelDB caches, the signature cache) are fixed when they are created, the rest of
+ * the budget moves between the dynamic ones (UTXO cache, mempool, masternode list cache):
+ *
+ *  - a cache using less than half of its share gives back part of what it doesn't use
+ *  - caches close to their share get the unassigned budget, weighted by their miss rate and by
+ *    how much they matter in the current phase (the UTXO cache during initial block download,
+ *    the mempool and masternode lists at the tip)
+ *
+ * A share is only shrunk while its cache uses less than half of it, and never below one and a half
+ * times that usage, so the limit functions only have to store the new share.
+ *
+ * Lock order: cs is held while the usage, limit and hits functions run, and some of them take
+ * cs_main. The budget must therefore not be called with cs_main held, and the functions must not
+ * call back into the budget.
+ */
+class CMemoryBudget
+{
+public:
+    /** Current usage of a cache in bytes */
+    typedef std::function<size_t()> UsageFunction;
+    /** Apply a new share in bytes to a cache */
+    typedef std::function<void(size_t)> LimitFunction;
+    /** Lookups served from the cache and lookups it missed, both counted since startup */
+    typedef std::function<void(uint64_t&, uint64_t&)> HitsFunction;
+
+    struct ConsumerStats {
+        std::string strName;
+        bool fDynamic;
+        size_t nLimit;
+        size_t nUsage;
+        size_t nMin;
+        size_t nMax;
+        double dMissRate;
+        uint64_t nGrown;
+        uint64_t nShrunk;
+    };
+
+private:
+    struct Consumer {
+        std::string strName;
+        size_t nLimit;
+        size_t nMin;
+        size_t nMax;
+        int nWeightInitialDownload;
+        int nWeightTip;
+        UsageFunction usage;
+        LimitFunction limit;
+        HitsFunction hits;
+        size_t nUsage{0};
+        uint64_t nLastHits{0};
+        uint64_t nLastMisses{0};
+        double dMissRate{0};
+        uint64_t nGrown{0};
+        uint64_t nShrunk{0};
+    };
+
+    mutable std::mutex cs;
+    size_t nTotal{0};
+    std::vector<Consumer> vConsumers;
+
+public:
+    /** Set the budget in bytes, 0 disables rebalancing */
+    void SetTotal(size_t nTotalIn);
+    size_t GetTotal() const;
+    bool IsActive() const;
+
+    /** A cache whose size was fixed when it was created */
+    void RegisterFixed(const std::string& strName, size_t nSize, UsageFunction usage = UsageFunction());
+    /**
+     * A cache which can be resized while running, within nMin and nMax bytes. The weights tell
+     * how much it profits from more memory during initial block download and at the tip.
+     */
+    void RegisterDynamic(const std::string& strName, size_t nInitial, size_t nMin, size_t nMax, int nWeightInitialDownload, int nWeightTip,
+                         UsageFunction usage, LimitFunction limit, HitsFunction hits = HitsFunction());
+    void Clear();
+
+    /** Shift the budget between the dynamic caches, called every MEMORY_BUDGET_INTERVAL seconds */
+    void Rebalance(bool fInitialDownload);
+
+    /** Shares and usage of all registered caches as of the last rebalancing */
+    std::vector<ConsumerStats> GetStats() const;
+};
+
+#endif // MEMORYBUDGET_H
@@ -0,0 +1,39 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "memoryregistry.h"
+
+CMemoryRegistry memoryRegistry;
+
+void CMemoryRegistry::Register(const std::string& strName, UsageFunction usage)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    mapSubsystems[strName] = usage;
+}
+
+void CMemoryRegistry::Unregister(const std::string& strName)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    mapSubsystems.erase(strName);
+}
+
+void CMemoryRegistry::Clear()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    mapSubsystems.clear();
+}
+
+std::map<std::string, size_t> CMemoryRegistry::GetUsage() const
+{
+    std::map<std::string, UsageFunction> mapCopy;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        mapCopy = mapSubsystems;
+    }
+    std::map<std::string, size_t> mapUsage;
+    for (const auto& pair : mapCopy) {
+        mapUsage.emplace(pair.first, pair.second());
+    }
+    return mapUsage;
+}
@@ -0,0 +1,43 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MEMORYREGISTRY_H
+#define MEMORYREGISTRY_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+class CMemoryRegistry;
+
+extern CMemoryRegistry memoryRegistry;
+
+/**
+ * Registry of the long-lived subsystems of the node and their dynamic memory usage, reported
+ * by getmemoryinfo "subsystems".
+ *
+ * Usage functions are called without the registry lock held, so they are free to take the
+ * locks of their subsystem. The numbers are estimates based on the memusage helpers.
+ */
+class CMemoryRegistry
+{
+public:
+    /** Dynamic memory used by a subsystem in bytes */
+    typedef std::function<size_t()> UsageFunction;
+
+private:
+    mutable std::mutex cs;
+    std::map<std::string, UsageFunction> mapSubsystems;
+
+public:
+    void Register(const std::string& strName, UsageFunction usage);
+    void Unregister(const std::string& strName);
+    void Clear();
+
+    /** Current usage of every registered subsystem */
+    std::map<std::string, size_t> GetUsage() const;
+};
+
+#endif // MEMORYREGISTRY_H
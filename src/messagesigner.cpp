@@ -5,11 +5,30 @@
 
 #include "base58.h"
 #include "hash.h"
+#include "limitedmap.h"
+#include "sync.h"
 #include "validation.h" // For strMessageMagic
 #include "messagesigner.h"
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 
+// Signers recovered by PreRecoverHash, each entry is used by a single VerifyHash call.
+// Bounded so that signatures which are never verified (e.g. of messages that are
+// dropped before their signature is checked) can't grow it.
+static const size_t MAX_PRE_RECOVERED_KEYS = 10000;
+static CCriticalSection cs_mapPreRecoveredKeys;
+// the values are (sequence number, signer), so the oldest entries are evicted first
+static limitedmap<uint256, std::pair<uint64_t, CKeyID> > mapPreRecoveredKeys(MAX_PRE_RECOVERED_KEYS);
+static uint64_t nPreRecoveredSequence = 0;
+
+static uint256 GetPreRecoveredKeyHash(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << hash;
+    ss << vchSig;
+    return ss.GetHash();
+}
+
 bool CMessageSigner::GetKeysFromSecret(const std::string& strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     CBitcoinSecret vchSecret;
@@ -45,6 +64,15 @@ bool CMessageSigner::VerifyMessage(const CKeyID& keyID, const std::vector<unsign
     return CHashSigner::VerifyHash(ss.GetHash(), keyID, vchSig, strErrorRet);
 }
 
+void CMessageSigner::PreRecoverMessage(const std::string& strMessage, const std::vector<unsigned char>& vchSig)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << strMessageMagic;
+    ss << strMessage;
+
+    CHashSigner::PreRecoverHash(ss.GetHash(), vchSig);
+}
+
 bool CHashSigner::SignHash(const uint256& hash, const CKey& key, std::vector<unsigned char>& vchSigRet)
 {
     return key.SignCompact(hash, vchSigRet);
@@ -57,18 +85,52 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey& pubkey, const s
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
-    CPubKey pubkeyFromSig;
-    if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+    CKeyID keyIDFromSig;
+    bool fPreRecovered = false;
+    {
+        LOCK(cs_mapPreRecoveredKeys);
+        if (mapPreRecoveredKeys.size()) {
+            uint256 hashKey = GetPreRecoveredKeyHash(hash, vchSig);
+            auto it = mapPreRecoveredKeys.find(hashKey);
+            if (it != mapPreRecoveredKeys.end()) {
+                keyIDFromSig = it->second.second;
+                fPreRecovered = true;
+                mapPreRecoveredKeys.erase(hashKey);
+            }
+        }
+    }
+
+    if (!fPreRecovered) {
+        CPubKey pubkeyFromSig;
+        if (pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+            keyIDFromSig = pubkeyFromSig.GetID();
+        }
+    }
+
+    if(keyIDFromSig.IsNull()) {
         strErrorRet = "Error recovering public key.";
         return false;
     }
 
-    if(pubkeyFromSig.GetID() != keyID) {
+    if(keyIDFromSig != keyID) {
         strErrorRet = strprintf("Keys don't match: pubkey=%s, pubkeyFromSig=%s, hash=%s, vchSig=%s",
-                    keyID.ToString(), pubkeyFromSig.GetID().ToString(), hash.ToString(),
+                    keyID.ToString(), keyIDFromSig.ToString(), hash.ToString(),
                     EncodeBase64(&vchSig[0], vchSig.size()));
         return false;
     }
 
     return true;
 }
+
+CKeyID CHashSigner::PreRecoverHash(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    CKeyID keyIDFromSig;
+    CPubKey pubkeyFromSig;
+    if (pubkeyFromSig.RecoverCompact(hash, vchSig)) {
+        keyIDFromSig = pubkeyFromSig.GetID();
+    }
+
+    LOCK(cs_mapPreRecoveredKeys);
+    mapPreRecoveredKeys.insert(std::make_pair(GetPreRecoveredKeyHash(hash, vchSig), std::make_pair(++nPreRecoveredSequence, keyIDFromSig)));
+    return keyIDFromSig;
+}
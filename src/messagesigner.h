@@ -21,6 +21,8 @@ public:
     static bool VerifyMessage(const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, const std::string& strMessage, std::string& strErrorRet);
     /// Verify the message signature, returns true if succcessful
     static bool VerifyMessage(const CKeyID& keyID, const std::vector<unsigned char>& vchSig, const std::string& strMessage, std::string& strErrorRet);
+    /// Recover the signer of the message ahead of time, see CHashSigner::PreRecoverHash
+    static void PreRecoverMessage(const std::string& strMessage, const std::vector<unsigned char>& vchSig);
 };
 
 /** Helper class for signing hashes and checking their signatures
@@ -34,6 +36,10 @@ public:
     static bool VerifyHash(const uint256& hash, const CPubKey& pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
     /// Verify the hash signature, returns true if succcessful
     static bool VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
+    /// Recover the signer of the hash ahead of time (e.g. in a worker thread), so that the next
+    /// VerifyHash call for the same hash and signature only has to compare the key IDs.
+    /// Returns the recovered key ID, which is null if the recovery failed.
+    static CKeyID PreRecoverHash(const uint256& hash, const std::vector<unsigned char>& vchSig);
 };
 
 #endif
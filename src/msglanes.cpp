@@ -0,0 +1,171 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "msglanes.h"
+
+#include "protocol.h"
+#include "util.h"
+#include "utiltime.h"
+
+CMessageLanes messageLanes;
+
+// thread names must outlive the threads
+static const char* const LANE_THREAD_NAMES[CMessageLanes::LANE_COUNT] = {"lane-mn", "lane-gov", "lane-ps", "lane-spork", "lane-quorum"};
+
+CMessageLanes::~CMessageLanes()
+{
+    Stop();
+}
+
+const char* CMessageLanes::GetLaneName(Lane lane)
+{
+    switch (lane) {
+        case LANE_MASTERNODE: return "masternode";
+        case LANE_GOVERNANCE: return "governance";
+        case LANE_PRIVATESEND: return "privatesend";
+        case LANE_SPORK: return "spork";
+        case LANE_QUORUM: return "quorum";
+        default: return "none";
+    }
+}
+
+CMessageLanes::Lane CMessageLanes::GetLane(const std::string& strCommand)
+{
+    if (strCommand == NetMsgType::MNANNOUNCE ||
+        strCommand == NetMsgType::MNPING ||
+        strCommand == NetMsgType::DSEG ||
+        strCommand == NetMsgType::MNVERIFY ||
+        strCommand == NetMsgType::MASTERNODEPAYMENTVOTE ||
+        strCommand == NetMsgType::MASTERNODEPAYMENTSYNC) {
+        return LANE_MASTERNODE;
+    }
+    if (strCommand == NetMsgType::MNGOVERNANCESYNC ||
+        strCommand == NetMsgType::MNGOVERNANCEOBJECT ||
+        strCommand == NetMsgType::MNGOVERNANCEOBJECTVOTE) {
+        return LANE_GOVERNANCE;
+    }
+    if (strCommand == NetMsgType::DSACCEPT ||
+        strCommand == NetMsgType::DSVIN ||
+        strCommand == NetMsgType::DSFINALTX ||
+        strCommand == NetMsgType::DSSIGNFINALTX ||
+        strCommand == NetMsgType::DSCOMPLETE ||
+        strCommand == NetMsgType::DSSTATUSUPDATE ||
+        strCommand == NetMsgType::DSQUEUE) {
+        return LANE_PRIVATESEND;
+    }
+    if (strCommand == NetMsgType::SPORK ||
+        strCommand == NetMsgType::GETSPORKS) {
+        return LANE_SPORK;
+    }
+    if (strCommand == NetMsgType::QFCOMMITMENT ||
+        strCommand == NetMsgType::QDCOMMITMENT ||
+        strCommand == NetMsgType::QCONTRIB) {
+        return LANE_QUORUM;
+    }
+    return LANE_NONE;
+}
+
+bool CMessageLanes::WaitsForLanes(const std::string& strCommand)
+{
+    // the sync status counts the items the peer sent before it, which are processed on the lanes
+    return strCommand == NetMsgType::SYNCSTATUSCOUNT;
+}
+
+void CMessageLanes::Start()
+{
+    std::lock_guard<std::mutex> lock(cs);
+    if (fRunning) {
+        return;
+    }
+    fStopping = false;
+    fRunning = true;
+    for (int i = 0; i < LANE_COUNT; i++) {
+        lanes[i].thread = std::thread(&TraceThread<std::function<void()> >, LANE_THREAD_NAMES[i], std::function<void()>(std::bind(&CMessageLanes::ThreadLane, this, (Lane)i)));
+    }
+}
+
+void CMessageLanes::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (!fRunning) {
+            return;
+        }
+        fStopping = true;
+    }
+    condQueue.notify_all();
+    for (auto& laneState : lanes) {
+        if (laneState.thread.joinable()) {
+            laneState.thread.join();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(cs);
+    fRunning = false;
+    for (int i = 0; i < LANE_COUNT; i++) {
+        LogPrint("net", "CMessageLanes::%s -- lane %s: %d messages, at most %d pending, busy %dms\n", __func__,
+            GetLaneName((Lane)i), lanes[i].nProcessed.load(), lanes[i].nMaxPending, lanes[i].nBusyMicros.load() / 1000);
+    }
+}
+
+bool CMessageLanes::IsRunning() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return fRunning && !fStopping;
+}
+
+void CMessageLanes::Push(Lane lane, std::function<void()> job)
+{
+    assert(lane > LANE_NONE && lane < LANE_COUNT);
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fRunning && !fStopping) {
+            LaneState& laneState = lanes[lane];
+            laneState.queue.push_back(std::move(job));
+            laneState.nMaxPending = std::max(laneState.nMaxPending, laneState.queue.size());
+            laneState.nQueued++;
+            condQueue.notify_all();
+            return;
+        }
+    }
+    job();
+}
+
+void CMessageLanes::ThreadLane(Lane lane)
+{
+    LaneState& laneState = lanes[lane];
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        condQueue.wait(lock, [this, &laneState] { return fStopping || !laneState.queue.empty(); });
+        if (laneState.queue.empty()) {
+            break; // stopping and nothing left
+        }
+        std::function<void()> job = std::move(laneState.queue.front());
+        laneState.queue.pop_front();
+
+        lock.unlock();
+        int64_t nTimeStart = GetTimeMicros();
+        job();
+        laneState.nBusyMicros += GetTimeMicros() - nTimeStart;
+        laneState.nProcessed++;
+        lock.lock();
+    }
+}
+
+std::vector<CMessageLanes::LaneStats> CMessageLanes::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    std::vector<LaneStats> vStats;
+    for (int i = 0; i < LANE_COUNT; i++) {
+        LaneStats stats;
+        stats.strName = GetLaneName((Lane)i);
+        stats.nQueued = lanes[i].nQueued;
+        stats.nProcessed = lanes[i].nProcessed;
+        stats.nPending = lanes[i].queue.size();
+        stats.nMaxPending = lanes[i].nMaxPending;
+        stats.nBusyMicros = lanes[i].nBusyMicros;
+        vStats.push_back(stats);
+    }
+    return vStats;
+}
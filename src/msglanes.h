@@ -0,0 +1,97 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MSGLANES_H
+#define MSGLANES_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CMessageLanes;
+
+extern CMessageLanes messageLanes;
+
+/** Default for -msglanes */
+static const bool DEFAULT_MSGLANES = true;
+
+/**
+ * Worker lanes for the masternode network messages which don't need cs_main for most of their
+ * processing (masternode list and payments, governance, PrivateSend, sporks and quorum
+ * commitments). The message handler thread hands these messages to the lane of their subsystem
+ * instead of processing them itself, so they no longer add latency to block and transaction relay.
+ *
+ * Every lane is a single thread working through its queue in order, so messages of one subsystem
+ * are still processed in the order they were received, per peer and overall. Messages of
+ * different subsystems can be processed in a different order than they were received in.
+ */
+class CMessageLanes
+{
+public:
+    enum Lane {
+        LANE_NONE = -1,
+        LANE_MASTERNODE,
+        LANE_GOVERNANCE,
+        LANE_PRIVATESEND,
+        LANE_SPORK,
+        LANE_QUORUM,
+        LANE_COUNT
+    };
+
+    struct LaneStats {
+        std::string strName;
+        uint64_t nQueued;
+        uint64_t nProcessed;
+        size_t nPending;
+        size_t nMaxPending;
+        int64_t nBusyMicros;
+    };
+
+private:
+    struct LaneState {
+        std::thread thread;
+        std::deque<std::function<void()> > queue;
+        size_t nMaxPending{0};
+        std::atomic<uint64_t> nQueued{0};
+        std::atomic<uint64_t> nProcessed{0};
+        std::atomic<int64_t> nBusyMicros{0};
+    };
+
+    mutable std::mutex cs;
+    std::condition_variable condQueue;
+    LaneState lanes[LANE_COUNT];
+    bool fRunning{false};
+    bool fStopping{false};
+
+    void ThreadLane(Lane lane);
+
+public:
+    ~CMessageLanes();
+
+    static const char* GetLaneName(Lane lane);
+    /** The lane a message is processed on, LANE_NONE for messages handled by the message handler thread */
+    static Lane GetLane(const std::string& strCommand);
+    /**
+     * Whether a message must wait until all messages the same peer sent before it have left the
+     * lanes. Used for the few messages whose handling depends on the state of several subsystems.
+     */
+    static bool WaitsForLanes(const std::string& strCommand);
+
+    void Start();
+    /** Stop the lane threads, jobs which are still queued are run before the threads exit */
+    void Stop();
+    bool IsRunning() const;
+
+    /** Queue a job on a lane, runs it right away on the calling thread if the lanes are not running */
+    void Push(Lane lane, std::function<void()> job);
+
+    std::vector<LaneStats> GetStats() const;
+};
+
+#endif // MSGLANES_H
@@ -26,6 +26,7 @@
 #include "utilstrencodings.h"
 
 #include "instantx.h"
+#include "masternode-sigworker.h"
 #include "masternode-sync.h"
 #include "masternodeman.h"
 #include "privatesend.h"
@@ -34,6 +35,8 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef USE_UPNP
@@ -56,6 +59,13 @@
 #define MSG_NOSIGNAL 0
 #endif
 
+// Maximum number of queued buffers handed to a single sendmsg() call
+#if defined(IOV_MAX) && IOV_MAX < 64
+#define MAX_SEND_IOV IOV_MAX
+#else
+#define MAX_SEND_IOV 64
+#endif
+
 // Fix for ancient MinGW versions, that don't have defined these in ws2tcpip.h.
 // Todo: Can be removed when our pull-tester is upgraded to a modern MinGW version.
 #ifdef WIN32
@@ -421,6 +431,7 @@ void CConnman::DumpBanlist()
 {
     SweepBanned(); // clean unused entries (if bantime has expired)
 
+    LOCK(cs_banlistFile);
     if (!BannedSetIsDirty())
         return;
 
@@ -428,13 +439,39 @@ void CConnman::DumpBanlist()
 
     CBanDB bandb;
     banmap_t banmap;
-    SetBannedSetDirty(false);
-    GetBanned(banmap);
-    if (!bandb.Write(banmap))
-        SetBannedSetDirty(true);
+    CBanDB::changes_t vChanges;
+    bool fRewrite;
+    {
+        LOCK(cs_setBanned);
+        // compact the journal once it holds more changes than the list has entries
+        fRewrite = fBanlistRewrite || nBanJournalSize + vBanChanges.size() > std::max(setBanned.size(), MIN_BANLIST_JOURNAL_SIZE);
+        if (fRewrite) {
+            banmap = setBanned;
+            fBanlistRewrite = false;
+            nBanJournalSize = 0;
+        } else {
+            nBanJournalSize += vBanChanges.size();
+        }
+        vChanges.swap(vBanChanges);
+        setBannedIsDirty = false;
+    }
+
+    bool fSuccess = fRewrite ? bandb.Write(banmap) : bandb.AppendJournal(vChanges);
+    if (!fSuccess) {
+        // the state of the files is unknown now
+        LOCK(cs_setBanned);
+        fBanlistRewrite = true;
+        setBannedIsDirty = true;
+        return;
+    }
 
-    LogPrint("net", "Flushed %d banned node ips/subnets to banlist.dat  %dms\n",
-        banmap.size(), GetTimeMillis() - nStart);
+    if (fRewrite) {
+        LogPrint("net", "Flushed %d banned node ips/subnets to banlist.dat  %dms\n",
+            banmap.size(), GetTimeMillis() - nStart);
+    } else {
+        LogPrint("net", "Appended %d banlist changes to banjournal.dat  %dms\n",
+            vChanges.size(), GetTimeMillis() - nStart);
+    }
 }
 
 void CNode::CloseSocketDisconnect()
@@ -453,6 +490,9 @@ void CConnman::ClearBanned()
     {
         LOCK(cs_setBanned);
         setBanned.clear();
+        banIndex.Clear();
+        vBanChanges.clear();
+        fBanlistRewrite = true;
         setBannedIsDirty = true;
     }
     DumpBanlist(); //store banlist to disk
@@ -462,19 +502,9 @@ void CConnman::ClearBanned()
 
 bool CConnman::IsBanned(CNetAddr ip)
 {
-    bool fResult = false;
-    {
-        LOCK(cs_setBanned);
-        for (banmap_t::iterator it = setBanned.begin(); it != setBanned.end(); it++)
-        {
-            CSubNet subNet = (*it).first;
-            CBanEntry banEntry = (*it).second;
-
-            if(subNet.Match(ip) && GetTime() < banEntry.nBanUntil)
-                fResult = true;
-        }
-    }
-    return fResult;
+    int64_t nNow = GetTime();
+    LOCK(cs_setBanned);
+    return banIndex.IsBanned(ip, nNow);
 }
 
 bool CConnman::IsBanned(CSubNet subnet)
@@ -512,6 +542,8 @@ void CConnman::Ban(const CSubNet& subNet, const BanReason &banReason, int64_t ba
         LOCK(cs_setBanned);
         if (setBanned[subNet].nBanUntil < banEntry.nBanUntil) {
             setBanned[subNet] = banEntry;
+            banIndex.Set(subNet, banEntry.nBanUntil);
+            vBanChanges.emplace_back(subNet, banEntry);
             setBannedIsDirty = true;
         }
         else
@@ -540,6 +572,9 @@ bool CConnman::Unban(const CSubNet &subNet) {
         LOCK(cs_setBanned);
         if (!setBanned.erase(subNet))
             return false;
+        banIndex.Erase(subNet);
+        // an entry without ban time, it's swept after loading the journal
+        vBanChanges.emplace_back(subNet, CBanEntry());
         setBannedIsDirty = true;
     }
     if(clientInterface)
@@ -558,6 +593,9 @@ void CConnman::SetBanned(const banmap_t &banMap)
 {
     LOCK(cs_setBanned);
     setBanned = banMap;
+    banIndex.Build(setBanned);
+    vBanChanges.clear();
+    fBanlistRewrite = true;
     setBannedIsDirty = true;
 }
 
@@ -573,8 +611,10 @@ void CConnman::SweepBanned()
         CBanEntry banEntry = (*it).second;
         if(now > banEntry.nBanUntil)
         {
+            // Expired bans are already ignored by IsBanned and don't need to be journaled, as they
+            // are swept again after loading. banlist.dat drops them when it's rewritten.
             setBanned.erase(it++);
-            setBannedIsDirty = true;
+            banIndex.Erase(subNet);
             LogPrint("net", "%s: Removed banned node ip/subnet from banlist.dat: %s\n", __func__, subNet.ToString());
         }
         else
@@ -664,6 +704,7 @@ void CNode::copyStats(CNodeStats &stats)
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgCmd);
         X(nSendBytes);
+        X(nSendSyscalls);
     }
     {
         LOCK(cs_vRecv);
@@ -671,6 +712,7 @@ void CNode::copyStats(CNodeStats &stats)
         X(nRecvBytes);
     }
     X(fWhitelisted);
+    X(nNetThread);
 
     // It is common for nodes with good ping times to suddenly become lagged,
     // due to a new block arriving or other large transfer.
@@ -844,27 +886,55 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert(it->size() > pnode->nSendOffset);
         int nBytes = 0;
+        size_t nOffered = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            nOffered = it->size() - pnode->nSendOffset;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(it->data()) + pnode->nSendOffset, nOffered, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // hand as many queued buffers (headers and payloads) as possible to the kernel at once
+            struct iovec iov[MAX_SEND_IOV];
+            int nIov = 0;
+            size_t nOffset = pnode->nSendOffset;
+            for (auto itBuf = it; itBuf != pnode->vSendMsg.end() && nIov < MAX_SEND_IOV; ++itBuf, ++nIov) {
+                iov[nIov].iov_base = const_cast<unsigned char*>(itBuf->data()) + nOffset;
+                iov[nIov].iov_len = itBuf->size() - nOffset;
+                nOffered += iov[nIov].iov_len;
+                nOffset = 0;
+            }
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nIov;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
+        pnode->nSendSyscalls++;
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // drop the buffers which were sent completely, remember how far we got into the last one
+            size_t nLeft = nBytes;
+            while (nLeft > 0) {
+                size_t nRemaining = it->size() - pnode->nSendOffset;
+                if (nLeft < nRemaining) {
+                    pnode->nSendOffset += nLeft;
+                    break;
+                }
+                nLeft -= nRemaining;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
+                pnode->nSendSize -= it->size();
                 pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            if ((size_t)nBytes < nOffered) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -1121,6 +1191,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     {
         LOCK(cs_vNodes);
+        AssignNetThread(pnode);
         vNodes.push_back(pnode);
     }
 }
@@ -1146,6 +1217,8 @@ void CConnman::ThreadSocketHandler()
 
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+                    if (pnode->nNetThread >= 0)
+                        vNetThreads[pnode->nNetThread]->nPeers--;
 
                     // release outbound grant (if any)
                     pnode->grantOutbound.Release();
@@ -1196,18 +1269,14 @@ void CConnman::ThreadSocketHandler()
         }
 
         //
-        // Find which sockets have data to receive
+        // Accept new connections, the peers' sockets are serviced by the net I/O threads
         //
         struct timeval timeout;
         timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
+        timeout.tv_usec = 50000; // frequency of the inactivity checks
 
         fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
         FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
         SOCKET hSocketMax = 0;
         bool have_fds = false;
 
@@ -1217,10 +1286,100 @@ void CConnman::ThreadSocketHandler()
             have_fds = true;
         }
 
+        int nSelect = have_fds ? select(hSocketMax + 1, &fdsetRecv, NULL, NULL, &timeout) : SOCKET_ERROR;
+        if (interruptNet)
+            return;
+
+        if (nSelect == SOCKET_ERROR)
+        {
+            if (have_fds)
+            {
+                int nErr = WSAGetLastError();
+                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            }
+            FD_ZERO(&fdsetRecv);
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(50)))
+                return;
+        }
+
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+        {
+            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            {
+                AcceptConnection(hListenSocket);
+            }
+        }
+
+        std::vector<CNode*> vNodesCopy = CopyNodeVector();
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+        {
+            //
+            // Inactivity checking
+            //
+            int64_t nTime = GetSystemTimeInSeconds();
+            if (nTime - pnode->nTimeConnected > 60)
+            {
+                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+                {
+                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+                    pnode->fDisconnect = true;
+                }
+                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+                {
+                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+                    pnode->fDisconnect = true;
+                }
+                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+                {
+                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+                    pnode->fDisconnect = true;
+                }
+                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+                {
+                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+                    pnode->fDisconnect = true;
+                }
+                else if (!pnode->fSuccessfullyConnected)
+                {
+                    LogPrintf("version handshake timeout from %d\n", pnode->id);
+                    pnode->fDisconnect = true;
+                }
+            }
+        }
+        ReleaseNodeVector(vNodesCopy);
+    }
+}
+
+void CConnman::ThreadNetIO(int nThread)
+{
+    NetThread& netThread = *vNetThreads[nThread];
+    auto fOwned = [nThread](const CNode* pnode) { return pnode->nNetThread == nThread; };
+
+    while (!interruptNet)
+    {
+        //
+        // Find which sockets of our peers have data to receive
+        //
+        struct timeval timeout;
+        timeout.tv_sec  = 0;
+        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
+
+        fd_set fdsetRecv;
+        fd_set fdsetSend;
+        fd_set fdsetError;
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        SOCKET hSocketMax = 0;
+        bool have_fds = false;
+
         {
             LOCK(cs_vNodes);
             BOOST_FOREACH(CNode* pnode, vNodes)
             {
+                if (!fOwned(pnode))
+                    continue;
+
                 // Implement the following logic:
                 // * If there is data to send, select() for sending data. As this only
                 //   happens when optimistic write failed, we choose to first drain the
@@ -1257,45 +1416,39 @@ void CConnman::ThreadSocketHandler()
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        if (!have_fds) {
+            // no peers assigned to this thread (yet)
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(50)))
+                return;
+            continue;
+        }
+
+        int nSelect = select(hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
         if (interruptNet)
             return;
 
         if (nSelect == SOCKET_ERROR)
         {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            for (unsigned int i = 0; i <= hSocketMax; i++)
+                FD_SET(i, &fdsetRecv);
             FD_ZERO(&fdsetSend);
             FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(50)))
                 return;
         }
 
-        //
-        // Accept new connections
-        //
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
-        {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
-            {
-                AcceptConnection(hListenSocket);
-            }
-        }
+        int64_t nTimeStart = GetTimeMicros();
 
         //
         // Service each socket
         //
-        std::vector<CNode*> vNodesCopy = CopyNodeVector();
+        std::vector<CNode*> vNodesCopy = CopyNodeVector(fOwned);
         BOOST_FOREACH(CNode* pnode, vNodesCopy)
         {
             if (interruptNet)
-                return;
+                break;
 
             //
             // Receive
@@ -1330,6 +1483,7 @@ void CConnman::ThreadSocketHandler()
                             if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
                                 pnode->CloseSocketDisconnect();
                             RecordBytesRecv(nBytes);
+                            netThread.nBytesRecv += nBytes;
                             if (notify) {
                                 size_t nSizeAdded = 0;
                                 auto it(pnode->vRecvMsg.begin());
@@ -1337,6 +1491,10 @@ void CConnman::ThreadSocketHandler()
                                     if (!it->complete())
                                         break;
                                     nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+                                    // finish the checksum here instead of on the message handler thread
+                                    const uint256& hashMsg = it->GetMessageHash();
+                                    netThread.nMessagesRecv++;
+                                    masternodeSigWorker.PushMessage(pnode->GetId(), it->hdr.GetCommand(), hashMsg, it->vRecv);
                                 }
                                 {
                                     LOCK(pnode->cs_vProcessMsg);
@@ -1378,44 +1536,46 @@ void CConnman::ThreadSocketHandler()
                 size_t nBytes = SocketSendData(pnode);
                 if (nBytes) {
                     RecordBytesSent(nBytes);
-                }
-            }
-
-            //
-            // Inactivity checking
-            //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-                else if (!pnode->fSuccessfullyConnected)
-                {
-                    LogPrintf("version handshake timeout from %d\n", pnode->id);
-                    pnode->fDisconnect = true;
+                    netThread.nBytesSent += nBytes;
                 }
             }
         }
         ReleaseNodeVector(vNodesCopy);
+
+        netThread.nBusyMicros += GetTimeMicros() - nTimeStart;
+    }
+}
+
+void CConnman::AssignNetThread(CNode* pnode)
+{
+    AssertLockHeld(cs_vNodes);
+    if (vNetThreads.empty())
+        return;
+    // the thread with the fewest peers, connections stay on it until they are closed
+    int nBest = 0;
+    for (size_t i = 1; i < vNetThreads.size(); i++) {
+        if (vNetThreads[i]->nPeers < vNetThreads[nBest]->nPeers)
+            nBest = i;
+    }
+    pnode->nNetThread = nBest;
+    vNetThreads[nBest]->nPeers++;
+}
+
+std::vector<CConnman::NetThreadStats> CConnman::GetNetThreadStats() const
+{
+    std::vector<NetThreadStats> vStats;
+    for (size_t i = 0; i < vNetThreads.size(); i++) {
+        const NetThread& netThread = *vNetThreads[i];
+        NetThreadStats stats;
+        stats.nThread = i;
+        stats.nPeers = netThread.nPeers;
+        stats.nBytesRecv = netThread.nBytesRecv;
+        stats.nBytesSent = netThread.nBytesSent;
+        stats.nMessagesRecv = netThread.nMessagesRecv;
+        stats.nBusyMicros = netThread.nBusyMicros;
+        vStats.push_back(stats);
     }
+    return vStats;
 }
 
 void CConnman::WakeMessageHandler()
@@ -2030,6 +2190,7 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     GetNodeSignals().InitializeNode(pnode, *this);
     {
         LOCK(cs_vNodes);
+        AssignNetThread(pnode);
         vNodes.push_back(pnode);
     }
 
@@ -2259,6 +2420,8 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) :
 {
     fNetworkActive = true;
     setBannedIsDirty = false;
+    nBanJournalSize = 0;
+    fBanlistRewrite = false;
     fAddressesInitialized = false;
     nLastNodeId = 0;
     nSendBufferMaxSize = 0;
@@ -2299,6 +2462,14 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
     nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
 
+    {
+        LOCK(cs_vNodes);
+        vNetThreads.clear();
+        int nNetThreads = std::max(1, std::min(connOptions.nNetThreads, MAX_NET_THREADS));
+        for (int i = 0; i < nNetThreads; i++)
+            vNetThreads.emplace_back(new NetThread());
+    }
+
     SetBestHeight(connOptions.nBestHeight);
 
     clientInterface = connOptions.uiInterface;
@@ -2322,16 +2493,32 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nStart = GetTimeMillis();
     CBanDB bandb;
     banmap_t banmap;
+    CBanDB::changes_t vJournal;
     if (bandb.Read(banmap)) {
+        // a journal which can't be read doesn't make the list itself invalid
+        bool fJournalValid = bandb.ReadJournal(vJournal);
+        if (!fJournalValid) {
+            LogPrintf("Invalid banjournal.dat; discarding it\n");
+            vJournal.clear();
+        }
+        for (const auto& change : vJournal)
+            banmap[change.first] = change.second;
         SetBanned(banmap); // thread save setter
-        SetBannedSetDirty(false); // no need to write down, just read data
+        {
+            LOCK(cs_setBanned);
+            nBanJournalSize = vJournal.size();
+            fBanlistRewrite = !fJournalValid;
+        }
+        SetBannedSetDirty(!fJournalValid); // no need to write down unless the journal is replaced
         SweepBanned(); // sweep out unused entries
 
-        LogPrint("net", "Loaded %d banned node ips/subnets from banlist.dat  %dms\n",
-            banmap.size(), GetTimeMillis() - nStart);
+        LogPrint("net", "Loaded %d banned node ips/subnets from banlist.dat and %d changes from banjournal.dat  %dms\n",
+            banmap.size(), vJournal.size(), GetTimeMillis() - nStart);
+        if (!fJournalValid)
+            DumpBanlist();
     } else {
         LogPrintf("Invalid or missing banlist.dat; recreating\n");
-        SetBannedSetDirty(true); // force write
+        SetBanned(banmap_t()); // force write of the whole list
         DumpBanlist();
     }
 
@@ -2365,8 +2552,11 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
         fMsgProcWake = false;
     }
 
-    // Send and receive from sockets, accept connections
+    // Accept connections, disconnect peers
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
+    // Send and receive from sockets
+    for (size_t i = 0; i < vNetThreads.size(); i++)
+        vNetThreads[i]->thread = std::thread(&TraceThread<std::function<void()> >, "netio", std::function<void()>(std::bind(&CConnman::ThreadNetIO, this, (int)i)));
 
     if (!GetBoolArg("-dnsseed", true))
         LogPrintf("DNS seeding disabled\n");
@@ -2387,7 +2577,7 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
 
     // Dump network addresses
-    scheduler.scheduleEvery(boost::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL);
+    scheduler.scheduleEvery(boost::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL, "dumpaddresses");
 
     return true;
 }
@@ -2459,6 +2649,10 @@ void CConnman::Stop()
         threadDNSAddressSeed.join();
     if (threadSocketHandler.joinable())
         threadSocketHandler.join();
+    for (auto& netThread : vNetThreads) {
+        if (netThread->thread.joinable())
+            netThread->thread.join();
+    }
 
     if (fAddressesInitialized)
     {
@@ -2513,6 +2707,11 @@ size_t CConnman::GetAddressCount() const
     return addrman.size();
 }
 
+size_t CConnman::GetAddressMemoryUsage() const
+{
+    return addrman.DynamicMemoryUsage();
+}
+
 void CConnman::SetServices(const CService &addr, ServiceFlags nServices)
 {
     addrman.SetServices(addr, nServices);
@@ -2833,6 +3032,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nLastSend = 0;
     nLastRecv = 0;
     nSendBytes = 0;
+    nSendSyscalls = 0;
     nRecvBytes = 0;
     nTimeOffset = 0;
     addrName = addrNameIn == "" ? addr.ToStringIPPort() : addrNameIn;
@@ -2871,8 +3071,10 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fMasternode = false;
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
     fPauseRecv = false;
+    nNetThread = -1;
     fPauseSend = false;
     nProcessQueueSize = 0;
+    nLaneMessages = 0;
 
     BOOST_FOREACH(const std::string &msg, getAllNetMessageTypes())
         mapRecvBytesPerMsgCmd[msg] = 0;
@@ -91,11 +91,16 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default for -netthreads, number of threads doing socket I/O for the connected peers */
+static const int DEFAULT_NET_THREADS = 2;
+static const int MAX_NET_THREADS = 16;
 
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
+/** The banlist journal may always hold this many changes before it is compacted into banlist.dat */
+static const size_t MIN_BANLIST_JOURNAL_SIZE = 1000;
 
 typedef int64_t NodeId;
 
@@ -150,7 +155,18 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        int nNetThreads = DEFAULT_NET_THREADS;
     };
+
+    struct NetThreadStats {
+        int nThread;
+        int nPeers;
+        uint64_t nBytesRecv;
+        uint64_t nBytesSent;
+        uint64_t nMessagesRecv;
+        int64_t nBusyMicros;
+    };
+
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
     bool Start(CScheduler& scheduler, std::string& strNodeError, Options options);
@@ -317,6 +333,7 @@ public:
 
     // Addrman functions
     size_t GetAddressCount() const;
+    size_t GetAddressMemoryUsage() const;
     void SetServices(const CService &addr, ServiceFlags nServices);
     void MarkAddressGood(const CAddress& addr);
     void AddNewAddress(const CAddress& addr, const CAddress& addrFrom, int64_t nTimePenalty = 0);
@@ -399,6 +416,8 @@ public:
     unsigned int GetReceiveFloodSize() const;
 
     void WakeMessageHandler();
+
+    std::vector<NetThreadStats> GetNetThreadStats() const;
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -407,12 +426,24 @@ private:
         ListenSocket(SOCKET socket_, bool whitelisted_) : socket(socket_), whitelisted(whitelisted_) {}
     };
 
+    /** A socket I/O thread, every peer is serviced by exactly one of them (CNode::nNetThread) */
+    struct NetThread {
+        std::thread thread;
+        std::atomic<int> nPeers{0};
+        std::atomic<uint64_t> nBytesRecv{0};
+        std::atomic<uint64_t> nBytesSent{0};
+        std::atomic<uint64_t> nMessagesRecv{0};
+        std::atomic<int64_t> nBusyMicros{0};
+    };
+
     void ThreadOpenAddedConnections();
     void ProcessOneShot();
     void ThreadOpenConnections();
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
+    void ThreadNetIO(int nThread);
+    void AssignNetThread(CNode* pnode);
     void ThreadDNSAddressSeed();
     void ThreadOpenMasternodeConnections();
 
@@ -472,8 +503,19 @@ private:
     std::vector<ListenSocket> vhListenSocket;
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
+    // lookups of addresses in setBanned
+    CBanIndex banIndex;
+    // changes to setBanned which were not appended to the banlist journal yet
+    CBanDB::changes_t vBanChanges;
+    // number of changes in the banlist journal, it's compacted into banlist.dat when it grows too large
+    size_t nBanJournalSize;
+    // the whole banlist has to be written, e.g. after it was cleared
+    bool fBanlistRewrite;
     CCriticalSection cs_setBanned;
     bool setBannedIsDirty;
+    // held by DumpBanlist while it takes the changes and writes them, so a rewrite of banlist.dat
+    // can't remove a journal another dump just appended to. Locked before cs_setBanned.
+    CCriticalSection cs_banlistFile;
     bool fAddressesInitialized;
     CAddrMan addrman;
     std::deque<std::string> vOneShots;
@@ -517,6 +559,7 @@ private:
 
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
+    std::vector<std::unique_ptr<NetThread>> vNetThreads;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadOpenMasternodeConnections;
@@ -618,6 +661,7 @@ public:
     bool fAddnode;
     int nStartingHeight;
     uint64_t nSendBytes;
+    uint64_t nSendSyscalls;
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
@@ -627,6 +671,7 @@ public:
     double dMinPing;
     std::string addrLocal;
     CAddress addr;
+    int nNetThread;
 };
 
 
@@ -688,6 +733,7 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
+    uint64_t nSendSyscalls; // number of send calls made by SocketSendData
     std::deque<std::vector<unsigned char>> vSendMsg;
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
@@ -696,6 +742,8 @@ public:
     CCriticalSection cs_vProcessMsg;
     std::list<CNetMessage> vProcessMsg;
     size_t nProcessQueueSize;
+    // messages handed to the message lanes (msglanes.h) which have not been processed yet
+    std::atomic<int> nLaneMessages;
 
     CCriticalSection cs_sendProcessing;
 
@@ -744,6 +792,8 @@ public:
 
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // index of the socket I/O thread servicing this peer, set once when it is added to vNodes
+    int nNetThread;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
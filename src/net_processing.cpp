@@ -11,10 +11,12 @@
 #include "blockencodings.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
+#include "core_memusage.h"
 #include "hash.h"
 #include "init.h"
 #include "validation.h"
 #include "merkleblock.h"
+#include "msglanes.h"
 #include "net.h"
 #include "netmessagemaker.h"
 #include "netbase.h"
@@ -24,7 +26,9 @@
 #include "primitives/transaction.h"
 #include "random.h"
 #include "tinyformat.h"
+#include "trustedheaders.h"
 #include "txmempool.h"
+#include "txreconciliation.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
@@ -123,6 +127,7 @@ namespace {
         const CBlockIndex* pindex;                               //!< Optional.
         bool fValidatedHeaders;                                  //!< Whether this block has validated headers at the time of request.
         std::unique_ptr<PartiallyDownloadedBlock> partialBlock;  //!< Optional, used for CMPCTBLOCK downloads
+        int64_t nTimeRequested;                                  //!< When the block was requested (in microseconds).
     };
     std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
@@ -203,6 +208,21 @@ struct CNodeState {
     bool fPreferHeaderAndIDs;
     //! Whether this peer will send us cmpctblocks if we request them
     bool fProvidesHeaderAndIDs;
+    //! How many blocks we request from this peer at once, adapted to its download speed.
+    int nBlocksInFlightLimit;
+    //! When the last block requested from this peer arrived (in microseconds), or 0.
+    int64_t nLastBlockReceived;
+    //! Moving average of the time from requesting a block until it arrives (in microseconds), or 0.
+    int64_t nAvgBlockLatency;
+    //! Moving average of the time it takes this peer to deliver one more block (in microseconds), or 0.
+    int64_t nAvgBlockInterval;
+    //! Moving average of the size of the blocks downloaded from this peer.
+    int64_t nAvgBlockSize;
+    //! Number and total size of the blocks we requested from this peer and got.
+    uint64_t nBlocksDownloaded;
+    uint64_t nBlockBytesDownloaded;
+    //! Number of blocks requested again from this peer because a slower one held back the download.
+    uint64_t nBlocksRerequested;
     /**
      * If we've announced last version to this peer: whether the peer sends last version in cmpctblocks/blocktxns,
      * otherwise: whether this peer sends non-last version in cmpctblocks/blocktxns.
@@ -229,6 +249,14 @@ struct CNodeState {
         fPreferHeaderAndIDs = false;
         fProvidesHeaderAndIDs = false;
         fSupportsDesiredCmpctVersion = false;
+        nBlocksInFlightLimit = MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+        nLastBlockReceived = 0;
+        nAvgBlockLatency = 0;
+        nAvgBlockInterval = 0;
+        nAvgBlockSize = 0;
+        nBlocksDownloaded = 0;
+        nBlockBytesDownloaded = 0;
+        nBlocksRerequested = 0;
     }
 };
 
@@ -306,6 +334,7 @@ void FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTime) {
     assert(nPeersWithValidatedDownloads >= 0);
 
     mapNodeState.erase(nodeid);
+    txreconciliation.ForgetPeer(nodeid);
 
     if (mapNodeState.empty()) {
         // Do a consistency check after the last peer is removed.
@@ -340,6 +369,38 @@ bool MarkBlockAsReceived(const uint256& hash) {
     return false;
 }
 
+static int64_t UpdateMovingAverage(int64_t nAverage, int64_t nValue)
+{
+    return nAverage == 0 ? nValue : (nAverage * 7 + nValue) / 8;
+}
+
+// Requires cs_main.
+// Measure how fast a peer delivers the blocks we requested from it and adapt how
+// many blocks to keep in flight from it, call before MarkBlockAsReceived.
+void UpdateBlockDownloadStats(NodeId nodeid, const uint256& hash, size_t nSize) {
+    std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+    if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != nodeid)
+        return;
+    CNodeState *state = State(nodeid);
+    const QueuedBlock& queued = *itInFlight->second.second;
+    int64_t nNow = GetTimeMicros();
+
+    // While earlier requests were still queued, the time since the previous block arrived
+    // is what this one took; otherwise it's the full round trip.
+    int64_t nInterval = std::max<int64_t>(1, nNow - std::max(state->nLastBlockReceived, queued.nTimeRequested));
+    state->nAvgBlockLatency = UpdateMovingAverage(state->nAvgBlockLatency, std::max<int64_t>(1, nNow - queued.nTimeRequested));
+    state->nAvgBlockInterval = UpdateMovingAverage(state->nAvgBlockInterval, nInterval);
+    state->nAvgBlockSize = UpdateMovingAverage(state->nAvgBlockSize, nSize);
+    state->nLastBlockReceived = nNow;
+    state->nBlocksDownloaded++;
+    state->nBlockBytesDownloaded += nSize;
+
+    // Keep about BLOCK_DOWNLOAD_QUEUE_TIME worth of blocks requested: fast peers get
+    // more, slow ones fewer so they hold back less of the download window.
+    int64_t nLimit = 1 + BLOCK_DOWNLOAD_QUEUE_TIME / state->nAvgBlockInterval;
+    state->nBlocksInFlightLimit = std::max<int64_t>(MIN_BLOCKS_IN_TRANSIT_PER_PEER, std::min<int64_t>(MAX_BLOCKS_IN_TRANSIT_PER_FAST_PEER, nLimit));
+}
+
 // Requires cs_main.
 // returns false, still setting pit, if the block was already in flight from the same peer
 // pit will only be valid as long as the same cs_main lock is being held
@@ -358,7 +419,7 @@ bool MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Pa
     MarkBlockAsReceived(hash);
 
     std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(),
-            {hash, pindex, pindex != NULL, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&mempool) : NULL)});
+            {hash, pindex, pindex != NULL, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&mempool) : NULL), GetTimeMicros()});
     state->nBlocksInFlight++;
     state->nBlocksInFlightValidHeaders += it->fValidatedHeaders;
     if (state->nBlocksInFlight == 1) {
@@ -478,8 +539,8 @@ const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex*
 }
 
 /** Update pindexLastCommonBlock and add not-in-flight missing successors to vBlocks, until it has
- *  at most count entries. */
-void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, NodeId& nodeStaller, const Consensus::Params& consensusParams) {
+ *  at most count entries. pindexWaitingFor is set to the first missing block already in flight. */
+void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, NodeId& nodeStaller, const CBlockIndex*& pindexWaitingFor, const Consensus::Params& consensusParams) {
     if (count == 0)
         return;
 
@@ -556,6 +617,7 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<con
             } else if (waitingfor == -1) {
                 // This is the first already-in-flight block.
                 waitingfor = mapBlocksInFlight[pindex->GetBlockHash()].first;
+                pindexWaitingFor = pindex;
             }
         }
     }
@@ -575,6 +637,13 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
         if (queue.pindex)
             stats.vHeightInFlight.push_back(queue.pindex->nHeight);
     }
+    stats.nBlocksInFlightLimit = state->nBlocksInFlightLimit;
+    stats.nBlocksDownloaded = state->nBlocksDownloaded;
+    stats.nBlockBytesDownloaded = state->nBlockBytesDownloaded;
+    stats.nBlocksRerequested = state->nBlocksRerequested;
+    stats.nAvgBlockLatency = state->nAvgBlockLatency;
+    stats.nAvgBlockInterval = state->nAvgBlockInterval;
+    stats.nAvgBlockSize = state->nAvgBlockSize;
     return true;
 }
 
@@ -713,6 +782,19 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRE
     return nEvicted;
 }
 
+size_t GetOrphanTxsMemoryUsage()
+{
+    LOCK(cs_main);
+    size_t nUsage = memusage::DynamicUsage(mapOrphanTransactions) + memusage::DynamicUsage(mapOrphanTransactionsByPrev);
+    for (const auto& pair : mapOrphanTransactions) {
+        nUsage += memusage::DynamicUsage(pair.second.tx) + RecursiveDynamicUsage(*pair.second.tx);
+    }
+    for (const auto& pair : mapOrphanTransactionsByPrev) {
+        nUsage += memusage::DynamicUsage(pair.second);
+    }
+    return nUsage;
+}
+
 // Requires cs_main.
 void Misbehaving(NodeId pnode, int howmuch)
 {
@@ -1357,6 +1439,44 @@ inline void static SendBlockTransactions(const CBlock& block, const BlockTransac
     connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCKTXN, resp));
 }
 
+// Announce transactions agreed on in a reconciliation round, those are already in mapRelay
+// and filterInventoryKnown of the peer, see SendMessages.
+static void AnnounceReconciledTxs(CNode* pto, const std::vector<uint256>& vTxid, CConnman& connman)
+{
+    const CNetMsgMaker msgMaker(pto->GetSendVersion());
+    std::vector<CInv> vInv;
+    {
+        LOCK(cs_main);
+        for (const uint256& txid : vTxid) {
+            // expired from the relay memory, the peer couldn't fetch it anymore
+            if (!mapRelay.count(txid)) {
+                continue;
+            }
+            vInv.push_back(CInv(MSG_TX, txid));
+        }
+    }
+    for (size_t i = 0; i < vInv.size(); i += MAX_INV_SZ) {
+        std::vector<CInv> vChunk(vInv.begin() + i, vInv.begin() + std::min(vInv.size(), i + MAX_INV_SZ));
+        connman.PushMessage(pto, msgMaker.Make(NetMsgType::INV, vChunk));
+    }
+}
+
+static void ProcessExtensionMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
+{
+#ifdef ENABLE_WALLET
+    privateSendClient.ProcessMessage(pfrom, strCommand, vRecv, connman);
+#endif // ENABLE_WALLET
+    privateSendServer.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    mnodeman.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    mnpayments.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    instantsend.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
+    masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+    governance.ProcessMessage(pfrom, strCommand, vRecv, connman);
+    llmq::quorumBlockProcessor->ProcessMessage(pfrom, strCommand, vRecv, connman);
+    llmq::quorumDummyDKG->ProcessMessage(pfrom, strCommand, vRecv, connman);
+}
+
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
@@ -1653,6 +1773,18 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDCMPCT, fAnnounceUsingCMPCTBLOCK, nCMPCTBLOCKVersion));
         }
 
+        bool fPeerRelaysTxes;
+        {
+            LOCK(pfrom->cs_filter);
+            fPeerRelaysTxes = pfrom->fRelayTxes;
+        }
+        if (txreconciliation.IsEnabled() && fRelayTxes && fPeerRelaysTxes && !pfrom->fMasternode) {
+            // Tell our peer we'd like to reconcile transactions instead of announcing all of them,
+            // this only takes effect if it sends "sendrecon" as well
+            uint64_t nReconSalt = txreconciliation.PreRegisterPeer(pfrom->GetId());
+            connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDRECON, TXRECONCILIATION_VERSION, nReconSalt));
+        }
+
         pfrom->fSuccessfullyConnected = true;
     }
 
@@ -1731,6 +1863,71 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     }
 
 
+    else if (strCommand == NetMsgType::SENDRECON)
+    {
+        uint32_t nReconVersion = 0;
+        uint64_t nRemoteSalt = 0;
+        vRecv >> nReconVersion >> nRemoteSalt;
+        // The side which opened the connection starts the rounds
+        if (txreconciliation.RegisterPeer(pfrom->GetId(), !pfrom->fInbound, nReconVersion, nRemoteSalt)) {
+            LogPrint("net", "reconciling transactions with peer=%d (version %d, %s)\n", pfrom->id, nReconVersion, pfrom->fInbound ? "responder" : "initiator");
+        }
+    }
+
+
+    else if (strCommand == NetMsgType::REQRECON)
+    {
+        uint64_t nRemoteSetSize = 0;
+        vRecv >> nRemoteSetSize;
+        CReconSketch sketch;
+        std::vector<uint256> vAnnounce;
+        if (!txreconciliation.HandleRequest(pfrom->GetId(), GetTimeMicros(), nRemoteSetSize, sketch, vAnnounce)) {
+            LogPrint("net", "unexpected or too frequent reqrecon from peer=%d\n", pfrom->id);
+            return true;
+        }
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::RECONSKETCH, sketch));
+        AnnounceReconciledTxs(pfrom, vAnnounce, connman);
+    }
+
+
+    else if (strCommand == NetMsgType::RECONSKETCH)
+    {
+        CReconSketch sketch;
+        vRecv >> sketch;
+        if (sketch.GetCellCount() > RECON_MAX_CELLS || !sketch.IsValid()) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 20);
+            return error("invalid reconsketch with %u cells", sketch.GetCellCount());
+        }
+        std::vector<uint256> vAnnounce;
+        std::vector<uint32_t> vRequest;
+        bool fSuccess = false;
+        if (!txreconciliation.HandleSketch(pfrom->GetId(), sketch, vAnnounce, vRequest, fSuccess)) {
+            LogPrint("net", "unexpected reconsketch from peer=%d\n", pfrom->id);
+            return true;
+        }
+        if (!fSuccess) {
+            LogPrint("net", "reconciliation with peer=%d failed, announcing %u transactions\n", pfrom->id, vAnnounce.size());
+        }
+        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::RECONDIFF, fSuccess, vRequest));
+        AnnounceReconciledTxs(pfrom, vAnnounce, connman);
+    }
+
+
+    else if (strCommand == NetMsgType::RECONDIFF)
+    {
+        bool fSuccess = false;
+        std::vector<uint32_t> vRequested;
+        vRecv >> fSuccess >> vRequested;
+        std::vector<uint256> vAnnounce;
+        if (!txreconciliation.HandleDiff(pfrom->GetId(), fSuccess, vRequested, vAnnounce)) {
+            LogPrint("net", "unexpected recondiff from peer=%d\n", pfrom->id);
+            return true;
+        }
+        AnnounceReconciledTxs(pfrom, vAnnounce, connman);
+    }
+
+
     else if (strCommand == NetMsgType::INV)
     {
         std::vector<CInv> vInv;
@@ -2594,7 +2791,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 Misbehaving(pfrom->GetId(), 20);
                 return error("non-continuous headers sequence");
             }
-            hashLastBlock = header.GetHash();
+            hashLastBlock = trustedHeaders.GetHash(header);
         }
         }
 
@@ -2684,6 +2881,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     else if (strCommand == NetMsgType::BLOCK && !fImporting && !fReindex) // Ignore blocks received while importing
     {
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        size_t nBlockSize = vRecv.size();
         vRecv >> *pblock;
 
         LogPrint("net", "received block %s peer=%d\n", pblock->GetHash().ToString(), pfrom->id);
@@ -2698,6 +2896,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             LOCK(cs_main);
             // Also always process if we requested the block explicitly, as we may
             // need it even though it is not a candidate for a new best tip.
+            UpdateBlockDownloadStats(pfrom->GetId(), hash, nBlockSize);
             forceProcessing |= MarkBlockAsReceived(hash);
             // mapBlockSource is only used for sending reject messages and DoS scores,
             // so the race between here and cs_main in ProcessNewBlock is fine.
@@ -2970,18 +3169,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         if (found)
         {
             //probably one the extensions
-#ifdef ENABLE_WALLET
-            privateSendClient.ProcessMessage(pfrom, strCommand, vRecv, connman);
-#endif // ENABLE_WALLET
-            privateSendServer.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            mnodeman.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            mnpayments.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            instantsend.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
-            masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
-            governance.ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumBlockProcessor->ProcessMessage(pfrom, strCommand, vRecv, connman);
-            llmq::quorumDummyDKG->ProcessMessage(pfrom, strCommand, vRecv, connman);
+            ProcessExtensionMessage(pfrom, strCommand, vRecv, connman);
         }
         else
         {
@@ -3023,6 +3211,86 @@ static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman& connman)
     return false;
 }
 
+/** Run a message handler, exceptions caused by malformed messages are logged and answered with a reject */
+static bool CallMessageHandler(CNode* pfrom, const std::string& strCommand, unsigned int nMessageSize, CConnman& connman, const std::function<bool()>& handler)
+{
+    try
+    {
+        return handler();
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        connman.PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, std::string("error parsing message")));
+        if (strstr(e.what(), "end of data"))
+        {
+            // Allow exceptions from under-length message on vRecv
+            LogPrintf("%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else if (strstr(e.what(), "size too large"))
+        {
+            // Allow exceptions from over-long size
+            LogPrintf("%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else if (strstr(e.what(), "non-canonical ReadCompactSize()"))
+        {
+            // Allow exceptions from non-canonical encoding
+            LogPrintf("%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else
+        {
+            PrintExceptionContinue(&e, "ProcessMessages()");
+        }
+    }
+    catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessMessages()");
+    } catch (...) {
+        PrintExceptionContinue(NULL, "ProcessMessages()");
+    }
+    return false;
+}
+
+/**
+ * Hand a message to the lane of its subsystem. The message stays accounted in the peer's process
+ * queue until the lane is done with it, so a peer flooding a lane is paused like any other.
+ */
+static void PushLaneMessage(CNode* pfrom, CMessageLanes::Lane lane, std::list<CNetMessage>& msgs, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
+{
+    auto pmsgs = std::make_shared<std::list<CNetMessage> >();
+    pmsgs->splice(pmsgs->begin(), msgs);
+    size_t nMessageSize = pmsgs->front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+    {
+        LOCK(pfrom->cs_vProcessMsg);
+        pfrom->nProcessQueueSize += nMessageSize;
+    }
+    pfrom->AddRef();
+    pfrom->nLaneMessages++;
+
+    const std::atomic<bool>* pinterruptMsgProc = &interruptMsgProc;
+    messageLanes.Push(lane, [pfrom, pmsgs, nMessageSize, pinterruptMsgProc, &connman]() {
+        CNetMessage& msg = pmsgs->front();
+        std::string strCommand = msg.hdr.GetCommand();
+        if (!pfrom->fDisconnect && !*pinterruptMsgProc) {
+            bool fRet = CallMessageHandler(pfrom, strCommand, msg.hdr.nMessageSize, connman, [&]() {
+                ProcessExtensionMessage(pfrom, strCommand, msg.vRecv, connman);
+                return true;
+            });
+            if (!fRet) {
+                LogPrintf("ProcessMessages(%s, %u bytes) FAILED peer=%d\n", SanitizeString(strCommand), msg.hdr.nMessageSize, pfrom->id);
+            }
+        }
+        {
+            LOCK(pfrom->cs_vProcessMsg);
+            pfrom->nProcessQueueSize -= nMessageSize;
+            pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman.GetReceiveFloodSize();
+        }
+        if (--pfrom->nLaneMessages == 0) {
+            // messages waiting for the lanes can be processed now
+            connman.WakeMessageHandler();
+        }
+        pfrom->Release();
+    });
+}
+
 bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3054,6 +3322,9 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             LOCK(pfrom->cs_vProcessMsg);
             if (pfrom->vProcessMsg.empty())
                 return false;
+            // Keep the order with the messages this peer sent before that are still on the lanes
+            if (pfrom->nLaneMessages > 0 && CMessageLanes::WaitsForLanes(pfrom->vProcessMsg.front().hdr.GetCommand()))
+                return false;
             // Just take one message
             msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
             pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
@@ -3094,45 +3365,23 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             return fMoreWork;
         }
 
-        // Process message
-        bool fRet = false;
-        try
-        {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
-            if (interruptMsgProc)
-                return false;
-            if (!pfrom->vRecvGetData.empty())
-                fMoreWork = true;
-        }
-        catch (const std::ios_base::failure& e)
-        {
-            connman.PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, std::string("error parsing message")));
-            if (strstr(e.what(), "end of data"))
-            {
-                // Allow exceptions from under-length message on vRecv
-                LogPrintf("%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-            }
-            else if (strstr(e.what(), "size too large"))
-            {
-                // Allow exceptions from over-long size
-                LogPrintf("%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-            }
-            else if (strstr(e.what(), "non-canonical ReadCompactSize()"))
-            {
-                // Allow exceptions from non-canonical encoding
-                LogPrintf("%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-            }
-            else
-            {
-                PrintExceptionContinue(&e, "ProcessMessages()");
-            }
-        }
-        catch (const std::exception& e) {
-            PrintExceptionContinue(&e, "ProcessMessages()");
-        } catch (...) {
-            PrintExceptionContinue(NULL, "ProcessMessages()");
+        // Messages of the masternode network subsystems are processed on their lanes once the
+        // handshake is done, everything before that has to be handled here
+        CMessageLanes::Lane lane = CMessageLanes::GetLane(strCommand);
+        if (lane != CMessageLanes::LANE_NONE && pfrom->fSuccessfullyConnected && messageLanes.IsRunning()) {
+            PushLaneMessage(pfrom, lane, msgs, connman, interruptMsgProc);
+            return fMoreWork;
         }
 
+        // Process message
+        bool fRet = CallMessageHandler(pfrom, strCommand, nMessageSize, connman, [&]() {
+            return ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
+        });
+        if (interruptMsgProc)
+            return false;
+        if (!pfrom->vRecvGetData.empty())
+            fMoreWork = true;
+
         if (!fRet) {
             LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
         }
@@ -3498,6 +3747,8 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
                 // No reason to drain out at many times the network's capacity,
                 // especially since we have many peers and some will draw much shorter delays.
                 unsigned int nRelayedTransactions = 0;
+                // Peers we reconcile with learn about transactions in the next round instead
+                bool fReconcile = txreconciliation.IsPeerRegistered(pto->GetId());
                 LOCK(pto->cs_filter);
                 while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX_PER_1MB_BLOCK * MaxBlockSize(true) / 1000000) {
                     // Fetch the top element from the heap
@@ -3518,7 +3769,9 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
                     }
                     if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
                     // Send
-                    vInv.push_back(CInv(MSG_TX, hash));
+                    if (!fReconcile || !txreconciliation.AddToSet(pto->GetId(), hash)) {
+                        vInv.push_back(CInv(MSG_TX, hash));
+                    }
                     nRelayedTransactions++;
                     {
                         // Expire old relay messages
@@ -3558,6 +3811,12 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
         if (!vInv.empty())
             connman.PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
 
+        // Start a transaction reconciliation round
+        uint64_t nReconSetSize = 0;
+        if (txreconciliation.InitiateRound(pto->GetId(), nNow, nReconSetSize)) {
+            connman.PushMessage(pto, msgMaker.Make(NetMsgType::REQRECON, nReconSetSize));
+        }
+
         // Detect whether we're stalling
         nNow = GetTimeMicros();
         if (state.nStallingSince && state.nStallingSince < nNow - 1000000 * BLOCK_STALLING_TIMEOUT) {
@@ -3620,16 +3879,34 @@ bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interr
         // Message: getdata (blocks)
         //
         std::vector<CInv> vGetData;
-        if (!pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        if (!pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < state.nBlocksInFlightLimit) {
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller, consensusParams);
+            const CBlockIndex* pindexWaitingFor = NULL;
+            unsigned int nFreeSlots = state.nBlocksInFlightLimit - state.nBlocksInFlight;
+            FindNextBlocksToDownload(pto->GetId(), nFreeSlots, vToDownload, staller, pindexWaitingFor, consensusParams);
             BOOST_FOREACH(const CBlockIndex *pindex, vToDownload) {
                 vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), consensusParams, pindex);
                 LogPrint("net", "Requesting block %s (%d) peer=%d\n", pindex->GetBlockHash().ToString(),
                     pindex->nHeight, pto->id);
             }
+            if (vToDownload.size() < nFreeSlots && pindexWaitingFor && state.nAvgBlockInterval > 0) {
+                // We have room for more, but the download is held back by a block in flight from another
+                // peer. If that one is much slower than us and the block is overdue, request it from us.
+                std::pair<NodeId, std::list<QueuedBlock>::iterator>& inFlight = mapBlocksInFlight[pindexWaitingFor->GetBlockHash()];
+                CNodeState *stateOwner = State(inFlight.first);
+                bool fOverdue = nNow - inFlight.second->nTimeRequested > 2 * state.nAvgBlockLatency;
+                bool fSlower = stateOwner->nAvgBlockInterval == 0 || stateOwner->nAvgBlockInterval > 2 * state.nAvgBlockInterval;
+                if (inFlight.first != pto->GetId() && fOverdue && fSlower) {
+                    LogPrint("net", "Requesting block %s (%d) peer=%d again, held back by peer=%d\n", pindexWaitingFor->GetBlockHash().ToString(),
+                        pindexWaitingFor->nHeight, pto->id, inFlight.first);
+                    vGetData.push_back(CInv(MSG_BLOCK, pindexWaitingFor->GetBlockHash()));
+                    MarkBlockAsInFlight(pto->GetId(), pindexWaitingFor->GetBlockHash(), consensusParams, pindexWaitingFor);
+                    state.nBlocksRerequested++;
+                    staller = -1;
+                }
+            }
             if (state.nBlocksInFlight == 0 && staller != -1) {
                 if (State(staller)->nStallingSince == 0) {
                     State(staller)->nStallingSince = nNow;
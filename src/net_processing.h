@@ -47,10 +47,19 @@ struct CNodeStateStats {
     int nSyncHeight;
     int nCommonHeight;
     std::vector<int> vHeightInFlight;
+    int nBlocksInFlightLimit;
+    uint64_t nBlocksDownloaded;
+    uint64_t nBlockBytesDownloaded;
+    uint64_t nBlocksRerequested;
+    int64_t nAvgBlockLatency;
+    int64_t nAvgBlockInterval;
+    int64_t nAvgBlockSize;
 };
 
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
+/** Estimated memory used by the orphan transactions */
+size_t GetOrphanTxsMemoryUsage();
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch);
 
@@ -705,6 +705,25 @@ std::string CSubNet::ToString() const
     return network.ToString() + "/" + strNetmask;
 }
 
+int CSubNet::GetPrefixLength() const
+{
+    int nBits = 0;
+    int n = 0;
+    for (; n < 16 && netmask[n] == 0xff; ++n)
+        nBits += 8;
+    if (n < 16) {
+        int bits = NetmaskBits(netmask[n]);
+        if (bits < 0)
+            return -1;
+        nBits += bits;
+        ++n;
+    }
+    for (; n < 16; ++n)
+        if (netmask[n] != 0x00)
+            return -1;
+    return nBits;
+}
+
 bool CSubNet::IsValid() const
 {
     return valid;
@@ -117,6 +117,14 @@ class CSubNet
         std::string ToString() const;
         bool IsValid() const;
 
+        /** The (normalized) base address of the subnet */
+        const CNetAddr& GetNetwork() const { return network; }
+        /**
+         * The number of leading one bits of the netmask, counted over all 128 bits (IPv4 subnets are
+         * mapped into IPv6). Returns -1 if the netmask can't be represented by a prefix length.
+         */
+        int GetPrefixLength() const;
+
         friend bool operator==(const CSubNet& a, const CSubNet& b);
         friend bool operator!=(const CSubNet& a, const CSubNet& b);
         friend bool operator<(const CSubNet& a, const CSubNet& b);
@@ -11,12 +11,28 @@
 #include "utilstrencodings.h"
 #include "crypto/common.h"
 
+#include <atomic>
+
+static std::atomic<BlockHashFunction> blockHashFunction(BLOCK_HASH_YESPOWER);
+
+void SetBlockHashFunction(BlockHashFunction func)
+{
+    blockHashFunction = func;
+}
+
+BlockHashFunction GetBlockHashFunction()
+{
+    return blockHashFunction;
+}
+
 uint256 CBlockHeader::GetHash() const
 {
 //    std::vector<unsigned char> vch(80);
 //    CVectorWriter ss(SER_NETWORK, PROTOCOL_VERSION, vch, 0);
 //    ss << *this;
 //    return HashX11((const char *)vch.data(), (const char *)vch.data() + vch.size());
+    if (blockHashFunction.load(std::memory_order_relaxed) == BLOCK_HASH_SHA256D)
+        return SerializeHash(*this);
     return SerializeHashYespower(*this);
 
 }
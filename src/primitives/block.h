@@ -10,6 +10,17 @@
 #include "serialize.h"
 #include "uint256.h"
 
+/** Hash functions that can be used for the block hash and proof of work */
+enum BlockHashFunction {
+    BLOCK_HASH_YESPOWER,
+    /** Cheap hash for regtest and devnet, speeds up tests which create and validate lots of blocks */
+    BLOCK_HASH_SHA256D,
+};
+
+/** Select the hash function of CBlockHeader::GetHash(), only to be called through the chain params */
+void SetBlockHashFunction(BlockHashFunction func);
+BlockHashFunction GetBlockHashFunction();
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -242,6 +242,27 @@ extern const char *GETBLOCKTXN;
  * @since protocol version 70209 as described by BIP 152
  */
 extern const char *BLOCKTXN;
+/**
+ * Contains a 4-byte reconciliation protocol version and an 8-byte salt.
+ * Signals that the node wants to announce transactions by set reconciliation
+ * instead of flooding "inv" messages, sent once after "verack".
+ */
+extern const char *SENDRECON;
+/**
+ * Contains the 8-byte size of the sender's set of transactions to announce.
+ * Starts a reconciliation round, the peer should respond with "reconsketch".
+ */
+extern const char *REQRECON;
+/**
+ * Contains a sketch of the sender's set of transactions to announce.
+ * Sent in response to a "reqrecon" message.
+ */
+extern const char *RECONSKETCH;
+/**
+ * Contains a bool whether the sketch could be decoded and the short ids of the
+ * transactions the sender is missing. Sent in response to a "reconsketch" message.
+ */
+extern const char *RECONDIFF;
 
 // Volkshash message types
 // NOTE: do NOT declare non-implmented here, we don't want them to be exposed to the outside
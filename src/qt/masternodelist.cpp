@@ -374,10 +374,19 @@ void MasternodeList::updateNodeList()
 
     int offsetFromUtc = GetOffsetFromUtc();
 
-    std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
-
+    CMasternodeMan::masternode_map_t mapMasternodes = mnodeman.GetFullMasternodeMap();
+    // The snapshot doesn't iterate in outpoint order, sort it like masternodelist does
+    std::vector<const CMasternode*> vMasternodes;
+    vMasternodes.reserve(mapMasternodes.size());
     for (const auto& mnpair : mapMasternodes) {
-        CMasternode mn = mnpair.second;
+        vMasternodes.emplace_back(&mnpair.second);
+    }
+    std::sort(vMasternodes.begin(), vMasternodes.end(), [](const CMasternode* a, const CMasternode* b) {
+        return a->outpoint < b->outpoint;
+    });
+
+    for (const CMasternode* pmn : vMasternodes) {
+        const CMasternode& mn = *pmn;
         // populate list
         // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
         QTableWidgetItem* addressItem = new QTableWidgetItem(QString::fromStdString(mn.addr.ToString()));
@@ -130,12 +130,15 @@ UniValue getpoolinfo(const JSONRPCRequest& request)
 void masternode_list_help()
 {
     throw std::runtime_error(
-            "masternode list ( \"mode\" \"filter\" )\n"
+            "masternode list ( \"mode\" \"filter\" count skip )\n"
             "Get a list of masternodes in different modes. This call is identical to masternodelist call.\n"
             "\nArguments:\n"
             "1. \"mode\"      (string, optional/required to use filter, defaults = json) The mode to run list in\n"
             "2. \"filter\"    (string, optional) Filter results. Partial match by outpoint by default in all modes,\n"
             "                                    additional matches in some modes are also available\n"
+            "3. count         (numeric, optional) The maximum number of masternodes to return\n"
+            "4. skip          (numeric, optional, default=0) The number of matching masternodes to skip. Masternodes\n"
+            "                                    are sorted by outpoint (by rank in \"rank\" mode)\n"
             "\nAvailable modes:\n"
             "  activeseconds  - Print number of seconds masternode recognized by the network as enabled\n"
             "                   (since latest issued \"masternode start/start-many/start-alias\")\n"
@@ -853,10 +856,15 @@ UniValue masternodelist(const JSONRPCRequest& request)
     std::string strMode = "json";
     std::string strFilter = "";
 
+    int count = std::numeric_limits<int>::max();
+    int skip = 0;
+
     if (request.params.size() >= 1) strMode = request.params[0].get_str();
-    if (request.params.size() == 2) strFilter = request.params[1].get_str();
+    if (request.params.size() >= 2) strFilter = request.params[1].get_str();
+    if (request.params.size() >= 3) count = ParseInt32V(request.params[2], "count");
+    if (request.params.size() >= 4) skip = ParseInt32V(request.params[3], "skip");
 
-    if (request.fHelp || (
+    if (request.fHelp || request.params.size() > 4 || (
                 strMode != "activeseconds" && strMode != "addr" && strMode != "daemon" && strMode != "full" && strMode != "info" && strMode != "json" &&
                 strMode != "owneraddress" && strMode != "votingaddress" && strMode != "keyid" &&
                 strMode != "lastseen" && strMode != "lastpaidtime" && strMode != "lastpaidblock" &&
@@ -866,6 +874,10 @@ UniValue masternodelist(const JSONRPCRequest& request)
         masternode_list_help();
     }
 
+    if (count < 0 || skip < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count and skip must not be negative");
+    }
+
     if (strMode == "full" || strMode == "json" || strMode == "lastpaidtime" || strMode == "lastpaidblock") {
         CBlockIndex* pindex = NULL;
         {
@@ -876,24 +888,52 @@ UniValue masternodelist(const JSONRPCRequest& request)
     }
 
     UniValue obj(UniValue::VOBJ);
+    int nMatches = 0;
+    // entries are skipped after filtering, so that pages are stable as long as the list does not change
+    auto pushEntry = [&](const std::string& strOutpoint, const UniValue& value) {
+        if (nMatches++ >= skip) {
+            obj.push_back(Pair(strOutpoint, value));
+        }
+    };
+
     if (strMode == "rank") {
         CMasternodeMan::rank_pair_vec_t vMasternodeRanks;
         mnodeman.GetMasternodeRanks(vMasternodeRanks);
         for (const auto& rankpair : vMasternodeRanks) {
+            if ((int)obj.size() >= count) break;
             std::string strOutpoint = rankpair.second.outpoint.ToStringShort();
             if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-            obj.push_back(Pair(strOutpoint, rankpair.first));
+            pushEntry(strOutpoint, rankpair.first);
         }
     } else {
-        std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
+        // The snapshot shares its entries with the masternode manager, only pointers to them
+        // are copied to sort the entries for paging.
+        CMasternodeMan::masternode_map_t mapMasternodes = mnodeman.GetFullMasternodeMap();
+        std::vector<const CMasternode*> vMasternodes;
+        vMasternodes.reserve(mapMasternodes.size());
         for (const auto& mnpair : mapMasternodes) {
-            CMasternode mn = mnpair.second;
-            std::string strOutpoint = mnpair.first.ToStringShort();
+            vMasternodes.emplace_back(&mnpair.second);
+        }
+        std::sort(vMasternodes.begin(), vMasternodes.end(), [](const CMasternode* a, const CMasternode* b) {
+            return a->outpoint < b->outpoint;
+        });
+
+        bool fNeedPayee = strMode == "full" || strMode == "info" || strMode == "json" || strMode == "payee";
+        bool fDIP3Active = deterministicMNManager->IsDeterministicMNsSporkActive();
+        CDeterministicMNList mnList;
+        if (fNeedPayee && fDIP3Active) {
+            mnList = deterministicMNManager->GetListAtChainTip();
+        }
+
+        for (const CMasternode* pmn : vMasternodes) {
+            if ((int)obj.size() >= count) break;
+            const CMasternode& mn = *pmn;
+            std::string strOutpoint = mn.outpoint.ToStringShort();
 
             CScript payeeScript;
             std::string collateralAddressStr = "UNKNOWN";
-            if (deterministicMNManager->IsDeterministicMNsSporkActive()) {
-                auto dmn = deterministicMNManager->GetListAtChainTip().GetMNByCollateral(mn.outpoint);
+            if (fNeedPayee && fDIP3Active) {
+                auto dmn = mnList.GetMNByCollateral(mn.outpoint);
                 if (dmn) {
                     payeeScript = dmn->pdmnState->scriptPayout;
                     Coin coin;
@@ -904,35 +944,35 @@ UniValue masternodelist(const JSONRPCRequest& request)
                         }
                     }
                 }
-            } else {
+            } else if (fNeedPayee) {
                 payeeScript = GetScriptForDestination(mn.keyIDCollateralAddress);
                 collateralAddressStr = CBitcoinAddress(mn.keyIDCollateralAddress).ToString();
             }
 
             CTxDestination payeeDest;
             std::string payeeStr = "UNKNOWN";
-            if (ExtractDestination(payeeScript, payeeDest)) {
+            if (fNeedPayee && ExtractDestination(payeeScript, payeeDest)) {
                 payeeStr = CBitcoinAddress(payeeDest).ToString();
             }
 
             if (strMode == "activeseconds") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, (int64_t)(mn.lastPing.sigTime - mn.sigTime)));
+                pushEntry(strOutpoint, (int64_t)(mn.lastPing.sigTime - mn.sigTime));
             } else if (strMode == "addr") {
                 std::string strAddress = mn.addr.ToString();
                 if (strFilter !="" && strAddress.find(strFilter) == std::string::npos &&
                     strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strAddress));
+                pushEntry(strOutpoint, strAddress);
             } else if (strMode == "daemon") {
                 std::string strDaemon = mn.lastPing.GetDaemonString();
                 if (strFilter !="" && strDaemon.find(strFilter) == std::string::npos &&
                     strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strDaemon));
+                pushEntry(strOutpoint, strDaemon);
             } else if (strMode == "sentinel") {
                 std::string strSentinel = mn.lastPing.GetSentinelString();
                 if (strFilter !="" && strSentinel.find(strFilter) == std::string::npos &&
                     strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strSentinel));
+                pushEntry(strOutpoint, strSentinel);
             } else if (strMode == "full") {
                 std::ostringstream streamFull;
                 streamFull << std::setw(18) <<
@@ -947,7 +987,7 @@ UniValue masternodelist(const JSONRPCRequest& request)
                 std::string strFull = streamFull.str();
                 if (strFilter !="" && strFull.find(strFilter) == std::string::npos &&
                     strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strFull));
+                pushEntry(strOutpoint, strFull);
             } else if (strMode == "info") {
                 std::ostringstream streamInfo;
                 streamInfo << std::setw(18) <<
@@ -962,7 +1002,7 @@ UniValue masternodelist(const JSONRPCRequest& request)
                 std::string strInfo = streamInfo.str();
                 if (strFilter !="" && strInfo.find(strFilter) == std::string::npos &&
                     strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strInfo));
+                pushEntry(strOutpoint, strInfo);
             } else if (strMode == "json") {
                 std::ostringstream streamInfo;
                 streamInfo <<  mn.addr.ToString() << " " <<
@@ -995,38 +1035,38 @@ UniValue masternodelist(const JSONRPCRequest& request)
                 objMN.push_back(Pair("owneraddress", CBitcoinAddress(mn.keyIDOwner).ToString()));
                 objMN.push_back(Pair("votingaddress", CBitcoinAddress(mn.keyIDVoting).ToString()));
                 objMN.push_back(Pair("collateraladdress", collateralAddressStr));
-                obj.push_back(Pair(strOutpoint, objMN));
+                pushEntry(strOutpoint, objMN);
             } else if (strMode == "keyid") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, HexStr(mn.legacyKeyIDOperator)));
+                pushEntry(strOutpoint, HexStr(mn.legacyKeyIDOperator));
             } else if (strMode == "lastpaidblock") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, mn.GetLastPaidBlock()));
+                pushEntry(strOutpoint, mn.GetLastPaidBlock());
             } else if (strMode == "lastpaidtime") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, mn.GetLastPaidTime()));
+                pushEntry(strOutpoint, mn.GetLastPaidTime());
             } else if (strMode == "lastseen") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, (int64_t)mn.lastPing.sigTime));
+                pushEntry(strOutpoint, (int64_t)mn.lastPing.sigTime);
             } else if (strMode == "owneraddress") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, CBitcoinAddress(mn.keyIDOwner).ToString()));
+                pushEntry(strOutpoint, CBitcoinAddress(mn.keyIDOwner).ToString());
             } else if (strMode == "payee") {
                 if (strFilter !="" && payeeStr.find(strFilter) == std::string::npos &&
                     strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, payeeStr));
+                pushEntry(strOutpoint, payeeStr);
             } else if (strMode == "protocol") {
                 if (strFilter !="" && strFilter != strprintf("%d", mn.nProtocolVersion) &&
                     strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, mn.nProtocolVersion));
+                pushEntry(strOutpoint, mn.nProtocolVersion);
             } else if (strMode == "status") {
                 std::string strStatus = mn.GetStatus();
                 if (strFilter !="" && strStatus.find(strFilter) == std::string::npos &&
                     strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, strStatus));
+                pushEntry(strOutpoint, strStatus);
             } else if (strMode == "votingaddress") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, CBitcoinAddress(mn.keyIDVoting).ToString()));
+                pushEntry(strOutpoint, CBitcoinAddress(mn.keyIDVoting).ToString());
             }
         }
     }
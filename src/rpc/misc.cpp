@@ -8,10 +8,14 @@
 #include "base58.h"
 #include "clientversion.h"
 #include "init.h"
+#include "memorybudget.h"
+#include "memoryregistry.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpc/server.h"
+#include "scheduler.h"
 #include "timedata.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -1090,16 +1094,48 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCSubsystemsMemoryInfo()
+{
+    std::map<std::string, size_t> mapLimits;
+    for (const auto& stats : memoryBudget.GetStats()) {
+        mapLimits.emplace(stats.strName, stats.nLimit);
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    size_t nTotal = 0;
+    for (const auto& pair : memoryRegistry.GetUsage()) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("usage", uint64_t(pair.second)));
+        auto it = mapLimits.find(pair.first);
+        if (it != mapLimits.end()) {
+            size_t nLimit = it->second;
+            // the share of the UTXO cache includes the peak a flush needs, the usage doesn't
+            if (pair.first == "coinscache")
+                nLimit /= DB_PEAK_USAGE_FACTOR;
+            entry.push_back(Pair("limit", uint64_t(nLimit)));
+        }
+        obj.push_back(Pair(pair.first, entry));
+        nTotal += pair.second;
+    }
+    obj.push_back(Pair("total", uint64_t(nTotal)));
+    return obj;
+}
+
 UniValue getmemoryinfo(const JSONRPCRequest& request)
 {
     /* Please, avoid using the word "pool" here in the RPC interface or help,
      * as users will undoubtedly confuse it with the other "memory pool"
      */
-    if (request.fHelp || request.params.size() != 0)
+    std::string mode = (request.params.size() < 1) ? "stats" : request.params[0].get_str();
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-            "getmemoryinfo\n"
+            "getmemoryinfo (\"mode\")\n"
             "Returns an object containing information about memory usage.\n"
-            "\nResult:\n"
+            "\nArguments:\n"
+            "1. \"mode\" (string, optional, default: \"stats\") determines what kind of information is returned.\n"
+            "  - \"stats\" returns general statistics about memory usage in the daemon.\n"
+            "  - \"subsystems\" returns the estimated dynamic memory usage of every long-lived subsystem.\n"
+            "\nResult (mode \"stats\"):\n"
             "{\n"
             "  \"locked\": {               (json object) Information about locked memory manager\n"
             "    \"used\": xxxxx,          (numeric) Number of bytes used\n"
@@ -1110,12 +1146,90 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
             "  }\n"
             "}\n"
+            "\nResult (mode \"subsystems\"):\n"
+            "{\n"
+            "  \"name\": {                 (json object) One entry per subsystem, e.g. \"mempool\", \"masternodes\" or \"governance\"\n"
+            "    \"usage\": xxxxx,         (numeric) Estimated number of bytes used\n"
+            "    \"limit\": xxxxx,         (numeric, optional) Share of the memory budget in bytes, for caches managed by it.\n"
+            "                              For \"coinscache\" this is the size the cache may grow to, the share also\n"
+            "                              covers the peak a flush of the cache needs (twice the size of the cache)\n"
+            "  },\n"
+            "  ...\n"
+            "  \"total\": xxxxx           (numeric) Sum of the usage of all subsystems\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getmemoryinfo", "")
-            + HelpExampleRpc("getmemoryinfo", "")
+            + HelpExampleCli("getmemoryinfo", "\"subsystems\"")
+            + HelpExampleRpc("getmemoryinfo", "\"subsystems\"")
+        );
+    if (mode == "stats") {
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("locked", RPCLockedMemoryInfo()));
+        return obj;
+    } else if (mode == "subsystems") {
+        return RPCSubsystemsMemoryInfo();
+    } else {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "unknown mode " + mode);
+    }
+}
+
+static UniValue SchedulerHistogramToJSON(const std::array<uint64_t, 7>& histogram)
+{
+    static const char* labels[] = {"<1ms", "<10ms", "<100ms", "<1s", "<10s", "<60s", ">=60s"};
+    static_assert(sizeof(labels) / sizeof(labels[0]) == CScheduler::HISTOGRAM_BOUNDS.size() + 1, "labels don't match the histogram bounds");
+
+    UniValue obj(UniValue::VOBJ);
+    for (size_t i = 0; i < histogram.size(); i++) {
+        obj.push_back(Pair(labels[i], histogram[i]));
+    }
+    return obj;
+}
+
+UniValue getschedulerinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getschedulerinfo\n"
+            "Returns an object containing information about the tasks run by the scheduler.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"queued\": n,               (numeric) Number of tasks waiting to be run\n"
+            "  \"tasks\": {\n"
+            "    \"name\": {                (json object) Statistics of all runs of the task with this name\n"
+            "      \"runs\": n,             (numeric) Number of times the task was run\n"
+            "      \"total_run_us\": n,     (numeric) Total run time in microseconds\n"
+            "      \"max_run_us\": n,       (numeric) Longest run time in microseconds\n"
+            "      \"max_late_us\": n,      (numeric) Longest delay between the scheduled and the actual start in microseconds\n"
+            "      \"run_histogram\": {...},  (json object) Number of runs by run time\n"
+            "      \"late_histogram\": {...}  (json object) Number of runs by delay\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getschedulerinfo", "")
+            + HelpExampleRpc("getschedulerinfo", "")
         );
+
+    if (!g_scheduler)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Scheduler is not running");
+
+    boost::chrono::system_clock::time_point first, last;
     UniValue obj(UniValue::VOBJ);
-    obj.push_back(Pair("locked", RPCLockedMemoryInfo()));
+    obj.push_back(Pair("queued", (uint64_t)g_scheduler->getQueueInfo(first, last)));
+
+    UniValue tasks(UniValue::VOBJ);
+    for (const auto& p : g_scheduler->getTaskStats()) {
+        const CScheduler::TaskStats& stats = p.second;
+        UniValue task(UniValue::VOBJ);
+        task.push_back(Pair("runs", stats.nRuns));
+        task.push_back(Pair("total_run_us", stats.nTotalRunMicros));
+        task.push_back(Pair("max_run_us", stats.nMaxRunMicros));
+        task.push_back(Pair("max_late_us", stats.nMaxLateMicros));
+        task.push_back(Pair("run_histogram", SchedulerHistogramToJSON(stats.runHistogram)));
+        task.push_back(Pair("late_histogram", SchedulerHistogramToJSON(stats.lateHistogram)));
+        tasks.push_back(Pair(p.first, task));
+    }
+    obj.push_back(Pair("tasks", tasks));
     return obj;
 }
 
@@ -1137,7 +1251,8 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "debug",                  &debug,                  true,  {} },
     { "control",            "getinfo",                &getinfo,                true,  {} }, /* uses wallet if enabled */
-    { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {} },
+    { "control",            "getmemoryinfo",          &getmemoryinfo,          true,  {"mode"} },
+    { "control",            "getschedulerinfo",       &getschedulerinfo,       true,  {} },
     { "util",               "validateaddress",        &validateaddress,        true,  {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         true,  {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          true,  {"address","signature","message"} },
@@ -9,6 +9,7 @@
 #include "chainparams.h"
 #include "clientversion.h"
 #include "validation.h"
+#include "msglanes.h"
 #include "net.h"
 #include "net_processing.h"
 #include "netbase.h"
@@ -16,6 +17,7 @@
 #include "protocol.h"
 #include "sync.h"
 #include "timedata.h"
+#include "txreconciliation.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -85,6 +87,8 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"lastrecv\": ttt,           (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last receive\n"
             "    \"bytessent\": n,            (numeric) The total bytes sent\n"
             "    \"bytesrecv\": n,            (numeric) The total bytes received\n"
+            "    \"sendcalls\": n,            (numeric) The number of send system calls made for this peer\n"
+            "    \"bytespersendcall\": n,     (numeric) The average number of bytes sent per send system call\n"
             "    \"conntime\": ttt,           (numeric) The connection time in seconds since epoch (Jan 1 1970 GMT)\n"
             "    \"timeoffset\": ttt,         (numeric) The time offset in seconds\n"
             "    \"pingtime\": n,             (numeric) ping time (if available)\n"
@@ -102,7 +106,25 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "       n,                        (numeric) The heights of blocks we're currently asking from this peer\n"
             "       ...\n"
             "    ],\n"
+            "    \"blockdownload\": {\n"
+            "       \"inflightlimit\": n,      (numeric) How many blocks we request from this peer at once, adapted to its speed\n"
+            "       \"blocks\": n,             (numeric) The number of requested blocks downloaded from this peer\n"
+            "       \"bytes\": n,              (numeric) The total size of those blocks\n"
+            "       \"rerequested\": n,        (numeric) Blocks requested again from this peer because a slower peer held back the download\n"
+            "       \"latency\": n,            (numeric) Average time in seconds from requesting a block until it arrives\n"
+            "       \"blockinterval\": n,      (numeric) Average time in seconds this peer takes to deliver one more block\n"
+            "       \"rate\": n                (numeric) Average download rate in bytes per second\n"
+            "    },\n"
             "    \"whitelisted\": true|false, (boolean) Whether the peer is whitelisted\n"
+            "    \"netthread\": n,            (numeric) The socket I/O thread serving this peer\n"
+            "    \"txreconciliation\": {       (json object, optional) Only for peers we reconcile transactions with\n"
+            "       \"initiator\": true|false, (boolean) Whether we start the reconciliation rounds\n"
+            "       \"pending\": n,            (numeric) Transactions not reconciled with the peer yet\n"
+            "       \"rounds\": n,             (numeric) Finished reconciliation rounds\n"
+            "       \"failures\": n,           (numeric) Rounds which fell back to announcing all transactions\n"
+            "       \"announced\": n,          (numeric) Transactions announced to the peer after a round\n"
+            "       \"requested\": n,          (numeric) Transactions the peer announced to us after a round\n"
+            "    },\n"
             "    \"bytessent_per_msg\": {\n"
             "       \"addr\": n,              (numeric) The total bytes sent aggregated by message type\n"
             "       ...\n"
@@ -141,6 +163,8 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
         obj.push_back(Pair("lastrecv", stats.nLastRecv));
         obj.push_back(Pair("bytessent", stats.nSendBytes));
         obj.push_back(Pair("bytesrecv", stats.nRecvBytes));
+        obj.push_back(Pair("sendcalls", stats.nSendSyscalls));
+        obj.push_back(Pair("bytespersendcall", stats.nSendSyscalls ? (double)stats.nSendBytes / stats.nSendSyscalls : 0.0));
         obj.push_back(Pair("conntime", stats.nTimeConnected));
         obj.push_back(Pair("timeoffset", stats.nTimeOffset));
         if (stats.dPingTime > 0.0)
@@ -166,8 +190,29 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
                 heights.push_back(height);
             }
             obj.push_back(Pair("inflight", heights));
+            UniValue download(UniValue::VOBJ);
+            download.push_back(Pair("inflightlimit", statestats.nBlocksInFlightLimit));
+            download.push_back(Pair("blocks", statestats.nBlocksDownloaded));
+            download.push_back(Pair("bytes", statestats.nBlockBytesDownloaded));
+            download.push_back(Pair("rerequested", statestats.nBlocksRerequested));
+            download.push_back(Pair("latency", statestats.nAvgBlockLatency * 0.000001));
+            download.push_back(Pair("blockinterval", statestats.nAvgBlockInterval * 0.000001));
+            download.push_back(Pair("rate", statestats.nAvgBlockInterval ? statestats.nAvgBlockSize * 1000000.0 / statestats.nAvgBlockInterval : 0.0));
+            obj.push_back(Pair("blockdownload", download));
         }
         obj.push_back(Pair("whitelisted", stats.fWhitelisted));
+        obj.push_back(Pair("netthread", stats.nNetThread));
+        CTxReconciliationTracker::PeerStats reconstats;
+        if (txreconciliation.GetPeerStats(stats.nodeid, reconstats)) {
+            UniValue recon(UniValue::VOBJ);
+            recon.push_back(Pair("initiator", reconstats.fInitiator));
+            recon.push_back(Pair("pending", (uint64_t)reconstats.nPending));
+            recon.push_back(Pair("rounds", reconstats.nRounds));
+            recon.push_back(Pair("failures", reconstats.nFailures));
+            recon.push_back(Pair("announced", reconstats.nAnnounced));
+            recon.push_back(Pair("requested", reconstats.nRequested));
+            obj.push_back(Pair("txreconciliation", recon));
+        }
 
         UniValue sendPerMsgCmd(UniValue::VOBJ);
         BOOST_FOREACH(const mapMsgCmdSize::value_type &i, stats.mapSendBytesPerMsgCmd) {
@@ -345,7 +390,29 @@ UniValue getnettotals(const JSONRPCRequest& request)
             "    \"serve_historical_blocks\": true|false,  (boolean) True if serving historical blocks\n"
             "    \"bytes_left_in_cycle\": t,               (numeric) Bytes left in current time cycle\n"
             "    \"time_left_in_cycle\": t                 (numeric) Seconds left in current time cycle\n"
-            "  }\n"
+            "  },\n"
+            "  \"netthreads\": [        (array) Socket I/O threads\n"
+            "    {\n"
+            "      \"thread\": n,         (numeric) Thread index, as in getpeerinfo's netthread\n"
+            "      \"peers\": n,          (numeric) Number of peers served by this thread\n"
+            "      \"bytesrecv\": n,      (numeric) Total bytes received by this thread\n"
+            "      \"bytessent\": n,      (numeric) Total bytes sent by this thread\n"
+            "      \"msgsrecv\": n,       (numeric) Total complete messages received by this thread\n"
+            "      \"busymillis\": n      (numeric) Total time in milliseconds spent outside of select\n"
+            "    }\n"
+            "    ,...\n"
+            "  ],\n"
+            "  \"messagelanes\": [      (array) Worker lanes for masternode network messages (empty if disabled)\n"
+            "    {\n"
+            "      \"lane\": \"name\",     (string) The subsystem handled by this lane\n"
+            "      \"queued\": n,         (numeric) Total messages handed to this lane\n"
+            "      \"processed\": n,      (numeric) Total messages processed by this lane\n"
+            "      \"pending\": n,        (numeric) Messages waiting to be processed\n"
+            "      \"maxpending\": n,     (numeric) Most messages that were waiting at the same time\n"
+            "      \"busymillis\": n      (numeric) Total time in milliseconds spent processing messages\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getnettotals", "")
@@ -367,6 +434,34 @@ UniValue getnettotals(const JSONRPCRequest& request)
     outboundLimit.push_back(Pair("bytes_left_in_cycle", g_connman->GetOutboundTargetBytesLeft()));
     outboundLimit.push_back(Pair("time_left_in_cycle", g_connman->GetMaxOutboundTimeLeftInCycle()));
     obj.push_back(Pair("uploadtarget", outboundLimit));
+
+    UniValue netThreads(UniValue::VARR);
+    for (const auto& stats : g_connman->GetNetThreadStats()) {
+        UniValue netThread(UniValue::VOBJ);
+        netThread.push_back(Pair("thread", stats.nThread));
+        netThread.push_back(Pair("peers", stats.nPeers));
+        netThread.push_back(Pair("bytesrecv", stats.nBytesRecv));
+        netThread.push_back(Pair("bytessent", stats.nBytesSent));
+        netThread.push_back(Pair("msgsrecv", stats.nMessagesRecv));
+        netThread.push_back(Pair("busymillis", stats.nBusyMicros / 1000));
+        netThreads.push_back(netThread);
+    }
+    obj.push_back(Pair("netthreads", netThreads));
+
+    UniValue lanes(UniValue::VARR);
+    if (messageLanes.IsRunning()) {
+        for (const auto& stats : messageLanes.GetStats()) {
+            UniValue lane(UniValue::VOBJ);
+            lane.push_back(Pair("lane", stats.strName));
+            lane.push_back(Pair("queued", stats.nQueued));
+            lane.push_back(Pair("processed", stats.nProcessed));
+            lane.push_back(Pair("pending", (uint64_t)stats.nPending));
+            lane.push_back(Pair("maxpending", (uint64_t)stats.nMaxPending));
+            lane.push_back(Pair("busymillis", stats.nBusyMicros / 1000));
+            lanes.push_back(lane);
+        }
+    }
+    obj.push_back(Pair("messagelanes", lanes));
     return obj;
 }
 
@@ -811,11 +811,15 @@ UniValue protx_revoke(const JSONRPCRequest& request)
 void protx_list_help()
 {
     throw std::runtime_error(
-            "protx list (\"type\" \"detailed\" \"height\")\n"
+            "protx list (\"type\" \"detailed\" \"height\" \"filter\" count skip)\n"
             "\nLists all ProTxs in your wallet or on-chain, depending on the given type.\n"
             "If \"type\" is not specified, it defaults to \"registered\".\n"
             "If \"detailed\" is not specified, it defaults to \"false\" and only the hashes of the ProTx will be returned.\n"
             "If \"height\" is not specified, it defaults to the current chain-tip.\n"
+            "If \"filter\" is not empty, only ProTxs with a partial match of the hash, collateral, IP address or\n"
+            "payout address are returned.\n"
+            "The results are sorted by ProTx hash, \"count\" (default: all) and \"skip\" (default: 0) can be\n"
+            "used to page through them.\n"
             "\nAvailable types:\n"
             "  registered   - List all ProTx which are registered at the given chain height.\n"
             "                 This will also include ProTx which failed PoSe verfication.\n"
@@ -827,36 +831,106 @@ void protx_list_help()
     );
 }
 
-static bool CheckWalletOwnsKey(const CKeyID& keyID) {
-#ifndef ENABLE_WALLET
-    return false;
-#else
-    if (!pwalletMain) {
-        return false;
+/**
+ * The keys, scripts and collaterals of a masternode list that are owned by the wallet. Determined
+ * once per RPC call, so that the entries can be built without locking the wallet for every one.
+ */
+struct CWalletMNOwnership
+{
+    std::set<CKeyID> setKeyIDs;
+    std::set<CScriptID> setScriptIDs;
+    std::set<COutPoint> setCollaterals;
+
+    bool OwnsKey(const CKeyID& keyID) const
+    {
+        return setKeyIDs.count(keyID) != 0;
     }
-    return pwalletMain->HaveKey(keyID);
-#endif
-}
 
-static bool CheckWalletOwnsScript(const CScript& script) {
-#ifndef ENABLE_WALLET
-    return false;
-#else
-    if (!pwalletMain) {
+    bool OwnsScript(const CScript& script) const
+    {
+        CTxDestination dest;
+        if (ExtractDestination(script, dest)) {
+            if ((boost::get<CKeyID>(&dest) && OwnsKey(*boost::get<CKeyID>(&dest))) || (boost::get<CScriptID>(&dest) && setScriptIDs.count(*boost::get<CScriptID>(&dest)))) {
+                return true;
+            }
+        }
         return false;
     }
 
+    bool OwnsMN(const CDeterministicMNCPtr& dmn) const
+    {
+        return setCollaterals.count(dmn->collateralOutpoint) ||
+               OwnsKey(dmn->pdmnState->keyIDOwner) ||
+               OwnsKey(dmn->pdmnState->keyIDVoting) ||
+               OwnsScript(dmn->pdmnState->scriptPayout) ||
+               OwnsScript(dmn->pdmnState->scriptOperatorPayout);
+    }
+};
+
+#ifdef ENABLE_WALLET
+static void AddWalletOwnership(const CScript& script, CWalletMNOwnership& ownership)
+{
+    AssertLockHeld(pwalletMain->cs_wallet);
     CTxDestination dest;
     if (ExtractDestination(script, dest)) {
-        if ((boost::get<CKeyID>(&dest) && pwalletMain->HaveKey(*boost::get<CKeyID>(&dest))) || (boost::get<CScriptID>(&dest) && pwalletMain->HaveCScript(*boost::get<CScriptID>(&dest)))) {
-            return true;
+        if (boost::get<CKeyID>(&dest) && pwalletMain->HaveKey(*boost::get<CKeyID>(&dest))) {
+            ownership.setKeyIDs.emplace(*boost::get<CKeyID>(&dest));
+        } else if (boost::get<CScriptID>(&dest) && pwalletMain->HaveCScript(*boost::get<CScriptID>(&dest))) {
+            ownership.setScriptIDs.emplace(*boost::get<CScriptID>(&dest));
         }
     }
-    return false;
+}
+#endif
+
+// vCollateralScripts are the scripts of collaterals which are not in the wallet's ProTx coins, e.g. when
+// a single entry is shown. The ownership is empty if there is no wallet.
+static void GetWalletMNOwnership(const std::vector<CDeterministicMNCPtr>& vMNs, const std::vector<CScript>& vCollateralScripts, CWalletMNOwnership& ownership)
+{
+#ifdef ENABLE_WALLET
+    if (!pwalletMain) {
+        return;
+    }
+
+    LOCK(pwalletMain->cs_wallet);
+
+    std::vector<COutPoint> vOutpts;
+    pwalletMain->ListProTxCoins(vOutpts);
+    ownership.setCollaterals.insert(vOutpts.begin(), vOutpts.end());
+
+    for (const auto& dmn : vMNs) {
+        for (const CKeyID& keyID : {dmn->pdmnState->keyIDOwner, dmn->pdmnState->keyIDVoting}) {
+            if (pwalletMain->HaveKey(keyID)) {
+                ownership.setKeyIDs.emplace(keyID);
+            }
+        }
+        AddWalletOwnership(dmn->pdmnState->scriptPayout, ownership);
+        AddWalletOwnership(dmn->pdmnState->scriptOperatorPayout, ownership);
+    }
+    for (const auto& script : vCollateralScripts) {
+        AddWalletOwnership(script, ownership);
+    }
 #endif
 }
 
-UniValue BuildDMNListEntry(const CDeterministicMNCPtr& dmn, bool detailed)
+static bool GetCollateralScript(const COutPoint& collateralOutpoint, CScript& scriptRet)
+{
+    // the collateral of a registered MN is usually unspent, the transaction lookup is only
+    // needed for historic heights
+    Coin coin;
+    if (GetUTXOCoin(collateralOutpoint, coin)) {
+        scriptRet = coin.out.scriptPubKey;
+        return true;
+    }
+    CTransactionRef collateralTx;
+    uint256 tmpHashBlock;
+    if (GetTransaction(collateralOutpoint.hash, collateralTx, Params().GetConsensus(), tmpHashBlock) && collateralOutpoint.n < collateralTx->vout.size()) {
+        scriptRet = collateralTx->vout[collateralOutpoint.n].scriptPubKey;
+        return true;
+    }
+    return false;
+}
+
+UniValue BuildDMNListEntry(const CDeterministicMNCPtr& dmn, bool detailed, const CWalletMNOwnership& ownership)
 {
     if (!detailed) {
         return dmn->proTxHash.ToString();
@@ -869,15 +943,16 @@ UniValue BuildDMNListEntry(const CDeterministicMNCPtr& dmn, bool detailed)
     int confirmations = GetUTXOConfirmations(dmn->collateralOutpoint);
     o.push_back(Pair("confirmations", confirmations));
 
-    bool hasOwnerKey = CheckWalletOwnsKey(dmn->pdmnState->keyIDOwner);
-    bool hasOperatorKey = false; //CheckWalletOwnsKey(dmn->pdmnState->keyIDOperator);
-    bool hasVotingKey = CheckWalletOwnsKey(dmn->pdmnState->keyIDVoting);
+    bool hasOwnerKey = ownership.OwnsKey(dmn->pdmnState->keyIDOwner);
+    bool hasOperatorKey = false; //ownership.OwnsKey(dmn->pdmnState->keyIDOperator);
+    bool hasVotingKey = ownership.OwnsKey(dmn->pdmnState->keyIDVoting);
 
-    bool ownsCollateral = false;
-    CTransactionRef collateralTx;
-    uint256 tmpHashBlock;
-    if (GetTransaction(dmn->collateralOutpoint.hash, collateralTx, Params().GetConsensus(), tmpHashBlock)) {
-        ownsCollateral = CheckWalletOwnsScript(collateralTx->vout[dmn->collateralOutpoint.n].scriptPubKey);
+    // unspent collaterals of the wallet are known from its ProTx coins, the script is only needed
+    // for the others
+    bool ownsCollateral = ownership.setCollaterals.count(dmn->collateralOutpoint) != 0;
+    CScript collateralScript;
+    if (!ownsCollateral && GetCollateralScript(dmn->collateralOutpoint, collateralScript)) {
+        ownsCollateral = ownership.OwnsScript(collateralScript);
     }
 
     UniValue walletObj(UniValue::VOBJ);
@@ -885,13 +960,27 @@ UniValue BuildDMNListEntry(const CDeterministicMNCPtr& dmn, bool detailed)
     walletObj.push_back(Pair("hasOperatorKey", hasOperatorKey));
     walletObj.push_back(Pair("hasVotingKey", hasVotingKey));
     walletObj.push_back(Pair("ownsCollateral", ownsCollateral));
-    walletObj.push_back(Pair("ownsPayeeScript", CheckWalletOwnsScript(dmn->pdmnState->scriptPayout)));
-    walletObj.push_back(Pair("ownsOperatorRewardScript", CheckWalletOwnsScript(dmn->pdmnState->scriptOperatorPayout)));
+    walletObj.push_back(Pair("ownsPayeeScript", ownership.OwnsScript(dmn->pdmnState->scriptPayout)));
+    walletObj.push_back(Pair("ownsOperatorRewardScript", ownership.OwnsScript(dmn->pdmnState->scriptOperatorPayout)));
     o.push_back(Pair("wallet", walletObj));
 
     return o;
 }
 
+static bool MatchesDMNFilter(const CDeterministicMNCPtr& dmn, const std::string& strFilter)
+{
+    if (strFilter.empty()) {
+        return true;
+    }
+    if (dmn->proTxHash.ToString().find(strFilter) != std::string::npos ||
+        dmn->collateralOutpoint.ToStringShort().find(strFilter) != std::string::npos ||
+        dmn->pdmnState->addr.ToString().find(strFilter) != std::string::npos) {
+        return true;
+    }
+    CTxDestination payoutDest;
+    return ExtractDestination(dmn->pdmnState->scriptPayout, payoutDest) && CBitcoinAddress(payoutDest).ToString().find(strFilter) != std::string::npos;
+}
+
 UniValue protx_list(const JSONRPCRequest& request)
 {
     if (request.fHelp) {
@@ -908,68 +997,62 @@ UniValue protx_list(const JSONRPCRequest& request)
     if (request.params.size() > 1) {
         type = request.params[1].get_str();
     }
+    if (type != "registered" && type != "valid" && type != "wallet") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid type specified");
+    }
+    if (type == "wallet" && !hasWallet) {
+        throw std::runtime_error("\"protx list wallet\" not supported when wallet is disabled");
+    }
+    if (request.params.size() > 7) {
+        protx_list_help();
+    }
 
-    UniValue ret(UniValue::VARR);
-
-    LOCK(cs_main);
-
-    if (type == "wallet") {
-        if (!hasWallet) {
-            throw std::runtime_error("\"protx list wallet\" not supported when wallet is disabled");
-        }
-#ifdef ENABLE_WALLET
-        LOCK2(cs_main, pwalletMain->cs_wallet);
-
-        if (request.params.size() > 3) {
-            protx_list_help();
-        }
-
-        bool detailed = request.params.size() > 2 ? ParseBoolV(request.params[2], "detailed") : false;
+    bool detailed = request.params.size() > 2 ? ParseBoolV(request.params[2], "detailed") : false;
 
+    uint256 blockHash;
+    {
+        LOCK(cs_main);
         int height = request.params.size() > 3 ? ParseInt32V(request.params[3], "height") : chainActive.Height();
         if (height < 1 || height > chainActive.Height()) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid height specified");
         }
+        blockHash = chainActive[height]->GetBlockHash();
+    }
 
-        std::vector<COutPoint> vOutpts;
-        pwalletMain->ListProTxCoins(vOutpts);
-        std::set<COutPoint> setOutpts;
-        for (const auto& outpt : vOutpts) {
-            setOutpts.emplace(outpt);
-        }
+    std::string strFilter = request.params.size() > 4 ? request.params[4].get_str() : "";
+    int count = request.params.size() > 5 ? ParseInt32V(request.params[5], "count") : std::numeric_limits<int>::max();
+    int skip = request.params.size() > 6 ? ParseInt32V(request.params[6], "skip") : 0;
+    if (count < 0 || skip < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count and skip must not be negative");
+    }
 
-        CDeterministicMNList mnList = deterministicMNManager->GetListForBlock(chainActive[height]->GetBlockHash());
-        mnList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
-            if (setOutpts.count(dmn->collateralOutpoint) ||
-                CheckWalletOwnsKey(dmn->pdmnState->keyIDOwner) ||
-                CheckWalletOwnsKey(dmn->pdmnState->keyIDVoting) ||
-                CheckWalletOwnsScript(dmn->pdmnState->scriptPayout) ||
-                CheckWalletOwnsScript(dmn->pdmnState->scriptOperatorPayout)) {
-                ret.push_back(BuildDMNListEntry(dmn, detailed));
-            }
-        });
-#endif
-    } else if (type == "valid" || type == "registered") {
-        if (request.params.size() > 4) {
-            protx_list_help();
+    // The list shares its entries with the cached lists of the manager, so this is cheap.
+    // Only pointers to the matching entries are collected.
+    CDeterministicMNList mnList = deterministicMNManager->GetListForBlock(blockHash);
+    std::vector<CDeterministicMNCPtr> vMatches;
+    mnList.ForEachMN(type == "valid", [&](const CDeterministicMNCPtr& dmn) {
+        if (MatchesDMNFilter(dmn, strFilter)) {
+            vMatches.emplace_back(dmn);
         }
+    });
 
-        LOCK(cs_main);
-
-        bool detailed = request.params.size() > 2 ? ParseBoolV(request.params[2], "detailed") : false;
+    CWalletMNOwnership ownership;
+    if (type == "wallet" || detailed) {
+        GetWalletMNOwnership(vMatches, {}, ownership);
+    }
+    if (type == "wallet") {
+        vMatches.erase(std::remove_if(vMatches.begin(), vMatches.end(), [&](const CDeterministicMNCPtr& dmn) {
+            return !ownership.OwnsMN(dmn);
+        }), vMatches.end());
+    }
 
-        int height = request.params.size() > 3 ? ParseInt32V(request.params[3], "height") : chainActive.Height();
-        if (height < 1 || height > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid height specified");
-        }
+    std::sort(vMatches.begin(), vMatches.end(), [](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
+        return a->proTxHash < b->proTxHash;
+    });
 
-        CDeterministicMNList mnList = deterministicMNManager->GetListForBlock(chainActive[height]->GetBlockHash());
-        bool onlyValid = type == "valid";
-        mnList.ForEachMN(onlyValid, [&](const CDeterministicMNCPtr& dmn) {
-            ret.push_back(BuildDMNListEntry(dmn, detailed));
-        });
-    } else {
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid type specified");
+    UniValue ret(UniValue::VARR);
+    for (size_t i = skip; i < vMatches.size() && ret.size() < (size_t)count; i++) {
+        ret.push_back(BuildDMNListEntry(vMatches[i], detailed, ownership));
     }
 
     return ret;
@@ -1002,7 +1085,14 @@ UniValue protx_info(const JSONRPCRequest& request)
     if (!dmn) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s not found", proTxHash.ToString()));
     }
-    return BuildDMNListEntry(dmn, true);
+
+    CWalletMNOwnership ownership;
+    std::vector<CScript> vCollateralScripts(1);
+    if (!GetCollateralScript(dmn->collateralOutpoint, vCollateralScripts[0])) {
+        vCollateralScripts.clear();
+    }
+    GetWalletMNOwnership({dmn}, vCollateralScripts, ownership);
+    return BuildDMNListEntry(dmn, true, ownership);
 }
 
 void protx_diff_help()
@@ -6,6 +6,7 @@
 
 #include "reverselock.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <boost/bind.hpp>
 #include <utility>
@@ -27,6 +28,16 @@ static boost::system_time toPosixTime(const boost::chrono::system_clock::time_po
 }
 #endif
 
+const std::array<int64_t, 6> CScheduler::HISTOGRAM_BOUNDS = {{1000, 10000, 100000, 1000000, 10000000, 60000000}};
+
+static void AddToHistogram(std::array<uint64_t, 7>& histogram, int64_t nMicros)
+{
+    size_t i = 0;
+    while (i < CScheduler::HISTOGRAM_BOUNDS.size() && nMicros >= CScheduler::HISTOGRAM_BOUNDS[i])
+        i++;
+    histogram[i]++;
+}
+
 void CScheduler::serviceQueue()
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
@@ -41,39 +52,71 @@ void CScheduler::serviceQueue()
                 // Wait until there is something to do.
                 newTaskScheduled.wait(lock);
             }
+            if (shouldStop())
+                continue;
 
-            // Wait until either there is a new task, or until
-            // the time of the first item on the queue:
+            // Find the first task which is due and whose group is not running on
+            // another thread. Tasks of busy groups keep their place in the queue.
+            boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+            auto it = taskQueue.begin();
+            while (it != taskQueue.end() && it->first <= now &&
+                   !it->second.strGroup.empty() && setRunningGroups.count(it->second.strGroup)) {
+                ++it;
+            }
 
+            if (it == taskQueue.end()) {
+                // All due tasks are blocked, wait until a task finishes or a new one is scheduled
+                newTaskScheduled.wait(lock);
+                continue;
+            }
+            if (it->first > now) {
+                // Wait until either there is a new task, or until
+                // the time of the next item on the queue:
 // wait_until needs boost 1.50 or later; older versions have timed_wait:
 #if BOOST_VERSION < 105000
-            while (!shouldStop() && !taskQueue.empty() &&
-                   newTaskScheduled.timed_wait(lock, toPosixTime(taskQueue.begin()->first))) {
-                // Keep waiting until timeout
-            }
+                newTaskScheduled.timed_wait(lock, toPosixTime(it->first));
 #else
-            // Some boost versions have a conflicting overload of wait_until that returns void.
-            // Explicitly use a template here to avoid hitting that overload.
-            while (!shouldStop() && !taskQueue.empty()) {
-                boost::chrono::system_clock::time_point timeToWaitFor = taskQueue.begin()->first;
-                if (newTaskScheduled.wait_until<>(lock, timeToWaitFor) == boost::cv_status::timeout)
-                    break; // Exit loop after timeout, it means we reached the time of the event
-            }
+                // Some boost versions have a conflicting overload of wait_until that returns void.
+                // Explicitly use a template here to avoid hitting that overload.
+                newTaskScheduled.wait_until<>(lock, it->first);
 #endif
-            // If there are multiple threads, the queue can empty while we're waiting (another
-            // thread may service the task we were waiting on).
-            if (shouldStop() || taskQueue.empty())
+                // The queue may have changed while we were waiting (another thread may
+                // service the task we were waiting on), so look again.
                 continue;
+            }
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            Task task = it->second;
+            int64_t nLateMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(now - it->first).count();
+            taskQueue.erase(it);
+            if (!task.strGroup.empty())
+                setRunningGroups.insert(task.strGroup);
 
-            {
+            boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+            try {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
-                f();
+                task.f();
+            } catch (...) {
+                if (!task.strGroup.empty())
+                    setRunningGroups.erase(task.strGroup);
+                throw;
+            }
+            int64_t nRunMicros = boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::steady_clock::now() - start).count();
+
+            if (!task.strGroup.empty()) {
+                setRunningGroups.erase(task.strGroup);
+                // tasks of this group may be waiting
+                newTaskScheduled.notify_all();
             }
+
+            TaskStats& stats = mapTaskStats[task.strName.empty() ? "other" : task.strName];
+            stats.nRuns++;
+            stats.nTotalRunMicros += nRunMicros;
+            stats.nMaxRunMicros = std::max(stats.nMaxRunMicros, nRunMicros);
+            stats.nMaxLateMicros = std::max(stats.nMaxLateMicros, nLateMicros);
+            AddToHistogram(stats.runHistogram, nRunMicros);
+            AddToHistogram(stats.lateHistogram, nLateMicros);
         } catch (...) {
             --nThreadsServicingQueue;
             throw;
@@ -95,29 +138,30 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t, const std::string& strName, const std::string& strGroup)
 {
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        taskQueue.insert(std::make_pair(t, Task{f, strName, strGroup}));
     }
-    newTaskScheduled.notify_one();
+    // all threads, as the thread waiting for the earliest task may be blocked by its group
+    newTaskScheduled.notify_all();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds, const std::string& strName, const std::string& strGroup)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds));
+    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds), strName, strGroup);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaSeconds)
+static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaSeconds, const std::string& strName, const std::string& strGroup)
 {
     f();
-    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaSeconds), deltaSeconds);
+    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaSeconds, strName, strGroup), deltaSeconds, strName, strGroup);
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds, const std::string& strName, const std::string& strGroup)
 {
-    scheduleFromNow(boost::bind(&Repeat, this, f, deltaSeconds), deltaSeconds);
+    scheduleFromNow(boost::bind(&Repeat, this, f, deltaSeconds, strName, strGroup), deltaSeconds, strName, strGroup);
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
@@ -131,3 +175,9 @@ size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
     }
     return result;
 }
+
+std::map<std::string, CScheduler::TaskStats> CScheduler::getTaskStats() const
+{
+    boost::unique_lock<boost::mutex> lock(newTaskMutex);
+    return mapTaskStats;
+}
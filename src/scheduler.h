@@ -13,7 +13,13 @@
 #include <boost/function.hpp>
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
+#include <array>
 #include <map>
+#include <set>
+#include <string>
+
+static const int DEFAULT_SCHEDULER_THREADS = 2;
+static const int MAX_SCHEDULER_THREADS = 16;
 
 //
 // Simple class for background tasks that should be run
@@ -32,6 +38,11 @@
 // delete t;
 // delete s; // Must be done after thread is interrupted/joined.
 //
+// Several threads may run serviceQueue. Tasks can be given a name, run times
+// and lateness are then tracked per name, and a group: tasks of the same
+// group never run at the same time, so slow tasks which contend on the same
+// locks only occupy one thread.
+//
 
 class CScheduler
 {
@@ -41,18 +52,31 @@ public:
 
     typedef boost::function<void(void)> Function;
 
+    // Upper bounds of the histogram buckets in microseconds, the last bucket has no bound
+    static const std::array<int64_t, 6> HISTOGRAM_BOUNDS;
+
+    struct TaskStats
+    {
+        uint64_t nRuns{0};
+        int64_t nTotalRunMicros{0};
+        int64_t nMaxRunMicros{0};
+        int64_t nMaxLateMicros{0};
+        std::array<uint64_t, 7> runHistogram{};
+        std::array<uint64_t, 7> lateHistogram{};
+    };
+
     // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t);
+    void schedule(Function f, boost::chrono::system_clock::time_point t, const std::string& strName = "", const std::string& strGroup = "");
 
     // Convenience method: call f once deltaSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaSeconds);
+    void scheduleFromNow(Function f, int64_t deltaSeconds, const std::string& strName = "", const std::string& strGroup = "");
 
     // Another convenience method: call f approximately
     // every deltaSeconds forever, starting deltaSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaSeconds);
+    void scheduleEvery(Function f, int64_t deltaSeconds, const std::string& strName = "", const std::string& strGroup = "");
 
     // To keep things as simple as possible, there is no unschedule.
 
@@ -70,8 +94,20 @@ public:
     size_t getQueueInfo(boost::chrono::system_clock::time_point &first,
                         boost::chrono::system_clock::time_point &last) const;
 
+    // Returns the statistics of all tasks run so far, by name. Unnamed tasks are counted as "other".
+    std::map<std::string, TaskStats> getTaskStats() const;
+
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    struct Task
+    {
+        Function f;
+        std::string strName;
+        std::string strGroup;
+    };
+
+    std::multimap<boost::chrono::system_clock::time_point, Task> taskQueue;
+    std::set<std::string> setRunningGroups;
+    std::map<std::string, TaskStats> mapTaskStats;
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
@@ -30,6 +30,9 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
-void InitSignatureCache();
+/** Initialize the signature cache with -maxsigcachesize MiB, returns the bytes it uses */
+size_t InitSignatureCache();
+/** Initialize the signature cache with nMaxCacheSize bytes, returns the bytes it uses */
+size_t InitSignatureCache(size_t nMaxCacheSize);
 
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
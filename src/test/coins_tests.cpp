@@ -9,6 +9,7 @@
 #include "utilstrencodings.h"
 #include "test/test_volkshash.h"
 #include "test/test_random.h"
+#include "txdb.h"
 #include "validation.h"
 #include "consensus/validation.h"
 
@@ -856,4 +857,55 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_prefetch)
+{
+    CCoinsViewDB db(1 << 20, true);
+    uint256 hashBlock = GetRandHash();
+    std::vector<COutPoint> vOutpoints;
+    {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 20; i++) {
+            COutPoint outpoint(GetRandHash(), i % 3);
+            Coin coin;
+            coin.out.nValue = i + 1;
+            coin.out.scriptPubKey = CScript() << std::vector<unsigned char>(i, 0);
+            coin.nHeight = i;
+            cache.AddCoin(outpoint, std::move(coin), false);
+            vOutpoints.push_back(outpoint);
+        }
+        cache.SetBestBlock(hashBlock);
+        BOOST_CHECK(cache.Flush());
+    }
+    // an outpoint missing from the database is left out
+    vOutpoints.push_back(COutPoint(GetRandHash(), 0));
+    std::sort(vOutpoints.begin(), vOutpoints.end());
+
+    std::vector<std::pair<COutPoint, Coin> > vCoins;
+    BOOST_CHECK(db.GetCoinsSorted(vOutpoints, vCoins) == hashBlock);
+    BOOST_CHECK_EQUAL(vCoins.size(), 20);
+
+    CCoinsViewCache cache(&db);
+    // an entry already in the cache is kept
+    const COutPoint& spent = vCoins[0].first;
+    cache.SpendCoin(spent);
+    size_t nPrefetched = 0;
+    for (auto& coin : vCoins) {
+        Coin coinDB;
+        BOOST_CHECK(db.GetCoin(coin.first, coinDB));
+        BOOST_CHECK(coin.second == coinDB);
+        if (cache.Prefetch(coin.first, std::move(coin.second)))
+            nPrefetched++;
+    }
+    BOOST_CHECK_EQUAL(nPrefetched, 19);
+    BOOST_CHECK(!cache.HaveCoin(spent));
+
+    std::vector<COutPoint> vCached;
+    cache.GetCachedOutpoints(vCached, 100);
+    BOOST_CHECK_EQUAL(vCached.size(), 19);
+    BOOST_CHECK(std::find(vCached.begin(), vCached.end(), spent) == vCached.end());
+    vCached.clear();
+    cache.GetCachedOutpoints(vCached, 5);
+    BOOST_CHECK_EQUAL(vCached.size(), 5);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,151 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "eventnotifier.h"
+#include "random.h"
+#include "utiltime.h"
+
+#include "test/testutil.h"
+#include "test/test_volkshash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+static std::vector<std::string> ReadLines(const boost::filesystem::path& path)
+{
+    std::vector<std::string> vLines;
+    std::ifstream file(path.string());
+    std::string strLine;
+    while (std::getline(file, strLine)) {
+        vLines.push_back(strLine);
+    }
+    return vLines;
+}
+
+BOOST_FIXTURE_TEST_SUITE(eventnotifier_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(eventnotifier_file_sink)
+{
+    boost::filesystem::path path = GetTempPath() / strprintf("test_eventnotifier_%lu_%i.log", (unsigned long)GetTime(), (int)GetRand(100000));
+    uint256 hashBlock = GetRandHash();
+    uint256 hashTx = GetRandHash();
+
+    {
+        CEventNotifier notifier;
+        std::string strError;
+        BOOST_CHECK(!notifier.IsEnabled(CEventNotifier::EVENT_BLOCK));
+        BOOST_CHECK(notifier.SetSink(path.string(), strError));
+        BOOST_CHECK(notifier.IsEnabled(CEventNotifier::EVENT_INSTANTSEND));
+        notifier.Start();
+
+        notifier.Notify(CEventNotifier::EVENT_BLOCK, hashBlock);
+        notifier.Notify(CEventNotifier::EVENT_WALLETTX, hashTx);
+        notifier.Notify(CEventNotifier::EVENT_WALLETTX, hashTx);
+        notifier.Notify(CEventNotifier::EVENT_INSTANTSEND, hashTx);
+        notifier.WaitForIdle();
+
+        // the sink sees every event, duplicates included
+        std::vector<std::string> vLines = ReadLines(path);
+        BOOST_CHECK_EQUAL(vLines.size(), 4);
+        BOOST_CHECK_EQUAL(vLines[0], "block " + hashBlock.ToString());
+        BOOST_CHECK_EQUAL(vLines[1], "wallettx " + hashTx.ToString());
+        BOOST_CHECK_EQUAL(vLines[2], "wallettx " + hashTx.ToString());
+        BOOST_CHECK_EQUAL(vLines[3], "instantsend " + hashTx.ToString());
+
+        notifier.Stop();
+        CEventNotifier::Stats stats = notifier.GetStats();
+        BOOST_CHECK_EQUAL(stats.nEvents, 4);
+        BOOST_CHECK_EQUAL(stats.nLinesWritten, 4);
+        BOOST_CHECK_EQUAL(stats.nDropped, 0);
+    }
+
+    {
+        // overflowing the queue before the sink thread runs drops the oldest events
+        CEventNotifier notifier;
+        std::string strError;
+        BOOST_CHECK(notifier.SetSink(path.string(), strError));
+        notifier.SetQueueLimits(2, 0);
+        for (int i = 0; i < 5; i++) {
+            notifier.Notify(CEventNotifier::EVENT_BLOCK, ArithToUint256(i));
+        }
+        notifier.Start();
+        notifier.WaitForIdle();
+        notifier.Stop();
+
+        std::vector<std::string> vLines = ReadLines(path);
+        BOOST_CHECK_EQUAL(vLines.size(), 7);
+        BOOST_CHECK_EQUAL(vLines[4], "dropped 3");
+        BOOST_CHECK_EQUAL(vLines[5], "block " + ArithToUint256(3).ToString());
+        BOOST_CHECK_EQUAL(vLines[6], "block " + ArithToUint256(4).ToString());
+        BOOST_CHECK_EQUAL(notifier.GetStats().nDropped, 3);
+    }
+
+    std::string strError;
+    CEventNotifier notifier;
+    BOOST_CHECK(!notifier.SetSink((path / "nonexistent" / "events.log").string(), strError));
+    BOOST_CHECK(!strError.empty());
+
+    boost::filesystem::remove(path);
+}
+
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(eventnotifier_command_coalescing)
+{
+    boost::filesystem::path path = GetTempPath() / strprintf("test_eventnotifier_cmd_%lu_%i.log", (unsigned long)GetTime(), (int)GetRand(100000));
+    std::vector<uint256> vHashes;
+    for (int i = 0; i < 10; i++) {
+        vHashes.push_back(GetRandHash());
+    }
+
+    CEventNotifier notifier;
+    notifier.SetCommand(CEventNotifier::EVENT_BLOCK, "echo %s >> " + path.string());
+    notifier.SetCommand(CEventNotifier::EVENT_WALLETTX, "echo tx %s >> " + path.string());
+
+    // queue everything before the command thread runs, a burst of blocks only runs the command for the last one
+    for (const auto& hash : vHashes) {
+        notifier.Notify(CEventNotifier::EVENT_BLOCK, hash);
+    }
+    // the same transaction notified again while still pending runs the command once
+    notifier.Notify(CEventNotifier::EVENT_WALLETTX, vHashes[0]);
+    notifier.Notify(CEventNotifier::EVENT_WALLETTX, vHashes[0]);
+    notifier.Start();
+    notifier.WaitForIdle();
+    notifier.Stop();
+
+    std::vector<std::string> vLines = ReadLines(path);
+    BOOST_CHECK_EQUAL(vLines.size(), 2);
+    BOOST_CHECK(std::count(vLines.begin(), vLines.end(), vHashes.back().GetHex()) == 1);
+    BOOST_CHECK(std::count(vLines.begin(), vLines.end(), "tx " + vHashes[0].GetHex()) == 1);
+
+    CEventNotifier::Stats stats = notifier.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEvents, 12);
+    BOOST_CHECK_EQUAL(stats.nCommandsRun, 2);
+    BOOST_CHECK_EQUAL(stats.nCoalesced, 10);
+
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(eventnotifier_hung_command)
+{
+    CEventNotifier notifier;
+    notifier.SetCommand(CEventNotifier::EVENT_BLOCK, "sleep 10");
+    notifier.Start();
+    notifier.Notify(CEventNotifier::EVENT_BLOCK, GetRandHash());
+    MilliSleep(500);
+
+    // shutdown doesn't wait for the command
+    int64_t nStart = GetTimeMillis();
+    notifier.Stop();
+    BOOST_CHECK(GetTimeMillis() - nStart < 5000);
+    BOOST_CHECK_EQUAL(notifier.GetStats().nCommandsRun, 0);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -399,4 +399,91 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
     }
     BOOST_ASSERT(foundRevived);
 }
+
+// The payee order kept by the list must match sorting all valid MNs by last paid height
+static std::vector<uint256> GetPayeeOrderBruteForce(const CDeterministicMNList& mnList)
+{
+    std::vector<std::pair<int, uint256>> vKeys;
+    mnList.ForEachMN(true, [&](const CDeterministicMNCPtr& dmn) {
+        const CDeterministicMNState& state = *dmn->pdmnState;
+        int height = state.nLastPaidHeight;
+        if (state.nPoSeRevivedHeight != -1 && state.nPoSeRevivedHeight > height) {
+            height = state.nPoSeRevivedHeight;
+        } else if (height == 0) {
+            height = state.nRegisteredHeight;
+        }
+        vKeys.emplace_back(height, dmn->proTxHash);
+    });
+    std::sort(vKeys.begin(), vKeys.end());
+    std::vector<uint256> result;
+    for (const auto& p : vKeys) {
+        result.emplace_back(p.second);
+    }
+    return result;
+}
+
+BOOST_FIXTURE_TEST_CASE(dip3_payee_order, BasicTestingSetup)
+{
+    FastRandomContext rnd(true);
+    CDeterministicMNList mnList(uint256(), 1000);
+    std::vector<uint256> vProTxHashes;
+    for (int i = 0; i < 100; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>();
+        dmn->proTxHash = GetRandHash();
+        dmn->collateralOutpoint = COutPoint(GetRandHash(), 0);
+        auto state = std::make_shared<CDeterministicMNState>();
+        state->nRegisteredHeight = rnd.rand32(1000);
+        state->keyIDOwner = CKeyID(uint160(ParseHex(dmn->proTxHash.ToString().substr(0, 40))));
+        dmn->pdmnState = state;
+        mnList.AddMN(dmn);
+        vProTxHashes.emplace_back(dmn->proTxHash);
+    }
+
+    CDeterministicMNList oldList = mnList;
+    std::vector<uint256> vOldOrder = GetPayeeOrderBruteForce(oldList);
+
+    for (int i = 0; i < 500; i++) {
+        const uint256& proTxHash = vProTxHashes[rnd.rand32(vProTxHashes.size())];
+        auto dmn = mnList.GetMN(proTxHash);
+        if (!dmn) {
+            continue;
+        }
+        auto newState = std::make_shared<CDeterministicMNState>(*dmn->pdmnState);
+        switch (rnd.rand32(4)) {
+        case 0:
+            newState->nLastPaidHeight = 1000 + i;
+            break;
+        case 1:
+            newState->nPoSeBanHeight = newState->nPoSeBanHeight == -1 ? 1000 + i : -1;
+            if (newState->nPoSeBanHeight == -1) {
+                newState->nPoSeRevivedHeight = 1000 + i;
+            }
+            break;
+        case 2:
+            mnList.RemoveMN(proTxHash);
+            break;
+        default:
+            // does not change the order
+            newState->nPoSePenalty++;
+            break;
+        }
+        if (mnList.HasMN(proTxHash)) {
+            mnList.UpdateMN(proTxHash, newState);
+        }
+
+        std::vector<uint256> vOrder = GetPayeeOrderBruteForce(mnList);
+        auto payee = mnList.GetMNPayee();
+        BOOST_CHECK(vOrder.empty() ? !payee : payee && payee->proTxHash == vOrder[0]);
+    }
+
+    // the copy taken before all updates is not affected by them
+    auto oldPayee = oldList.GetMNPayee();
+    BOOST_CHECK(oldPayee && oldPayee->proTxHash == vOldOrder[0]);
+    auto vProjected = oldList.GetProjectedMNPayees(10);
+    BOOST_CHECK_EQUAL(vProjected.size(), 10);
+    for (size_t i = 0; i < vProjected.size(); i++) {
+        BOOST_CHECK(vProjected[i]->proTxHash == vOldOrder[i]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include "key.h"
 
 #include "base58.h"
+#include "messagesigner.h"
 #include "script/script.h"
 #include "uint256.h"
 #include "util.h"
@@ -186,4 +187,30 @@ BOOST_AUTO_TEST_CASE(key_test1)
     BOOST_CHECK(detsigc == ParseHex("2052d8a32079c11e79db95af63bb9600c5b04f21a9ca33dc129c2bfa8ac9dc1cd561d8ae5e0f6c1a16bde3719c64c2fd70e404b6428ab9a69566962e8771b5944d"));
 }
 
+BOOST_AUTO_TEST_CASE(pre_recovered_signatures)
+{
+    CKey key1, key2;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    uint256 hash = Hash(strSecret1.begin(), strSecret1.end());
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(CHashSigner::SignHash(hash, key1, vchSig));
+    std::string strError;
+
+    // the pre-recovered signer is used for a single verification
+    BOOST_CHECK(CHashSigner::PreRecoverHash(hash, vchSig) == key1.GetPubKey().GetID());
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key1.GetPubKey().GetID(), vchSig, strError));
+    BOOST_CHECK(CHashSigner::VerifyHash(hash, key1.GetPubKey().GetID(), vchSig, strError));
+
+    // and results in the same errors as the normal recovery
+    CHashSigner::PreRecoverHash(hash, vchSig);
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, key2.GetPubKey().GetID(), vchSig, strError));
+    BOOST_CHECK(strError.find("Keys don't match") == 0);
+
+    std::vector<unsigned char> vchSigBad(vchSig.size(), 0);
+    BOOST_CHECK(CHashSigner::PreRecoverHash(hash, vchSigBad).IsNull());
+    BOOST_CHECK(!CHashSigner::VerifyHash(hash, key1.GetPubKey().GetID(), vchSigBad, strError));
+    BOOST_CHECK_EQUAL(strError, "Error recovering public key.");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,173 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "memorybudget.h"
+
+#include "coins.h"
+#include "random.h"
+#include "test/test_volkshash.h"
+#include "txdb.h"
+#include "validation.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(memorybudget_tests, BasicTestingSetup)
+
+namespace {
+struct FakeCache {
+    size_t nUsage{0};
+    size_t nLimit{0};
+    uint64_t nHits{0};
+    uint64_t nMisses{0};
+
+    void Register(CMemoryBudget& budget, const std::string& strName, size_t nInitial, size_t nMin, size_t nMax, int nWeightInitialDownload, int nWeightTip)
+    {
+        budget.RegisterDynamic(strName, nInitial, nMin, nMax, nWeightInitialDownload, nWeightTip,
+            [this]() { return nUsage; },
+            [this](size_t n) { nLimit = n; },
+            [this](uint64_t& h, uint64_t& m) { h = nHits; m = nMisses; });
+    }
+};
+}
+
+static const size_t MB = 1 << 20;
+
+BOOST_AUTO_TEST_CASE(memorybudget_inactive)
+{
+    CMemoryBudget budget;
+    FakeCache cache;
+    cache.Register(budget, "cache", 100 * MB, 100 * MB, 100 * MB, 1, 1);
+    BOOST_CHECK_EQUAL(cache.nLimit, 100 * MB);
+    BOOST_CHECK(!budget.IsActive());
+
+    // without a budget the share never moves, but usage is still reported
+    cache.nUsage = 10 * MB;
+    budget.Rebalance(false);
+    BOOST_CHECK_EQUAL(cache.nLimit, 100 * MB);
+    std::vector<CMemoryBudget::ConsumerStats> vStats = budget.GetStats();
+    BOOST_CHECK_EQUAL(vStats.size(), 1);
+    BOOST_CHECK_EQUAL(vStats[0].nUsage, 10 * MB);
+    BOOST_CHECK(vStats[0].fDynamic);
+}
+
+BOOST_AUTO_TEST_CASE(memorybudget_shrink_and_grow)
+{
+    CMemoryBudget budget;
+    budget.SetTotal(300 * MB);
+    budget.RegisterFixed("fixed", 40 * MB);
+    FakeCache idle, busy;
+    idle.Register(budget, "idle", 130 * MB, 10 * MB, 200 * MB, 1, 1);
+    busy.Register(budget, "busy", 130 * MB, 10 * MB, 200 * MB, 1, 1);
+
+    idle.nUsage = 10 * MB;
+    busy.nUsage = 125 * MB;
+    budget.Rebalance(false);
+    // idle keeps 1.5 times its usage and gives away half of the rest
+    BOOST_CHECK_EQUAL(idle.nLimit, 130 * MB - (130 * MB - 15 * MB) / 2);
+    BOOST_CHECK(busy.nLimit > 130 * MB);
+    BOOST_CHECK(idle.nLimit + busy.nLimit + 40 * MB <= 300 * MB);
+
+    // repeated rounds never take a share below the usage of its cache, nor over its maximum
+    for (int i = 0; i < 20; i++) {
+        busy.nUsage = busy.nLimit;
+        budget.Rebalance(false);
+    }
+    BOOST_CHECK(idle.nLimit >= 15 * MB);
+    BOOST_CHECK(busy.nLimit <= 200 * MB);
+    BOOST_CHECK(idle.nLimit + busy.nLimit + 40 * MB <= 300 * MB);
+}
+
+BOOST_AUTO_TEST_CASE(memorybudget_weights)
+{
+    CMemoryBudget budget;
+    budget.SetTotal(200 * MB);
+    FakeCache coins, pool;
+    coins.Register(budget, "coins", 50 * MB, 10 * MB, 200 * MB, 1, 0);
+    pool.Register(budget, "pool", 50 * MB, 10 * MB, 200 * MB, 0, 1);
+    coins.nUsage = 50 * MB;
+    pool.nUsage = 50 * MB;
+
+    // during initial block download only the first cache grows
+    budget.Rebalance(true);
+    BOOST_CHECK_EQUAL(coins.nLimit, 150 * MB);
+    BOOST_CHECK_EQUAL(pool.nLimit, 50 * MB);
+
+    // a cache missing more lookups gets the larger part
+    CMemoryBudget budget2;
+    budget2.SetTotal(200 * MB);
+    FakeCache a, b;
+    a.Register(budget2, "a", 50 * MB, 10 * MB, 200 * MB, 1, 1);
+    b.Register(budget2, "b", 50 * MB, 10 * MB, 200 * MB, 1, 1);
+    a.nUsage = b.nUsage = 50 * MB;
+    a.nHits = 90; a.nMisses = 10;
+    b.nHits = 50; b.nMisses = 50;
+    budget2.Rebalance(false);
+    BOOST_CHECK(b.nLimit > a.nLimit);
+    BOOST_CHECK(a.nLimit + b.nLimit <= 200 * MB);
+}
+
+static void RegisterCoinsCache(CMemoryBudget& budget)
+{
+    budget.RegisterDynamic("coinscache", 8 * MB, 1 * MB, 64 * MB, 1, 0,
+        []() { LOCK(cs_main); return GetCoinsCacheUsage(); },
+        [](size_t nLimit) { LOCK(cs_main); nCoinCacheUsage = nLimit; });
+}
+
+// Add coins until FlushStateToDisk is about to flush the cache
+static void FillCoinsCache()
+{
+    LOCK(cs_main);
+    while (pcoinsTip->DynamicMemoryUsage() * DB_PEAK_USAGE_FACTOR < nCoinCacheUsage / 100 * 95) {
+        Coin coin;
+        coin.out.nValue = 1;
+        coin.out.scriptPubKey = CScript() << std::vector<unsigned char>(20, 0);
+        coin.nHeight = 1;
+        pcoinsTip->AddCoin(COutPoint(GetRandHash(), 0), std::move(coin), false);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(memorybudget_coinscache, TestingSetup)
+{
+    size_t nCoinCacheUsageOld = nCoinCacheUsage;
+
+    // the share of a cache close to being flushed grows, although it uses only half of it
+    {
+        CMemoryBudget budget;
+        budget.SetTotal(64 * MB);
+        RegisterCoinsCache(budget);
+        BOOST_CHECK_EQUAL(nCoinCacheUsage, 8 * MB);
+        FillCoinsCache();
+        {
+            LOCK(cs_main);
+            BOOST_CHECK(pcoinsTip->DynamicMemoryUsage() < nCoinCacheUsage / 2);
+        }
+        budget.Rebalance(true);
+        BOOST_CHECK(nCoinCacheUsage > 8 * MB);
+    }
+
+    FlushStateToDisk();
+    {
+        LOCK(cs_main);
+        GetCoinsCacheUsage();
+    }
+
+    // a cache flushed between two rounds is judged by its peak, not by its usage after the flush
+    {
+        CMemoryBudget budget;
+        budget.SetTotal(64 * MB);
+        RegisterCoinsCache(budget);
+        FillCoinsCache();
+        FlushStateToDisk();
+        {
+            LOCK(cs_main);
+            BOOST_CHECK_EQUAL(pcoinsTip->GetCacheSize(), 0);
+        }
+        budget.Rebalance(true);
+        BOOST_CHECK(nCoinCacheUsage > 8 * MB);
+    }
+
+    nCoinCacheUsage = nCoinCacheUsageOld;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -583,4 +583,55 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(DisconnectedBlockTransactionsTest)
+{
+    // Two disconnected blocks, the second one spends an output of the first one
+    std::vector<CTransactionRef> vBlock1, vBlock2;
+    for (int i = 0; i < 3; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << i;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx.vout[0].nValue = COIN;
+        vBlock1.push_back(MakeTransactionRef(tx));
+    }
+    CMutableTransaction txChild;
+    txChild.vin.resize(1);
+    txChild.vin[0].prevout = COutPoint(vBlock1[2]->GetHash(), 0);
+    txChild.vout.resize(1);
+    txChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild.vout[0].nValue = COIN;
+    vBlock2.push_back(MakeTransactionRef(txChild));
+
+    // blocks are disconnected from the tip, transactions are added in reverse
+    DisconnectedBlockTransactions disconnectpool;
+    for (const auto& vtx : {vBlock2, vBlock1}) {
+        for (auto it = vtx.rbegin(); it != vtx.rend(); ++it) {
+            disconnectpool.addTransaction(*it);
+        }
+    }
+    BOOST_CHECK_EQUAL(disconnectpool.queuedTx.size(), 4U);
+
+    // reverse insertion order is the topological order of the old chain
+    std::vector<uint256> vOrder;
+    for (auto it = disconnectpool.queuedTx.get<insertion_order>().rbegin(); it != disconnectpool.queuedTx.get<insertion_order>().rend(); ++it) {
+        vOrder.push_back((*it)->GetHash());
+    }
+    BOOST_CHECK(vOrder[0] == vBlock1[0]->GetHash());
+    BOOST_CHECK(vOrder[2] == vBlock1[2]->GetHash());
+    BOOST_CHECK(vOrder[3] == txChild.GetHash());
+
+    // transactions confirmed again in the new chain are dropped, the memory accounting follows
+    size_t nUsage = disconnectpool.DynamicMemoryUsage();
+    disconnectpool.removeForBlock({vBlock1[1], vBlock1[1]});
+    BOOST_CHECK_EQUAL(disconnectpool.queuedTx.size(), 3U);
+    BOOST_CHECK(disconnectpool.DynamicMemoryUsage() < nUsage);
+
+    disconnectpool.removeEntry(disconnectpool.queuedTx.get<insertion_order>().begin());
+    disconnectpool.removeForBlock(vBlock1);
+    BOOST_CHECK(disconnectpool.queuedTx.empty());
+    BOOST_CHECK_EQUAL(disconnectpool.cachedInnerUsage, 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,79 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "msglanes.h"
+#include "protocol.h"
+
+#include "test/test_volkshash.h"
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(msglanes_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(msglanes_dispatch)
+{
+    BOOST_CHECK_EQUAL(CMessageLanes::GetLane(NetMsgType::MNPING), CMessageLanes::LANE_MASTERNODE);
+    BOOST_CHECK_EQUAL(CMessageLanes::GetLane(NetMsgType::MNGOVERNANCEOBJECTVOTE), CMessageLanes::LANE_GOVERNANCE);
+    BOOST_CHECK_EQUAL(CMessageLanes::GetLane(NetMsgType::DSQUEUE), CMessageLanes::LANE_PRIVATESEND);
+    BOOST_CHECK_EQUAL(CMessageLanes::GetLane(NetMsgType::SPORK), CMessageLanes::LANE_SPORK);
+    BOOST_CHECK_EQUAL(CMessageLanes::GetLane(NetMsgType::QFCOMMITMENT), CMessageLanes::LANE_QUORUM);
+    // validation and InstantSend stay on the message handler thread
+    BOOST_CHECK_EQUAL(CMessageLanes::GetLane(NetMsgType::BLOCK), CMessageLanes::LANE_NONE);
+    BOOST_CHECK_EQUAL(CMessageLanes::GetLane(NetMsgType::TX), CMessageLanes::LANE_NONE);
+    BOOST_CHECK_EQUAL(CMessageLanes::GetLane(NetMsgType::TXLOCKVOTE), CMessageLanes::LANE_NONE);
+    BOOST_CHECK_EQUAL(CMessageLanes::GetLane(NetMsgType::VERSION), CMessageLanes::LANE_NONE);
+
+    BOOST_CHECK(CMessageLanes::WaitsForLanes(NetMsgType::SYNCSTATUSCOUNT));
+    BOOST_CHECK(!CMessageLanes::WaitsForLanes(NetMsgType::BLOCK));
+}
+
+BOOST_AUTO_TEST_CASE(msglanes_order)
+{
+    CMessageLanes lanes;
+    std::thread::id idCaller = std::this_thread::get_id();
+
+    // not running, jobs run on the calling thread
+    bool fInline = false;
+    lanes.Push(CMessageLanes::LANE_SPORK, [&]() { fInline = std::this_thread::get_id() == idCaller; });
+    BOOST_CHECK(fInline);
+    BOOST_CHECK(!lanes.IsRunning());
+
+    lanes.Start();
+    BOOST_CHECK(lanes.IsRunning());
+
+    std::mutex cs;
+    std::vector<int> vOrder[CMessageLanes::LANE_COUNT];
+    bool fOtherThread = true;
+    for (int i = 0; i < 1000; i++) {
+        CMessageLanes::Lane lane = (CMessageLanes::Lane)(i % CMessageLanes::LANE_COUNT);
+        lanes.Push(lane, [&, lane, i]() {
+            std::lock_guard<std::mutex> lock(cs);
+            vOrder[lane].push_back(i);
+            fOtherThread &= std::this_thread::get_id() != idCaller;
+        });
+    }
+    // queued jobs are still run when stopping
+    lanes.Stop();
+    BOOST_CHECK(fOtherThread);
+
+    uint64_t nProcessed = 0;
+    for (int lane = 0; lane < CMessageLanes::LANE_COUNT; lane++) {
+        BOOST_CHECK_EQUAL(vOrder[lane].size(), 1000 / CMessageLanes::LANE_COUNT);
+        for (size_t j = 1; j < vOrder[lane].size(); j++) {
+            BOOST_CHECK(vOrder[lane][j - 1] < vOrder[lane][j]);
+        }
+    }
+    for (const auto& stats : lanes.GetStats()) {
+        BOOST_CHECK_EQUAL(stats.nQueued, stats.nProcessed);
+        BOOST_CHECK_EQUAL(stats.nPending, 0);
+        nProcessed += stats.nProcessed;
+    }
+    BOOST_CHECK_EQUAL(nProcessed, 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
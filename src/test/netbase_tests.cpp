@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "addrdb.h"
 #include "netbase.h"
 #include "test/test_volkshash.h"
 
@@ -267,6 +268,54 @@ BOOST_AUTO_TEST_CASE(subnet_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(subnet_ban_index)
+{
+    const char* subnets[] = {"1.2.3.0/24", "1.2.3.4/32", "10.0.0.0/8", "2001:db8::/32", "2001:db8:1::1/128",
+                             "1.2.0.0/255.255.232.0", "0.0.0.0/0"};
+    CBanIndex index;
+    banmap_t banmap;
+    for (const char* strSubNet : subnets) {
+        CSubNet subnet = ResolveSubNet(strSubNet);
+        BOOST_CHECK(subnet.IsValid());
+        CBanEntry entry(0);
+        entry.nBanUntil = 100;
+        banmap[subnet] = entry;
+    }
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.3.0/24").GetPrefixLength(), 120);
+    BOOST_CHECK_EQUAL(ResolveSubNet("2001:db8::/32").GetPrefixLength(), 32);
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.0.0/255.255.232.0").GetPrefixLength(), -1);
+
+    // the IPv4 catch-all is tested separately, as it matches everything
+    banmap.erase(ResolveSubNet("0.0.0.0/0"));
+    index.Build(banmap);
+    BOOST_CHECK_EQUAL(index.size(), banmap.size());
+
+    const char* addrs[] = {"1.2.3.4", "1.2.3.5", "1.2.4.1", "1.2.16.1", "10.255.0.1", "11.0.0.1", "2001:db8::1",
+                           "2001:db8:1::1", "2001:db9::1", "::1"};
+    for (const char* strAddr : addrs) {
+        CNetAddr addr = ResolveIP(strAddr);
+        bool fExpected = false;
+        for (const auto& p : banmap)
+            fExpected |= p.first.Match(addr);
+        BOOST_CHECK_MESSAGE(index.IsBanned(addr, 0) == fExpected, strAddr);
+        // expired
+        BOOST_CHECK(!index.IsBanned(addr, 100));
+    }
+
+    // a shorter prefix still bans when a longer one expired
+    index.Set(ResolveSubNet("1.2.3.4/32"), 10);
+    BOOST_CHECK(index.IsBanned(ResolveIP("1.2.3.4"), 50));
+    index.Erase(ResolveSubNet("1.2.3.0/24"));
+    index.Erase(ResolveSubNet("1.2.0.0/255.255.232.0"));
+    BOOST_CHECK(!index.IsBanned(ResolveIP("1.2.3.4"), 50));
+    BOOST_CHECK(index.IsBanned(ResolveIP("1.2.3.4"), 5));
+    BOOST_CHECK_EQUAL(index.size(), banmap.size() - 2);
+
+    index.Set(ResolveSubNet("0.0.0.0/0"), 100);
+    BOOST_CHECK(index.IsBanned(ResolveIP("11.0.0.1"), 50));
+    BOOST_CHECK(!index.IsBanned(CNetAddr(), 50));
+}
+
 BOOST_AUTO_TEST_CASE(netbase_getgroup)
 {
 
@@ -4,6 +4,7 @@
 
 #include "chain.h"
 #include "chainparams.h"
+#include "hash.h"
 #include "pow.h"
 #include "random.h"
 #include "util.h"
@@ -208,4 +209,20 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(cheap_block_hash)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    UpdateRegtestBlockHashFunction(BLOCK_HASH_SHA256D);
+    const CBlock& genesis = Params().GenesisBlock();
+    BOOST_CHECK(GetBlockHashFunction() == BLOCK_HASH_SHA256D);
+    BOOST_CHECK(genesis.GetHash() == SerializeHash(genesis.GetBlockHeader()));
+    BOOST_CHECK(genesis.GetHash() == Params().GetConsensus().hashGenesisBlock);
+    BOOST_CHECK(CheckProofOfWork(genesis.GetHash(), genesis.nBits, Params().GetConsensus()));
+
+    // other networks always use yespower
+    SelectParams(CBaseChainParams::MAIN);
+    BOOST_CHECK(GetBlockHashFunction() == BLOCK_HASH_YESPOWER);
+    BOOST_CHECK(Params().GenesisBlock().GetHash() == Params().GetConsensus().hashGenesisBlock);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -114,4 +114,57 @@ BOOST_AUTO_TEST_CASE(manythreads)
     BOOST_CHECK_EQUAL(counterSum, 200);
 }
 
+static void groupTask(boost::mutex& mutex, int& nRunning, int& nMaxRunning)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nMaxRunning = std::max(nMaxRunning, ++nRunning);
+    }
+    MicroSleep(2000);
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        --nRunning;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(groups_and_stats)
+{
+    // Tasks of one group never overlap, even with many threads servicing the queue,
+    // while tasks of other groups keep running
+    CScheduler scheduler;
+
+    boost::mutex mutex;
+    int nRunning[2] = { 0 };
+    int nMaxRunning[2] = { 0 };
+    boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+    for (int i = 0; i < 10; i++) {
+        scheduler.schedule(boost::bind(&groupTask, boost::ref(mutex), boost::ref(nRunning[0]), boost::ref(nMaxRunning[0])), now, "grouped", "group");
+        scheduler.schedule(boost::bind(&groupTask, boost::ref(mutex), boost::ref(nRunning[1]), boost::ref(nMaxRunning[1])), now, "ungrouped");
+    }
+
+    boost::thread_group threads;
+    for (int i = 0; i < 5; i++)
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+    scheduler.stop(true);
+    threads.join_all();
+
+    BOOST_CHECK_EQUAL(nMaxRunning[0], 1);
+    BOOST_CHECK(nMaxRunning[1] > 1);
+
+    std::map<std::string, CScheduler::TaskStats> mapStats = scheduler.getTaskStats();
+    BOOST_CHECK_EQUAL(mapStats.size(), 2);
+    for (const auto& p : mapStats) {
+        const CScheduler::TaskStats& stats = p.second;
+        BOOST_CHECK_EQUAL(stats.nRuns, 10);
+        BOOST_CHECK(stats.nMaxRunMicros >= 2000);
+        uint64_t nRunCount = 0, nLateCount = 0;
+        for (size_t i = 0; i < stats.runHistogram.size(); i++) {
+            nRunCount += stats.runHistogram[i];
+            nLateCount += stats.lateHistogram[i];
+        }
+        BOOST_CHECK_EQUAL(nRunCount, 10);
+        BOOST_CHECK_EQUAL(nLateCount, 10);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
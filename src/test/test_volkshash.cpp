@@ -51,6 +51,10 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
         fPrintToDebugLog = false; // don't want to write to debug.log file
         fCheckBlockIndex = true;
         SelectParams(chainName);
+        if (chainName == CBaseChainParams::REGTEST) {
+            // yespower is far too slow for the amount of blocks the tests create
+            UpdateRegtestBlockHashFunction(BLOCK_HASH_SHA256D);
+        }
         evoDb = new CEvoDB(1 << 20, true, true);
         deterministicMNManager = new CDeterministicMNManager(*evoDb);
         noui_connect();
@@ -0,0 +1,201 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "trustedheaders.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "consensus/validation.h"
+#include "hash.h"
+#include "messagesigner.h"
+#include "streams.h"
+#include "util.h"
+#include "validation.h"
+
+#include "test/test_volkshash.h"
+
+#include <boost/test/unit_test.hpp>
+
+typedef CTrustedHeaderTable::Entry Entry;
+
+// private key of the regtest spork address, see chainparams.cpp
+static const std::string strSporkSecret = "92cxgcNf2hNjnAyarcqFhpGbHon6e13dCHD6UPCyYCnsMvSHo4X";
+
+struct TrustedHeadersSetup : public TestChain100Setup
+{
+    CKey sporkKey;
+
+    TrustedHeadersSetup()
+    {
+        CPubKey sporkPubKey;
+        BOOST_REQUIRE(CMessageSigner::GetKeysFromSecret(strSporkSecret, sporkKey, sporkPubKey));
+    }
+
+    ~TrustedHeadersSetup()
+    {
+        trustedHeaders.Clear();
+    }
+};
+
+static Entry MakeEntry(const CBlockHeader& header)
+{
+    Entry entry;
+    entry.hashBlock = header.GetHash();
+    uint256 hash = SerializeHash(header);
+    memcpy(entry.commitment, hash.begin(), CTrustedHeaderTable::COMMITMENT_SIZE);
+    return entry;
+}
+
+static CBlockHeader GetActiveHeader(int nHeight)
+{
+    LOCK(cs_main);
+    return chainActive[nHeight]->GetBlockHeader();
+}
+
+static std::vector<Entry> MakeEntries(int nMaxHeight)
+{
+    std::vector<Entry> vEntries;
+    for (int i = 0; i <= nMaxHeight; i++) {
+        vEntries.push_back(MakeEntry(GetActiveHeader(i)));
+    }
+    return vEntries;
+}
+
+static std::vector<unsigned char> SignTable(const std::vector<Entry>& vEntries, const CKey& key)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << TRUSTED_HEADERS_MAGIC << TRUSTED_HEADERS_VERSION;
+    ss << FLATDATA(Params().MessageStart());
+    ss << vEntries;
+
+    std::vector<unsigned char> vchSig;
+    BOOST_REQUIRE(CHashSigner::SignHash(ss.GetHash(), key, vchSig));
+    return vchSig;
+}
+
+static std::string WriteTable(const std::vector<Entry>& vEntries, const std::vector<unsigned char>& vchSig,
+                              const std::string& strMagic = TRUSTED_HEADERS_MAGIC)
+{
+    std::string strFile = (GetDataDir() / "trustedheaders.dat").string();
+    CAutoFile fileout(fopen(strFile.c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!fileout.IsNull());
+    fileout << strMagic << TRUSTED_HEADERS_VERSION;
+    fileout << FLATDATA(Params().MessageStart());
+    fileout << vEntries << vchSig;
+    return strFile;
+}
+
+BOOST_FIXTURE_TEST_SUITE(trustedheaders_tests, TrustedHeadersSetup)
+
+BOOST_AUTO_TEST_CASE(trustedheaders_load)
+{
+    std::vector<Entry> vEntries = MakeEntries(100);
+    std::string strError;
+
+    CTrustedHeaderTable table;
+    BOOST_CHECK(!table.IsEnabled());
+    BOOST_CHECK(table.Load(WriteTable(vEntries, SignTable(vEntries, sporkKey)), strError));
+    BOOST_CHECK(table.IsEnabled());
+    BOOST_CHECK_EQUAL(table.GetMaxHeight(), 100);
+
+    // every header of the table is found at its height
+    for (int i = 0; i <= 100; i++) {
+        CBlockHeader header = GetActiveHeader(i);
+        uint256 hash;
+        int nHeight;
+        BOOST_CHECK(table.GetTrustedHash(header, hash, nHeight));
+        BOOST_CHECK(hash == header.GetHash());
+        BOOST_CHECK_EQUAL(nHeight, i);
+        BOOST_CHECK(table.GetHash(header) == hash);
+    }
+
+    // a modified header is not, GetHash() falls back to the yespower hash
+    CBlockHeader header = GetActiveHeader(50);
+    header.nNonce ^= 1;
+    uint256 hash;
+    int nHeight;
+    BOOST_CHECK(!table.GetTrustedHash(header, hash, nHeight));
+    BOOST_CHECK(table.GetHash(header) == header.GetHash());
+
+    // signed by another key
+    CKey otherKey;
+    otherKey.MakeNewKey(true);
+    BOOST_CHECK(!table.Load(WriteTable(vEntries, SignTable(vEntries, otherKey)), strError));
+    BOOST_CHECK(strError.find("not signed") != std::string::npos);
+
+    // modified after signing
+    std::vector<unsigned char> vchSig = SignTable(vEntries, sporkKey);
+    std::vector<Entry> vEntriesModified = vEntries;
+    vEntriesModified[50].commitment[0] ^= 1;
+    BOOST_CHECK(!table.Load(WriteTable(vEntriesModified, vchSig), strError));
+    BOOST_CHECK(strError.find("not signed") != std::string::npos);
+
+    // not a table
+    BOOST_CHECK(!table.Load(WriteTable(vEntries, vchSig, "volkshash-headers"), strError));
+    BOOST_CHECK(strError.find("not a trusted header table") != std::string::npos);
+
+    // does not start at the genesis block
+    vEntriesModified.assign(vEntries.begin() + 1, vEntries.end());
+    BOOST_CHECK(!table.Load(WriteTable(vEntriesModified, SignTable(vEntriesModified, sporkKey)), strError));
+    BOOST_CHECK(strError.find("genesis") != std::string::npos);
+
+    // missing file
+    BOOST_CHECK(!table.Load((GetDataDir() / "missing.dat").string(), strError));
+
+    // failed loads keep the table that was loaded before
+    BOOST_CHECK_EQUAL(table.GetMaxHeight(), 100);
+    BOOST_CHECK(table.GetTrustedHash(GetActiveHeader(50), hash, nHeight));
+}
+
+BOOST_AUTO_TEST_CASE(trustedheaders_acceptheader)
+{
+    const CChainParams& chainparams = Params();
+    std::vector<Entry> vEntries = MakeEntries(100);
+    std::vector<CMutableTransaction> noTxns;
+    std::string strError;
+
+    // a header committed to at the wrong height is rejected
+    CBlock block = CreateBlock(noTxns, CScript() << OP_TRUE);
+    std::vector<Entry> vEntriesWrongHeight = vEntries;
+    Entry dummy;
+    dummy.hashBlock = uint256S("0x01");
+    memset(dummy.commitment, 0, sizeof(dummy.commitment));
+    vEntriesWrongHeight.push_back(dummy);
+    vEntriesWrongHeight.push_back(MakeEntry(block));
+    BOOST_REQUIRE(trustedHeaders.Load(WriteTable(vEntriesWrongHeight, SignTable(vEntriesWrongHeight, sporkKey)), strError));
+    {
+        CValidationState state;
+        BOOST_CHECK(!ProcessNewBlockHeaders({block.GetBlockHeader()}, state, chainparams));
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-trusted-height");
+    }
+
+    // the proof of work is checked with the block hash from the table
+    std::vector<Entry> vEntriesWrongHash = vEntries;
+    vEntriesWrongHash.push_back(MakeEntry(block));
+    vEntriesWrongHash.back().hashBlock = uint256S("0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+    BOOST_REQUIRE(trustedHeaders.Load(WriteTable(vEntriesWrongHash, SignTable(vEntriesWrongHash, sporkKey)), strError));
+    {
+        CValidationState state;
+        BOOST_CHECK(!ProcessNewBlockHeaders({block.GetBlockHeader()}, state, chainparams));
+        BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    }
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(mapBlockIndex.count(block.GetHash()) == 0);
+    }
+
+    // the header is accepted at the right height
+    vEntries.push_back(MakeEntry(block));
+    BOOST_REQUIRE(trustedHeaders.Load(WriteTable(vEntries, SignTable(vEntries, sporkKey)), strError));
+    {
+        CValidationState state;
+        const CBlockIndex* pindex = NULL;
+        BOOST_CHECK(ProcessNewBlockHeaders({block.GetBlockHeader()}, state, chainparams, &pindex));
+        BOOST_REQUIRE(pindex != NULL);
+        BOOST_CHECK(pindex->GetBlockHash() == block.GetHash());
+        BOOST_CHECK_EQUAL(pindex->nHeight, 101);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,227 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txreconciliation.h"
+#include "random.h"
+
+#include "test/test_volkshash.h"
+
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sketch_decode)
+{
+    CReconSketch a(CReconSketch::CellsForDifference(20));
+    CReconSketch b(CReconSketch::CellsForDifference(20));
+    BOOST_CHECK(a.IsValid());
+    BOOST_CHECK_EQUAL(a.GetCellCount(), b.GetCellCount());
+
+    // 500 shared keys, 10 only in a and 10 only in b
+    for (uint32_t i = 1; i <= 500; i++) {
+        a.Insert(i * 7919);
+        b.Insert(i * 7919);
+    }
+    std::set<uint32_t> setOnlyA, setOnlyB;
+    for (uint32_t i = 1; i <= 10; i++) {
+        a.Insert(1000000 + i);
+        setOnlyA.insert(1000000 + i);
+        b.Insert(2000000 + i);
+        setOnlyB.insert(2000000 + i);
+    }
+
+    BOOST_CHECK(a.Subtract(b));
+    std::vector<uint32_t> vOurs, vTheirs;
+    BOOST_CHECK(a.Decode(vOurs, vTheirs));
+    BOOST_CHECK(std::set<uint32_t>(vOurs.begin(), vOurs.end()) == setOnlyA);
+    BOOST_CHECK(std::set<uint32_t>(vTheirs.begin(), vTheirs.end()) == setOnlyB);
+
+    // different sizes can't be combined
+    BOOST_CHECK(!a.Subtract(CReconSketch(a.GetCellCount() + CReconSketch::NUM_HASHES)));
+
+    // a much larger difference than the sketch was built for doesn't decode
+    CReconSketch c(CReconSketch::CellsForDifference(5));
+    for (uint32_t i = 1; i <= 200; i++) {
+        c.Insert(i);
+    }
+    BOOST_CHECK(!c.Decode(vOurs, vTheirs));
+}
+
+static void Connect(CTxReconciliationTracker& initiator, CTxReconciliationTracker& responder)
+{
+    initiator.SetEnabled(true);
+    responder.SetEnabled(true);
+    uint64_t nSaltInitiator = initiator.PreRegisterPeer(1);
+    uint64_t nSaltResponder = responder.PreRegisterPeer(1);
+    BOOST_CHECK(initiator.RegisterPeer(1, true, TXRECONCILIATION_VERSION, nSaltResponder));
+    BOOST_CHECK(responder.RegisterPeer(1, false, TXRECONCILIATION_VERSION, nSaltInitiator));
+    // only once
+    BOOST_CHECK(!responder.RegisterPeer(1, false, TXRECONCILIATION_VERSION, nSaltInitiator));
+}
+
+// One round between two trackers, returns what each side announced to the other
+static void Reconcile(CTxReconciliationTracker& initiator, CTxReconciliationTracker& responder, int64_t nNow,
+                      std::set<uint256>& setToResponder, std::set<uint256>& setToInitiator, bool& fSuccess)
+{
+    uint64_t nSetSize = 0;
+    BOOST_CHECK(initiator.InitiateRound(1, nNow, nSetSize));
+    // no second round until this one is done
+    BOOST_CHECK(!initiator.InitiateRound(1, nNow + RECON_INTERVAL, nSetSize));
+
+    CReconSketch sketch;
+    std::vector<uint256> vAnnounce;
+    BOOST_CHECK(responder.HandleRequest(1, nNow, nSetSize, sketch, vAnnounce));
+    setToInitiator.insert(vAnnounce.begin(), vAnnounce.end());
+
+    vAnnounce.clear();
+    std::vector<uint32_t> vRequest;
+    BOOST_CHECK(initiator.HandleSketch(1, sketch, vAnnounce, vRequest, fSuccess));
+    setToResponder.insert(vAnnounce.begin(), vAnnounce.end());
+
+    vAnnounce.clear();
+    BOOST_CHECK(responder.HandleDiff(1, fSuccess, vRequest, vAnnounce));
+    setToInitiator.insert(vAnnounce.begin(), vAnnounce.end());
+}
+
+BOOST_AUTO_TEST_CASE(tracker_round)
+{
+    CTxReconciliationTracker initiator, responder;
+    Connect(initiator, responder);
+    BOOST_CHECK(initiator.IsPeerRegistered(1));
+    BOOST_CHECK(!initiator.IsPeerRegistered(2));
+    // roles are fixed, a responder doesn't start rounds
+    uint64_t nSetSize = 0;
+    BOOST_CHECK(!responder.InitiateRound(1, 0, nSetSize));
+
+    std::set<uint256> setShared, setOnlyInitiator, setOnlyResponder;
+    for (int i = 0; i < 300; i++) {
+        uint256 txid = GetRandHash();
+        setShared.insert(txid);
+        initiator.AddToSet(1, txid);
+        responder.AddToSet(1, txid);
+    }
+    for (int i = 0; i < 20; i++) {
+        uint256 txid = GetRandHash();
+        setOnlyInitiator.insert(txid);
+        initiator.AddToSet(1, txid);
+        txid = GetRandHash();
+        setOnlyResponder.insert(txid);
+        responder.AddToSet(1, txid);
+    }
+
+    std::set<uint256> setToResponder, setToInitiator;
+    bool fSuccess = false;
+    Reconcile(initiator, responder, 0, setToResponder, setToInitiator, fSuccess);
+    if (fSuccess) {
+        // only the difference is announced
+        BOOST_CHECK(setToResponder == setOnlyInitiator);
+        BOOST_CHECK(setToInitiator == setOnlyResponder);
+    } else {
+        // falling back to announcing everything still gets everything across
+        BOOST_CHECK_EQUAL(setToResponder.size(), setShared.size() + setOnlyInitiator.size());
+        BOOST_CHECK_EQUAL(setToInitiator.size(), setShared.size() + setOnlyResponder.size());
+    }
+
+    CTxReconciliationTracker::PeerStats stats;
+    BOOST_CHECK(initiator.GetPeerStats(1, stats));
+    BOOST_CHECK(stats.fInitiator);
+    BOOST_CHECK_EQUAL(stats.nPending, 0);
+    BOOST_CHECK_EQUAL(stats.nRounds, 1);
+    BOOST_CHECK_EQUAL(stats.nAnnounced, setToResponder.size());
+    BOOST_CHECK(responder.GetPeerStats(1, stats));
+    BOOST_CHECK(!stats.fInitiator);
+    BOOST_CHECK_EQUAL(stats.nAnnounced, setToInitiator.size());
+
+    // the next round only starts after the interval
+    BOOST_CHECK(!initiator.InitiateRound(1, RECON_INTERVAL - 1, nSetSize));
+
+    initiator.ForgetPeer(1);
+    BOOST_CHECK(!initiator.IsPeerRegistered(1));
+    BOOST_CHECK(!initiator.GetPeerStats(1, stats));
+}
+
+BOOST_AUTO_TEST_CASE(tracker_fallback)
+{
+    CTxReconciliationTracker initiator, responder;
+    Connect(initiator, responder);
+
+    // nothing on the initiator side, the responder announces right away
+    std::set<uint256> setOnlyResponder;
+    for (int i = 0; i < 50; i++) {
+        uint256 txid = GetRandHash();
+        setOnlyResponder.insert(txid);
+        responder.AddToSet(1, txid);
+    }
+    std::set<uint256> setToResponder, setToInitiator;
+    bool fSuccess = false;
+    Reconcile(initiator, responder, 0, setToResponder, setToInitiator, fSuccess);
+    BOOST_CHECK(fSuccess);
+    BOOST_CHECK(setToResponder.empty());
+    BOOST_CHECK(setToInitiator == setOnlyResponder);
+
+    // a sketch which can't be decoded falls back to announcing the whole round
+    std::set<uint256> setOnlyInitiator;
+    for (int i = 0; i < 50; i++) {
+        uint256 txid = GetRandHash();
+        setOnlyInitiator.insert(txid);
+        initiator.AddToSet(1, txid);
+    }
+    uint64_t nSetSize = 0;
+    BOOST_CHECK(initiator.InitiateRound(1, RECON_INTERVAL, nSetSize));
+    BOOST_CHECK_EQUAL(nSetSize, 50);
+    std::vector<uint256> vAnnounce;
+    std::vector<uint32_t> vRequest;
+    CReconSketch bogus(CReconSketch::CellsForDifference(1));
+    BOOST_CHECK(initiator.HandleSketch(1, bogus, vAnnounce, vRequest, fSuccess));
+    BOOST_CHECK(!fSuccess);
+    BOOST_CHECK(vRequest.empty());
+    BOOST_CHECK(std::set<uint256>(vAnnounce.begin(), vAnnounce.end()) == setOnlyInitiator);
+
+    CTxReconciliationTracker::PeerStats stats;
+    BOOST_CHECK(initiator.GetPeerStats(1, stats));
+    BOOST_CHECK_EQUAL(stats.nFailures, 1);
+
+    // a round without an answer is retried with the same transactions
+    initiator.AddToSet(1, GetRandHash());
+    BOOST_CHECK(initiator.InitiateRound(1, 2 * RECON_INTERVAL, nSetSize));
+    BOOST_CHECK_EQUAL(nSetSize, 1);
+    BOOST_CHECK(!initiator.InitiateRound(1, 3 * RECON_INTERVAL, nSetSize));
+    BOOST_CHECK(initiator.InitiateRound(1, 3 * RECON_INTERVAL + RECON_TIMEOUT, nSetSize));
+    BOOST_CHECK_EQUAL(nSetSize, 1);
+
+    // messages for a round that isn't in flight are rejected
+    BOOST_CHECK(!responder.HandleDiff(1, true, vRequest, vAnnounce));
+}
+
+BOOST_AUTO_TEST_CASE(tracker_limits)
+{
+    CTxReconciliationTracker initiator, responder;
+    Connect(initiator, responder);
+
+    // a peer which never asks for a round doesn't get an unbounded set, the rest is flooded
+    for (size_t i = 0; i < MAX_RECON_SET_SIZE; i++) {
+        BOOST_CHECK(responder.AddToSet(1, GetRandHash()));
+    }
+    BOOST_CHECK(!responder.AddToSet(1, GetRandHash()));
+    BOOST_CHECK(!responder.AddToSet(2, GetRandHash()));
+    CTxReconciliationTracker::PeerStats stats;
+    BOOST_CHECK(responder.GetPeerStats(1, stats));
+    BOOST_CHECK_EQUAL(stats.nPending, MAX_RECON_SET_SIZE);
+
+    // requests are only answered every RECON_MIN_REQUEST_INTERVAL
+    CReconSketch sketch;
+    std::vector<uint256> vAnnounce;
+    BOOST_CHECK(responder.HandleRequest(1, 0, 0, sketch, vAnnounce));
+    BOOST_CHECK_EQUAL(vAnnounce.size(), MAX_RECON_SET_SIZE);
+    BOOST_CHECK(responder.AddToSet(1, GetRandHash()));
+    vAnnounce.clear();
+    BOOST_CHECK(!responder.HandleRequest(1, RECON_MIN_REQUEST_INTERVAL - 1, 0, sketch, vAnnounce));
+    BOOST_CHECK(vAnnounce.empty());
+    BOOST_CHECK(responder.HandleRequest(1, RECON_MIN_REQUEST_INTERVAL, 0, sketch, vAnnounce));
+    BOOST_CHECK_EQUAL(vAnnounce.size(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,173 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "trustedheaders.h"
+
+#include "base58.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "init.h"
+#include "messagesigner.h"
+#include "pow.h"
+#include "streams.h"
+#include "ui_interface.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/thread.hpp>
+
+CTrustedHeaderTable trustedHeaders;
+
+void CTrustedHeaderTable::CalcCommitment(const CBlockHeader& header, unsigned char* commitmentRet)
+{
+    // SHA256d of the 80-byte header
+    uint256 hash = SerializeHash(header);
+    memcpy(commitmentRet, hash.begin(), COMMITMENT_SIZE);
+}
+
+uint256 CTrustedHeaderTable::GetSignatureHash(const std::vector<Entry>& vEntriesIn)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << TRUSTED_HEADERS_MAGIC << TRUSTED_HEADERS_VERSION;
+    ss << FLATDATA(Params().MessageStart());
+    ss << vEntriesIn;
+    return ss.GetHash();
+}
+
+bool CTrustedHeaderTable::Load(const std::string& strFile, std::string& strErrorRet)
+{
+    CAutoFile filein(fopen(strFile.c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        strErrorRet = strprintf("Failed to open trusted header table %s", strFile);
+        return false;
+    }
+
+    std::string strMagic;
+    int nVersion;
+    CMessageHeader::MessageStartChars pchMessageStart;
+    std::vector<Entry> vEntriesIn;
+    std::vector<unsigned char> vchSig;
+    try {
+        filein >> strMagic >> nVersion;
+        if (strMagic != TRUSTED_HEADERS_MAGIC || nVersion != TRUSTED_HEADERS_VERSION) {
+            strErrorRet = strprintf("%s is not a trusted header table or has an unsupported version", strFile);
+            return false;
+        }
+        filein >> FLATDATA(pchMessageStart) >> vEntriesIn >> vchSig;
+    } catch (const std::exception& e) {
+        strErrorRet = strprintf("Failed to read trusted header table %s: %s", strFile, e.what());
+        return false;
+    }
+
+    if (memcmp(pchMessageStart, Params().MessageStart(), sizeof(pchMessageStart)) != 0) {
+        strErrorRet = strprintf("Trusted header table %s is for a different network", strFile);
+        return false;
+    }
+    if (vEntriesIn.empty() || vEntriesIn[0].hashBlock != Params().GetConsensus().hashGenesisBlock) {
+        strErrorRet = strprintf("Trusted header table %s does not start at the genesis block", strFile);
+        return false;
+    }
+
+    // must be signed by one of the spork keys
+    uint256 hash = GetSignatureHash(vEntriesIn);
+    bool fSigValid = false;
+    for (const auto& strAddress : Params().SporkAddresses()) {
+        CKeyID keyID;
+        std::string strError;
+        if (CBitcoinAddress(strAddress).GetKeyID(keyID) && CHashSigner::VerifyHash(hash, keyID, vchSig, strError)) {
+            fSigValid = true;
+            break;
+        }
+    }
+    if (!fSigValid) {
+        strErrorRet = strprintf("Trusted header table %s is not signed by a known key", strFile);
+        return false;
+    }
+
+    vEntries = std::move(vEntriesIn);
+    mapCommitments.clear();
+    mapCommitments.reserve(vEntries.size());
+    for (size_t i = 0; i < vEntries.size(); i++) {
+        mapCommitments.emplace(ReadLE64(vEntries[i].commitment), (int)i);
+    }
+
+    LogPrintf("CTrustedHeaderTable::%s -- loaded %d entries from %s\n", __func__, vEntries.size(), strFile);
+    return true;
+}
+
+bool CTrustedHeaderTable::GetTrustedHash(const CBlockHeader& header, uint256& hashRet, int& nHeightRet) const
+{
+    if (vEntries.empty())
+        return false;
+
+    unsigned char commitment[COMMITMENT_SIZE];
+    CalcCommitment(header, commitment);
+
+    auto it = mapCommitments.find(ReadLE64(commitment));
+    if (it == mapCommitments.end())
+        return false;
+
+    const Entry& entry = vEntries[it->second];
+    if (memcmp(entry.commitment, commitment, COMMITMENT_SIZE) != 0)
+        return false;
+
+    hashRet = entry.hashBlock;
+    nHeightRet = it->second;
+    return true;
+}
+
+uint256 CTrustedHeaderTable::GetHash(const CBlockHeader& header) const
+{
+    uint256 hash;
+    int nHeight;
+    if (GetTrustedHash(header, hash, nHeight))
+        return hash;
+    return header.GetHash();
+}
+
+void CTrustedHeaderTable::ThreadVerify()
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    int nHeight = nVerifiedHeight + 1;
+    while (nHeight <= GetMaxHeight()) {
+        boost::this_thread::interruption_point();
+
+        const Entry& entry = vEntries[nHeight];
+        CBlockHeader header;
+        bool fFound = false;
+        {
+            LOCK(cs_main);
+            BlockMap::const_iterator it = mapBlockIndex.find(entry.hashBlock);
+            if (it != mapBlockIndex.end()) {
+                header = it->second->GetBlockHeader();
+                fFound = true;
+            }
+        }
+        if (!fFound) {
+            // header sync didn't get that far yet
+            MilliSleep(1000);
+            continue;
+        }
+
+        uint256 hash = header.GetHash();
+        if (hash != entry.hashBlock || !CheckProofOfWork(hash, header.nBits, consensusParams)) {
+            LogPrintf("CTrustedHeaderTable::%s -- ERROR: hash of header at height %d does not match the table, expected %s, got %s\n",
+                      __func__, nHeight, entry.hashBlock.ToString(), hash.ToString());
+            uiInterface.ThreadSafeMessageBox(_("The trusted header table does not match the block chain. Restart with -reindex and without -trustedheaders."),
+                                             "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+            return;
+        }
+
+        nVerifiedHeight = nHeight++;
+        if (nHeight % 10000 == 0) {
+            LogPrint("trustedheaders", "CTrustedHeaderTable::%s -- verified up to height %d\n", __func__, nVerifiedHeight);
+        }
+    }
+
+    LogPrintf("CTrustedHeaderTable::%s -- verified all %d entries\n", __func__, vEntries.size());
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TRUSTEDHEADERS_H
+#define TRUSTEDHEADERS_H
+
+#include "primitives/block.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CTrustedHeaderTable;
+
+extern CTrustedHeaderTable trustedHeaders;
+
+static const std::string TRUSTED_HEADERS_MAGIC = "volkshash-trusted-headers";
+static const int TRUSTED_HEADERS_VERSION = 1;
+
+/**
+ * Table of block hashes up to a known height, loaded from a file signed with one of the spork keys.
+ *
+ * Computing the yespower hash of every historical header makes header sync CPU-bound. Each entry of the
+ * table therefore also commits to the exact 80-byte header with a (truncated) SHA256d hash, which is cheap
+ * to compute. A header matching the commitment at its height can be accepted with the block hash from the
+ * table. The whole range is still verified with yespower by a background thread, see ThreadVerify().
+ */
+class CTrustedHeaderTable
+{
+public:
+    /** Number of bytes of the SHA256d header hash stored per entry */
+    static const size_t COMMITMENT_SIZE = 16;
+
+    struct Entry
+    {
+        uint256 hashBlock;
+        unsigned char commitment[COMMITMENT_SIZE];
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action)
+        {
+            READWRITE(hashBlock);
+            READWRITE(FLATDATA(commitment));
+        }
+    };
+
+private:
+    // index is the block height, only modified in Load() before any other thread uses the table
+    std::vector<Entry> vEntries;
+    // first 8 bytes of the commitment -> height
+    std::unordered_map<uint64_t, int> mapCommitments;
+
+    std::atomic<int> nVerifiedHeight;
+
+    static void CalcCommitment(const CBlockHeader& header, unsigned char* commitmentRet);
+    static uint256 GetSignatureHash(const std::vector<Entry>& vEntries);
+
+public:
+    CTrustedHeaderTable() : nVerifiedHeight(-1) {}
+
+    /** Load and verify the signature of a table file, must be called before the table is used */
+    bool Load(const std::string& strFile, std::string& strErrorRet);
+    /** Drop the table, only used by the unit tests */
+    void Clear() { vEntries.clear(); mapCommitments.clear(); nVerifiedHeight = -1; }
+
+    bool IsEnabled() const { return !vEntries.empty(); }
+    int GetMaxHeight() const { return (int)vEntries.size() - 1; }
+    int GetVerifiedHeight() const { return nVerifiedHeight; }
+
+    /**
+     * Returns true if the header is the one committed to in the table, together with its block hash
+     * and height. No yespower hash is computed.
+     */
+    bool GetTrustedHash(const CBlockHeader& header, uint256& hashRet, int& nHeightRet) const;
+    /** Block hash of the header, taken from the table when possible */
+    uint256 GetHash(const CBlockHeader& header) const;
+
+    /** Verify the yespower hashes of all table entries as their headers arrive, shuts down the node on mismatch */
+    void ThreadVerify();
+};
+
+#endif // TRUSTEDHEADERS_H
@@ -11,6 +11,9 @@
 #include "uint256.h"
 #include "ui_interface.h"
 #include "init.h"
+#include "util.h"
+
+#include "ctpl.h"
 
 #include <stdint.h>
 
@@ -145,6 +148,33 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const
     return i;
 }
 
+uint256 CCoinsViewDB::GetCoinsSorted(const std::vector<COutPoint>& vOutpoints, std::vector<std::pair<COutPoint, Coin> >& vCoinsRet) const
+{
+    // The iterator reads from a snapshot taken when it's created
+    std::unique_ptr<CDBIterator> pcursor(const_cast<CDBWrapper*>(&db)->NewIterator());
+
+    uint256 hashBestChain;
+    char key;
+    pcursor->Seek(DB_BEST_BLOCK);
+    if (pcursor->Valid() && pcursor->GetKeySize() == 1 && pcursor->GetKey(key) && key == DB_BEST_BLOCK) {
+        pcursor->GetValue(hashBestChain);
+    }
+
+    for (const COutPoint& outpoint : vOutpoints) {
+        COutPoint outpointFound;
+        CoinEntry entry(&outpointFound);
+        pcursor->Seek(CoinEntry(&outpoint));
+        if (!pcursor->Valid() || !pcursor->GetKey(entry) || entry.key != DB_COIN || outpointFound != outpoint) {
+            continue;
+        }
+        Coin coin;
+        if (pcursor->GetValue(coin)) {
+            vCoinsRet.emplace_back(outpoint, std::move(coin));
+        }
+    }
+    return hashBestChain;
+}
+
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
@@ -350,40 +380,91 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
+    // Entries are read in batches. Decoding and PoW checks of a batch are spread over a pool of
+    // workers, linking into mapBlockIndex is done on this thread afterwards.
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    int nWorkers = std::max(1, std::min(GetNumCores(), MAX_BLOCK_INDEX_LOAD_THREADS));
+    ctpl::thread_pool workerPool(nWorkers);
+    RenameThreadPool(workerPool, "blkidx-load");
+
+    std::vector<char> vRawValues;
+    std::vector<size_t> vOffsets;
+    std::vector<CDiskBlockIndex> vDiskIndex;
+    int64_t nTimeScan = 0, nTimeDecode = 0, nTimeLink = 0;
+    size_t nLoaded = 0;
+
+    bool fDone = false;
+    while (!fDone) {
+        int64_t nTime1 = GetTimeMicros();
+        vRawValues.clear();
+        vOffsets.assign(1, 0);
+        while (vOffsets.size() <= BLOCK_INDEX_LOAD_BATCH_SIZE) {
+            boost::this_thread::interruption_point();
+            std::pair<char, uint256> key;
+            if (!pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX) {
+                fDone = true;
+                break;
             }
-        } else {
+            pcursor->AppendValueRaw(vRawValues);
+            vOffsets.emplace_back(vRawValues.size());
+            pcursor->Next();
+        }
+        size_t nCount = vOffsets.size() - 1;
+        if (nCount == 0) {
             break;
         }
+        int64_t nTime2 = GetTimeMicros(); nTimeScan += nTime2 - nTime1;
+
+        vDiskIndex.assign(nCount, CDiskBlockIndex());
+        std::vector<std::future<bool> > vFutures;
+        size_t nPerWorker = (nCount + nWorkers - 1) / nWorkers;
+        for (size_t nBegin = 0; nBegin < nCount; nBegin += nPerWorker) {
+            size_t nEnd = std::min(nCount, nBegin + nPerWorker);
+            vFutures.emplace_back(workerPool.push([&, nBegin, nEnd](int threadId) {
+                for (size_t i = nBegin; i < nEnd; i++) {
+                    CDiskBlockIndex& diskindex = vDiskIndex[i];
+                    if (!DecodeValue(vRawValues.data() + vOffsets[i], vRawValues.data() + vOffsets[i + 1], diskindex)) {
+                        return error("LoadBlockIndexGuts: failed to read value");
+                    }
+                    if (!CheckProofOfWork(diskindex.GetBlockHash(), diskindex.nBits, consensusParams)) {
+                        return error("LoadBlockIndexGuts: CheckProofOfWork failed: %s", diskindex.ToString());
+                    }
+                }
+                return true;
+            }));
+        }
+        bool fOk = true;
+        for (auto& f : vFutures) {
+            fOk &= f.get();
+        }
+        if (!fOk) {
+            return false;
+        }
+        int64_t nTime3 = GetTimeMicros(); nTimeDecode += nTime3 - nTime2;
+
+        for (const CDiskBlockIndex& diskindex : vDiskIndex) {
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+        }
+        nLoaded += nCount;
+        nTimeLink += GetTimeMicros() - nTime3;
     }
 
+    LogPrintf("%s: %u entries, db scan %.2fms, decode %.2fms (%d threads), link %.2fms\n", __func__,
+              nLoaded, nTimeScan * 0.001, nTimeDecode * 0.001, nWorkers, nTimeLink * 0.001);
+
     return true;
 }
 
@@ -32,6 +32,10 @@ static const int64_t nDefaultDbCache = 300;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
 static const int64_t nMinDbCache = 4;
+//! Max number of threads decoding block index entries at startup
+static const int MAX_BLOCK_INDEX_LOAD_THREADS = 8;
+//! Number of block index entries read from the DB before they are handed to the decoding threads
+static const size_t BLOCK_INDEX_LOAD_BATCH_SIZE = 50000;
 //! Max memory allocated to block tree DB specific cache, if no -txindex (MiB)
 static const int64_t nMaxBlockDBCache = 2;
 //! Max memory allocated to block tree DB specific cache, if -txindex (MiB)
@@ -81,6 +85,13 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    /**
+     * Read the coins of outpoints through one iterator, so they all come from
+     * the same state of the database. Each outpoint is sought on its own; passing them sorted by
+     * txid keeps the seeks mostly forward. Returns the best block of that state.
+     */
+    uint256 GetCoinsSorted(const std::vector<COutPoint>& vOutpoints, std::vector<std::pair<COutPoint, Coin> >& vCoinsRet) const;
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
@@ -0,0 +1,378 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txreconciliation.h"
+
+#include "hash.h"
+#include "random.h"
+
+#include <algorithm>
+#include <limits>
+
+CTxReconciliationTracker txreconciliation;
+
+static inline uint64_t MixKey(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint32_t KeyChecksum(uint32_t nKey)
+{
+    return (uint32_t)MixKey(nKey ^ 0x5bd1e9955bd1e995ULL);
+}
+
+static inline size_t KeyIndex(uint32_t nKey, int nHash, size_t nPartition)
+{
+    return nHash * nPartition + MixKey(nKey + nHash * 0x9e3779b97f4a7c15ULL) % nPartition;
+}
+
+CReconSketch::CReconSketch(size_t nCells)
+{
+    // every key goes into one cell of each of the NUM_HASHES partitions
+    vCells.resize((nCells + NUM_HASHES - 1) / NUM_HASHES * NUM_HASHES);
+}
+
+size_t CReconSketch::CellsForDifference(size_t nDifference)
+{
+    if (nDifference == 0) {
+        return 0;
+    }
+    // 2.5 cells per element keep decoding failures at a few percent at most, those rounds fall
+    // back to announcing everything
+    return (nDifference * 5 / 2 + 2 * NUM_HASHES + NUM_HASHES - 1) / NUM_HASHES * NUM_HASHES;
+}
+
+void CReconSketch::Update(uint32_t nKey, uint8_t nDirection)
+{
+    if (vCells.empty()) {
+        return;
+    }
+    size_t nPartition = vCells.size() / NUM_HASHES;
+    uint32_t nChecksum = KeyChecksum(nKey);
+    for (int i = 0; i < NUM_HASHES; i++) {
+        Cell& cell = vCells[KeyIndex(nKey, i, nPartition)];
+        cell.nCount += nDirection;
+        cell.nKeySum ^= nKey;
+        cell.nHashSum ^= nChecksum;
+    }
+}
+
+bool CReconSketch::Subtract(const CReconSketch& other)
+{
+    if (other.vCells.size() != vCells.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < vCells.size(); i++) {
+        vCells[i].nCount -= other.vCells[i].nCount;
+        vCells[i].nKeySum ^= other.vCells[i].nKeySum;
+        vCells[i].nHashSum ^= other.vCells[i].nHashSum;
+    }
+    return true;
+}
+
+bool CReconSketch::Decode(std::vector<uint32_t>& vOurs, std::vector<uint32_t>& vTheirs) const
+{
+    vOurs.clear();
+    vTheirs.clear();
+    if (!IsValid()) {
+        return false;
+    }
+
+    CReconSketch sketch(*this);
+    std::vector<size_t> vPure;
+    auto fIsPure = [&sketch](size_t i) {
+        const Cell& cell = sketch.vCells[i];
+        return (cell.nCount == 1 || cell.nCount == 0xff) && cell.nHashSum == KeyChecksum(cell.nKeySum);
+    };
+    for (size_t i = 0; i < sketch.vCells.size(); i++) {
+        if (fIsPure(i)) {
+            vPure.push_back(i);
+        }
+    }
+
+    // peel off the cells holding a single key until none are left
+    size_t nPartition = sketch.vCells.size() / NUM_HASHES;
+    while (!vPure.empty()) {
+        size_t nIndex = vPure.back();
+        vPure.pop_back();
+        if (!fIsPure(nIndex)) {
+            continue;
+        }
+        uint32_t nKey = sketch.vCells[nIndex].nKeySum;
+        uint8_t nCount = sketch.vCells[nIndex].nCount;
+        if (nCount == 1) {
+            vOurs.push_back(nKey);
+        } else {
+            vTheirs.push_back(nKey);
+        }
+        if (vOurs.size() + vTheirs.size() > sketch.vCells.size()) {
+            return false; // can't be a valid difference anymore
+        }
+        sketch.Update(nKey, -nCount);
+        for (int i = 0; i < NUM_HASHES; i++) {
+            size_t j = KeyIndex(nKey, i, nPartition);
+            if (fIsPure(j)) {
+                vPure.push_back(j);
+            }
+        }
+    }
+
+    for (const auto& cell : sketch.vCells) {
+        if (!cell.IsEmpty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CTxReconciliationTracker::SetEnabled(bool fEnabledIn)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    fEnabled = fEnabledIn;
+}
+
+bool CTxReconciliationTracker::IsEnabled() const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    return fEnabled;
+}
+
+uint32_t CTxReconciliationTracker::GetShortId(const PeerState& state, const uint256& txid) const
+{
+    return (uint32_t)SipHashUint256(state.k0, state.k1, txid);
+}
+
+void CTxReconciliationTracker::TakeSnapshot(PeerState& state)
+{
+    state.mapSnapshot.clear();
+    std::set<uint256> setCollisions;
+    for (const auto& txid : state.setPending) {
+        if (!state.mapSnapshot.emplace(GetShortId(state, txid), txid).second) {
+            // short id collision, leave it for the next round
+            setCollisions.insert(txid);
+        }
+    }
+    state.setPending.swap(setCollisions);
+}
+
+void CTxReconciliationTracker::ReturnSnapshot(PeerState& state, std::vector<uint256>& vTxRet)
+{
+    for (const auto& pair : state.mapSnapshot) {
+        vTxRet.push_back(pair.second);
+    }
+    state.mapSnapshot.clear();
+}
+
+uint64_t CTxReconciliationTracker::PreRegisterPeer(NodeId nodeid)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    PeerState& state = mapPeers[nodeid];
+    if (state.nLocalSalt == 0) {
+        state.nLocalSalt = GetRand(std::numeric_limits<uint64_t>::max() - 1) + 1;
+    }
+    return state.nLocalSalt;
+}
+
+bool CTxReconciliationTracker::RegisterPeer(NodeId nodeid, bool fInitiator, uint32_t nVersion, uint64_t nRemoteSalt)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapPeers.find(nodeid);
+    if (!fEnabled || it == mapPeers.end() || it->second.fRegistered || nVersion < 1 || nRemoteSalt == 0) {
+        return false;
+    }
+    PeerState& state = it->second;
+    state.fRegistered = true;
+    state.fInitiator = fInitiator;
+    // both sides end up with the same keys no matter who sent which salt
+    state.k0 = std::min(state.nLocalSalt, nRemoteSalt);
+    state.k1 = std::max(state.nLocalSalt, nRemoteSalt);
+    return true;
+}
+
+void CTxReconciliationTracker::ForgetPeer(NodeId nodeid)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    mapPeers.erase(nodeid);
+}
+
+bool CTxReconciliationTracker::IsPeerRegistered(NodeId nodeid) const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapPeers.find(nodeid);
+    return it != mapPeers.end() && it->second.fRegistered;
+}
+
+bool CTxReconciliationTracker::AddToSet(NodeId nodeid, const uint256& txid)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapPeers.find(nodeid);
+    if (it == mapPeers.end() || !it->second.fRegistered) {
+        return false;
+    }
+    PeerState& state = it->second;
+    if (state.setPending.size() >= MAX_RECON_SET_SIZE && !state.setPending.count(txid)) {
+        // the peer doesn't ask for rounds (often enough), don't let the set grow without bounds
+        return false;
+    }
+    state.setPending.insert(txid);
+    return true;
+}
+
+bool CTxReconciliationTracker::InitiateRound(NodeId nodeid, int64_t nNow, uint64_t& nSetSizeRet)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapPeers.find(nodeid);
+    if (it == mapPeers.end() || !it->second.fRegistered || !it->second.fInitiator) {
+        return false;
+    }
+    PeerState& state = it->second;
+    if (state.fRoundInFlight) {
+        if (nNow < state.nNextRound + RECON_TIMEOUT) {
+            return false;
+        }
+        // no sketch came back, try again with the transactions of the lost round
+        for (const auto& pair : state.mapSnapshot) {
+            state.setPending.insert(pair.second);
+        }
+        state.fRoundInFlight = false;
+    }
+    if (nNow < state.nNextRound) {
+        return false;
+    }
+    state.nNextRound = nNow + RECON_INTERVAL;
+    TakeSnapshot(state);
+    state.fRoundInFlight = true;
+    nSetSizeRet = state.mapSnapshot.size();
+    return true;
+}
+
+bool CTxReconciliationTracker::HandleRequest(NodeId nodeid, int64_t nNow, uint64_t nRemoteSetSize, CReconSketch& sketchRet, std::vector<uint256>& vAnnounceRet)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapPeers.find(nodeid);
+    if (it == mapPeers.end() || !it->second.fRegistered || it->second.fInitiator) {
+        return false;
+    }
+    PeerState& state = it->second;
+    if (nNow < state.nNextRequest) {
+        // every request costs a snapshot and a sketch of the whole set
+        return false;
+    }
+    state.nNextRequest = nNow + RECON_MIN_REQUEST_INTERVAL;
+    if (state.fRoundInFlight) {
+        // the previous round was never finished, reconcile its transactions again
+        for (const auto& pair : state.mapSnapshot) {
+            state.setPending.insert(pair.second);
+        }
+    }
+    TakeSnapshot(state);
+    state.fRoundInFlight = true;
+
+    uint64_t nLocalSetSize = state.mapSnapshot.size();
+    if (nRemoteSetSize == 0) {
+        // the difference is our whole set, announcing it is cheaper than a sketch of it
+        state.nAnnounced += nLocalSetSize;
+        ReturnSnapshot(state, vAnnounceRet);
+        sketchRet = CReconSketch(0);
+        return true;
+    }
+
+    // most transactions are expected to be in both sets
+    uint64_t nDifference = std::max(nLocalSetSize, nRemoteSetSize) - std::min(nLocalSetSize, nRemoteSetSize) + std::min(nLocalSetSize, nRemoteSetSize) / 4 + 1;
+    sketchRet = CReconSketch(std::min(CReconSketch::CellsForDifference(nDifference), RECON_MAX_CELLS));
+    for (const auto& pair : state.mapSnapshot) {
+        sketchRet.Insert(pair.first);
+    }
+    return true;
+}
+
+bool CTxReconciliationTracker::HandleSketch(NodeId nodeid, const CReconSketch& sketch, std::vector<uint256>& vAnnounceRet, std::vector<uint32_t>& vRequestRet, bool& fSuccessRet)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapPeers.find(nodeid);
+    if (it == mapPeers.end() || !it->second.fRegistered || !it->second.fInitiator || !it->second.fRoundInFlight) {
+        return false;
+    }
+    PeerState& state = it->second;
+    state.fRoundInFlight = false;
+    state.nRounds++;
+
+    CReconSketch local(sketch.GetCellCount());
+    for (const auto& pair : state.mapSnapshot) {
+        local.Insert(pair.first);
+    }
+    std::vector<uint32_t> vOurs;
+    std::vector<uint32_t> vTheirs;
+    // an empty sketch only answers an empty set
+    fSuccessRet = sketch.IsValid() && sketch.GetCellCount() <= RECON_MAX_CELLS && (sketch.GetCellCount() > 0 || state.mapSnapshot.empty()) &&
+                  local.Subtract(sketch) && local.Decode(vOurs, vTheirs);
+
+    if (!fSuccessRet) {
+        state.nFailures++;
+        state.nAnnounced += state.mapSnapshot.size();
+        ReturnSnapshot(state, vAnnounceRet);
+        return true;
+    }
+    for (uint32_t nShortId : vOurs) {
+        auto itTx = state.mapSnapshot.find(nShortId);
+        if (itTx != state.mapSnapshot.end()) {
+            vAnnounceRet.push_back(itTx->second);
+        }
+    }
+    vRequestRet = vTheirs;
+    state.nAnnounced += vAnnounceRet.size();
+    state.nRequested += vRequestRet.size();
+    state.mapSnapshot.clear();
+    return true;
+}
+
+bool CTxReconciliationTracker::HandleDiff(NodeId nodeid, bool fSuccess, const std::vector<uint32_t>& vRequested, std::vector<uint256>& vAnnounceRet)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapPeers.find(nodeid);
+    if (it == mapPeers.end() || !it->second.fRegistered || it->second.fInitiator || !it->second.fRoundInFlight) {
+        return false;
+    }
+    PeerState& state = it->second;
+    state.fRoundInFlight = false;
+    state.nRounds++;
+
+    if (!fSuccess) {
+        state.nFailures++;
+        state.nAnnounced += state.mapSnapshot.size();
+        ReturnSnapshot(state, vAnnounceRet);
+        return true;
+    }
+    for (uint32_t nShortId : vRequested) {
+        auto itTx = state.mapSnapshot.find(nShortId);
+        if (itTx != state.mapSnapshot.end()) {
+            vAnnounceRet.push_back(itTx->second);
+        }
+    }
+    state.nAnnounced += vAnnounceRet.size();
+    state.mapSnapshot.clear();
+    return true;
+}
+
+bool CTxReconciliationTracker::GetPeerStats(NodeId nodeid, PeerStats& stats) const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    auto it = mapPeers.find(nodeid);
+    if (it == mapPeers.end() || !it->second.fRegistered) {
+        return false;
+    }
+    const PeerState& state = it->second;
+    stats.fInitiator = state.fInitiator;
+    stats.nPending = state.setPending.size() + state.mapSnapshot.size();
+    stats.nRounds = state.nRounds;
+    stats.nFailures = state.nFailures;
+    stats.nAnnounced = state.nAnnounced;
+    stats.nRequested = state.nRequested;
+    return true;
+}
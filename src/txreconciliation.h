@@ -0,0 +1,197 @@
+// Copyright (c) 2023 The Volkshash Core Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TXRECONCILIATION_H
+#define TXRECONCILIATION_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+typedef int64_t NodeId;
+
+class CTxReconciliationTracker;
+
+extern CTxReconciliationTracker txreconciliation;
+
+/** Default for -txreconciliation */
+static const bool DEFAULT_TXRECONCILIATION_ENABLE = false;
+/** Version of the reconciliation protocol announced in "sendrecon" */
+static const uint32_t TXRECONCILIATION_VERSION = 1;
+/** Time between two reconciliation rounds started by the initiator of a connection, in microseconds */
+static const int64_t RECON_INTERVAL = 2 * 1000000;
+/** Time after which a round without an answer is given up, in microseconds */
+static const int64_t RECON_TIMEOUT = 10 * 1000000;
+/** Shortest time between two "reqrecon" we answer from the same peer, in microseconds */
+static const int64_t RECON_MIN_REQUEST_INTERVAL = RECON_INTERVAL / 2;
+/** Largest sketch we send or accept, larger differences fall back to flooding */
+static const size_t RECON_MAX_CELLS = 3000;
+/** Most transactions queued for a peer, further ones are announced by flooding until a round takes them */
+static const size_t MAX_RECON_SET_SIZE = 3000;
+
+/**
+ * A sketch of a set of 32 bit short transaction ids (an invertible Bloom lookup table).
+ *
+ * Subtracting the sketch of another set leaves a sketch of the symmetric difference of both
+ * sets, which can be decoded as long as the difference is not much larger than the number of
+ * cells the sketch was built with. The size of a sketch only depends on the expected
+ * difference, not on the size of the sets.
+ */
+class CReconSketch
+{
+public:
+    static const int NUM_HASHES = 3;
+
+    struct Cell {
+        // counts are only compared to +-1, wrapping around doesn't matter
+        uint8_t nCount;
+        uint32_t nKeySum;
+        uint32_t nHashSum;
+
+        Cell() : nCount(0), nKeySum(0), nHashSum(0) {}
+
+        bool IsEmpty() const { return nCount == 0 && nKeySum == 0 && nHashSum == 0; }
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(nCount);
+            READWRITE(nKeySum);
+            READWRITE(nHashSum);
+        }
+    };
+
+private:
+    std::vector<Cell> vCells;
+
+    void Update(uint32_t nKey, uint8_t nDirection);
+
+public:
+    explicit CReconSketch(size_t nCells = 0);
+
+    /** Number of cells needed to decode a difference of nDifference elements with high probability */
+    static size_t CellsForDifference(size_t nDifference);
+
+    size_t GetCellCount() const { return vCells.size(); }
+    bool IsValid() const { return vCells.size() % NUM_HASHES == 0; }
+
+    void Insert(uint32_t nKey) { Update(nKey, 1); }
+    /** Subtract another sketch with the same number of cells, afterwards this sketches the difference */
+    bool Subtract(const CReconSketch& other);
+    /**
+     * Decode the difference, vOurs gets the keys only inserted into this sketch, vTheirs those only
+     * inserted into the subtracted one. Returns false if the difference was too large to decode.
+     */
+    bool Decode(std::vector<uint32_t>& vOurs, std::vector<uint32_t>& vTheirs) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(vCells);
+    }
+};
+
+/**
+ * Keeps track of the peers we reconcile transactions with instead of announcing them by flooding.
+ *
+ * Both sides of a connection send "sendrecon" with a random salt after the handshake. The short
+ * ids of the transactions are keyed with both salts, so they differ for every connection. The
+ * side which made the outbound connection initiates a round every RECON_INTERVAL:
+ *
+ *  - initiator: "reqrecon" with the size of its set of transactions to announce
+ *  - responder: "reconsketch" with a sketch of its own set, sized for the expected difference
+ *  - initiator: subtracts the sketch of its set, announces (inv) the transactions the responder
+ *    is missing and sends "recondiff" with the short ids of those it is missing itself
+ *  - responder: announces (inv) the requested transactions
+ *
+ * When the sketch can't be decoded, "recondiff" says so and both sides announce their whole set.
+ * Transactions the peer already knows about are never announced on the connection, which is
+ * where the bandwidth is saved with many peers.
+ */
+class CTxReconciliationTracker
+{
+public:
+    struct PeerStats {
+        bool fInitiator;
+        size_t nPending;
+        uint64_t nRounds;
+        uint64_t nFailures;
+        uint64_t nAnnounced;
+        uint64_t nRequested;
+    };
+
+private:
+    struct PeerState {
+        bool fRegistered{false};
+        bool fInitiator{false};
+        uint64_t nLocalSalt{0};
+        uint64_t k0{0};
+        uint64_t k1{0};
+        // transactions added since the current round started
+        std::set<uint256> setPending;
+        // the transactions being reconciled in the current round, by short id
+        std::map<uint32_t, uint256> mapSnapshot;
+        bool fRoundInFlight{false};
+        int64_t nNextRound{0};
+        // responder: the earliest time the next request is answered
+        int64_t nNextRequest{0};
+        uint64_t nRounds{0};
+        uint64_t nFailures{0};
+        uint64_t nAnnounced{0};
+        uint64_t nRequested{0};
+    };
+
+    mutable std::mutex cs;
+    bool fEnabled{false};
+    std::map<NodeId, PeerState> mapPeers;
+
+    uint32_t GetShortId(const PeerState& state, const uint256& txid) const;
+    void TakeSnapshot(PeerState& state);
+    void ReturnSnapshot(PeerState& state, std::vector<uint256>& vTxRet);
+
+public:
+    void SetEnabled(bool fEnabledIn);
+    bool IsEnabled() const;
+
+    /** Called before sending "sendrecon", returns the salt to send */
+    uint64_t PreRegisterPeer(NodeId nodeid);
+    /** Called for a received "sendrecon", false if the peer can't be used for reconciliation */
+    bool RegisterPeer(NodeId nodeid, bool fInitiator, uint32_t nVersion, uint64_t nRemoteSalt);
+    void ForgetPeer(NodeId nodeid);
+    bool IsPeerRegistered(NodeId nodeid) const;
+
+    /**
+     * Queue a transaction for the next round instead of announcing it. Returns false if the peer
+     * doesn't reconcile or already has MAX_RECON_SET_SIZE transactions queued, the transaction has
+     * to be announced by flooding then.
+     */
+    bool AddToSet(NodeId nodeid, const uint256& txid);
+
+    /** Initiator: whether it is time for a new round, sets the size to send in "reqrecon" */
+    bool InitiateRound(NodeId nodeid, int64_t nNow, uint64_t& nSetSizeRet);
+    /**
+     * Responder: build the sketch to answer "reqrecon" with. If the initiator has nothing to
+     * reconcile the sketch is empty and our transactions are returned to be announced right away.
+     * Requests coming faster than RECON_MIN_REQUEST_INTERVAL are refused.
+     */
+    bool HandleRequest(NodeId nodeid, int64_t nNow, uint64_t nRemoteSetSize, CReconSketch& sketchRet, std::vector<uint256>& vAnnounceRet);
+    /**
+     * Initiator: reconcile with the received sketch. Sets the transactions to announce to the
+     * peer and the short ids to request, or on failure all transactions of the round.
+     */
+    bool HandleSketch(NodeId nodeid, const CReconSketch& sketch, std::vector<uint256>& vAnnounceRet, std::vector<uint32_t>& vRequestRet, bool& fSuccessRet);
+    /** Responder: the transactions to announce for a received "recondiff" */
+    bool HandleDiff(NodeId nodeid, bool fSuccess, const std::vector<uint32_t>& vRequested, std::vector<uint256>& vAnnounceRet);
+
+    bool GetPeerStats(NodeId nodeid, PeerStats& stats) const;
+};
+
+#endif // TXRECONCILIATION_H
@@ -28,6 +28,7 @@
 #include "script/standard.h"
 #include "timedata.h"
 #include "tinyformat.h"
+#include "trustedheaders.h"
 #include "txdb.h"
 #include "txmempool.h"
 #include "ui_interface.h"
@@ -71,6 +72,8 @@
 CCriticalSection cs_main;
 
 BlockMap mapBlockIndex;
+/** Owns all entries of mapBlockIndex */
+static CBlockIndexArena blockIndexArena;
 CChain chainActive;
 CBlockIndex *pindexBestHeader = NULL;
 CWaitableCriticalSection csBestBlock;
@@ -90,6 +93,8 @@ unsigned int nBytesPerSigOp = DEFAULT_BYTES_PER_SIGOP;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
+/** Largest UTXO cache usage since the last GetCoinsCacheUsage(), protected by cs_main */
+static size_t nCoinCachePeakUsage = 0;
 uint64_t nPruneTarget = 0;
 bool fAlerts = DEFAULT_ALERTS;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
@@ -639,7 +644,7 @@ static bool IsCurrentForFeeEstimation()
 
 bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx, bool fLimitFree,
                               bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, 
-                              const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache, bool fDryRun)
+                              const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache, bool fDryRun, const CAmount nValidatedFee)
 {
     const CTransaction& tx = *ptx;
     const uint256 hash = tx.GetHash();
@@ -814,7 +819,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
             return state.DoS(0, false, REJECT_NONSTANDARD, "bad-txns-too-many-sigops", false,
                 strprintf("%d", nSigOps));
 
-        CAmount mempoolRejectFee = pool.GetMinFee(GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000).GetFee(nSize);
+        CAmount mempoolRejectFee = pool.GetMinFee(pool.GetSizeLimit()).GetFee(nSize);
         if (mempoolRejectFee > 0 && nModifiedFees < mempoolRejectFee) {
             return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool min fee not met", false, strprintf("%d < %d", nFees, mempoolRejectFee));
         } else if (GetBoolArg("-relaypriority", DEFAULT_RELAYPRIORITY) && nModifiedFees < ::minRelayTxFee.GetFee(nSize) && !AllowFree(entry.GetPriority(chainActive.Height() + 1))) {
@@ -874,9 +879,12 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         // If we aren't going to actually accept it but just were verifying it, we are fine already
         if(fDryRun) return true;
 
+        // The scripts were verified against this tip before, only the inexpensive input checks are left
+        bool fScriptChecks = nValidatedFee < 0 || nFees != nValidatedFee;
+
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        if (!CheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true))
+        if (!CheckInputs(tx, state, view, fScriptChecks, STANDARD_SCRIPT_VERIFY_FLAGS, true))
             return false; // state filled in by CheckInputs
 
         // Check again against just the consensus-critical mandatory script
@@ -888,7 +896,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         // There is a similar check in CreateNewBlock() to prevent creating
         // invalid blocks, however allowing such transactions into the mempool
         // can be exploited as a DoS attack.
-        if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true))
+        if (fScriptChecks && !CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true))
         {
             return error("%s: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s, %s",
                 __func__, hash.ToString(), FormatStateMessage(state));
@@ -914,7 +922,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 
         // trim mempool and check if tx was trimmed
         if (!fOverrideMempoolLimit) {
-            LimitMempoolSize(pool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+            LimitMempoolSize(pool, pool.GetSizeLimit(), GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
             if (!pool.exists(hash))
                 return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
         }
@@ -928,10 +936,10 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 
 bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool fLimitFree,
                         bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit, 
-                        const CAmount nAbsurdFee, bool fDryRun)
+                        const CAmount nAbsurdFee, bool fDryRun, const CAmount nValidatedFee)
 {
     std::vector<COutPoint> coins_to_uncache;
-    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, fOverrideMempoolLimit, nAbsurdFee, coins_to_uncache, fDryRun);
+    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, fOverrideMempoolLimit, nAbsurdFee, coins_to_uncache, fDryRun, nValidatedFee);
     if (!res || fDryRun) {
         if(!res) LogPrint("mempool", "%s: %s %s (%s)\n", __func__, tx->GetHash().ToString(), state.GetRejectReason(), state.GetDebugMessage());
         BOOST_FOREACH(const COutPoint& hashTx, coins_to_uncache)
@@ -2407,8 +2415,9 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
     if (nLastSetChain == 0) {
         nLastSetChain = nNow;
     }
-    int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+    int64_t nMempoolSizeMax = mempool.GetSizeLimit();
     int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() * DB_PEAK_USAGE_FACTOR;
+    nCoinCachePeakUsage = std::max<size_t>(nCoinCachePeakUsage, pcoinsTip->DynamicMemoryUsage());
     int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
     // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
     bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
@@ -2489,6 +2498,14 @@ void PruneAndFlush() {
     FlushStateToDisk(state, FLUSH_STATE_NONE);
 }
 
+size_t GetCoinsCacheUsage() {
+    AssertLockHeld(cs_main);
+    size_t nUsage = std::max(nCoinCachePeakUsage, pcoinsTip ? pcoinsTip->DynamicMemoryUsage() : 0);
+    nCoinCachePeakUsage = 0;
+    // the cache is flushed once this reaches nCoinCacheUsage
+    return nUsage * DB_PEAK_USAGE_FACTOR;
+}
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     chainActive.SetTip(pindexNew);
@@ -2551,8 +2568,69 @@ void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
     LogPrintf("\n");
 }
 
-/** Disconnect chainActive's tip. You probably want to call mempool.removeForReorg and manually re-limit mempool size after this, with cs_main held. */
-bool static DisconnectTip(CValidationState& state, const CChainParams& chainparams)
+/* Make mempool consistent after a reorg, by re-adding or recursively erasing
+ * disconnected block transactions from the mempool, and also removing any
+ * other transactions from the mempool that are no longer valid given the new
+ * tip/height.
+ *
+ * Note: we assume that disconnectpool only contains transactions that are NOT
+ * confirmed in the current chain nor already in the mempool (otherwise,
+ * in-mempool descendants of such transactions would be removed).
+ *
+ * Passing fAddToMempool=false will skip trying to add the transactions back,
+ * and instead just erase from the mempool as needed.
+ */
+static void UpdateMempoolForReorg(DisconnectedBlockTransactions &disconnectpool, bool fAddToMempool)
+{
+    AssertLockHeld(cs_main);
+    int64_t nStart = GetTimeMicros();
+    std::vector<uint256> vHashUpdate;
+    // disconnectpool's insertion_order index sorts the entries from
+    // oldest to newest, but the oldest entry will be the last tx from the
+    // latest mined block that was disconnected.
+    // Iterate disconnectpool in reverse, so that we add transactions
+    // back to the mempool starting with the earliest transaction that had
+    // been previously seen in a block, which is a topological order.
+    auto it = disconnectpool.queuedTx.get<insertion_order>().rbegin();
+    while (it != disconnectpool.queuedTx.get<insertion_order>().rend()) {
+        // ignore validation errors in resurrected transactions
+        CValidationState stateDummy;
+        if (!fAddToMempool || (*it)->IsCoinBase() || !AcceptToMemoryPool(mempool, stateDummy, *it, false, NULL, true)) {
+            // If the transaction doesn't make it in to the mempool, remove any
+            // transactions that depend on it (which would now be orphans).
+            mempool.removeRecursive(**it, MemPoolRemovalReason::REORG);
+        } else if (mempool.exists((*it)->GetHash())) {
+            vHashUpdate.push_back((*it)->GetHash());
+        }
+        ++it;
+    }
+    size_t nDisconnected = disconnectpool.queuedTx.size();
+    disconnectpool.clear();
+    // AcceptToMemoryPool/addUnchecked all assume that new mempool entries have
+    // no in-mempool children, which is generally not true when adding
+    // previously-confirmed transactions back to the mempool.
+    // UpdateTransactionsFromBlock finds descendants of any transactions in
+    // the disconnectpool that were added back and cleans up the mempool state.
+    mempool.UpdateTransactionsFromBlock(vHashUpdate);
+
+    // We also need to remove any now-immature transactions
+    mempool.removeForReorg(pcoinsTip, chainActive.Tip()->nHeight + 1, STANDARD_LOCKTIME_VERIFY_FLAGS);
+    // Re-limit mempool size, in case we added any transactions
+    LimitMempoolSize(mempool, mempool.GetSizeLimit(), GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+    LogPrint("bench", "- Update mempool for reorg: %u txs, %u re-added, %.2fms\n", nDisconnected, vHashUpdate.size(), (GetTimeMicros() - nStart) * 0.001);
+}
+
+/** Disconnect chainActive's tip.
+  * After calling, the mempool will be in an inconsistent state, with
+  * transactions from disconnected blocks being added to disconnectpool.  You
+  * should make the mempool consistent again by calling UpdateMempoolForReorg,
+  * with cs_main held.
+  *
+  * If disconnectpool is NULL, then no disconnected transactions are added to
+  * disconnectpool (note that the caller is responsible for mempool consistency
+  * in any case).
+  */
+bool static DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions *disconnectpool)
 {
     CBlockIndex *pindexDelete = chainActive.Tip();
     assert(pindexDelete);
@@ -2576,24 +2654,18 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
         return false;
-    // Resurrect mempool transactions from the disconnected block.
-    std::vector<uint256> vHashUpdate;
-    for (const auto& it : block.vtx) {
-        const CTransaction& tx = *it;
-        // ignore validation errors in resurrected transactions
-        CValidationState stateDummy;
-        if (tx.IsCoinBase() || !AcceptToMemoryPool(mempool, stateDummy, it, false, NULL, true)) {
-            mempool.removeRecursive(tx, MemPoolRemovalReason::REORG);
-        } else if (mempool.exists(tx.GetHash())) {
-            vHashUpdate.push_back(tx.GetHash());
+    if (disconnectpool) {
+        // Save transactions to re-add to mempool at end of reorg
+        for (auto it = block.vtx.rbegin(); it != block.vtx.rend(); ++it) {
+            disconnectpool->addTransaction(*it);
+        }
+        while (disconnectpool->DynamicMemoryUsage() > MAX_DISCONNECTED_TX_POOL_SIZE * 1000) {
+            // Drop the earliest entry, and remove its children from the mempool.
+            auto it = disconnectpool->queuedTx.get<insertion_order>().begin();
+            mempool.removeRecursive(**it, MemPoolRemovalReason::REORG);
+            disconnectpool->removeEntry(it);
         }
     }
-    // AcceptToMemoryPool/addUnchecked all assume that new mempool entries have
-    // no in-mempool children, which is generally not true when adding
-    // previously-confirmed transactions back to the mempool.
-    // UpdateTransactionsFromBlock finds descendants of any transactions in this
-    // block that were added back and cleans up the mempool state.
-    mempool.UpdateTransactionsFromBlock(vHashUpdate);
     // Update chainActive and related variables.
     UpdateTip(pindexDelete->pprev, chainparams);
     // Let wallets know transactions went from 1-confirmed to
@@ -2626,7 +2698,7 @@ struct ConnectTrace {
  * pblock) - if that is not intended, care must be taken to remove the last entry in
  * blocksConnected in case of failure.
  */
-bool static ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace)
+bool static ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool)
 {
     assert(pindexNew->pprev == chainActive.Tip());
     // Read block from disk.
@@ -2670,6 +2742,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     LogPrint("bench", "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
     // Remove conflicting transactions from the mempool.;
     mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
+    disconnectpool.removeForBlock(blockConnecting.vtx);
     // Update chainActive & related variables.
     UpdateTip(pindexNew, chainparams);
 
@@ -2679,6 +2752,39 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     return true;
 }
 
+bool ConnectNextBlock(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexTarget)
+{
+    AssertLockHeld(cs_main);
+    assert(pindexTarget->nHeight > chainActive.Height());
+
+    CBlockIndex* pindexNew = pindexTarget->GetAncestor(chainActive.Height() + 1);
+    if (pindexNew->pprev != chainActive.Tip())
+        return state.Error(strprintf("%s: block %s does not build on the active chain", __func__, pindexTarget->GetBlockHash().ToString()));
+
+    ConnectTrace connectTrace;
+    DisconnectedBlockTransactions disconnectpool;
+    return ConnectTip(state, chainparams, pindexNew, NULL, connectTrace, disconnectpool);
+}
+
+CBlockConnectTimings GetBlockConnectTimings()
+{
+    CBlockConnectTimings timings;
+    timings.nReadFromDisk = nTimeReadFromDisk;
+    timings.nCheck = nTimeCheck;
+    timings.nForks = nTimeForks;
+    timings.nConnect = nTimeConnect;
+    timings.nVerify = nTimeVerify;
+    timings.nPayeeAndSpecial = nTimePayeeAndSpecial;
+    timings.nIndex = nTimeIndex;
+    timings.nCallbacks = nTimeCallbacks;
+    timings.nConnectTotal = nTimeConnectTotal;
+    timings.nFlush = nTimeFlush;
+    timings.nChainState = nTimeChainState;
+    timings.nPostConnect = nTimePostConnect;
+    timings.nTotal = nTimeTotal;
+    return timings;
+}
+
 bool DisconnectBlocks(int blocks)
 {
     LOCK(cs_main);
@@ -2687,11 +2793,14 @@ bool DisconnectBlocks(int blocks)
     const CChainParams& chainparams = Params();
 
     LogPrintf("DisconnectBlocks -- Got command to replay %d blocks\n", blocks);
+    DisconnectedBlockTransactions disconnectpool;
     for(int i = 0; i < blocks; i++) {
-        if(!DisconnectTip(state, chainparams) || !state.IsValid()) {
+        if(!DisconnectTip(state, chainparams, &disconnectpool) || !state.IsValid()) {
+            UpdateMempoolForReorg(disconnectpool, false);
             return false;
         }
     }
+    UpdateMempoolForReorg(disconnectpool, true);
 
     return true;
 }
@@ -2804,9 +2913,14 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
 
     // Disconnect active blocks which are no longer in the best chain.
     bool fBlocksDisconnected = false;
+    DisconnectedBlockTransactions disconnectpool;
     while (chainActive.Tip() && chainActive.Tip() != pindexFork) {
-        if (!DisconnectTip(state, chainparams))
+        if (!DisconnectTip(state, chainparams, &disconnectpool)) {
+            // This is likely a fatal error, but keep the mempool consistent,
+            // just in case. Only remove from the mempool in this case.
+            UpdateMempoolForReorg(disconnectpool, false);
             return false;
+        }
         fBlocksDisconnected = true;
     }
 
@@ -2829,7 +2943,7 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
 
         // Connect new blocks.
         BOOST_REVERSE_FOREACH(CBlockIndex *pindexConnect, vpindexToConnect) {
-            if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace)) {
+            if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (!state.CorruptionPossible())
@@ -2842,6 +2956,9 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
                     break;
                 } else {
                     // A system error occurred (disk space, database error, ...).
+                    // Make the mempool consistent with the current tip, just in case
+                    // any observers try to use it before shutdown.
+                    UpdateMempoolForReorg(disconnectpool, false);
                     return false;
                 }
             } else {
@@ -2856,8 +2973,9 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
     }
 
     if (fBlocksDisconnected) {
-        mempool.removeForReorg(pcoinsTip, chainActive.Tip()->nHeight + 1, STANDARD_LOCKTIME_VERIFY_FLAGS);
-        LimitMempoolSize(mempool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+        // If any blocks were disconnected, disconnectpool may be non empty.  Add
+        // any disconnected transactions back to the mempool.
+        UpdateMempoolForReorg(disconnectpool, true);
     }
     mempool.check(pcoinsTip);
 
@@ -3023,6 +3141,7 @@ bool InvalidateBlock(CValidationState& state, const CChainParams& chainparams, C
         pindexBestHeader = pindexBestHeader->pprev;
     }
 
+    DisconnectedBlockTransactions disconnectpool;
     while (chainActive.Contains(pindex)) {
         CBlockIndex *pindexWalk = chainActive.Tip();
         pindexWalk->nStatus |= BLOCK_FAILED_CHILD;
@@ -3030,8 +3149,10 @@ bool InvalidateBlock(CValidationState& state, const CChainParams& chainparams, C
         setBlockIndexCandidates.erase(pindexWalk);
         // ActivateBestChain considers blocks already in chainActive
         // unconditionally valid already, so force disconnect away from it.
-        if (!DisconnectTip(state, chainparams)) {
-            mempool.removeForReorg(pcoinsTip, chainActive.Tip()->nHeight + 1, STANDARD_LOCKTIME_VERIFY_FLAGS);
+        if (!DisconnectTip(state, chainparams, &disconnectpool)) {
+            // It's probably hopeless to try to make the mempool consistent
+            // here if DisconnectTip failed, but we can try.
+            UpdateMempoolForReorg(disconnectpool, false);
             return false;
         }
         if (pindexWalk == pindexBestHeader) {
@@ -3040,7 +3161,9 @@ bool InvalidateBlock(CValidationState& state, const CChainParams& chainparams, C
         }
     }
 
-    LimitMempoolSize(mempool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+    // DisconnectTip will add transactions to disconnectpool; try to add these
+    // back to the mempool.
+    UpdateMempoolForReorg(disconnectpool, true);
 
     // The resulting new best tip may not be in setBlockIndexCandidates anymore, so
     // add it again.
@@ -3053,7 +3176,6 @@ bool InvalidateBlock(CValidationState& state, const CChainParams& chainparams, C
     }
 
     InvalidChainFound(pindex);
-    mempool.removeForReorg(pcoinsTip, chainActive.Tip()->nHeight + 1, STANDARD_LOCKTIME_VERIFY_FLAGS);
     GetMainSignals().UpdatedBlockTip(chainActive.Tip(), NULL, IsInitialBlockDownload());
     uiInterface.NotifyBlockTip(IsInitialBlockDownload(), pindex->pprev);
     return true;
@@ -3092,17 +3214,16 @@ bool ResetBlockFailureFlags(CBlockIndex *pindex) {
     return true;
 }
 
-CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256& hash)
 {
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end())
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
+    *pindexNew = CBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3127,6 +3248,11 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     return pindexNew;
 }
 
+CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
+{
+    return AddToBlockIndex(block, block.GetHash());
+}
+
 /** Mark a block as having its data received and checked (up to BLOCK_VALID_TRANSACTIONS). */
 bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBlockIndex *pindexNew, const CDiskBlockPos& pos)
 {
@@ -3453,8 +3579,15 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, const Co
 static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
 {
     AssertLockHeld(cs_main);
+    // Headers below the height of the trusted header table don't need their yespower hash computed here,
+    // the table entries are verified in the background.
+    uint256 hash;
+    int nTrustedHeight = -1;
+    bool fTrusted = trustedHeaders.GetTrustedHash(block, hash, nTrustedHeight);
+    if (!fTrusted)
+        hash = block.GetHash();
+
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
 
@@ -3471,8 +3604,14 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (fTrusted) {
+            if (!CheckProofOfWork(hash, block.nBits, chainparams.GetConsensus()))
+                return state.DoS(50, error("%s: trusted header %s: proof of work failed", __func__, hash.ToString()), REJECT_INVALID, "high-hash");
+            if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), false))
+                return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
+        } else if (!CheckBlockHeader(block, state, chainparams.GetConsensus())) {
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
+        }
 
         // Get prev block index
         CBlockIndex* pindexPrev = NULL;
@@ -3482,6 +3621,8 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
         pindexPrev = (*mi).second;
         if (pindexPrev->nStatus & BLOCK_FAILED_MASK)
             return state.DoS(100, error("%s: prev block invalid", __func__), REJECT_INVALID, "bad-prevblk");
+        if (fTrusted && pindexPrev->nHeight + 1 != nTrustedHeight)
+            return state.DoS(100, error("%s: trusted header %s at wrong height %d", __func__, hash.ToString(), pindexPrev->nHeight + 1), REJECT_INVALID, "bad-trusted-height");
 
         assert(pindexPrev);
         if (fCheckpointsEnabled && !CheckIndexAgainstCheckpoint(pindexPrev, state, chainparams, hash))
@@ -3491,7 +3632,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return error("%s: Consensus::ContextualCheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
     }
     if (pindex == NULL)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, hash);
 
     if (ppindex)
         *ppindex = pindex;
@@ -3857,9 +3998,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw std::runtime_error(std::string(__func__) + ": new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -3868,23 +4007,32 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
 
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
+    int64_t nTimeStart = GetTimeMicros();
     if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
         return false;
+    int64_t nTimeGuts = GetTimeMicros();
 
     boost::this_thread::interruption_point();
 
     // Calculate nChainWork
-    std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
-    vSortedByHeight.reserve(mapBlockIndex.size());
-    BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
-    {
-        CBlockIndex* pindex = item.second;
-        vSortedByHeight.push_back(std::make_pair(pindex->nHeight, pindex));
+    // Heights are dense, so a counting sort is enough to order all entries by height
+    int nMaxHeight = 0;
+    for (const auto& item : mapBlockIndex) {
+        nMaxHeight = std::max(nMaxHeight, item.second->nHeight);
     }
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
-    BOOST_FOREACH(const PAIRTYPE(int, CBlockIndex*)& item, vSortedByHeight)
+    std::vector<size_t> vHeightOffsets(nMaxHeight + 2, 0);
+    for (const auto& item : mapBlockIndex) {
+        vHeightOffsets[item.second->nHeight + 1]++;
+    }
+    for (size_t i = 1; i < vHeightOffsets.size(); i++) {
+        vHeightOffsets[i] += vHeightOffsets[i - 1];
+    }
+    std::vector<CBlockIndex*> vSortedByHeight(mapBlockIndex.size());
+    for (const auto& item : mapBlockIndex) {
+        vSortedByHeight[vHeightOffsets[item.second->nHeight]++] = item.second;
+    }
+    for (CBlockIndex* pindex : vSortedByHeight)
     {
-        CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
         pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
         // We can link the chain of blocks for which we've received transactions at some point.
@@ -3910,6 +4058,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == NULL || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
     }
+    int64_t nTimeChainWork = GetTimeMicros();
+    LogPrintf("%s: loaded %u block index entries (%.1fMiB) in %.2fms (db scan %.2fms, chain work %.2fms)\n", __func__,
+              mapBlockIndex.size(), blockIndexArena.DynamicMemoryUsage() * (1.0 / (1 << 20)),
+              (nTimeChainWork - nTimeStart) * 0.001, (nTimeGuts - nTimeStart) * 0.001, (nTimeChainWork - nTimeGuts) * 0.001);
 
     // Load block file info
     pblocktree->ReadLastBlockFile(nLastBlockFile);
@@ -4118,10 +4270,8 @@ void UnloadBlockIndex()
         warningcache[b].clear();
     }
 
-    BOOST_FOREACH(BlockMap::value_type& entry, mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
     fHavePruned = false;
 }
 
@@ -4521,7 +4671,37 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
     return VersionBitsStateSinceHeight(chainActive.Tip(), params, pos, versionbitscache);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+/**
+ * Version 2 adds the tip the mempool was validated against, the script flags it was validated with,
+ * the fee of every entry and a hash of the whole file. When the tip and the flags are unchanged at
+ * startup and the hash matches, the entries skip their script checks.
+ */
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+static const uint64_t MEMPOOL_DUMP_VERSION_NO_TIP = 1;
+
+/** Check the hash at the end of mempool.dat before any of its entries is accepted */
+static bool CheckMempoolFileHash(FILE* filestr)
+{
+    bool fOk = false;
+    if (fseek(filestr, 0, SEEK_END) == 0) {
+        long nSize = ftell(filestr);
+        if (nSize >= (long)sizeof(uint256) && fseek(filestr, 0, SEEK_SET) == 0) {
+            CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+            std::vector<char> vBuf(1 << 16);
+            long nLeft = nSize - sizeof(uint256);
+            while (nLeft > 0) {
+                size_t nRead = fread(vBuf.data(), 1, std::min<long>(nLeft, vBuf.size()), filestr);
+                if (nRead == 0)
+                    break;
+                hasher.write(vBuf.data(), nRead);
+                nLeft -= nRead;
+            }
+            uint256 hashFile;
+            fOk = nLeft == 0 && fread(hashFile.begin(), 1, sizeof(hashFile), filestr) == sizeof(hashFile) && hasher.GetHash() == hashFile;
+        }
+    }
+    return fseek(filestr, 0, SEEK_SET) == 0 && fOk;
+}
 
 bool LoadMempool(void)
 {
@@ -4537,13 +4717,28 @@ bool LoadMempool(void)
     int64_t skipped = 0;
     int64_t failed = 0;
     int64_t nNow = GetTime();
+    int64_t nStart = GetTimeMicros();
+    int64_t fast = 0;
+    uint256 hashTip;
+    bool fFileHashOk = CheckMempoolFileHash(file.Get());
 
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_NO_TIP) {
             return false;
         }
+        if (version == MEMPOOL_DUMP_VERSION) {
+            uint32_t nScriptFlags;
+            file >> hashTip;
+            file >> nScriptFlags;
+            // neither the tip nor the fee covers the scripts themselves, so only trust an intact
+            // file that was checked with the flags we'd check with now
+            if (!fFileHashOk || nScriptFlags != STANDARD_SCRIPT_VERIFY_FLAGS) {
+                LogPrintf("Mempool file %s, verifying all scripts\n", fFileHashOk ? "was checked with other script flags" : "hash mismatch");
+                hashTip.SetNull();
+            }
+        }
         uint64_t num;
         file >> num;
         double prioritydummy = 0;
@@ -4551,9 +4746,13 @@ bool LoadMempool(void)
             CTransactionRef tx;
             int64_t nTime;
             int64_t nFeeDelta;
+            CAmount nFee = -1;
             file >> tx;
             file >> nTime;
             file >> nFeeDelta;
+            if (version == MEMPOOL_DUMP_VERSION) {
+                file >> nFee;
+            }
 
             CAmount amountdelta = nFeeDelta;
             if (amountdelta) {
@@ -4562,9 +4761,13 @@ bool LoadMempool(void)
             CValidationState state;
             if (nTime + nExpiryTimeout > nNow) {
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(mempool, state, tx, true, NULL, nTime);
+                // checked for every entry as blocks may be connected while loading
+                bool fSameTip = !hashTip.IsNull() && chainActive.Tip() && chainActive.Tip()->GetBlockHash() == hashTip;
+                AcceptToMemoryPoolWithTime(mempool, state, tx, true, NULL, nTime, false, 0, false, fSameTip ? nFee : -1);
                 if (state.IsValid()) {
                     ++count;
+                    if (fSameTip)
+                        ++fast;
                 } else {
                     ++failed;
                 }
@@ -4585,7 +4788,8 @@ bool LoadMempool(void)
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i successes, %i failed, %i expired\n", count, failed, skipped);
+    LogPrintf("Imported mempool transactions from disk: %i successes (%i at the tip they were validated at), %i failed, %i expired in %.2fs\n",
+              count, fast, failed, skipped, (GetTimeMicros() - nStart) * 0.000001);
     return true;
 }
 
@@ -4595,9 +4799,12 @@ void DumpMempool(void)
 
     std::map<uint256, CAmount> mapDeltas;
     std::vector<TxMempoolInfo> vinfo;
+    uint256 hashTip;
 
     {
-        LOCK(mempool.cs);
+        LOCK2(cs_main, mempool.cs);
+        if (chainActive.Tip())
+            hashTip = chainActive.Tip()->GetBlockHash();
         for (const auto &i : mempool.mapDeltas) {
             mapDeltas[i.first] = i.second.second;
         }
@@ -4613,19 +4820,29 @@ void DumpMempool(void)
         }
 
         CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        // everything written is hashed too, the hash is appended at the end
+        CHashWriter hasher(SER_DISK, CLIENT_VERSION);
+        auto write = [&file, &hasher](const auto& obj) {
+            file << obj;
+            hasher << obj;
+        };
 
         uint64_t version = MEMPOOL_DUMP_VERSION;
-        file << version;
+        write(version);
+        write(hashTip);
+        write((uint32_t)STANDARD_SCRIPT_VERIFY_FLAGS);
 
-        file << (uint64_t)vinfo.size();
+        write((uint64_t)vinfo.size());
         for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
+            write(*(i.tx));
+            write((int64_t)i.nTime);
+            write((int64_t)i.nFeeDelta);
+            write(i.nFee);
             mapDeltas.erase(i.tx->GetHash());
         }
 
-        file << mapDeltas;
+        write(mapDeltas);
+        file << hasher.GetHash();
         FileCommit(file.Get());
         file.fclose();
         RenameOver(GetDataDir() / "mempool.dat.new", GetDataDir() / "mempool.dat");
@@ -4636,6 +4853,110 @@ void DumpMempool(void)
     }
 }
 
+static const uint64_t COINS_CACHE_DUMP_VERSION = 1;
+
+bool LoadCoinsCache(void)
+{
+    FILE* filestr = fopen((GetDataDir() / "coinscache.dat").string().c_str(), "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open coins cache file from disk. Continuing anyway.\n");
+        return false;
+    }
+
+    int64_t nStart = GetTimeMicros();
+    std::vector<COutPoint> vOutpoints;
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != COINS_CACHE_DUMP_VERSION) {
+            return false;
+        }
+        file >> vOutpoints;
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize coins cache data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+    file.fclose();
+
+    // The outpoints were dumped sorted by txid, so the seeks of a batch mostly move forward
+    // through the database. Batches are read without holding cs_main and only added to the cache when the
+    // database is still at the state they were read from: an outpoint not held by the cache has
+    // the same coin in the cache and in the database, so adding it changes no result.
+    int64_t nLoaded = 0;
+    int64_t nSkipped = 0;
+    bool fFull = false;
+    for (size_t nBatchStart = 0; nBatchStart < vOutpoints.size() && !fFull; nBatchStart += COINS_CACHE_LOAD_BATCH) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested())
+            return false;
+
+        std::vector<COutPoint> vBatch(vOutpoints.begin() + nBatchStart,
+                                      vOutpoints.begin() + std::min(nBatchStart + COINS_CACHE_LOAD_BATCH, vOutpoints.size()));
+        std::vector<std::pair<COutPoint, Coin> > vCoins;
+        vCoins.reserve(vBatch.size());
+        uint256 hashBlock = pcoinsdbview->GetCoinsSorted(vBatch, vCoins);
+
+        LOCK(cs_main);
+        if (pcoinsdbview->GetBestBlock() != hashBlock) {
+            nSkipped += vBatch.size();
+            continue;
+        }
+        for (auto& coin : vCoins) {
+            if (pcoinsTip->DynamicMemoryUsage() >= nCoinCacheUsage / 2) {
+                fFull = true;
+                break;
+            }
+            if (pcoinsTip->Prefetch(coin.first, std::move(coin.second)))
+                ++nLoaded;
+        }
+    }
+
+    LogPrintf("Prefetched coins into the cache: %i loaded, %i skipped of %u saved%s in %.2fs\n",
+              nLoaded, nSkipped, vOutpoints.size(), fFull ? " (cache full)" : "", (GetTimeMicros() - nStart) * 0.000001);
+    return true;
+}
+
+void DumpCoinsCache(void)
+{
+    int64_t start = GetTimeMicros();
+
+    std::vector<COutPoint> vOutpoints;
+    {
+        LOCK(cs_main);
+        if (pcoinsTip == NULL)
+            return;
+        pcoinsTip->GetCachedOutpoints(vOutpoints, MAX_COINS_CACHE_DUMP);
+    }
+    // Sort by txid, then index. This is close to the order of the database keys but not the same:
+    // the index is stored as a VARINT, which doesn't sort numerically from 128 on. The order only
+    // helps the locality of the seeks when loading, every outpoint is still looked up on its own.
+    std::sort(vOutpoints.begin(), vOutpoints.end());
+
+    int64_t mid = GetTimeMicros();
+
+    try {
+        FILE* filestr = fopen((GetDataDir() / "coinscache.dat.new").string().c_str(), "wb");
+        if (!filestr) {
+            return;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+
+        uint64_t version = COINS_CACHE_DUMP_VERSION;
+        file << version;
+        file << vOutpoints;
+
+        FileCommit(file.Get());
+        file.fclose();
+        RenameOver(GetDataDir() / "coinscache.dat.new", GetDataDir() / "coinscache.dat");
+        int64_t last = GetTimeMicros();
+        LogPrintf("Dumped %u coins cache outpoints: %gs to copy, %gs to dump\n", vOutpoints.size(), (mid-start)*0.000001, (last-mid)*0.000001);
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump coins cache: %s. Continuing anyway.\n", e.what());
+    }
+}
+
 //! Guess how far we are in the verification process at the given block index
 double GuessVerificationProgress(const ChainTxData& data, CBlockIndex *pindex) {
     if (pindex == NULL)
@@ -4660,9 +4981,7 @@ public:
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
     }
 } instance_of_cmaincleanup;
@@ -82,6 +82,8 @@ static const unsigned int DEFAULT_DESCENDANT_LIMIT = 25;
 static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 101;
 /** Default for -mempoolexpiry, expiration time for mempool transactions in hours */
 static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 336;
+/** Maximum kilobytes for transactions to store for processing during reorg */
+static const unsigned int MAX_DISCONNECTED_TX_POOL_SIZE = 20000;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
@@ -93,8 +95,13 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
-/** Number of blocks that can be requested at any given time from a single peer. */
+/** Number of blocks that can be requested at any given time from a single peer, until its download speed is known. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Bounds of the per-peer limit of blocks in transit once it is adapted to the measured download speed. */
+static const int MIN_BLOCKS_IN_TRANSIT_PER_PEER = 2;
+static const int MAX_BLOCKS_IN_TRANSIT_PER_FAST_PEER = 64;
+/** Time in microseconds worth of block downloads to keep requested from each peer. */
+static const int64_t BLOCK_DOWNLOAD_QUEUE_TIME = 2 * 1000000;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
@@ -108,7 +115,7 @@ static const int MAX_BLOCKTXN_DEPTH = 10;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
- *  harder). We'll probably want to make this a per-peer adaptive value at some point. */
+ *  harder). A block holding back the window is requested again from a faster peer. */
 static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 /** Time to wait (in seconds) between writing blocks/block index to disk. */
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
@@ -143,6 +150,7 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const unsigned int DEFAULT_BYTES_PER_SIGOP = 20;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
+static const bool DEFAULT_CHEAP_BLOCK_HASH = false;
 static const bool DEFAULT_TXINDEX = true;
 static const bool DEFAULT_ADDRESSINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
@@ -182,6 +190,12 @@ extern unsigned int nBytesPerSigOp;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
 extern size_t nCoinCacheUsage;
+/** Default for -persistcoinscache */
+static const bool DEFAULT_PERSIST_COINS_CACHE = true;
+/** Most outpoints saved by DumpCoinsCache */
+static const uint64_t MAX_COINS_CACHE_DUMP = 1000000;
+/** Outpoints read from the coins database at a time by LoadCoinsCache */
+static const size_t COINS_CACHE_LOAD_BATCH = 1000;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
 /** Absolute maximum transaction fee  used by wallet and mempool (rejects high fee in sendrawtransaction) */
@@ -336,6 +350,12 @@ CBlockIndex * InsertBlockIndex(uint256 hash);
 void FlushStateToDisk();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
+/**
+ * Memory the UTXO cache counts against nCoinCacheUsage, scaled by DB_PEAK_USAGE_FACTOR like
+ * FlushStateToDisk does. It's the peak since the last call if the cache was flushed in between.
+ * Requires cs_main.
+ */
+size_t GetCoinsCacheUsage();
 /** Prune block files up to a given height */
 void PruneBlockFilesManual(int nPruneUpToHeight);
 
@@ -344,10 +364,14 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                         bool* pfMissingInputs, bool fOverrideMempoolLimit=false,
                         const CAmount nAbsurdFee=0, bool fDryRun=false);
 
-/** (try to) add transaction to memory pool with a specified acceptance time **/
+/**
+ * (try to) add transaction to memory pool with a specified acceptance time.
+ * nValidatedFee is the fee the transaction paid when its scripts were last verified against the
+ * current tip, if its inputs still add up to that fee the script checks are skipped.
+ */
 bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool fLimitFree,
                                 bool* pfMissingInputs, int64_t nAcceptTime, bool fOverrideMempoolLimit=false, 
-                                const CAmount nAbsurdFee=0, bool fDryRun=false);
+                                const CAmount nAbsurdFee=0, bool fDryRun=false, const CAmount nValidatedFee=-1);
 
 bool GetUTXOCoin(const COutPoint& outpoint, Coin& coin);
 int GetUTXOHeight(const COutPoint& outpoint);
@@ -498,6 +522,31 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 bool DisconnectBlocks(int blocks);
 void ReprocessBlocks(int nBlocks);
 
+/**
+ * Connect the block following chainActive.Tip() on the way to pindexTarget without going through
+ * ActivateBestChain(). Used to replay blocks for benchmarking, requires cs_main.
+ */
+bool ConnectNextBlock(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexTarget);
+
+/** Cumulative time in microseconds spent in the stages of connecting blocks to the active chain */
+struct CBlockConnectTimings
+{
+    int64_t nReadFromDisk;
+    int64_t nCheck;
+    int64_t nForks;
+    int64_t nConnect;
+    int64_t nVerify;
+    int64_t nPayeeAndSpecial;
+    int64_t nIndex;
+    int64_t nCallbacks;
+    int64_t nConnectTotal;
+    int64_t nFlush;
+    int64_t nChainState;
+    int64_t nPostConnect;
+    int64_t nTotal;
+};
+CBlockConnectTimings GetBlockConnectTimings();
+
 /** Context-independent validity checks */
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true);
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
@@ -584,4 +633,10 @@ void DumpMempool();
 /** Load the mempool from disk. */
 bool LoadMempool();
 
+/** Dump the outpoints held by the coins cache to disk. */
+void DumpCoinsCache();
+
+/** Prefetch the coins dumped by DumpCoinsCache into the coins cache. */
+bool LoadCoinsCache();
+
 #endif // BITCOIN_VALIDATION_H
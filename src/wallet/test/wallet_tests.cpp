@@ -4,6 +4,7 @@
 
 #include "wallet/wallet.h"
 
+#include <algorithm>
 #include <set>
 #include <stdint.h>
 #include <utility>
@@ -361,6 +362,75 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(bnb_search_test)
+{
+    std::vector<char> vfSelected;
+    CAmount nSelected;
+
+    // Exact match
+    std::vector<CAmount> vValues = {1 * CENT, 2 * CENT, 3 * CENT, 4 * CENT};
+    BOOST_CHECK(SelectCoinsBnB(vValues, 5 * CENT, 0, vfSelected, nSelected));
+    BOOST_CHECK_EQUAL(nSelected, 5 * CENT);
+    BOOST_CHECK_EQUAL(vfSelected.size(), vValues.size());
+    BOOST_CHECK_EQUAL(std::count(vfSelected.begin(), vfSelected.end(), true), 2);
+
+    // Excess up to the cost of change is accepted
+    BOOST_CHECK(SelectCoinsBnB(vValues, 10 * CENT - 500, 1000, vfSelected, nSelected));
+    BOOST_CHECK_EQUAL(nSelected, 10 * CENT);
+    BOOST_CHECK(!SelectCoinsBnB(vValues, 10 * CENT - 500, 499, vfSelected, nSelected));
+
+    // Nothing within the window, or not enough funds at all
+    vValues = {1 * CENT, 2 * CENT, 4 * CENT};
+    BOOST_CHECK(!SelectCoinsBnB(vValues, 3 * CENT + CENT / 2, CENT / 4, vfSelected, nSelected));
+    BOOST_CHECK(!SelectCoinsBnB(vValues, 8 * CENT, CENT, vfSelected, nSelected));
+
+    // The solution with the smallest excess wins
+    vValues = {5 * CENT + 300, 5 * CENT + 100, 5 * CENT + 200};
+    BOOST_CHECK(SelectCoinsBnB(vValues, 5 * CENT, 1000, vfSelected, nSelected));
+    BOOST_CHECK_EQUAL(nSelected, 5 * CENT + 100);
+    BOOST_CHECK(vfSelected[1] && !vfSelected[0] && !vfSelected[2]);
+
+    // Coins worth less than the fee to spend them are never selected
+    vValues = {-100, 0, 5 * CENT};
+    BOOST_CHECK(SelectCoinsBnB(vValues, 5 * CENT, 0, vfSelected, nSelected));
+    BOOST_CHECK(!vfSelected[0] && !vfSelected[1] && vfSelected[2]);
+
+    // Many equal coins don't blow up the search, the budget bounds it otherwise
+    vValues.assign(1000, 2 * CENT);
+    BOOST_CHECK(!SelectCoinsBnB(vValues, 3 * CENT, 0, vfSelected, nSelected));
+    BOOST_CHECK(SelectCoinsBnB(vValues, 300 * CENT, 0, vfSelected, nSelected));
+    BOOST_CHECK_EQUAL(std::count(vfSelected.begin(), vfSelected.end(), true), 150);
+    vValues = {4 * CENT, 3 * CENT, 2 * CENT};
+    BOOST_CHECK(!SelectCoinsBnB(vValues, 5 * CENT, 0, vfSelected, nSelected, 2));
+    BOOST_CHECK(SelectCoinsBnB(vValues, 5 * CENT, 0, vfSelected, nSelected));
+
+    // Through the wallet: the target is compared to the values minus the input fee
+    CoinSet setCoinsRet;
+    CAmount nValueRet;
+    CoinSelectionParams params;
+    params.fUseBnB = true;
+    params.nInputFee = 100;
+    params.nCostOfChange = 300;
+
+    LOCK(wallet.cs_wallet);
+    empty_wallet();
+    add_coin(1 * CENT);
+    add_coin(2 * CENT);
+    add_coin(5 * CENT);
+    add_coin(10 * CENT);
+
+    BOOST_CHECK(wallet.SelectCoinsMinConf(7 * CENT - 200, 1, 6, 0, vCoins, setCoinsRet, nValueRet, ALL_COINS, false, &params));
+    BOOST_CHECK_EQUAL(nValueRet, 7 * CENT);
+    BOOST_CHECK_EQUAL(setCoinsRet.size(), 2U);
+    BOOST_CHECK(wallet.SelectCoinsMinConf(7 * CENT - 500, 1, 6, 0, vCoins, setCoinsRet, nValueRet, ALL_COINS, false, &params));
+    BOOST_CHECK_EQUAL(nValueRet, 7 * CENT);
+    // 4 cents would need change, the knapsack is left to deal with that
+    BOOST_CHECK(!wallet.SelectCoinsMinConf(4 * CENT, 1, 6, 0, vCoins, setCoinsRet, nValueRet, ALL_COINS, false, &params));
+    BOOST_CHECK(wallet.SelectCoinsMinConf(4 * CENT, 1, 6, 0, vCoins, setCoinsRet, nValueRet));
+
+    empty_wallet();
+}
+
 BOOST_FIXTURE_TEST_CASE(rescan, TestChain100Setup)
 {
     LOCK(cs_main);
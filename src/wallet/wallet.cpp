@@ -13,6 +13,7 @@
 #include "wallet/coincontrol.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
+#include "eventnotifier.h"
 #include "key.h"
 #include "keystore.h"
 #include "validation.h"
@@ -38,7 +39,6 @@
 
 #include <assert.h>
 
-#include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 
@@ -1173,14 +1173,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
-    // notify an external script when a wallet transaction comes in or is updated
-    std::string strCmd = GetArg("-walletnotify", "");
-
-    if ( !strCmd.empty())
-    {
-        boost::replace_all(strCmd, "%s", wtxIn.GetHash().GetHex());
-        boost::thread t(runCommand, strCmd); // thread runs free
-    }
+    // notify an external script or the event sink when a wallet transaction comes in or is updated
+    eventNotifier.Notify(CEventNotifier::EVENT_WALLETTX, wtxIn.GetHash());
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
@@ -2690,6 +2684,88 @@ static void ApproximateBestSubset(std::vector<std::pair<CAmount, std::pair<const
     }
 }
 
+bool SelectCoinsBnB(const std::vector<CAmount>& vEffectiveValues, const CAmount& nTarget, const CAmount& nCostOfChange,
+                    std::vector<char>& vfSelected, CAmount& nSelectedRet, size_t nMaxTries)
+{
+    vfSelected.assign(vEffectiveValues.size(), false);
+    nSelectedRet = 0;
+    if (nTarget <= 0)
+        return false;
+
+    // Coins that cost more to spend than they are worth are never useful
+    std::vector<size_t> vOrder;
+    CAmount nAvailable = 0;
+    for (size_t i = 0; i < vEffectiveValues.size(); i++) {
+        if (vEffectiveValues[i] > 0) {
+            vOrder.push_back(i);
+            nAvailable += vEffectiveValues[i];
+        }
+    }
+    if (nAvailable < nTarget)
+        return false;
+
+    // Largest coins first, so that the search reaches the target early and starts pruning
+    std::sort(vOrder.begin(), vOrder.end(), [&vEffectiveValues](size_t a, size_t b) {
+        return vEffectiveValues[a] > vEffectiveValues[b];
+    });
+
+    // vInclude[d] is whether the coin vOrder[d] is part of the current branch, nAvailable is
+    // the sum of the coins not decided yet
+    std::vector<char> vInclude;
+    std::vector<char> vBest;
+    CAmount nValue = 0;
+    CAmount nBestExcess = nCostOfChange + 1;
+
+    for (size_t nTries = 0; nTries < nMaxTries; nTries++) {
+        bool fBacktrack = false;
+        if (nValue + nAvailable < nTarget || nValue - nTarget >= nBestExcess) {
+            // can't reach the target anymore or can't improve on the best solution
+            fBacktrack = true;
+        } else if (nValue >= nTarget) {
+            // more coins would only add to the excess
+            nBestExcess = nValue - nTarget;
+            vBest = vInclude;
+            if (nBestExcess == 0)
+                break;
+            fBacktrack = true;
+        }
+
+        if (fBacktrack) {
+            // Walk back to the last included coin and explore the branch without it
+            while (!vInclude.empty() && !vInclude.back()) {
+                vInclude.pop_back();
+                nAvailable += vEffectiveValues[vOrder[vInclude.size()]];
+            }
+            if (vInclude.empty())
+                break; // exhausted the search space
+            vInclude.back() = false;
+            nValue -= vEffectiveValues[vOrder[vInclude.size() - 1]];
+        } else {
+            const CAmount nCoin = vEffectiveValues[vOrder[vInclude.size()]];
+            nAvailable -= nCoin;
+            // Including a coin right after excluding one of the same value gives the same sums as
+            // the branch that included the previous one, which was searched already
+            if (!vInclude.empty() && !vInclude.back() && nCoin == vEffectiveValues[vOrder[vInclude.size() - 1]]) {
+                vInclude.push_back(false);
+            } else {
+                vInclude.push_back(true);
+                nValue += nCoin;
+            }
+        }
+    }
+
+    if (nBestExcess > nCostOfChange)
+        return false;
+
+    for (size_t d = 0; d < vBest.size(); d++) {
+        if (vBest[d]) {
+            vfSelected[vOrder[d]] = true;
+            nSelectedRet += vEffectiveValues[vOrder[d]];
+        }
+    }
+    return true;
+}
+
 struct CompareByPriority
 {
     bool operator()(const COutput& t1,
@@ -2716,11 +2792,62 @@ bool less_then_denom (const COutput& out1, const COutput& out2)
 }
 
 bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMine, const int nConfTheirs, const uint64_t nMaxAncestors, std::vector<COutput> vCoins,
-                                 std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType, bool fUseInstantSend) const
+                                 std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType, bool fUseInstantSend,
+                                 const CoinSelectionParams* pParams) const
 {
     setCoinsRet.clear();
     nValueRet = 0;
 
+    if (pParams && pParams->fUseBnB && nCoinType != ONLY_DENOMINATED) {
+        std::vector<const COutput*> vCandidates;
+        std::vector<bool> vfDenominated;
+        bool fHaveDenominated = false;
+        BOOST_FOREACH(const COutput &output, vCoins)
+        {
+            if (!output.fSpendable)
+                continue;
+
+            const CWalletTx *pcoin = output.tx;
+            if (output.nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs))
+                continue;
+
+            if (!mempool.TransactionWithinChainLimit(pcoin->GetHash(), nMaxAncestors))
+                continue;
+
+            vCandidates.push_back(&output);
+            vfDenominated.push_back(CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[output.i].nValue));
+            fHaveDenominated |= vfDenominated.back();
+        }
+
+        // try to find nondenom first to prevent unneeded spending of mixed coins
+        for (int tryDenom = 0; tryDenom < (fHaveDenominated ? 2 : 1); tryDenom++)
+        {
+            std::vector<CAmount> vEffectiveValues(vCandidates.size());
+            for (size_t i = 0; i < vCandidates.size(); i++) {
+                if (tryDenom == 0 && vfDenominated[i])
+                    vEffectiveValues[i] = 0; // skipped by SelectCoinsBnB
+                else
+                    vEffectiveValues[i] = vCandidates[i]->tx->tx->vout[vCandidates[i]->i].nValue - pParams->nInputFee;
+            }
+
+            std::vector<char> vfSelected;
+            CAmount nEffectiveValue;
+            if (!SelectCoinsBnB(vEffectiveValues, nTargetValue, pParams->nCostOfChange, vfSelected, nEffectiveValue))
+                continue;
+
+            for (size_t i = 0; i < vCandidates.size(); i++) {
+                if (vfSelected[i]) {
+                    setCoinsRet.insert(std::make_pair(vCandidates[i]->tx, vCandidates[i]->i));
+                    nValueRet += vCandidates[i]->tx->tx->vout[vCandidates[i]->i].nValue;
+                }
+            }
+            LogPrint("selectcoins", "CWallet::SelectCoinsMinConf branch and bound: %d inputs, total %s, excess %s\n",
+                     setCoinsRet.size(), FormatMoney(nValueRet), FormatMoney(nEffectiveValue - nTargetValue));
+            return true;
+        }
+        return false;
+    }
+
     // List of values less than target
     std::pair<CAmount, std::pair<const CWalletTx*,unsigned int> > coinLowestLarger;
     coinLowestLarger.first = fUseInstantSend
@@ -2868,8 +2995,11 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, const int nConfMin
     return nCoinType == ONLY_DENOMINATED ? (nValueRet - nTargetValue <= maxTxFee) : true;
 }
 
-bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl, AvailableCoinsType nCoinType, bool fUseInstantSend) const
+bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl* coinControl, AvailableCoinsType nCoinType, bool fUseInstantSend, const CoinSelectionParams* pParams, bool* pfBnBUsed) const
 {
+    if (pfBnBUsed)
+        *pfBnBUsed = false;
+
     // Note: this function should never be used for "always free" tx types like dstx
 
     std::vector<COutput> vCoins(vAvailableCoins);
@@ -2940,14 +3070,24 @@ bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAm
     size_t nMaxChainLength = std::min(GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT), GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT));
     bool fRejectLongChains = GetBoolArg("-walletrejectlongchains", DEFAULT_WALLET_REJECT_LONG_CHAINS);
 
+    // A changeless selection is preferred, but not over coins with more confirmations
+    auto selectMinConf = [&](int nConfMine, int nConfTheirs, uint64_t nMaxAncestors) {
+        if (pParams && pParams->fUseBnB && SelectCoinsMinConf(pParams->nTarget - nValueFromPresetInputs, nConfMine, nConfTheirs, nMaxAncestors, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend, pParams)) {
+            if (pfBnBUsed)
+                *pfBnBUsed = true;
+            return true;
+        }
+        return SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, nConfMine, nConfTheirs, nMaxAncestors, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend);
+    };
+
     bool res = nTargetValue <= nValueFromPresetInputs ||
-        SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 6, 0, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend) ||
-        SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 1, 1, 0, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend) ||
-        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, 2, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend)) ||
-        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, std::min((size_t)4, nMaxChainLength/3), vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend)) ||
-        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, nMaxChainLength/2, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend)) ||
-        (bSpendZeroConfChange && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, nMaxChainLength, vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend)) ||
-        (bSpendZeroConfChange && !fRejectLongChains && SelectCoinsMinConf(nTargetValue - nValueFromPresetInputs, 0, 1, std::numeric_limits<uint64_t>::max(), vCoins, setCoinsRet, nValueRet, nCoinType, fUseInstantSend));
+        selectMinConf(1, 6, 0) ||
+        selectMinConf(1, 1, 0) ||
+        (bSpendZeroConfChange && selectMinConf(0, 1, 2)) ||
+        (bSpendZeroConfChange && selectMinConf(0, 1, std::min((size_t)4, nMaxChainLength/3))) ||
+        (bSpendZeroConfChange && selectMinConf(0, 1, nMaxChainLength/2)) ||
+        (bSpendZeroConfChange && selectMinConf(0, 1, nMaxChainLength)) ||
+        (bSpendZeroConfChange && !fRejectLongChains && selectMinConf(0, 1, std::numeric_limits<uint64_t>::max()));
 
     // because SelectCoinsMinConf clears the setCoinsRet, we now add the possible inputs to the coinset
     setCoinsRet.insert(setPresetCoins.begin(), setPresetCoins.end());
@@ -3481,6 +3621,18 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
 
             nFeeRet = 0;
             if(nFeePay > 0) nFeeRet = nFeePay;
+
+            // First look for a selection that needs no change output, that saves the change output
+            // now and the input to spend it later. Without manually selected inputs only, as
+            // SelectCoins returns those no matter how much they exceed the target.
+            CoinSelectionParams bnbParams;
+            bnbParams.fUseBnB = nCoinType != ONLY_DENOMINATED && nSubtractFeeFromAmount == 0 && !fUseInstantSend &&
+                                !fSendFreeTransactions && !(coinControl && coinControl->HasSelected());
+            int nBnBConfirmTarget = (coinControl && coinControl->nConfirmTarget > 0) ? coinControl->nConfirmTarget : nTxConfirmTarget;
+            CFeeRate bnbFeeRate = (coinControl && coinControl->fOverrideFeeRate) ? coinControl->nFeeRate : CFeeRate(GetMinimumFee(1000, nBnBConfirmTarget, mempool));
+            bnbParams.nInputFee = bnbFeeRate.GetFee(P2PKH_INPUT_SIZE);
+            bnbParams.nCostOfChange = bnbFeeRate.GetFee(P2PKH_OUTPUT_SIZE) + bnbParams.nInputFee;
+
             // Start with no fee and loop until there is enough fee
             while (true)
             {
@@ -3529,7 +3681,23 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
                 // Choose coins to use
                 CAmount nValueIn = 0;
                 setCoins.clear();
-                if (!SelectCoins(vAvailableCoins, nValueToSelect, setCoins, nValueIn, coinControl, nCoinType, fUseInstantSend))
+                bool fBnBUsed = false;
+                if (bnbParams.fUseBnB)
+                {
+                    // The effective values of the coins already pay for their inputs, the target
+                    // only has to cover the outputs and the rest of the transaction
+                    unsigned int nBytesNoInputs = ::GetSerializeSize(txNew, SER_NETWORK, PROTOCOL_VERSION);
+                    if (nExtraPayloadSize != 0)
+                        nBytesNoInputs += GetSizeOfCompactSize(nExtraPayloadSize) + nExtraPayloadSize;
+                    bnbParams.nTarget = nValue + bnbFeeRate.GetFee(nBytesNoInputs);
+                }
+                bool fSelected = SelectCoins(vAvailableCoins, nValueToSelect, setCoins, nValueIn, coinControl, nCoinType, fUseInstantSend,
+                                             bnbParams.fUseBnB ? &bnbParams : NULL, &fBnBUsed);
+                if (!fBnBUsed) {
+                    // the knapsack was needed, keep using it for all further rounds
+                    bnbParams.fUseBnB = false;
+                }
+                if (!fSelected)
                 {
                     if (nCoinType == ONLY_NONDENOMINATED) {
                         strFailReason = _("Unable to locate enough PrivateSend non-denominated funds for this transaction.");
@@ -3565,7 +3733,11 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
                     dPriority += (double)nCredit * age;
                 }
 
-                const CAmount nChange = nValueIn - nValueToSelect;
+                if (fBnBUsed) {
+                    // no change output, the excess is less than the change would cost
+                    nFeeRet = nValueIn - nValue;
+                }
+                const CAmount nChange = fBnBUsed ? 0 : nValueIn - nValueToSelect;
                 CTxOut newTxOut;
 
                 if (nChange > 0)
@@ -3798,7 +3970,9 @@ bool CWallet::CreateTransaction(const std::vector<CRecipient>& vecSend, CWalletT
                     }
                 }
 
-                // Include more fee and try again.
+                // Include more fee and try again. A changeless selection that doesn't pay enough
+                // (e.g. for inputs larger than P2PKH) would be found again, use the knapsack instead.
+                bnbParams.fUseBnB = false;
                 nFeeRet = nFeeNeeded;
                 continue;
             }
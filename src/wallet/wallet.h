@@ -67,6 +67,11 @@ static const CAmount WALLET_INCREMENTAL_RELAY_FEE = 10;
 static const CAmount MIN_CHANGE = CENT;
 //! final minimum change amount after paying for fees
 static const CAmount MIN_FINAL_CHANGE = MIN_CHANGE/2;
+//! maximum number of steps of the branch and bound coin selection before falling back to the knapsack
+static const size_t BNB_MAX_TRIES = 100000;
+//! serialized size of a P2PKH input and output, used to estimate the fees of inputs and change
+static const unsigned int P2PKH_INPUT_SIZE = 148;
+static const unsigned int P2PKH_OUTPUT_SIZE = 34;
 //! Default for -spendzeroconfchange
 static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
 //! Default for -sendfreetransactions
@@ -518,8 +523,31 @@ public:
     std::string ToString() const;
 };
 
+/**
+ * Parameters for a changeless coin selection, see SelectCoinsBnB. The fees are computed
+ * by CreateTransaction for its current fee rate.
+ */
+struct CoinSelectionParams
+{
+    bool fUseBnB;
+    //! Fee to spend one input, the effective value of a coin is its value minus this fee
+    CAmount nInputFee;
+    //! Fee to create a change output and to spend it later, excess below this goes to the fee instead
+    CAmount nCostOfChange;
+    //! Target of the changeless selection, lower than the knapsack's as the inputs pay their own fee
+    CAmount nTarget;
+
+    CoinSelectionParams() : fUseBnB(false), nInputFee(0), nCostOfChange(0), nTarget(0) {}
+};
 
-
+/**
+ * Depth-first branch and bound search for a subset of vEffectiveValues whose sum is at least
+ * nTarget and at most nTarget + nCostOfChange, i.e. that doesn't need a change output.
+ * Of the solutions found in at most nMaxTries steps the one with the smallest excess is
+ * returned in vfSelected, false is returned if there is none.
+ */
+bool SelectCoinsBnB(const std::vector<CAmount>& vEffectiveValues, const CAmount& nTarget, const CAmount& nCostOfChange,
+                    std::vector<char>& vfSelected, CAmount& nSelectedRet, size_t nMaxTries = BNB_MAX_TRIES);
 
 /** Private key that includes an expiration date in case it never gets used. */
 class CWalletKey
@@ -643,9 +671,11 @@ private:
     /**
      * Select a set of coins such that nValueRet >= nTargetValue and at least
      * all coins from coinControl are selected; Never select unconfirmed coins
-     * if they are not ours
+     * if they are not ours. With pParams a changeless selection for pParams->nTarget
+     * is tried before the knapsack at every confirmation level, pfBnBUsed tells which
+     * one was returned.
      */
-    bool SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl *coinControl = NULL, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = true) const;
+    bool SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, const CCoinControl *coinControl = NULL, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = true, const CoinSelectionParams* pParams = NULL, bool* pfBnBUsed = NULL) const;
 
     CWalletDB *pwalletdbEncryption;
 
@@ -809,9 +839,10 @@ public:
      * Shuffle and select coins until nTargetValue is reached while avoiding
      * small change; This method is stochastic for some inputs and upon
      * completion the coin set and corresponding actual target value is
-     * assembled
+     * assembled. With pParams->fUseBnB only a changeless selection is
+     * searched, nTargetValue is then compared to the effective values
      */
-    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = false) const;
+    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, uint64_t nMaxAncestors, std::vector<COutput> vCoins, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, CAmount& nValueRet, AvailableCoinsType nCoinType=ALL_COINS, bool fUseInstantSend = false, const CoinSelectionParams* pParams = NULL) const;
 
     // Coin selection
     bool SelectPSInOutPairsByDenominations(int nDenom, CAmount nValueMin, CAmount nValueMax, std::vector< std::pair<CTxDSIn, CTxOut> >& vecPSInOutPairsRet);